@@ -71,6 +71,25 @@ struct CpuTimings
     float max;
 };
 
+struct PipelineStageTimings
+{
+    std::vector<int> processors;
+    CpuTimings       timings;
+};
+
+/* Loads are in fractions of the audio chunk period. Core loads are for the most loaded
+ * core, before and after adding the plugin, budget is empty if no budget is set */
+struct CpuLoadPrediction
+{
+    int                  core;
+    float                current_load;
+    float                plugin_load;
+    bool                 plugin_known;
+    float                predicted_load;
+    std::optional<float> budget;
+    bool                 within_budget;
+};
+
 enum class PluginType
 {
     INTERNAL,
@@ -233,7 +252,9 @@ enum class NotificationType
     TRACK_UPDATE,
     PROCESSOR_UPDATE,
     PARAMETER_CHANGE,
-    PROPERTY_CHANGE
+    PROPERTY_CHANGE,
+    CORE_STALL_UPDATE,
+    CPU_BUDGET_UPDATE
 };
 
 enum class ProcessorAction
@@ -405,6 +426,8 @@ public:
     virtual std::pair<ControlStatus, CpuTimings>    get_engine_timings() const = 0;
     virtual std::pair<ControlStatus, CpuTimings>    get_track_timings(int track_id) const = 0;
     virtual std::pair<ControlStatus, CpuTimings>    get_processor_timings(int processor_id) const = 0;
+    virtual std::pair<ControlStatus, std::vector<PipelineStageTimings>> get_track_pipeline_timings(int track_id) const = 0;
+    virtual std::pair<ControlStatus, CpuLoadPrediction> get_plugin_load_prediction(const std::string& uid, int track_id) const = 0;
     virtual ControlStatus                           reset_all_timings() = 0;
     virtual ControlStatus                           reset_track_timings(int track_id) = 0;
     virtual ControlStatus                           reset_processor_timings(int processor_id) = 0;
@@ -447,16 +470,24 @@ public:
     virtual ControlStatus set_processor_bypass_state(int processor_id, bool bypass_enabled) = 0;
     virtual ControlStatus set_processor_state(int processor_id, const ProcessorState& state) = 0;
 
-    virtual ControlStatus create_track(const std::string& name, int channels) = 0;
-    virtual ControlStatus create_multibus_track(const std::string& name, int buses) = 0;
-    virtual ControlStatus create_pre_track(const std::string& name) = 0;
-    virtual ControlStatus create_post_track(const std::string& name) = 0;
-    virtual ControlStatus move_processor_on_track(int processor_id, int source_track_id, int dest_track_id, std::optional<int> before_processor_id) = 0;
+    /* Graph edits are made as part of a transaction if given the id returned by
+     * begin_transaction(), and take effect directly otherwise */
+    virtual ControlStatus create_track(const std::string& name, int channels, std::optional<int> transaction_id) = 0;
+    virtual ControlStatus create_multibus_track(const std::string& name, int buses, std::optional<int> transaction_id) = 0;
+    virtual ControlStatus create_pre_track(const std::string& name, std::optional<int> transaction_id) = 0;
+    virtual ControlStatus create_post_track(const std::string& name, std::optional<int> transaction_id) = 0;
+    virtual ControlStatus move_processor_on_track(int processor_id, int source_track_id, int dest_track_id, std::optional<int> before_processor_id,
+                                                  std::optional<int> transaction_id) = 0;
     virtual ControlStatus create_processor_on_track(const std::string& name, const std::string& uid, const std::string& file,
-                                                      PluginType type, int track_id, std::optional<int> before_processor_id) = 0;
-
-    virtual ControlStatus delete_processor_from_track(int processor_id, int track_id) = 0;
-    virtual ControlStatus delete_track(int track_id) = 0;
+                                                      PluginType type, int track_id, std::optional<int> before_processor_id,
+                                                      std::optional<int> transaction_id) = 0;
+
+    virtual ControlStatus delete_processor_from_track(int processor_id, int track_id, std::optional<int> transaction_id) = 0;
+    virtual ControlStatus delete_track(int track_id, std::optional<int> transaction_id) = 0;
+    virtual ControlStatus pin_track_to_core(int track_id, std::optional<int> core) = 0;
+    virtual std::pair<ControlStatus, int> begin_transaction() = 0;
+    virtual ControlStatus commit_transaction(int transaction_id) = 0;
+    virtual ControlStatus abort_transaction(int transaction_id) = 0;
 
 protected:
     AudioGraphController() = default;
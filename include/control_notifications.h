@@ -31,14 +31,67 @@ private:
 class CpuTimingNotification : public ControlNotification
 {
 public:
-    CpuTimingNotification(CpuTimings timings, Time timestamp)
+    CpuTimingNotification(CpuTimings timings, Time timestamp, int shed_tracks = 0)
             : ControlNotification(NotificationType::CPU_TIMING_UPDATE, timestamp),
-              _cpu_timings(timings) {}
+              _cpu_timings(timings),
+              _shed_tracks(shed_tracks) {}
 
     CpuTimings cpu_timings() const {return _cpu_timings;}
 
+    /* The number of tracks not rendered because the engine is overloaded */
+    int shed_tracks() const {return _shed_tracks;}
+
 private:
     CpuTimings _cpu_timings;
+    int _shed_tracks;
+};
+
+class CoreStallNotification : public ControlNotification
+{
+public:
+    CoreStallNotification(int core, int track_id, int processor_id, bool stalled, Time timestamp)
+            : ControlNotification(NotificationType::CORE_STALL_UPDATE, timestamp),
+              _core(core),
+              _track_id(track_id),
+              _processor_id(processor_id),
+              _stalled(stalled) {}
+
+    int core() const {return _core;}
+    int track_id() const {return _track_id;}
+    /* The processor the core hung in, or the track if it was not inside a processor */
+    int processor_id() const {return _processor_id;}
+    /* false when the core has recovered */
+    bool stalled() const {return _stalled;}
+
+private:
+    int  _core;
+    int  _track_id;
+    int  _processor_id;
+    bool _stalled;
+};
+
+class CpuBudgetNotification : public ControlNotification
+{
+public:
+    CpuBudgetNotification(int processor_id, int track_id, CpuLoadPrediction prediction, bool rejected, Time timestamp)
+            : ControlNotification(NotificationType::CPU_BUDGET_UPDATE, timestamp),
+              _processor_id(processor_id),
+              _track_id(track_id),
+              _prediction(prediction),
+              _rejected(rejected) {}
+
+    int processor_id() const {return _processor_id;}
+    int track_id() const {return _track_id;}
+    /* The prediction that exceeded the budget */
+    CpuLoadPrediction prediction() const {return _prediction;}
+    /* false if the plugin was added anyway, as the budget is only warned about */
+    bool rejected() const {return _rejected;}
+
+private:
+    int               _processor_id;
+    int               _track_id;
+    CpuLoadPrediction _prediction;
+    bool              _rejected;
 };
 
 class TrackNotification : public ControlNotification
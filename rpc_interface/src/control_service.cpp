@@ -1104,7 +1104,7 @@ grpc::Status AudioGraphControlService::CreateTrack(grpc::ServerContext* /*contex
                                                    const sushi_rpc::CreateTrackRequest* request,
                                                    sushi_rpc::GenericVoidValue* /*response*/)
 {
-    auto status = _controller->create_track(request->name(), request->channels());
+    auto status = _controller->create_track(request->name(), request->channels(), std::nullopt);
     return to_grpc_status(status);
 }
 
@@ -1112,7 +1112,7 @@ grpc::Status AudioGraphControlService::CreateMultibusTrack(grpc::ServerContext*
                                                            const sushi_rpc::CreateMultibusTrackRequest* request,
                                                            sushi_rpc::GenericVoidValue* /*response*/)
 {
-    auto status = _controller->create_multibus_track(request->name(), request->buses());
+    auto status = _controller->create_multibus_track(request->name(), request->buses(), std::nullopt);
     return to_grpc_status(status);
 }
 
@@ -1120,7 +1120,7 @@ grpc::Status AudioGraphControlService::CreatePreTrack(grpc::ServerContext* /*con
                                                       const sushi_rpc::CreatePreTrackRequest* request,
                                                       sushi_rpc::GenericVoidValue* /*response*/)
 {
-    auto status = _controller->create_pre_track(request->name());
+    auto status = _controller->create_pre_track(request->name(), std::nullopt);
     return to_grpc_status(status);
 }
 
@@ -1128,7 +1128,7 @@ grpc::Status AudioGraphControlService::CreatePostTrack(grpc::ServerContext* /*co
                                                        const sushi_rpc::CreatePostTrackRequest* request,
                                                        sushi_rpc::GenericVoidValue* /*response*/)
 {
-    auto status = _controller->create_post_track(request->name());
+    auto status = _controller->create_post_track(request->name(), std::nullopt);
     return to_grpc_status(status);
 }
 
@@ -1136,7 +1136,7 @@ grpc::Status AudioGraphControlService::DeleteTrack(grpc::ServerContext* /*contex
                                                    const sushi_rpc::TrackIdentifier* request,
                                                    sushi_rpc::GenericVoidValue* /*response*/)
 {
-    auto status = _controller->delete_track(request->id());
+    auto status = _controller->delete_track(request->id(), std::nullopt);
     return to_grpc_status(status);
 }
 
@@ -1154,7 +1154,8 @@ grpc::Status AudioGraphControlService::CreateProcessorOnTrack(grpc::ServerContex
                                                          request->path(),
                                                          to_sushi_ext(request->type().type()),
                                                          request->track().id(),
-                                                         before_processor);
+                                                         before_processor,
+                                                         std::nullopt);
     return to_grpc_status(status);
 }
 
@@ -1169,7 +1170,8 @@ grpc::Status AudioGraphControlService::MoveProcessorOnTrack(grpc::ServerContext*
     auto status = _controller->move_processor_on_track(request->processor().id(),
                                                        request->source_track().id(),
                                                        request->dest_track().id(),
-                                                       before_processor);
+                                                       before_processor,
+                                                       std::nullopt);
     return to_grpc_status(status);
 
 }
@@ -1179,7 +1181,8 @@ grpc::Status AudioGraphControlService::DeleteProcessorFromTrack(grpc::ServerCont
                                                                 sushi_rpc::GenericVoidValue* /*response*/)
 {
     auto status = _controller->delete_processor_from_track(request->processor().id(),
-                                                           request->track().id());
+                                                           request->track().id(),
+                                                           std::nullopt);
     return to_grpc_status(status);
 }
 
@@ -18,6 +18,7 @@
 * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
 */
 
+#include <algorithm>
 #include <cmath>
 #include <cstring>
 #include <random>
@@ -238,12 +239,14 @@ void OfflineFrontend::_run_blocking()
 
         _buffer.clear();
 
+        /* The last chunk of the file may be partial, only copy the samples that were read */
         if (_mono)
         {
-            std::copy(file_buffer, file_buffer + AUDIO_CHUNK_SIZE, _buffer.channel(0));
+            std::copy(file_buffer, file_buffer + readcount, _buffer.channel(0));
         }
         else
         {
+            std::fill(file_buffer + readcount * OFFLINE_FRONTEND_CHANNELS, file_buffer + OFFLINE_FRONTEND_CHANNELS * AUDIO_CHUNK_SIZE, 0.0f);
             auto buffer = ChunkSampleBuffer::create_non_owning_buffer(_buffer, 0, 2);
             buffer.from_interleaved(file_buffer);
         }
@@ -252,7 +255,7 @@ void OfflineFrontend::_run_blocking()
 
         if (_mono)
         {
-            std::copy(_buffer.channel(0), _buffer.channel(0) + AUDIO_CHUNK_SIZE, file_buffer );
+            std::copy(_buffer.channel(0), _buffer.channel(0) + readcount, file_buffer);
         }
         else
         {
@@ -0,0 +1,191 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Runs a processor, or a stage of consecutive processors from a track's chain, in a
+ *        dedicated realtime thread, in parallel with the rest of its track, at the cost of
+ *        one chunk of added latency.
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#include <algorithm>
+#include <cassert>
+
+#include "twine/src/twine_internal.h"
+
+#include "async_processor_host.h"
+
+namespace sushi {
+namespace engine {
+
+constexpr bool DISABLE_DENORMALS = true;
+
+AsyncProcessorHost::AsyncProcessorHost(Processor* processor,
+                                       performance::PerformanceTimer* timer,
+                                       bool debug_mode_switches) : AsyncProcessorHost(std::vector<Processor*>{processor},
+                                                                                      timer,
+                                                                                      debug_mode_switches)
+{}
+
+AsyncProcessorHost::AsyncProcessorHost(std::vector<Processor*> processors,
+                                       performance::PerformanceTimer* timer,
+                                       bool debug_mode_switches) : _processors(std::move(processors)),
+                                                                   _timing_id(ProcessorIdGenerator::new_id()),
+                                                                   _timer(timer),
+                                                                   _input_buffer(MAX_TRACK_CHANNELS),
+                                                                   _output_buffer(MAX_TRACK_CHANNELS)
+{
+    assert(_processors.empty() == false);
+    _worker = twine::WorkerPool::create_worker_pool(1, DISABLE_DENORMALS, debug_mode_switches);
+    _worker->add_worker(_worker_callback, this);
+}
+
+AsyncProcessorHost::~AsyncProcessorHost()
+{
+    if (_processing)
+    {
+        _worker->wait_for_workers_idle();
+    }
+}
+
+void AsyncProcessorHost::process(const ChunkSampleBuffer& in, ChunkSampleBuffer& out)
+{
+    wait_for_processing();
+    // Pass on events the first processor output while receiving keyboard events from the track
+    _pass_on_events(_processors.size() > 1 ? _processors[1] : nullptr);
+    _forward_output_events();
+
+    auto previous_output = ChunkSampleBuffer::create_non_owning_buffer(_output_buffer, 0, out.channel_count());
+    out.replace(previous_output);
+
+    _input_channels = in.channel_count();
+    _output_channels = out.channel_count();
+    auto input = ChunkSampleBuffer::create_non_owning_buffer(_input_buffer, 0, _input_channels);
+    input.replace(in);
+
+    _processing = true;
+    _worker->wakeup_workers();
+}
+
+void AsyncProcessorHost::wait_for_processing()
+{
+    if (_processing)
+    {
+        _worker->wait_for_workers_idle();
+        _processing = false;
+    }
+}
+
+void AsyncProcessorHost::forward_events()
+{
+    _forward_output_events();
+    RtEvent event;
+    while (_event_buffer.pop(event))
+    {
+        if (_output_pipe)
+        {
+            _output_pipe->send_event(event);
+        }
+    }
+}
+
+void AsyncProcessorHost::send_event(const RtEvent& event)
+{
+    _event_buffer.push(event);
+}
+
+void AsyncProcessorHost::_worker_callback(void* data)
+{
+    /* Signal that this is a realtime audio processing thread */
+    twine::ThreadRtFlag rt_flag;
+
+    reinterpret_cast<AsyncProcessorHost*>(data)->_process();
+}
+
+void AsyncProcessorHost::_process()
+{
+    auto stage_timestamp = _timer->start_timer();
+
+    /* The input buffer is only read by the first processor, after that it is used as
+     * an intermediate buffer, swapped with the output buffer between processors */
+    int channels = std::max(_input_channels, _output_channels);
+    auto aliased_in = ChunkSampleBuffer::create_non_owning_buffer(_input_buffer, 0, channels);
+    auto aliased_out = ChunkSampleBuffer::create_non_owning_buffer(_output_buffer, 0, channels);
+    int stage_length = static_cast<int>(_processors.size());
+
+    for (int i = 0; i < stage_length; ++i)
+    {
+        auto processor = _processors[i];
+        auto timestamp = _timer->start_timer();
+
+        auto proc_in = ChunkSampleBuffer::create_non_owning_buffer(aliased_in, 0, processor->input_channels());
+        auto proc_out = ChunkSampleBuffer::create_non_owning_buffer(aliased_out, 0, processor->output_channels());
+        processor->process_audio(proc_in, proc_out);
+
+        int unused_channels = channels - processor->output_channels();
+        if (unused_channels > 0)
+        {
+            auto unused = ChunkSampleBuffer::create_non_owning_buffer(aliased_out, processor->output_channels(), unused_channels);
+            unused.clear();
+        }
+        swap(aliased_in, aliased_out);
+        _pass_on_events(i + 1 < stage_length ? _processors[i + 1] : nullptr);
+
+        _timer->stop_timer_rt_safe(timestamp, static_cast<int>(processor->id()));
+    }
+
+    /* aliased_in now points to the output of the last processor */
+    if (aliased_in.channel(0) != _output_buffer.channel(0))
+    {
+        auto output = ChunkSampleBuffer::create_non_owning_buffer(_output_buffer, 0, _output_channels);
+        output.replace(ChunkSampleBuffer::create_non_owning_buffer(aliased_in, 0, _output_channels));
+    }
+
+    _timer->stop_timer_rt_safe(stage_timestamp, static_cast<int>(_timing_id));
+}
+
+void AsyncProcessorHost::_forward_output_events()
+{
+    RtEvent event;
+    while (_output_events.pop(event))
+    {
+        if (_output_pipe)
+        {
+            _output_pipe->send_event(event);
+        }
+    }
+}
+
+void AsyncProcessorHost::_pass_on_events(Processor* next)
+{
+    /* Keyboard events are passed on to the next processor in the stage, like a track
+     * does. Note that the next processor may put events back into the queue, hence only
+     * the events already in it are handled */
+    for (int events = _event_buffer.size(); events > 0; --events)
+    {
+        RtEvent event = _event_buffer.pop();
+        if (next && is_keyboard_event(event))
+        {
+            next->process_event(event);
+        }
+        else
+        {
+            _output_events.push(event);
+        }
+    }
+}
+
+} // namespace engine
+} // namespace sushi
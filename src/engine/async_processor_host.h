@@ -0,0 +1,216 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Runs a processor, or a stage of consecutive processors from a track's chain, in a
+ *        dedicated realtime thread, in parallel with the rest of its track, at the cost of
+ *        one chunk of added latency.
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_ASYNC_PROCESSOR_HOST_H
+#define SUSHI_ASYNC_PROCESSOR_HOST_H
+
+#include <cassert>
+#include <memory>
+#include <vector>
+
+#include "twine/twine.h"
+
+#include "library/processor.h"
+#include "library/rt_event_fifo.h"
+#include "library/rt_event_pipe.h"
+#include "library/sample_buffer.h"
+#include "library/performance_timer.h"
+
+namespace sushi {
+namespace engine {
+
+class AsyncProcessorHost : public RtEventPipe
+{
+public:
+    SUSHI_DECLARE_NON_COPYABLE(AsyncProcessorHost);
+
+    /**
+     * @brief Create a host for a processor. Starts a realtime worker thread, so must
+     *        not be called from the rt thread.
+     * @param processor The processor to host, not owned by the host
+     * @param timer A timer object used to record the processing time of the processor
+     * @param debug_mode_switches Enable xenomai-specific thread debugging
+     */
+    AsyncProcessorHost(Processor* processor, performance::PerformanceTimer* timer, bool debug_mode_switches = false);
+
+    /**
+     * @brief Create a host for a stage of processors that are processed in sequence,
+     *        keyboard events output by one processor are passed on to the next one.
+     *        Starts a realtime worker thread, so must not be called from the rt thread.
+     * @param processors The processors of the stage, in processing order, not owned
+     *                   by the host. Must not be empty.
+     * @param timer A timer object used to record the processing time of the processors
+     *              and of the stage as a whole
+     * @param debug_mode_switches Enable xenomai-specific thread debugging
+     */
+    AsyncProcessorHost(std::vector<Processor*> processors, performance::PerformanceTimer* timer, bool debug_mode_switches = false);
+
+    ~AsyncProcessorHost();
+
+    /**
+     * @brief The latency, in samples, added by processing asynchronously
+     * @return The latency in samples
+     */
+    static constexpr int latency()
+    {
+        return AUDIO_CHUNK_SIZE;
+    }
+
+    /**
+     * @brief Return the processor being hosted, or the first processor of the stage
+     * @return A pointer to the processor
+     */
+    Processor* processor() const
+    {
+        return _processors.front();
+    }
+
+    /**
+     * @brief Return all processors of the stage, in processing order
+     * @return A list of processors
+     */
+    const std::vector<Processor*>& processors() const
+    {
+        return _processors;
+    }
+
+    /**
+     * @brief Give the host a new stage of processors, to take over from its current ones
+     *        when it is next added to a track with Track::set_pipeline(). Lets the host, and
+     *        its worker thread, be reused when the chain of a track is split differently.
+     *        Must not be called from the rt thread, nor concurrently with Track::set_pipeline().
+     * @param processors The processors of the new stage, in processing order. Must not be empty.
+     */
+    void set_next_processors(std::vector<Processor*> processors)
+    {
+        assert(processors.empty() == false);
+        _next_processors = std::move(processors);
+        _has_next_processors = true;
+    }
+
+    /**
+     * @brief Return the processors the host will have once added to a track, i.e. the ones
+     *        given to set_next_processors() if any, otherwise the current ones
+     * @return A list of processors
+     */
+    const std::vector<Processor*>& next_processors() const
+    {
+        return _has_next_processors ? _next_processors : _processors;
+    }
+
+    /**
+     * @brief Take over the processors given to set_next_processors(), if any. Called from the
+     *        rt thread, when the host is not on a track and not processing. Does not
+     *        allocate, the previous processors are kept until set_next_processors() is
+     *        called again.
+     */
+    void apply_next_processors()
+    {
+        if (_has_next_processors)
+        {
+            assert(_processing == false);
+            _processors.swap(_next_processors);
+            _has_next_processors = false;
+        }
+    }
+
+    /**
+     * @brief The id under which the processing time of the whole stage is recorded
+     *        in the performance timer
+     * @return An id unique among processors and hosts
+     */
+    ObjectId timing_id() const
+    {
+        return _timing_id;
+    }
+
+    /**
+     * @brief Set the pipe to pass events output by the processor to. Events are passed
+     *        on from the rt thread in process() or forward_events()
+     * @param output_pipe The event pipe to pass events to
+     */
+    void set_event_output(RtEventPipe* output_pipe)
+    {
+        _output_pipe = output_pipe;
+    }
+
+    /**
+     * @brief Start processing the given input in the worker thread and return the output
+     *        from processing the previous chunk. Events output during the previous chunk
+     *        are passed on before returning. Called from the rt thread in place of calling
+     *        process_audio() on the processor.
+     * @param in The input audio for this chunk, with the channels of the first processor
+     * @param out Filled with the output from the previous chunk, with the channels of
+     *            the last processor
+     */
+    void process(const ChunkSampleBuffer& in, ChunkSampleBuffer& out);
+
+    /**
+     * @brief Wait for the worker thread to finish processing, if running. Must be called
+     *        from the rt thread before any events are passed to the processor or any of
+     *        its state is touched.
+     */
+    void wait_for_processing();
+
+    /**
+     * @brief Pass on all events output by the processors to the output pipe. Called from
+     *        the rt thread when the host is idle.
+     */
+    void forward_events();
+
+    /* Inherited from RtEventPipe, never called concurrently from the worker and the rt thread */
+    void send_event(const RtEvent& event) override;
+
+private:
+    static void _worker_callback(void* data);
+
+    void _process();
+
+    void _forward_output_events();
+
+    void _pass_on_events(Processor* next);
+
+    std::vector<Processor*>            _processors;
+    std::vector<Processor*>            _next_processors;
+    bool                               _has_next_processors{false};
+    ObjectId                           _timing_id;
+    performance::PerformanceTimer*     _timer;
+    RtEventPipe*                       _output_pipe{nullptr};
+    std::unique_ptr<twine::WorkerPool> _worker;
+
+    ChunkSampleBuffer _input_buffer;
+    ChunkSampleBuffer _output_buffer;
+    int               _input_channels{0};
+    int               _output_channels{0};
+    bool              _processing{false};
+
+    /* Events output by the processors, written to from both the rt thread and the worker,
+     * but never concurrently */
+    RtEventFifo<>     _event_buffer;
+    /* Events to pass on to the output pipe, written to by the worker only */
+    RtEventFifo<>     _output_events;
+};
+
+} // namespace engine
+} // namespace sushi
+
+#endif //SUSHI_ASYNC_PROCESSOR_HOST_H
@@ -18,6 +18,8 @@
  * @copyright 2017-2022 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
  */
 
+#include <algorithm>
+#include <cmath>
 #include <fstream>
 #include <iomanip>
 #include <functional>
@@ -36,9 +38,14 @@ constexpr auto CLIPPING_DETECTION_INTERVAL = std::chrono::milliseconds(500);
 constexpr auto RT_EVENT_TIMEOUT = std::chrono::milliseconds(200);
 constexpr char TIMING_FILE_NAME[] = "timings.txt";
 constexpr int  TIMING_LOG_PRINT_INTERVAL = 15;
-
-constexpr int  MAX_TRACKS = 32;
-constexpr int  MAX_AUDIO_CONNECTIONS = MAX_TRACKS * MAX_TRACK_CHANNELS;
+constexpr int  MAX_PIPELINE_STAGES = 8;
+constexpr int  MAX_RENDER_AHEAD_CHUNKS = 64;
+constexpr int  MAX_COMPENSATION_DELAY = 65536;
+/* Only split a pipelined track again if it lowers the load of the most loaded stage by at least this much */
+constexpr float PIPELINE_SPLIT_THRESHOLD = 0.05f;
+
+constexpr int  INITIAL_TRACK_CAPACITY = 32;
+constexpr int  INITIAL_AUDIO_CONNECTION_CAPACITY = INITIAL_TRACK_CAPACITY * MAX_TRACK_CHANNELS;
 constexpr int  MAX_CV_CONNECTIONS = MAX_ENGINE_CV_IO_PORTS * 10;
 constexpr int  MAX_GATE_CONNECTIONS = MAX_ENGINE_GATE_PORTS * 10;
 
@@ -94,12 +101,17 @@ void ClipDetector::detect_clipped_samples(const ChunkSampleBuffer& buffer, RtSaf
 AudioEngine::AudioEngine(float sample_rate,
                          int rt_cpu_cores,
                          bool debug_mode_sw,
-                         dispatcher::BaseEventDispatcher* event_dispatcher) : BaseEngine::BaseEngine(sample_rate),
-                                                          _audio_graph(rt_cpu_cores, MAX_TRACKS, debug_mode_sw),
-                                                          _audio_in_connections(MAX_AUDIO_CONNECTIONS),
-                                                          _audio_out_connections(MAX_AUDIO_CONNECTIONS),
-                                                          _transport(sample_rate, &_main_out_queue),
-                                                          _clip_detector(sample_rate)
+                         dispatcher::BaseEventDispatcher* event_dispatcher,
+                         TrackScheduling scheduling,
+                         int worker_priority) : BaseEngine::BaseEngine(sample_rate),
+                                                _audio_graph(rt_cpu_cores, INITIAL_TRACK_CAPACITY, debug_mode_sw,
+                                                             scheduling, worker_priority),
+                                                _track_balancer(rt_cpu_cores),
+                                                _audio_in_connections(INITIAL_AUDIO_CONNECTION_CAPACITY),
+                                                _audio_out_connections(INITIAL_AUDIO_CONNECTION_CAPACITY),
+                                                _audio_routing(INITIAL_AUDIO_CONNECTION_CAPACITY),
+                                                _transport(sample_rate, &_main_out_queue),
+                                                _clip_detector(sample_rate)
 {
     if (event_dispatcher == nullptr)
     {
@@ -112,6 +124,7 @@ AudioEngine::AudioEngine(float sample_rate,
     _host_control = HostControl(_event_dispatcher.get(), &_transport, &_plugin_library);
 
     this->set_sample_rate(sample_rate);
+    _reported_stalls.resize(rt_cpu_cores, false);
     _cv_in_connections.reserve(MAX_CV_CONNECTIONS);
     _gate_in_connections.reserve(MAX_GATE_CONNECTIONS);
 }
@@ -124,6 +137,10 @@ AudioEngine::~AudioEngine()
         _process_timer.enable(false);
         print_timings_to_file(TIMING_FILE_NAME);
     }
+    if (_plugin_cost_file.empty() == false)
+    {
+        _plugin_costs.save(_plugin_cost_file);
+    }
 }
 
 void AudioEngine::set_sample_rate(float sample_rate)
@@ -136,6 +153,7 @@ void AudioEngine::set_sample_rate(float sample_rate)
     _transport.set_sample_rate(sample_rate);
     _process_timer.set_timing_period(sample_rate, AUDIO_CHUNK_SIZE);
     _clip_detector.set_sample_rate(sample_rate);
+    set_worker_watchdog(_watchdog_periods);
     for (auto& limiter : _master_limiters)
     {
         limiter.init(sample_rate);
@@ -372,6 +390,11 @@ EngineReturnStatus AudioEngine::_register_processor(std::shared_ptr<Processor> p
         SUSHI_LOG_WARNING("Processor with this name already exists");
         return EngineReturnStatus::INVALID_PROCESSOR;
     }
+    if (_resize_realtime_processors() == false)
+    {
+        _processors.remove_processor(processor->id());
+        return EngineReturnStatus::ERROR;
+    }
     SUSHI_LOG_DEBUG("Successfully registered processor {}.", name);
     return EngineReturnStatus::OK;
 }
@@ -381,34 +404,118 @@ void AudioEngine::_deregister_processor(Processor* processor)
     assert(processor);
     assert(processor->active_rt_processing() == false);
     _processors.remove_processor(processor->id());
+    _resize_realtime_processors();
     SUSHI_LOG_INFO("Successfully de-registered processor {}", processor->name());
 }
 
 bool AudioEngine::_insert_processor_in_realtime_part(Processor* processor)
 {
-    if (processor->id() > _realtime_processors.size())
-    {
-        /* TODO - When non-rt callbacks for events are ready we can have the
-         * rt processor list re-allocated outside the rt domain
-         * In the meantime, put a limit on the number of processors */
-        SUSHI_LOG_ERROR("Realtime processor list full");
-        assert(false);
-    }
-    if (_realtime_processors[processor->id()] != nullptr)
+    if (_realtime_processors.insert(processor) == false)
     {
+        SUSHI_LOG_ERROR_IF(_realtime_processors.size() >= _realtime_processors.max_size(), "Realtime processor table full");
         return false;
     }
-    _realtime_processors[processor->id()] = processor;
     return true;
 }
 
 bool AudioEngine::_remove_processor_from_realtime_part(ObjectId processor)
 {
-    if (_realtime_processors[processor] == nullptr)
+    return _realtime_processors.remove(processor);
+}
+
+bool AudioEngine::_resize_realtime_processors()
+{
+    int processors = static_cast<int>(_processors.all_processors().size());
+    int capacity = _realtime_processors.capacity();
+    bool full = processors > _realtime_processors.max_size();
+    /* Processors removed in an open transaction are still in the rt table, so it can't
+     * shrink until the transaction is committed */
+    bool sparse = _transaction_open.load(std::memory_order_acquire) == false && capacity > ProcessorTable::MIN_CAPACITY && processors < capacity / 8;
+    if (full == false && sparse == false)
+    {
+        return true;
+    }
+    auto swap = std::make_unique<StorageSwap>();
+    swap->add(&_realtime_processors, ProcessorTable(ProcessorTable::capacity_for(processors)));
+    if (_swap_storage(std::move(swap)) == false)
     {
+        SUSHI_LOG_ERROR("Failed to resize realtime processor table for {} processors", processors);
         return false;
     }
-    _realtime_processors[processor] = nullptr;
+    return true;
+}
+
+bool AudioEngine::_reserve_track_processor(Track* track)
+{
+    int processors = static_cast<int>(_processors.processors_on_track(track->id()).size());
+    if (processors < track->processor_capacity())
+    {
+        return true;
+    }
+    auto swap = std::make_unique<StorageSwap>();
+    track->grow(*swap, 2 * track->processor_capacity());
+    return _swap_storage(std::move(swap));
+}
+
+bool AudioEngine::_reserve_graph_track()
+{
+    int tracks = static_cast<int>(_processors.all_tracks().size());
+    if (tracks < _audio_graph.max_tracks())
+    {
+        return true;
+    }
+    auto swap = std::make_unique<StorageSwap>();
+    _audio_graph.grow(*swap, 2 * _audio_graph.max_tracks());
+    return _swap_storage(std::move(swap));
+}
+
+bool AudioEngine::_reserve_graph_dependencies()
+{
+    // All processors, including tracks, can add at most one dependency: a send or a group
+    int dependencies = static_cast<int>(_processors.all_processors().size()) + 1;
+    if (dependencies <= _audio_graph.max_dependencies())
+    {
+        return true;
+    }
+    auto swap = std::make_unique<StorageSwap>();
+    _audio_graph.grow_dependencies(*swap, 2 * dependencies);
+    return _swap_storage(std::move(swap));
+}
+
+bool AudioEngine::_reserve_audio_connection()
+{
+    auto connections = std::max(_audio_in_connections.connections().size(), _audio_out_connections.connections().size());
+    auto capacity = std::min(_audio_in_connections.capacity(), _audio_out_connections.capacity());
+    if (connections < capacity)
+    {
+        return true;
+    }
+    auto swap = std::make_unique<StorageSwap>();
+    _audio_in_connections.grow(*swap, 2 * capacity);
+    _audio_out_connections.grow(*swap, 2 * capacity);
+    _audio_routing.grow(*swap, static_cast<int>(2 * capacity));
+    return _swap_storage(std::move(swap));
+}
+
+bool AudioEngine::_swap_storage(std::unique_ptr<StorageSwap> swap)
+{
+    if (realtime())
+    {
+        auto event = RtEvent::make_storage_swap_event(swap.get());
+        _send_control_event(event);
+        if (_event_receiver.wait_for_response(event.returnable_event()->event_id(), RT_EVENT_TIMEOUT) == false)
+        {
+            // The rt thread could still swap it in at a later point, so it must not be freed
+            SUSHI_LOG_ERROR("Failed to swap in reallocated rt storage");
+            [[maybe_unused]] auto unreleased = swap.release();
+            return false;
+        }
+    }
+    else
+    {
+        swap->swap_rt();
+    }
+    // swap now holds the previous storage, which is freed when it goes out of scope
     return true;
 }
 
@@ -442,6 +549,7 @@ void AudioEngine::process_chunk(SampleBuffer<AUDIO_CHUNK_SIZE>* in_buffer,
 
     auto engine_timestamp = _process_timer.start_timer();
 
+    _wait_for_async_processing();
     _transport.set_time(timestamp, sample_count);
 
     _process_internal_rt_events();
@@ -472,6 +580,7 @@ void AudioEngine::process_chunk(SampleBuffer<AUDIO_CHUNK_SIZE>* in_buffer,
 
     // Render all tracks. If running in multicore mode, this part is processed in parallel.
     _audio_graph.render();
+    _report_stalled_cores();
 
     _retrieve_events_from_tracks(*out_controls);
     _main_out_queue.push(RtEvent::make_synchronisation_event(_transport.current_process_time()));
@@ -501,6 +610,7 @@ void AudioEngine::process_chunk(SampleBuffer<AUDIO_CHUNK_SIZE>* in_buffer,
     {
         _clip_detector.detect_clipped_samples(*out_buffer, _main_out_queue, false);
     }
+    _update_overload_shedding(engine_timestamp);
     _process_timer.stop_timer(engine_timestamp, ENGINE_TIMING_ID);
 }
 
@@ -611,6 +721,285 @@ std::pair<EngineReturnStatus, ObjectId> AudioEngine::create_pre_track(const std:
     return _create_master_track(name, TrackType::PRE, _audio_inputs);
 }
 
+EngineReturnStatus AudioEngine::pin_track_to_core(ObjectId track_id, std::optional<int> core)
+{
+    auto track = _processors.mutable_track(track_id);
+    if (track == nullptr || track->type() != TrackType::REGULAR)
+    {
+        SUSHI_LOG_ERROR("Couldn't pin track {}, not found", track_id);
+        return EngineReturnStatus::INVALID_TRACK;
+    }
+    if (_track_balancer.pin_track(track_id, core) == false)
+    {
+        SUSHI_LOG_ERROR("Couldn't pin track {} to core {}, only {} cores used", track_id, core.value(), _audio_graph.cores());
+        return EngineReturnStatus::ERROR;
+    }
+    if (core.has_value() && _move_track_to_core(track.get(), core.value()) == false)
+    {
+        SUSHI_LOG_ERROR("Failed to move track {} to core {}", track->name(), core.value());
+        return EngineReturnStatus::ERROR;
+    }
+    return EngineReturnStatus::OK;
+}
+
+EngineReturnStatus AudioEngine::set_track_priority(ObjectId track_id, int priority)
+{
+    auto track = _processors.mutable_track(track_id);
+    if (track == nullptr || track->type() != TrackType::REGULAR)
+    {
+        SUSHI_LOG_ERROR("Couldn't set priority of track {}, not found", track_id);
+        return EngineReturnStatus::INVALID_TRACK;
+    }
+    track->set_priority(priority);
+    return EngineReturnStatus::OK;
+}
+
+EngineReturnStatus AudioEngine::connect_track_to_group(ObjectId track_id, ObjectId group_id)
+{
+    auto track = _processors.mutable_track(track_id);
+    auto group = _processors.mutable_track(group_id);
+    if (track == nullptr || group == nullptr || track == group ||
+        track->type() != TrackType::REGULAR || group->type() != TrackType::REGULAR)
+    {
+        SUSHI_LOG_ERROR("Couldn't connect track {} to group {}, not found", track_id, group_id);
+        return EngineReturnStatus::INVALID_TRACK;
+    }
+    for (auto parent = group.get(); parent != nullptr; parent = parent->output_group())
+    {
+        if (parent == track.get())
+        {
+            SUSHI_LOG_ERROR("Couldn't connect track {} to group {}, group is routed to the track", track_id, group_id);
+            return EngineReturnStatus::ERROR;
+        }
+    }
+    // The audio graph picks up the change on the next render, no rt event is needed
+    track->set_output_group(group.get());
+    _update_latency_compensation();
+    return EngineReturnStatus::OK;
+}
+
+EngineReturnStatus AudioEngine::disconnect_track_from_group(ObjectId track_id)
+{
+    auto track = _processors.mutable_track(track_id);
+    if (track == nullptr)
+    {
+        SUSHI_LOG_ERROR("Couldn't disconnect track {} from group, not found", track_id);
+        return EngineReturnStatus::INVALID_TRACK;
+    }
+    track->set_output_group(nullptr);
+    _update_latency_compensation();
+    return EngineReturnStatus::OK;
+}
+
+EngineReturnStatus AudioEngine::freeze_track(ObjectId track_id, Time duration)
+{
+    auto track = _processors.mutable_track(track_id);
+    if (track == nullptr || track->type() != TrackType::REGULAR)
+    {
+        SUSHI_LOG_ERROR("Couldn't freeze track {}, not found", track_id);
+        return EngineReturnStatus::INVALID_TRACK;
+    }
+    auto samples = std::chrono::duration<double>(duration).count() * _sample_rate;
+    int chunks = static_cast<int>(std::ceil(samples / AUDIO_CHUNK_SIZE));
+    if (chunks <= 0 || track->frozen() || _in_transaction())
+    {
+        SUSHI_LOG_ERROR("Couldn't freeze track {}, already frozen, empty duration or open graph transaction", track->name());
+        return EngineReturnStatus::ERROR;
+    }
+    if (_is_rendered_ahead(track_id))
+    {
+        SUSHI_LOG_ERROR("Couldn't freeze track {}, it is rendered ahead", track->name());
+        return EngineReturnStatus::ALREADY_IN_USE;
+    }
+
+    if (_set_track_offline(track.get(), true) == false)
+    {
+        SUSHI_LOG_ERROR("Failed to take track {} out of processing", track->name());
+        return EngineReturnStatus::ERROR;
+    }
+    bool frozen = track->freeze(chunks);
+    SUSHI_LOG_ERROR_IF(frozen == false, "Couldn't freeze track {}, it has asynchronously processed plugins or rendered only silence", track->name());
+    if (_set_track_offline(track.get(), false) == false)
+    {
+        SUSHI_LOG_ERROR("Failed to return track {} to processing", track->name());
+        return EngineReturnStatus::ERROR;
+    }
+    if (frozen == false)
+    {
+        return EngineReturnStatus::ERROR;
+    }
+    SUSHI_LOG_INFO("Froze track {}, {} chunks of audio", track->name(), chunks);
+    _update_latency_compensation();
+    return EngineReturnStatus::OK;
+}
+
+EngineReturnStatus AudioEngine::unfreeze_track(ObjectId track_id)
+{
+    auto track = _processors.mutable_track(track_id);
+    if (track == nullptr || track->type() != TrackType::REGULAR)
+    {
+        SUSHI_LOG_ERROR("Couldn't unfreeze track {}, not found", track_id);
+        return EngineReturnStatus::INVALID_TRACK;
+    }
+    if (track->frozen() == false)
+    {
+        return EngineReturnStatus::OK;
+    }
+    if (_in_transaction() || _set_track_offline(track.get(), true) == false)
+    {
+        SUSHI_LOG_ERROR("Failed to take track {} out of processing", track->name());
+        return EngineReturnStatus::ERROR;
+    }
+    track->unfreeze();
+    if (_set_track_offline(track.get(), false) == false)
+    {
+        SUSHI_LOG_ERROR("Failed to return track {} to processing", track->name());
+        return EngineReturnStatus::ERROR;
+    }
+    _update_latency_compensation();
+    return EngineReturnStatus::OK;
+}
+
+EngineReturnStatus AudioEngine::set_track_render_ahead(ObjectId track_id, int chunks)
+{
+    auto track = _processors.mutable_track(track_id);
+    if (track == nullptr || track->type() != TrackType::REGULAR)
+    {
+        SUSHI_LOG_ERROR("Couldn't set render ahead of track {}, not found", track_id);
+        return EngineReturnStatus::INVALID_TRACK;
+    }
+    if (chunks < 0 || chunks > MAX_RENDER_AHEAD_CHUNKS)
+    {
+        SUSHI_LOG_ERROR("Invalid number of chunks to render ahead: {}", chunks);
+        return EngineReturnStatus::ERROR;
+    }
+    auto current = _render_ahead_hosts.find(track_id);
+    bool enabled = current != _render_ahead_hosts.end();
+    if (chunks == 0 && enabled == false)
+    {
+        return EngineReturnStatus::OK;
+    }
+    if (_in_transaction() || track->frozen())
+    {
+        SUSHI_LOG_ERROR("Couldn't set render ahead of track {}, frozen or open graph transaction", track->name());
+        return EngineReturnStatus::ERROR;
+    }
+    if (enabled == false && _has_live_input(track.get()))
+    {
+        SUSHI_LOG_ERROR("Couldn't render track {} ahead, it has live audio input", track->name());
+        return EngineReturnStatus::ERROR;
+    }
+
+    std::vector<Processor*> processors;
+    for (const auto& processor : _processors.processors_on_track(track_id))
+    {
+        if (_async_hosts.count(processor->id()) > 0)
+        {
+            SUSHI_LOG_ERROR("Track {} has asynchronously processed plugins", track->name());
+            return EngineReturnStatus::ALREADY_IN_USE;
+        }
+        processors.push_back(_processors.mutable_processor(processor->id()).get());
+    }
+    {
+        std::scoped_lock lock(_pipeline_lock);
+        if (_pipelines.count(track_id) > 0)
+        {
+            SUSHI_LOG_ERROR("Track {} is processed as a pipeline", track->name());
+            return EngineReturnStatus::ALREADY_IN_USE;
+        }
+    }
+
+    /* The processors of a track rendered ahead are kept out of the rt part, as they are
+     * processed by the host, so only the track itself needs to be taken out to change host */
+    if (_set_track_offline(track.get(), true, enabled == false) == false)
+    {
+        SUSHI_LOG_ERROR("Failed to take track {} out of processing", track->name());
+        return EngineReturnStatus::ERROR;
+    }
+    if (enabled)
+    {
+        track->set_render_ahead_host(nullptr);
+        current->second->stop();
+        /* The rt thread could be passing an event to the host, so it is taken out from there
+         * and only freed once the rt thread has responded. If it doesn't, the host is leaked
+         * with the swap, it no longer touches the processors once stopped */
+        std::shared_ptr<RenderAheadHost> host = std::move(current->second);
+        _render_ahead_hosts.erase(current);
+        auto swap = std::make_unique<StorageSwap>();
+        swap->on_swap([this, host]()
+        {
+            for (auto& slot : _rt_render_ahead_hosts)
+            {
+                if (slot.load(std::memory_order_relaxed) == host.get())
+                {
+                    slot.store(nullptr, std::memory_order_release);
+                }
+            }
+        });
+        host.reset();
+        SUSHI_LOG_ERROR_IF(_swap_storage(std::move(swap)) == false, "Failed to remove render ahead host of track {}", track->name());
+    }
+
+    auto free_slot = std::find(_rt_render_ahead_hosts.begin(), _rt_render_ahead_hosts.end(), nullptr);
+    if (chunks > 0 && free_slot != _rt_render_ahead_hosts.end())
+    {
+        auto host = std::make_unique<RenderAheadHost>(processors, track->max_output_channels(), chunks,
+                                                      &_transport, _sample_rate, &_process_timer);
+        track->set_render_ahead_host(host.get());
+        free_slot->store(host.get());
+        _render_ahead_hosts[track_id] = std::move(host);
+        if (_set_track_offline(track.get(), false, false) == false)
+        {
+            SUSHI_LOG_ERROR("Failed to return track {} to processing", track->name());
+            return EngineReturnStatus::ERROR;
+        }
+        SUSHI_LOG_INFO("Rendering track {} {} chunks ahead", track->name(), chunks);
+        _update_latency_compensation();
+        return EngineReturnStatus::OK;
+    }
+
+    if (_set_track_offline(track.get(), false, true) == false)
+    {
+        SUSHI_LOG_ERROR("Failed to return track {} to processing", track->name());
+        return EngineReturnStatus::ERROR;
+    }
+    _update_latency_compensation();
+    if (chunks > 0)
+    {
+        SUSHI_LOG_ERROR("Couldn't render track {} ahead, at most {} tracks can be rendered ahead", track->name(), MAX_RENDER_AHEAD_TRACKS);
+        return EngineReturnStatus::ERROR;
+    }
+    return EngineReturnStatus::OK;
+}
+
+bool AudioEngine::_has_live_input(const Track* track) const
+{
+    for (const auto& con : _audio_in_connections.connections())
+    {
+        if (con.track == track->id())
+        {
+            return true;
+        }
+    }
+    auto processors = _processors.processors_on_track(track->id());
+    for (const auto& other : _processors.all_tracks())
+    {
+        if (other->id() == track->id())
+        {
+            continue;
+        }
+        for (const auto& processor : _processors.processors_on_track(other->id()))
+        {
+            auto destination = processor->send_destination();
+            if (destination && std::any_of(processors.begin(), processors.end(), [&](const auto& p) {return p.get() == destination;}))
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 EngineReturnStatus AudioEngine::delete_track(ObjectId track_id)
 {
     auto track = _processors.mutable_track(track_id);
@@ -624,11 +1013,33 @@ EngineReturnStatus AudioEngine::delete_track(ObjectId track_id)
         SUSHI_LOG_ERROR("Couldn't delete track {}, track not empty", track_id);
         return EngineReturnStatus::ERROR;
     }
+    if (_is_rendered_ahead(track_id) && set_track_render_ahead(track_id, 0) != EngineReturnStatus::OK)
+    {
+        SUSHI_LOG_ERROR("Couldn't delete track {}, failed to stop rendering it ahead", track_id);
+        return EngineReturnStatus::ERROR;
+    }
 
     // First remove any audio connections, if realtime, this is done with RtEvents
     _remove_connections_from_track(track->id());
+    track->set_output_group(nullptr);
+    for (const auto& member : _processors.all_tracks())
+    {
+        if (member->output_group() == track.get())
+        {
+            _processors.mutable_track(member->id())->set_output_group(nullptr);
+        }
+    }
 
-    if (realtime())
+    if (_in_transaction())
+    {
+        _add_to_transaction(RtEvent::make_remove_track_event(track->id()),
+                            RtEvent::make_add_track_event(track->id()),
+                            [=]() {_processors.add_track(track);});
+        _add_to_transaction(RtEvent::make_remove_processor_event(track->id()),
+                            RtEvent::make_insert_processor_event(track.get()),
+                            [=]() {_processors.add_processor(track);});
+    }
+    else if (realtime())
     {
         auto remove_event = RtEvent::make_remove_track_event(track->id());
         auto delete_event = RtEvent::make_remove_processor_event(track->id());
@@ -647,13 +1058,25 @@ EngineReturnStatus AudioEngine::delete_track(ObjectId track_id)
         [[maybe_unused]] bool removed = _remove_processor_from_realtime_part(track->id());
         SUSHI_LOG_WARNING_IF(removed == false, "Plugin track {} was not in the audio graph", track_id)
     }
-    track->set_enabled(false);
+    _on_graph_change([=]()
+    {
+        track->set_enabled(false);
+        _track_balancer.pin_track(track->id(), std::nullopt);
+        {
+            std::scoped_lock lock(_pipeline_lock);
+            _pipelines.erase(track->id());
+        }
+    });
     _processors.remove_track(track->id());
     _deregister_processor(track.get());
-    _event_dispatcher->post_event(new AudioGraphNotificationEvent(AudioGraphNotificationEvent::Action::TRACK_DELETED,
+    _on_graph_change([=]()
+    {
+        _update_latency_compensation();
+        _event_dispatcher->post_event(new AudioGraphNotificationEvent(AudioGraphNotificationEvent::Action::TRACK_DELETED,
                                                                       0,
-                                                                  track->id(),
-                                                                  IMMEDIATE_PROCESS));
+                                                                      track->id(),
+                                                                      IMMEDIATE_PROCESS));
+    });
     return EngineReturnStatus::OK;
 }
 
@@ -673,7 +1096,13 @@ std::pair<EngineReturnStatus, ObjectId> AudioEngine::create_processor(const Plug
         return {status, ObjectId(0)};
     }
 
-    if (this->realtime())
+    if (_in_transaction())
+    {
+        _add_to_transaction(RtEvent::make_insert_processor_event(processor.get()),
+                            RtEvent::make_remove_processor_event(processor->id()),
+                            [=]() {_processors.remove_processor(processor->id());});
+    }
+    else if (this->realtime())
     {
         // In realtime mode we need to handle this in the audio thread
         auto insert_event = RtEvent::make_insert_processor_event(processor.get());
@@ -691,10 +1120,14 @@ std::pair<EngineReturnStatus, ObjectId> AudioEngine::create_processor(const Plug
         // If the engine is not running in realtime mode we can add the processor directly
         _insert_processor_in_realtime_part(processor.get());
     }
-    _event_dispatcher->post_event(new AudioGraphNotificationEvent(AudioGraphNotificationEvent::Action::PROCESSOR_CREATED,
-                                                                  processor->id(),
-                                                                  0,
-                                                                  IMMEDIATE_PROCESS));
+    _plugin_costs.add_instance(processor->id(), plugin_info.uid);
+    _on_graph_change([=]()
+    {
+        _event_dispatcher->post_event(new AudioGraphNotificationEvent(AudioGraphNotificationEvent::Action::PROCESSOR_CREATED,
+                                                                      processor->id(),
+                                                                      0,
+                                                                      IMMEDIATE_PROCESS));
+    });
     return {EngineReturnStatus::OK, processor->id()};
 }
 
@@ -716,17 +1149,51 @@ EngineReturnStatus AudioEngine::add_plugin_to_track(ObjectId plugin_id,
         return EngineReturnStatus::INVALID_PLUGIN;
     }
 
-    if (plugin->active_rt_processing())
+    if (_in_transaction() ? _is_on_track(plugin_id) : plugin->active_rt_processing())
     {
         SUSHI_LOG_ERROR("Plugin {} is already active on a track");
         return EngineReturnStatus::ERROR;
     }
 
+    if (_is_rendered_ahead(track_id))
+    {
+        SUSHI_LOG_ERROR("Couldn't add plugin to track {}, it is rendered ahead", track->name());
+        return EngineReturnStatus::ALREADY_IN_USE;
+    }
+
+    if (_check_cpu_budget(plugin_id, track.get()) == false)
+    {
+        return EngineReturnStatus::CPU_BUDGET_EXCEEDED;
+    }
+
+    if (_in_transaction() && before_plugin_id.has_value())
+    {
+        // Otherwise checked when the plugin is added in the rt thread
+        auto chain = _processors.processors_on_track(track_id);
+        if (std::none_of(chain.begin(), chain.end(), [&](const auto& p) {return p->id() == *before_plugin_id;}))
+        {
+            SUSHI_LOG_ERROR("Plugin {} not found on track {}", *before_plugin_id, track->name());
+            return EngineReturnStatus::INVALID_PROCESSOR;
+        }
+    }
+
+    if (_reserve_track_processor(track.get()) == false || _reserve_graph_dependencies() == false)
+    {
+        SUSHI_LOG_ERROR("Failed to make room for plugin {} on track {}", plugin_id, track->name());
+        return EngineReturnStatus::ERROR;
+    }
+
     plugin->set_enabled(true);
     plugin->set_input_channels(std::min(plugin->max_input_channels(), track->input_channels()));
     plugin->set_output_channels(std::min(plugin->max_output_channels(), track->input_channels()));
 
-    if (this->realtime())
+    if (_in_transaction())
+    {
+        _add_to_transaction(RtEvent::make_add_processor_to_track_event(plugin_id, track_id, before_plugin_id),
+                            RtEvent::make_remove_processor_from_track_event(plugin_id, track_id),
+                            [=]() {_processors.remove_from_track(plugin_id, track_id);});
+    }
+    else if (this->realtime())
     {
         // In realtime mode we need to handle this in the audio thread
         RtEvent add_event = RtEvent::make_add_processor_to_track_event(plugin_id, track_id, before_plugin_id);
@@ -750,14 +1217,19 @@ EngineReturnStatus AudioEngine::add_plugin_to_track(ObjectId plugin_id,
     }
     // Add it to the engine's mirror of track processing chains
     _processors.add_to_track(plugin, track->id(), before_plugin_id);
-    _event_dispatcher->post_event(new AudioGraphNotificationEvent(AudioGraphNotificationEvent::Action::PROCESSOR_ADDED_TO_TRACK,
-                                                                  plugin_id,
-                                                                  track_id,
-                                                                  IMMEDIATE_PROCESS));
+    _on_graph_change([=]()
+    {
+        _update_pipeline_after_change(track.get());
+        _update_latency_compensation();
+        _event_dispatcher->post_event(new AudioGraphNotificationEvent(AudioGraphNotificationEvent::Action::PROCESSOR_ADDED_TO_TRACK,
+                                                                      plugin_id,
+                                                                      track_id,
+                                                                      IMMEDIATE_PROCESS));
+    });
     return EngineReturnStatus::OK;
 }
 
-EngineReturnStatus AudioEngine::remove_plugin_from_track(ObjectId plugin_id, ObjectId track_id)
+EngineReturnStatus AudioEngine::set_processor_async(ObjectId plugin_id, ObjectId track_id, bool enabled)
 {
     auto plugin = _processors.mutable_processor(plugin_id);
     auto track = _processors.mutable_track(track_id);
@@ -769,36 +1241,303 @@ EngineReturnStatus AudioEngine::remove_plugin_from_track(ObjectId plugin_id, Obj
     {
         return EngineReturnStatus::INVALID_TRACK;
     }
-
-    if (realtime())
+    if (enabled == (_async_hosts.count(plugin_id) > 0))
     {
-        // Send events to handle this in the rt domain
-        auto remove_event = RtEvent::make_remove_processor_from_track_event(plugin_id, track_id);
-        _send_control_event(remove_event);
-        [[maybe_unused]] bool remove_ok = _event_receiver.wait_for_response(remove_event.returnable_event()->event_id(), RT_EVENT_TIMEOUT);
-        SUSHI_LOG_ERROR_IF(remove_ok == false, "Failed to remove/delete processor {} from processing part", plugin_id)
+        return EngineReturnStatus::OK;
     }
-    else
+    if (_is_rendered_ahead(track_id))
     {
-        if (!track->remove(plugin->id()))
+        SUSHI_LOG_ERROR("Track {} is rendered ahead", track->name());
+        return EngineReturnStatus::ALREADY_IN_USE;
+    }
+    {
+        std::scoped_lock lock(_pipeline_lock);
+        if (enabled && _pipelines.count(track_id) > 0)
+        {
+            SUSHI_LOG_ERROR("Track {} is already processed as a pipeline", track->name());
+            return EngineReturnStatus::ALREADY_IN_USE;
+        }
+    }
+    if (enabled && track->processor_bus(plugin_id).has_value())
+    {
+        SUSHI_LOG_ERROR("Plugin {} is assigned to a bus of track {}", plugin->name(), track->name());
+        return EngineReturnStatus::ALREADY_IN_USE;
+    }
+
+    std::unique_ptr<AsyncProcessorHost> host;
+    if (enabled)
+    {
+        host = std::make_unique<AsyncProcessorHost>(plugin.get(), &_process_timer);
+    }
+
+    bool set = false;
+    if (realtime())
+    {
+        auto async_event = RtEvent::make_async_processing_event(plugin_id, track_id, host.get());
+        _send_control_event(async_event);
+        set = _event_receiver.wait_for_response(async_event.returnable_event()->event_id(), RT_EVENT_TIMEOUT);
+    }
+    else
+    {
+        set = track->set_async_host(plugin_id, host.get());
+    }
+
+    if (set == false)
+    {
+        SUSHI_LOG_ERROR("Failed to set asynchronous processing of plugin {} on track {}", plugin->name(), track->name());
+        return EngineReturnStatus::ERROR;
+    }
+    if (enabled)
+    {
+        SUSHI_LOG_INFO("Processing plugin {} asynchronously, with {} samples of added latency", plugin->name(), host->latency());
+        _async_hosts[plugin_id] = std::move(host);
+    }
+    else
+    {
+        _async_hosts.erase(plugin_id);
+    }
+    _update_latency_compensation();
+    return EngineReturnStatus::OK;
+}
+
+EngineReturnStatus AudioEngine::set_processor_bus(ObjectId plugin_id, ObjectId track_id, std::optional<int> bus)
+{
+    auto plugin = _processors.mutable_processor(plugin_id);
+    auto track = _processors.mutable_track(track_id);
+    if (plugin == nullptr)
+    {
+        return EngineReturnStatus::INVALID_PLUGIN;
+    }
+    if (track == nullptr)
+    {
+        return EngineReturnStatus::INVALID_TRACK;
+    }
+    if (bus.has_value() && (track->buses() < 2 || *bus < 0 || *bus >= track->buses()))
+    {
+        return EngineReturnStatus::INVALID_BUS;
+    }
+    if (_async_hosts.count(plugin_id) > 0)
+    {
+        SUSHI_LOG_ERROR("Plugin {} is processed asynchronously", plugin->name());
+        return EngineReturnStatus::ALREADY_IN_USE;
+    }
+    {
+        std::scoped_lock lock(_pipeline_lock);
+        if (_pipelines.count(track_id) > 0)
+        {
+            SUSHI_LOG_ERROR("Track {} is processed as a pipeline", track->name());
+            return EngineReturnStatus::ALREADY_IN_USE;
+        }
+    }
+
+    auto chain = _processors.processors_on_track(track_id);
+    auto position = std::find_if(chain.begin(), chain.end(), [&](const auto& p) {return p->id() == plugin_id;});
+    if (position == chain.end())
+    {
+        SUSHI_LOG_ERROR("Plugin {} is not on track {}", plugin->name(), track->name());
+        return EngineReturnStatus::INVALID_PLUGIN;
+    }
+    std::optional<ObjectId> before_plugin_id;
+    if (std::next(position) != chain.end())
+    {
+        before_plugin_id = (*std::next(position))->id();
+    }
+
+    // Channels can't be changed while the plugin is processing, so it is removed from the track meanwhile
+    int channels = bus.has_value() ? 2 : track->input_channels();
+    bool set = false;
+    if (realtime())
+    {
+        auto remove_event = RtEvent::make_remove_processor_from_track_event(plugin_id, track_id);
+        _send_control_event(remove_event);
+        if (_event_receiver.wait_for_response(remove_event.returnable_event()->event_id(), RT_EVENT_TIMEOUT) == false)
+        {
+            // The plugin may still be processing, so its channels must not be touched
+            SUSHI_LOG_ERROR("Failed to remove plugin {} from track {} in realtime thread", plugin->name(), track->name());
+            return EngineReturnStatus::ERROR;
+        }
+
+        plugin->set_input_channels(std::min(plugin->max_input_channels(), channels));
+        plugin->set_output_channels(std::min(plugin->max_output_channels(), channels));
+
+        auto bus_event = RtEvent::make_processor_bus_event(plugin_id, track_id, bus);
+        auto add_event = RtEvent::make_add_processor_to_track_event(plugin_id, track_id, before_plugin_id);
+        _send_control_event(bus_event);
+        _send_control_event(add_event);
+        bool bus_set = _event_receiver.wait_for_response(bus_event.returnable_event()->event_id(), RT_EVENT_TIMEOUT);
+        bool added = _event_receiver.wait_for_response(add_event.returnable_event()->event_id(), RT_EVENT_TIMEOUT);
+        set = bus_set && added;
+    }
+    else
+    {
+        if (track->remove(plugin_id) == false)
+        {
+            SUSHI_LOG_ERROR("Failed to remove plugin {} from track {}", plugin->name(), track->name());
+            return EngineReturnStatus::ERROR;
+        }
+        plugin->set_input_channels(std::min(plugin->max_input_channels(), channels));
+        plugin->set_output_channels(std::min(plugin->max_output_channels(), channels));
+        set = track->set_processor_bus(plugin_id, bus) && track->add(plugin.get(), before_plugin_id);
+    }
+
+    if (set == false)
+    {
+        SUSHI_LOG_ERROR("Failed to assign plugin {} to a bus on track {}", plugin->name(), track->name());
+        return EngineReturnStatus::ERROR;
+    }
+    _update_latency_compensation();
+    return EngineReturnStatus::OK;
+}
+
+EngineReturnStatus AudioEngine::set_track_pipeline_stages(ObjectId track_id, int stages)
+{
+    auto track = _processors.mutable_track(track_id);
+    if (track == nullptr)
+    {
+        return EngineReturnStatus::INVALID_TRACK;
+    }
+    if (stages < 0 || stages > MAX_PIPELINE_STAGES)
+    {
+        SUSHI_LOG_ERROR("Invalid number of pipeline stages: {}", stages);
+        return EngineReturnStatus::ERROR;
+    }
+    if (_is_rendered_ahead(track_id))
+    {
+        SUSHI_LOG_ERROR("Track {} is rendered ahead", track->name());
+        return EngineReturnStatus::ALREADY_IN_USE;
+    }
+    for (const auto& processor : _processors.processors_on_track(track_id))
+    {
+        if (_async_hosts.count(processor->id()) > 0)
+        {
+            SUSHI_LOG_ERROR("Track {} has asynchronously processed plugins", track->name());
+            return EngineReturnStatus::ALREADY_IN_USE;
+        }
+    }
+
+    {
+        std::scoped_lock lock(_pipeline_lock);
+        auto& pipeline = _pipelines[track_id];
+        int previous_stages = pipeline.stages;
+        pipeline.stages = stages;
+        if (_update_pipeline(track.get(), pipeline, true) == false)
+        {
+            SUSHI_LOG_ERROR("Failed to set pipeline processing of track {}", track->name());
+            pipeline.stages = previous_stages;
+            if (pipeline.stages == 0)
+            {
+                _pipelines.erase(track_id);
+            }
+            return EngineReturnStatus::ERROR;
+        }
+        if (stages == 0)
+        {
+            _pipelines.erase(track_id);
+        }
+    }
+    SUSHI_LOG_INFO("Processing track {} in {} pipeline stages, with {} samples of added latency",
+                   track->name(), stages, stages * AsyncProcessorHost::latency());
+    _update_latency_compensation();
+    return EngineReturnStatus::OK;
+}
+
+std::vector<PipelineStage> AudioEngine::track_pipeline(ObjectId track_id) const
+{
+    std::vector<PipelineStage> stages;
+    std::scoped_lock lock(_pipeline_lock);
+    auto pipeline = _pipelines.find(track_id);
+    if (pipeline != _pipelines.end())
+    {
+        for (const auto& host : pipeline->second.hosts)
+        {
+            auto& stage = stages.emplace_back(PipelineStage{host->timing_id(), {}});
+            for (const auto& processor : host->processors())
+            {
+                stage.processors.push_back(processor->id());
+            }
+        }
+    }
+    return stages;
+}
+
+EngineReturnStatus AudioEngine::remove_plugin_from_track(ObjectId plugin_id, ObjectId track_id)
+{
+    auto plugin = _processors.mutable_processor(plugin_id);
+    auto track = _processors.mutable_track(track_id);
+    if (plugin == nullptr)
+    {
+        return EngineReturnStatus::INVALID_PLUGIN;
+    }
+    if (track == nullptr)
+    {
+        return EngineReturnStatus::INVALID_TRACK;
+    }
+    if (_is_rendered_ahead(track_id))
+    {
+        SUSHI_LOG_ERROR("Couldn't remove plugin from track {}, it is rendered ahead", track->name());
+        return EngineReturnStatus::ALREADY_IN_USE;
+    }
+
+    if (_in_transaction())
+    {
+        // Put the plugin back in the same place if the transaction fails
+        auto chain = _processors.processors_on_track(track_id);
+        auto position = std::find_if(chain.begin(), chain.end(), [&](const auto& p) {return p->id() == plugin_id;});
+        if (position == chain.end())
+        {
+            SUSHI_LOG_ERROR("Failed to remove processor {} from track_id {}", plugin_id, track_id);
+            return EngineReturnStatus::ERROR;
+        }
+        std::optional<ObjectId> next_plugin_id;
+        if (std::next(position) != chain.end())
+        {
+            next_plugin_id = (*std::next(position))->id();
+        }
+        _add_to_transaction(RtEvent::make_remove_processor_from_track_event(plugin_id, track_id),
+                            RtEvent::make_add_processor_to_track_event(plugin_id, track_id, next_plugin_id),
+                            [=]() {_processors.add_to_track(plugin, track_id, next_plugin_id);});
+    }
+    else if (realtime())
+    {
+        // Send events to handle this in the rt domain
+        auto remove_event = RtEvent::make_remove_processor_from_track_event(plugin_id, track_id);
+        _send_control_event(remove_event);
+        [[maybe_unused]] bool remove_ok = _event_receiver.wait_for_response(remove_event.returnable_event()->event_id(), RT_EVENT_TIMEOUT);
+        SUSHI_LOG_ERROR_IF(remove_ok == false, "Failed to remove/delete processor {} from processing part", plugin_id)
+    }
+    else
+    {
+        if (!track->remove(plugin->id()))
         {
             SUSHI_LOG_ERROR("Failed to remove processor {} from track_id {}", plugin_id, track_id);
             return EngineReturnStatus::ERROR;
         }
     }
 
-    plugin->set_enabled(false);
+    _on_graph_change([=]()
+    {
+        // The plugin could have been added to another track in the same transaction
+        if (_is_on_track(plugin_id) == false)
+        {
+            plugin->set_enabled(false);
+        }
+        _async_hosts.erase(plugin_id);
+    });
 
     bool removed = _processors.remove_from_track(plugin_id, track_id);
-    if (removed)
+    _on_graph_change([=]()
     {
-        _event_dispatcher->post_event(new AudioGraphNotificationEvent(AudioGraphNotificationEvent::Action::PROCESSOR_REMOVED_FROM_TRACK,
-                                                                      plugin_id,
-                                                                      track_id,
-                                                                      IMMEDIATE_PROCESS));
-        return EngineReturnStatus::OK;
-    }
-    return EngineReturnStatus::ERROR;
+        _update_pipeline_after_change(track.get());
+        _update_latency_compensation();
+        if (removed)
+        {
+            _event_dispatcher->post_event(new AudioGraphNotificationEvent(AudioGraphNotificationEvent::Action::PROCESSOR_REMOVED_FROM_TRACK,
+                                                                          plugin_id,
+                                                                          track_id,
+                                                                          IMMEDIATE_PROCESS));
+        }
+    });
+    return removed ? EngineReturnStatus::OK : EngineReturnStatus::ERROR;
 }
 
 EngineReturnStatus AudioEngine::delete_plugin(ObjectId plugin_id)
@@ -808,12 +1547,20 @@ EngineReturnStatus AudioEngine::delete_plugin(ObjectId plugin_id)
     {
         return EngineReturnStatus::INVALID_PLUGIN;
     }
-    if (processor->active_rt_processing())
+    if (_in_transaction() ? _is_on_track(plugin_id) : processor->active_rt_processing())
     {
         SUSHI_LOG_ERROR("Cannot delete processor {}, active on track", processor->name());
         return EngineReturnStatus::ERROR;
     }
-    if (realtime())
+    if (_in_transaction())
+    {
+        _add_to_transaction(RtEvent::make_remove_processor_event(processor->id()),
+                            RtEvent::make_insert_processor_event(processor.get()),
+                            [=]() {_processors.add_processor(processor);});
+        // The processor is still referenced by the rt thread until the transaction is committed
+        _processors.remove_processor(processor->id());
+    }
+    else if (realtime())
     {
         // Send events to handle this in the rt domain
         auto delete_event = RtEvent::make_remove_processor_event(processor->id());
@@ -826,18 +1573,161 @@ EngineReturnStatus AudioEngine::delete_plugin(ObjectId plugin_id)
         _remove_processor_from_realtime_part(processor->id());
     }
 
-    _deregister_processor(processor.get());
-    _event_dispatcher->post_event(new AudioGraphNotificationEvent(AudioGraphNotificationEvent::Action::PROCESSOR_DELETED,
-                                                                  processor->id(),
-                                                                  0,
-                                                                  IMMEDIATE_PROCESS));
+    if (_in_transaction() == false)
+    {
+        _deregister_processor(processor.get());
+    }
+    _plugin_costs.remove_instance(plugin_id);
+    _on_graph_change([=]()
+    {
+        _event_dispatcher->post_event(new AudioGraphNotificationEvent(AudioGraphNotificationEvent::Action::PROCESSOR_DELETED,
+                                                                      processor->id(),
+                                                                      0,
+                                                                      IMMEDIATE_PROCESS));
+    });
     return EngineReturnStatus::OK;
 }
 
+std::pair<EngineReturnStatus, int> AudioEngine::begin_graph_transaction(Time expiry)
+{
+    std::scoped_lock lock(_transaction_lock);
+    _expire_graph_transaction();
+    if (_transaction)
+    {
+        SUSHI_LOG_ERROR("Graph transaction {} is already open", _transaction->id);
+        return {EngineReturnStatus::ALREADY_IN_USE, 0};
+    }
+    int id = _next_transaction_id++;
+    if (realtime())
+    {
+        _transaction = std::make_unique<GraphTransaction>();
+        _transaction->id = id;
+        _transaction->expiry = std::chrono::steady_clock::now() + expiry;
+        _transaction_open.store(true, std::memory_order_release);
+    }
+    return {EngineReturnStatus::OK, id};
+}
+
+EngineReturnStatus AudioEngine::run_in_graph_transaction(int transaction_id, const std::function<void()>& edits)
+{
+    if (realtime() == false)
+    {
+        edits();
+        return EngineReturnStatus::OK;
+    }
+    std::scoped_lock lock(_transaction_lock);
+    _expire_graph_transaction();
+    if (_transaction == nullptr || _transaction->id != transaction_id)
+    {
+        SUSHI_LOG_ERROR("Graph transaction {} is not open", transaction_id);
+        return EngineReturnStatus::ERROR;
+    }
+    _transaction_thread.store(std::this_thread::get_id(), std::memory_order_release);
+    edits();
+    _transaction_thread.store(std::thread::id(), std::memory_order_release);
+    return EngineReturnStatus::OK;
+}
+
+EngineReturnStatus AudioEngine::commit_graph_transaction(int transaction_id)
+{
+    if (realtime() == false)
+    {
+        return EngineReturnStatus::OK;
+    }
+    std::scoped_lock lock(_transaction_lock);
+    _expire_graph_transaction();
+    if (_transaction == nullptr || _transaction->id != transaction_id)
+    {
+        SUSHI_LOG_ERROR("Graph transaction {} is not open", transaction_id);
+        return EngineReturnStatus::ERROR;
+    }
+    auto transaction = std::move(_transaction);
+    auto status = receiver::ResponseStatus::HANDLED_OK;
+    if (transaction->events.empty() == false)
+    {
+        auto event = RtEvent::make_graph_transaction_event(&transaction->events, &transaction->undo_events);
+        _send_control_event(event);
+        status = _event_receiver.wait_for_response_status(event.returnable_event()->event_id(), RT_EVENT_TIMEOUT);
+    }
+    // Only closed now, as removed processors are kept in the rt processor table until the edits are applied
+    _transaction_open.store(false, std::memory_order_release);
+
+    if (status == receiver::ResponseStatus::TIMED_OUT)
+    {
+        /* The rt thread could still apply the edits at a later point, so the events must
+         * not be freed, and the edits can't be reverted */
+        SUSHI_LOG_ERROR("Graph transaction of {} edits timed out in realtime thread", transaction->events.size());
+        [[maybe_unused]] auto unreleased = transaction.release();
+        return EngineReturnStatus::ERROR;
+    }
+    if (status == receiver::ResponseStatus::HANDLED_ERROR)
+    {
+        SUSHI_LOG_ERROR("Failed to apply graph transaction of {} edits, reverting", transaction->events.size());
+        for (auto action = transaction->undo_actions.rbegin(); action != transaction->undo_actions.rend(); ++action)
+        {
+            if (*action)
+            {
+                (*action)();
+            }
+        }
+        return EngineReturnStatus::ERROR;
+    }
+    for (auto& action : transaction->commit_actions)
+    {
+        action();
+    }
+    SUSHI_LOG_INFO("Applied graph transaction of {} edits", transaction->events.size());
+    return EngineReturnStatus::OK;
+}
+
+EngineReturnStatus AudioEngine::abort_graph_transaction(int transaction_id)
+{
+    if (realtime() == false)
+    {
+        SUSHI_LOG_ERROR("Can't abort graph transaction {}, edits are applied directly when not in realtime mode", transaction_id);
+        return EngineReturnStatus::ERROR;
+    }
+    std::scoped_lock lock(_transaction_lock);
+    _expire_graph_transaction();
+    if (_transaction == nullptr || _transaction->id != transaction_id)
+    {
+        SUSHI_LOG_ERROR("Graph transaction {} is not open", transaction_id);
+        return EngineReturnStatus::ERROR;
+    }
+    SUSHI_LOG_INFO("Aborting graph transaction of {} edits", _transaction->events.size());
+    _roll_back_graph_transaction();
+    return EngineReturnStatus::OK;
+}
+
+void AudioEngine::_expire_graph_transaction()
+{
+    if (_transaction && _transaction->expiry < std::chrono::steady_clock::now())
+    {
+        SUSHI_LOG_WARNING("Graph transaction {} expired, rolling back {} edits", _transaction->id, _transaction->events.size());
+        _roll_back_graph_transaction();
+    }
+}
+
+void AudioEngine::_roll_back_graph_transaction()
+{
+    // None of the edits have reached the rt thread, so only their non-rt part is reverted
+    auto transaction = std::move(_transaction);
+    for (auto action = transaction->undo_actions.rbegin(); action != transaction->undo_actions.rend(); ++action)
+    {
+        if (*action)
+        {
+            (*action)();
+        }
+    }
+    _transaction_open.store(false, std::memory_order_release);
+}
+
 EngineReturnStatus AudioEngine::_register_new_track(const std::string& name, std::shared_ptr<Track> track)
 {
     track->init(_sample_rate);
     track->set_enabled(true);
+    // The output of regular tracks is only read when mixed to the engine outputs
+    track->set_deferred_gain(track->type() == TrackType::REGULAR);
 
     auto status = _register_processor(track, name);
     if (status != EngineReturnStatus::OK)
@@ -845,8 +1735,23 @@ EngineReturnStatus AudioEngine::_register_new_track(const std::string& name, std
         track.reset();
         return status;
     }
+    if (_reserve_graph_track() == false || _reserve_graph_dependencies() == false)
+    {
+        SUSHI_LOG_ERROR("Failed to make room for track {} in the audio graph", name);
+        _deregister_processor(track.get());
+        return EngineReturnStatus::ERROR;
+    }
 
-    if (realtime())
+    if (_in_transaction())
+    {
+        _add_to_transaction(RtEvent::make_insert_processor_event(track.get()),
+                            RtEvent::make_remove_processor_event(track->id()),
+                            [=]() {_processors.remove_processor(track->id());});
+        _add_to_transaction(RtEvent::make_add_track_event(track->id()),
+                            RtEvent::make_remove_track_event(track->id()),
+                            [=]() {_processors.remove_track(track->id());});
+    }
+    else if (realtime())
     {
         auto insert_event = RtEvent::make_insert_processor_event(track.get());
         auto add_event = RtEvent::make_add_track_event(track->id());
@@ -879,10 +1784,14 @@ EngineReturnStatus AudioEngine::_register_new_track(const std::string& name, std
     if (_processors.add_track(track))
     {
         SUSHI_LOG_INFO("Track {} successfully added to engine", name);
-        _event_dispatcher->post_event(new AudioGraphNotificationEvent(AudioGraphNotificationEvent::Action::TRACK_CREATED,
-                                                                      0,
-                                                                      track->id(),
-                                                                      IMMEDIATE_PROCESS));
+        _on_graph_change([=]()
+        {
+            _update_latency_compensation();
+            _event_dispatcher->post_event(new AudioGraphNotificationEvent(AudioGraphNotificationEvent::Action::TRACK_CREATED,
+                                                                          0,
+                                                                          track->id(),
+                                                                          IMMEDIATE_PROCESS));
+        });
         return EngineReturnStatus::OK;
     }
     return EngineReturnStatus::ERROR;
@@ -899,6 +1808,41 @@ std::pair<EngineReturnStatus, ObjectId> AudioEngine::_create_master_track(const
     return {EngineReturnStatus::OK, track->id()};
 }
 
+void AudioEngine::_add_to_transaction(const RtEvent& event, const RtEvent& undo_event, std::function<void()> undo_action)
+{
+    assert(_transaction);
+    _transaction->events.push_back(event);
+    _transaction->undo_events.push_back(undo_event);
+    _transaction->undo_actions.push_back(std::move(undo_action));
+}
+
+void AudioEngine::_on_graph_change(std::function<void()> action)
+{
+    if (_in_transaction())
+    {
+        _transaction->commit_actions.push_back(std::move(action));
+    }
+    else
+    {
+        action();
+    }
+}
+
+bool AudioEngine::_is_on_track(ObjectId processor_id) const
+{
+    for (const auto& track : _processors.all_tracks())
+    {
+        for (const auto& processor : _processors.processors_on_track(track->id()))
+        {
+            if (processor->id() == processor_id)
+            {
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
 EngineReturnStatus AudioEngine::_connect_audio_channel(int engine_channel,
                                                        int track_channel,
                                                        ObjectId track_id,
@@ -916,6 +1860,11 @@ EngineReturnStatus AudioEngine::_connect_audio_channel(int engine_channel,
         {
             return EngineReturnStatus::INVALID_CHANNEL;
         }
+        if (track->render_ahead_host() != nullptr)
+        {
+            SUSHI_LOG_ERROR("Couldn't connect input to track {}, it is rendered ahead", track->name());
+            return EngineReturnStatus::ERROR;
+        }
     }
     else
     {
@@ -935,6 +1884,11 @@ EngineReturnStatus AudioEngine::_connect_audio_channel(int engine_channel,
         }
     }
 
+    if (_reserve_audio_connection() == false)
+    {
+        SUSHI_LOG_ERROR("Failed to make room for another audio connection");
+        return EngineReturnStatus::ERROR;
+    }
     auto& storage = direction == Direction::INPUT ? _audio_in_connections : _audio_out_connections;
     bool realtime = this->realtime();
 
@@ -942,8 +1896,21 @@ EngineReturnStatus AudioEngine::_connect_audio_channel(int engine_channel,
                            .track_channel = track_channel,
                            .track = track->id()};
     bool added = storage.add(con, !realtime);
+    if (added && realtime == false)
+    {
+        _audio_routing.update(_audio_in_connections.connections(), _audio_out_connections.connections());
+    }
 
-    if (added && realtime)
+    if (added && _in_transaction())
+    {
+        bool input = direction == Direction::INPUT;
+        _add_to_transaction(input ? RtEvent::make_add_audio_input_connection_event(con) :
+                                    RtEvent::make_add_audio_output_connection_event(con),
+                            input ? RtEvent::make_remove_audio_input_connection_event(con) :
+                                    RtEvent::make_remove_audio_output_connection_event(con),
+                            [=, &storage]() {storage.remove(con, false);});
+    }
+    else if (added && realtime)
     {
         auto event = direction == Direction::INPUT ? RtEvent::make_add_audio_input_connection_event(con) :
                                                      RtEvent::make_add_audio_output_connection_event(con);
@@ -977,13 +1944,31 @@ EngineReturnStatus AudioEngine::_disconnect_audio_channel(int engine_channel,
         return EngineReturnStatus::INVALID_TRACK;
     }
 
+    if (_reserve_audio_connection() == false)
+    {
+        SUSHI_LOG_ERROR("Failed to make room for another audio connection");
+        return EngineReturnStatus::ERROR;
+    }
     auto& storage = direction == Direction::INPUT ? _audio_in_connections : _audio_out_connections;
     bool realtime = this->realtime();
 
     AudioConnection con = {.engine_channel = engine_channel, .track_channel = track_channel, .track = track->id()};
     bool removed = storage.remove(con, !realtime);
+    if (removed && realtime == false)
+    {
+        _audio_routing.update(_audio_in_connections.connections(), _audio_out_connections.connections());
+    }
 
-    if (removed && realtime)
+    if (removed && _in_transaction())
+    {
+        bool input = direction == Direction::INPUT;
+        _add_to_transaction(input ? RtEvent::make_remove_audio_input_connection_event(con) :
+                                    RtEvent::make_remove_audio_output_connection_event(con),
+                            input ? RtEvent::make_add_audio_input_connection_event(con) :
+                                    RtEvent::make_add_audio_output_connection_event(con),
+                            [=, &storage]() {storage.add(con, false);});
+    }
+    else if (removed && realtime)
     {
         auto event = direction == Direction::INPUT ? RtEvent::make_remove_audio_input_connection_event(con) :
                                                      RtEvent::make_remove_audio_output_connection_event(con);
@@ -1005,8 +1990,10 @@ EngineReturnStatus AudioEngine::_disconnect_audio_channel(int engine_channel,
 void AudioEngine::_process_internal_rt_events()
 {
     RtEvent event;
+    bool returned_events = false;
     while(_control_queue_in.pop(event))
     {
+        returned_events = true;
         switch (event.type())
         {
             case RtEventType::TEMPO:
@@ -1018,79 +2005,203 @@ void AudioEngine::_process_internal_rt_events()
                 break;
             }
             case RtEventType::INSERT_PROCESSOR:
-            {
-                auto typed_event = event.processor_operation_event();
-                bool inserted = _insert_processor_in_realtime_part(typed_event->instance());
-                typed_event->set_handled(inserted);
-                break;
-            }
             case RtEventType::REMOVE_PROCESSOR:
+            case RtEventType::ADD_PROCESSOR_TO_TRACK:
+            case RtEventType::REMOVE_PROCESSOR_FROM_TRACK:
+            case RtEventType::ADD_TRACK:
+            case RtEventType::REMOVE_TRACK:
+            case RtEventType::ADD_AUDIO_CONNECTION:
+            case RtEventType::REMOVE_AUDIO_CONNECTION:
             {
-                auto typed_event = event.processor_reorder_event();
-                bool removed = _remove_processor_from_realtime_part(typed_event->processor());
-                typed_event->set_handled(removed);
+                event.returnable_event()->set_handled(_apply_graph_event(event));
                 break;
             }
-            case RtEventType::ADD_PROCESSOR_TO_TRACK:
+            case RtEventType::GRAPH_TRANSACTION:
             {
-                auto typed_event = event.processor_reorder_event();
-                auto track = static_cast<Track*>(_realtime_processors[typed_event->track()]);
-                auto processor = static_cast<Processor*>(_realtime_processors[typed_event->processor()]);
-                bool added = false;
-                if (track && processor)
-                {
-                    added = track->add(processor, typed_event->before_processor());
-                }
-                typed_event->set_handled(added);
+                auto typed_event = event.graph_transaction_event();
+                typed_event->set_handled(_apply_graph_transaction(*typed_event->events(), *typed_event->undo_events()));
                 break;
             }
-            case RtEventType::REMOVE_PROCESSOR_FROM_TRACK:
+            case RtEventType::SWAP_STORAGE:
             {
-                auto typed_event = event.processor_reorder_event();
-                auto track = static_cast<Track*>(_realtime_processors[typed_event->track()]);
-                bool removed = false;
-                if (track)
-                {
-                    removed = track->remove(typed_event->processor());
-                }
-                typed_event->set_handled(removed);
+                auto typed_event = event.storage_swap_event();
+                typed_event->swap()->swap_rt();
+                typed_event->set_handled(true);
                 break;
             }
-            case RtEventType::ADD_TRACK:
+            case RtEventType::SET_ASYNC_PROCESSING:
             {
-                auto typed_event = event.processor_reorder_event();
-                auto track = static_cast<Track*>(_realtime_processors[typed_event->track()]);
-                typed_event->set_handled(track ? _add_track(track) : false);
+                auto typed_event = event.async_processing_event();
+                auto track = static_cast<Track*>(_realtime_processors.processor(typed_event->track()));
+                typed_event->set_handled(track ? track->set_async_host(typed_event->processor_id(), typed_event->host()) : false);
                 break;
             }
-            case RtEventType::REMOVE_TRACK:
+            case RtEventType::SET_PROCESSOR_BUS:
             {
-                auto typed_event = event.processor_reorder_event();
-                auto track = static_cast<Track*>(_realtime_processors[typed_event->track()]);
-                typed_event->set_handled(track ? _remove_track(track) : false);
+                auto typed_event = event.processor_bus_event();
+                auto track = static_cast<Track*>(_realtime_processors.processor(typed_event->track()));
+                typed_event->set_handled(track ? track->set_processor_bus(typed_event->processor(), typed_event->bus()) : false);
                 break;
             }
-            case RtEventType::ADD_AUDIO_CONNECTION:
+            case RtEventType::SET_TRACK_PIPELINE:
             {
-                auto typed_event = event.audio_connection_event();
-                assert(_realtime_processors[typed_event->connection().track]);
-                auto& storage = typed_event->input_connection() ? _audio_in_connections : _audio_out_connections;
-                typed_event->set_handled(storage.add_rt(typed_event->connection()));
+                auto typed_event = event.track_pipeline_event();
+                auto track = static_cast<Track*>(_realtime_processors.processor(typed_event->track()));
+                typed_event->set_handled(track ? track->set_pipeline(*typed_event->stages()) : false);
                 break;
             }
-            case RtEventType::REMOVE_AUDIO_CONNECTION:
+            case RtEventType::MOVE_TRACK:
             {
-                auto typed_event = event.audio_connection_event();
-                auto& storage = typed_event->input_connection() ? _audio_in_connections : _audio_out_connections;
-                typed_event->set_handled(storage.remove_rt(typed_event->connection()));
+                auto typed_event = event.move_track_event();
+                auto track = static_cast<Track*>(_realtime_processors.processor(typed_event->track()));
+                typed_event->set_handled(track ? _audio_graph.move_to_core(track, typed_event->core()) : false);
                 break;
             }
-
             default:
                 break;
         }
         _control_queue_out.push(event); // Send event back to non-rt domain
     }
+    if (returned_events)
+    {
+        // Wake up threads waiting for a response directly, rather than having them poll the queue
+        _event_receiver.notify();
+    }
+}
+
+bool AudioEngine::_apply_graph_event(const RtEvent& event)
+{
+    switch (event.type())
+    {
+        case RtEventType::INSERT_PROCESSOR:
+        {
+            return _insert_processor_in_realtime_part(event.processor_operation_event()->instance());
+        }
+        case RtEventType::REMOVE_PROCESSOR:
+        {
+            return _remove_processor_from_realtime_part(event.processor_reorder_event()->processor());
+        }
+        case RtEventType::ADD_PROCESSOR_TO_TRACK:
+        {
+            auto typed_event = event.processor_reorder_event();
+            auto track = static_cast<Track*>(_realtime_processors.processor(typed_event->track()));
+            auto processor = _realtime_processors.processor(typed_event->processor());
+            if (track && processor)
+            {
+                return track->add(processor, typed_event->before_processor());
+            }
+            return false;
+        }
+        case RtEventType::REMOVE_PROCESSOR_FROM_TRACK:
+        {
+            auto typed_event = event.processor_reorder_event();
+            auto track = static_cast<Track*>(_realtime_processors.processor(typed_event->track()));
+            return track ? track->remove(typed_event->processor()) : false;
+        }
+        case RtEventType::ADD_TRACK:
+        {
+            auto track = static_cast<Track*>(_realtime_processors.processor(event.processor_reorder_event()->track()));
+            return track ? _add_track(track) : false;
+        }
+        case RtEventType::REMOVE_TRACK:
+        {
+            auto track = static_cast<Track*>(_realtime_processors.processor(event.processor_reorder_event()->track()));
+            return track ? _remove_track(track) : false;
+        }
+        case RtEventType::ADD_AUDIO_CONNECTION:
+        {
+            auto typed_event = event.audio_connection_event();
+            assert(_realtime_processors.processor(typed_event->connection().track));
+            auto& storage = typed_event->input_connection() ? _audio_in_connections : _audio_out_connections;
+            bool added = storage.add_rt(typed_event->connection());
+            _audio_routing.update(_audio_in_connections.connections_rt(), _audio_out_connections.connections_rt());
+            return added;
+        }
+        case RtEventType::REMOVE_AUDIO_CONNECTION:
+        {
+            auto typed_event = event.audio_connection_event();
+            auto& storage = typed_event->input_connection() ? _audio_in_connections : _audio_out_connections;
+            bool removed = storage.remove_rt(typed_event->connection());
+            _audio_routing.update(_audio_in_connections.connections_rt(), _audio_out_connections.connections_rt());
+            return removed;
+        }
+        default:
+            return false;
+    }
+}
+
+bool AudioEngine::_apply_graph_transaction(const std::vector<RtEvent>& events, const std::vector<RtEvent>& undo_events)
+{
+    assert(events.size() == undo_events.size());
+    for (size_t i = 0; i < events.size(); ++i)
+    {
+        if (_apply_graph_event(events[i]) == false)
+        {
+            // Revert the events already applied, in reverse order, to leave the graph as it was
+            while (i > 0)
+            {
+                --i;
+                [[maybe_unused]] bool reverted = _apply_graph_event(undo_events[i]);
+                assert(reverted);
+            }
+            return false;
+        }
+    }
+    return true;
+}
+
+bool AudioEngine::_apply_graph_events(std::vector<RtEvent> events, std::vector<RtEvent> undo_events)
+{
+    if (realtime())
+    {
+        // Kept on the heap, as the rt thread could still read the events after a timeout
+        auto transaction = std::make_unique<GraphTransaction>();
+        transaction->events = std::move(events);
+        transaction->undo_events = std::move(undo_events);
+        auto event = RtEvent::make_graph_transaction_event(&transaction->events, &transaction->undo_events);
+        _send_control_event(event);
+        auto status = _event_receiver.wait_for_response_status(event.returnable_event()->event_id(), RT_EVENT_TIMEOUT);
+        if (status == receiver::ResponseStatus::TIMED_OUT)
+        {
+            SUSHI_LOG_ERROR("Applying {} graph edits timed out in realtime thread", transaction->events.size());
+            [[maybe_unused]] auto unreleased = transaction.release();
+        }
+        return status == receiver::ResponseStatus::HANDLED_OK;
+    }
+    return _apply_graph_transaction(events, undo_events);
+}
+
+bool AudioEngine::_set_track_offline(Track* track, bool remove, bool processors)
+{
+    std::vector<RtEvent> remove_events;
+    std::vector<RtEvent> insert_events;
+    remove_events.push_back(RtEvent::make_remove_track_event(track->id()));
+    insert_events.push_back(RtEvent::make_add_track_event(track->id()));
+    for (const auto& processor : _processors.processors_on_track(track->id()))
+    {
+        if (processors == false)
+        {
+            break;
+        }
+        remove_events.push_back(RtEvent::make_remove_processor_event(processor->id()));
+        insert_events.push_back(RtEvent::make_insert_processor_event(_processors.mutable_processor(processor->id()).get()));
+    }
+    remove_events.push_back(RtEvent::make_remove_processor_event(track->id()));
+    insert_events.push_back(RtEvent::make_insert_processor_event(track));
+
+    if (remove)
+    {
+        return _apply_graph_events(std::move(remove_events), std::move(insert_events));
+    }
+    // Put back in the reverse order, the track must be in the rt part before it is added to the graph
+    std::reverse(insert_events.begin(), insert_events.end());
+    std::reverse(remove_events.begin(), remove_events.end());
+    if (_apply_graph_events(std::move(insert_events), std::move(remove_events)) == false)
+    {
+        return false;
+    }
+    auto core = _track_balancer.pinned_core(track->id());
+    return core.has_value() == false || _move_track_to_core(track, core.value());
 }
 
 void AudioEngine::_send_rt_events_to_processors()
@@ -1104,18 +2215,33 @@ void AudioEngine::_send_rt_events_to_processors()
 
 void AudioEngine::_send_rt_event(const RtEvent& event)
 {
-    if (event.processor_id() < _realtime_processors.size() &&
-        _realtime_processors[event.processor_id()] != nullptr)
+    auto processor = _realtime_processors.processor(event.processor_id());
+    if (processor != nullptr)
     {
-        _realtime_processors[event.processor_id()]->process_event(event);
+        processor->process_event(event);
+        return;
+    }
+    for (auto& slot : _rt_render_ahead_hosts)
+    {
+        auto host = slot.load(std::memory_order_acquire);
+        if (host && host->hosts(event.processor_id()))
+        {
+            host->queue_event(event);
+            return;
+        }
     }
 }
 
 void AudioEngine::_retrieve_events_from_tracks(ControlBuffer& buffer)
 {
-    for (auto& output : _audio_graph.event_outputs())
+    auto& outputs = _audio_graph.event_outputs();
+    for (int core = 0; core < static_cast<int>(outputs.size()); ++core)
     {
-        _retrieve_events_from_output_pipe(output, buffer);
+        // The worker of a stalled core may still be writing to its output
+        if (_audio_graph.core_stall(core).stalled == false)
+        {
+            _retrieve_events_from_output_pipe(outputs[core], buffer);
+        }
     }
     _retrieve_events_from_output_pipe(_prepost_event_outputs, buffer);
 }
@@ -1150,23 +2276,12 @@ void AudioEngine::_retrieve_events_from_output_pipe(RtEventFifo<>& pipe, Control
 
 void AudioEngine::_copy_audio_to_tracks(ChunkSampleBuffer* input)
 {
-    for (const auto& c : _audio_in_connections.connections_rt())
-    {
-        auto engine_in = ChunkSampleBuffer::create_non_owning_buffer(*input, c.engine_channel, 1);
-        auto track_in = static_cast<Track*>(_realtime_processors[c.track])->input_channel(c.track_channel);
-        track_in = engine_in;
-    }
+    _audio_routing.route_inputs(*input, _realtime_processors);
 }
 
 void AudioEngine::_copy_audio_from_tracks(ChunkSampleBuffer* output)
 {
-    output->clear();
-    for (const auto& c : _audio_out_connections.connections_rt())
-    {
-        auto track_out = static_cast<Track*>(_realtime_processors[c.track])->output_channel(c.track_channel);
-        auto engine_out = ChunkSampleBuffer::create_non_owning_buffer(*output, c.engine_channel, 1);
-        engine_out.add(track_out);
-    }
+    _audio_routing.mix_outputs(*output, _realtime_processors);
 }
 
 void AudioEngine::update_timings()
@@ -1174,11 +2289,31 @@ void AudioEngine::update_timings()
     if (_process_timer.enabled())
     {
         auto engine_timings = _process_timer.timings_for_node(ENGINE_TIMING_ID);
-        _event_dispatcher->post_event(new EngineTimingNotificationEvent(*engine_timings, IMMEDIATE_PROCESS));
+        int shed_tracks = _audio_graph.shed_tracks();
+        _event_dispatcher->post_event(new EngineTimingNotificationEvent(*engine_timings, shed_tracks, IMMEDIATE_PROCESS));
+        if (shed_tracks != _reported_shed_tracks)
+        {
+            SUSHI_LOG_WARNING_IF(shed_tracks > _reported_shed_tracks, "Engine overloaded, {} tracks shed", shed_tracks);
+            SUSHI_LOG_INFO_IF(shed_tracks < _reported_shed_tracks, "Engine load decreased, {} tracks shed", shed_tracks);
+            _reported_shed_tracks = shed_tracks;
+        }
+
+        for (const auto& processor : _processors.all_processors())
+        {
+            auto timings = _process_timer.timings_for_node(processor->id());
+            if (timings.has_value())
+            {
+                _plugin_costs.update(processor->id(), TrackBalancer::track_load(timings.value()));
+            }
+        }
 
         _log_timing_print_counter += 1;
         if (_log_timing_print_counter > TIMING_LOG_PRINT_INTERVAL)
         {
+            if (_plugin_cost_file.empty() == false)
+            {
+                _plugin_costs.save(_plugin_cost_file);
+            }
             for (const auto& processor : _processors.all_processors())
             {
                 auto id = processor->id();
@@ -1196,6 +2331,34 @@ void AudioEngine::update_timings()
             }
             _log_timing_print_counter = 0;
         }
+        if (_audio_graph.cores() > 1)
+        {
+            _rebalance_tracks();
+        }
+        _update_pipelines();
+    }
+    // Plugins can change their latency at any time
+    _update_latency_compensation();
+
+    {
+        std::scoped_lock lock(_transaction_lock);
+        _expire_graph_transaction();
+    }
+
+    int stalled_cores = _audio_graph.stalled_cores();
+    if (stalled_cores != _logged_stalled_cores)
+    {
+        SUSHI_LOG_WARNING_IF(stalled_cores > _logged_stalled_cores, "Worker hung, {} cores stalled", stalled_cores);
+        SUSHI_LOG_INFO_IF(stalled_cores < _logged_stalled_cores, "Worker recovered, {} cores stalled", stalled_cores);
+        _logged_stalled_cores = stalled_cores;
+    }
+
+    int dropped_dependencies = _audio_graph.dropped_dependencies();
+    if (dropped_dependencies != _logged_dropped_dependencies)
+    {
+        SUSHI_LOG_WARNING_IF(dropped_dependencies > 0, "No room for {} dependencies between tracks, "
+                             "audio sent along them is delayed by one chunk", dropped_dependencies);
+        _logged_dropped_dependencies = dropped_dependencies;
     }
 }
 
@@ -1239,6 +2402,511 @@ bool AudioEngine::_add_track(Track* track)
     return added;
 }
 
+void AudioEngine::_wait_for_async_processing()
+{
+    if (_pre_track)
+    {
+        _pre_track->wait_for_async_processing();
+    }
+    _audio_graph.wait_for_async_processing();
+    if (_post_track)
+    {
+        _post_track->wait_for_async_processing();
+    }
+}
+
+void AudioEngine::set_elastic_cores(bool enabled)
+{
+    _track_balancer.set_elastic(enabled);
+    if (enabled)
+    {
+        _process_timer.enable(true);
+    }
+}
+
+void AudioEngine::set_overload_shedding(bool enabled)
+{
+    _overload_shedding = enabled;
+    if (enabled)
+    {
+        _process_timer.enable(true);
+    }
+}
+
+void AudioEngine::_update_overload_shedding(performance::TimePoint chunk_start)
+{
+    if (_overload_shedding == false)
+    {
+        _overload_shedder.reset();
+        if (_audio_graph.shed_tracks() > 0)
+        {
+            while (_audio_graph.restore_shed_priority());
+        }
+        return;
+    }
+    switch (_overload_shedder.update(_process_timer.elapsed_load(chunk_start), _audio_graph.shed_tracks() > 0))
+    {
+        case ShedAction::SHED:
+            _audio_graph.shed_lowest_priority();
+            break;
+
+        case ShedAction::RESTORE:
+            _audio_graph.restore_shed_priority();
+            break;
+
+        default:
+            break;
+    }
+}
+
+void AudioEngine::set_worker_watchdog(float chunk_periods)
+{
+    _watchdog_periods = chunk_periods;
+    auto timeout = std::chrono::duration<float>(chunk_periods * AUDIO_CHUNK_SIZE / _sample_rate);
+    _audio_graph.set_watchdog_timeout(std::chrono::duration_cast<std::chrono::nanoseconds>(timeout));
+}
+
+void AudioEngine::_report_stalled_cores()
+{
+    for (int core = 1; core < _audio_graph.cores(); ++core)
+    {
+        const auto& stall = _audio_graph.core_stall(core);
+        if (stall.stalled != _reported_stalls[core])
+        {
+            _main_out_queue.push(RtEvent::make_core_stall_notification_event(core, stall.track, stall.processor, stall.stalled));
+            _reported_stalls[core] = stall.stalled;
+        }
+    }
+}
+
+void AudioEngine::set_cpu_budget(std::optional<float> budget, CpuBudgetPolicy policy)
+{
+    {
+        std::scoped_lock lock(_cpu_budget_lock);
+        _cpu_budget = budget;
+        _cpu_budget_policy = policy;
+    }
+    if (budget.has_value())
+    {
+        _process_timer.enable(true);
+    }
+}
+
+void AudioEngine::set_plugin_cost_file(const std::string& path)
+{
+    _plugin_cost_file = path;
+    if (_plugin_costs.load(path))
+    {
+        SUSHI_LOG_INFO("Loaded plugin costs from {}", path);
+    }
+}
+
+std::pair<EngineReturnStatus, LoadPrediction> AudioEngine::predict_plugin_load(const std::string& plugin_uid,
+                                                                               ObjectId track_id)
+{
+    auto track = _processors.track(track_id);
+    if (track == nullptr)
+    {
+        SUSHI_LOG_ERROR("Couldn't predict load of track {}, not found", track_id);
+        return {EngineReturnStatus::INVALID_TRACK, LoadPrediction{}};
+    }
+    return {EngineReturnStatus::OK, _predict_load(track.get(), _plugin_costs.cost(plugin_uid))};
+}
+
+LoadPrediction AudioEngine::_predict_load(const Track* track, std::optional<float> plugin_load)
+{
+    std::vector<float> core_loads(_audio_graph.cores(), 0.0f);
+    if (_audio_graph.cores() == 1)
+    {
+        // The engine total includes the work done outside of the tracks
+        auto timings = _process_timer.timings_for_node(ENGINE_TIMING_ID);
+        core_loads[0] = timings.has_value() ? TrackBalancer::track_load(timings.value()) : 0.0f;
+    }
+    else
+    {
+        // Pre and post tracks are processed on the first core
+        for (const auto& t : _processors.all_tracks())
+        {
+            int core = t->type() == TrackType::REGULAR ? t->assigned_core() : 0;
+            auto timings = _process_timer.timings_for_node(t->id());
+            if (core != UNASSIGNED_CORE && timings.has_value())
+            {
+                core_loads[core] += TrackBalancer::track_load(timings.value());
+            }
+        }
+    }
+
+    LoadPrediction prediction;
+    prediction.core = track->type() == TrackType::REGULAR ? std::max(track->assigned_core(), 0) : 0;
+    prediction.current_load = *std::max_element(core_loads.begin(), core_loads.end());
+    prediction.plugin_load = plugin_load.value_or(0.0f);
+    prediction.plugin_known = plugin_load.has_value();
+    core_loads[prediction.core] += prediction.plugin_load;
+    prediction.predicted_load = *std::max_element(core_loads.begin(), core_loads.end());
+    {
+        std::scoped_lock lock(_cpu_budget_lock);
+        prediction.budget = _cpu_budget;
+    }
+    prediction.within_budget = prediction.budget.has_value() == false ||
+                               prediction.predicted_load <= prediction.budget.value();
+    return prediction;
+}
+
+bool AudioEngine::_check_cpu_budget(ObjectId plugin_id, const Track* track)
+{
+    std::unique_lock lock(_cpu_budget_lock);
+    bool budget_set = _cpu_budget.has_value();
+    auto policy = _cpu_budget_policy;
+    lock.unlock();
+
+    // Plugins moved between tracks are already part of the load
+    auto uid = _plugin_costs.uid(plugin_id);
+    if (budget_set == false || uid.has_value() == false || _plugin_costs.admitted(plugin_id))
+    {
+        _plugin_costs.admit(plugin_id);
+        return true;
+    }
+
+    auto prediction = _predict_load(track, _plugin_costs.cost(uid.value()));
+    SUSHI_LOG_WARNING_IF(prediction.plugin_known == false, "Cost of plugin {} not known, assuming none", uid.value());
+    if (prediction.within_budget == false)
+    {
+        bool rejected = policy == CpuBudgetPolicy::REJECT;
+        _event_dispatcher->post_event(new CpuBudgetNotificationEvent(plugin_id, track->id(), prediction,
+                                                                     rejected, IMMEDIATE_PROCESS));
+        if (rejected)
+        {
+            SUSHI_LOG_ERROR("Couldn't add plugin {} to track {}, predicted load {}% exceeds budget of {}%",
+                            plugin_id, track->name(), prediction.predicted_load * 100.0f, prediction.budget.value() * 100.0f);
+            return false;
+        }
+        SUSHI_LOG_WARNING("Adding plugin {} to track {}, predicted load {}% exceeds budget of {}%",
+                          plugin_id, track->name(), prediction.predicted_load * 100.0f, prediction.budget.value() * 100.0f);
+    }
+    _plugin_costs.admit(plugin_id);
+    return true;
+}
+
+bool AudioEngine::_move_track_to_core(Track* track, int core)
+{
+    if (realtime())
+    {
+        auto move_event = RtEvent::make_move_track_event(track->id(), core);
+        _send_control_event(move_event);
+        return _event_receiver.wait_for_response(move_event.returnable_event()->event_id(), RT_EVENT_TIMEOUT);
+    }
+    return _audio_graph.move_to_core(track, core);
+}
+
+void AudioEngine::_rebalance_tracks()
+{
+    std::vector<TrackLoad> track_loads;
+    for (const auto& track : _processors.all_tracks())
+    {
+        auto core = track->assigned_core();
+        auto timings = _process_timer.timings_for_node(track->id());
+        if (track->type() == TrackType::REGULAR && core != UNASSIGNED_CORE && timings.has_value())
+        {
+            track_loads.push_back({track->id(), core, TrackBalancer::track_load(timings.value())});
+        }
+    }
+
+    [[maybe_unused]] int active_cores = _track_balancer.active_cores();
+    auto moves = _track_balancer.rebalance(track_loads);
+    SUSHI_LOG_INFO_IF(_track_balancer.active_cores() != active_cores, "Processing on {} of {} cores",
+                      _track_balancer.active_cores(), _audio_graph.cores());
+    for (const auto& move : moves)
+    {
+        auto track = _processors.mutable_track(move.track);
+        if (track && _move_track_to_core(track.get(), move.core))
+        {
+            SUSHI_LOG_DEBUG("Moved track {} to core {}", track->name(), move.core);
+        }
+        else
+        {
+            SUSHI_LOG_WARNING("Failed to move track {} to core {}", move.track, move.core);
+        }
+    }
+}
+
+bool AudioEngine::_update_pipeline(Track* track, TrackPipeline& pipeline, bool force)
+{
+    auto chain = _processors.processors_on_track(track->id());
+    int stages = std::min(pipeline.stages, static_cast<int>(chain.size()));
+
+    // Without timings for all plugins, split the chain evenly by the number of plugins
+    bool timed = _process_timer.enabled();
+    std::vector<float> loads;
+    for (const auto& processor : chain)
+    {
+        auto timings = _process_timer.timings_for_node(processor->id());
+        timed = timed && timings.has_value();
+        loads.push_back(timings.has_value() ? TrackBalancer::track_load(timings.value()) : 0.0f);
+    }
+    if (timed == false)
+    {
+        loads.assign(chain.size(), 1.0f);
+    }
+    auto stage_lengths = TrackBalancer::split_chain(loads, stages);
+
+    std::vector<int> current_lengths;
+    std::vector<ObjectId> current_chain;
+    for (const auto& host : pipeline.hosts)
+    {
+        current_lengths.push_back(static_cast<int>(host->processors().size()));
+        for (const auto& processor : host->processors())
+        {
+            current_chain.push_back(processor->id());
+        }
+    }
+    bool chain_changed = current_chain.size() != chain.size() ||
+                         std::equal(current_chain.begin(), current_chain.end(), chain.begin(),
+                                    [](ObjectId id, const auto& processor) {return id == processor->id();}) == false;
+
+    if (force == false && chain_changed == false)
+    {
+        if (stage_lengths == current_lengths || timed == false)
+        {
+            return true;
+        }
+        float current_load = TrackBalancer::max_stage_load(loads, current_lengths);
+        float new_load = TrackBalancer::max_stage_load(loads, stage_lengths);
+        if (current_load - new_load < PIPELINE_SPLIT_THRESHOLD)
+        {
+            return true;
+        }
+    }
+
+    /* The hosts of the current stages, and their worker threads, are reused and only get
+     * new processors, hosts are only created or deleted when the number of stages changes */
+    std::vector<std::unique_ptr<AsyncProcessorHost>> hosts;
+    auto rt_stages = std::make_unique<std::vector<AsyncProcessorHost*>>();
+    auto previous_hosts = pipeline.hosts.size();
+    auto processor = chain.begin();
+    for (auto length : stage_lengths)
+    {
+        std::vector<Processor*> stage;
+        for (int i = 0; i < length; ++i, ++processor)
+        {
+            stage.push_back(_processors.mutable_processor((*processor)->id()).get());
+        }
+        if (hosts.size() < pipeline.hosts.size())
+        {
+            auto& host = hosts.emplace_back(std::move(pipeline.hosts[hosts.size()]));
+            host->set_next_processors(std::move(stage));
+        }
+        else
+        {
+            hosts.emplace_back(std::make_unique<AsyncProcessorHost>(std::move(stage), &_process_timer));
+        }
+        rt_stages->push_back(hosts.back().get());
+    }
+    // Hosts left over when the number of stages decreases
+    for (auto i = hosts.size(); i < pipeline.hosts.size(); ++i)
+    {
+        hosts.push_back(std::move(pipeline.hosts[i]));
+    }
+    pipeline.hosts.clear();
+
+    bool set = false;
+    if (realtime())
+    {
+        auto pipeline_event = RtEvent::make_track_pipeline_event(track->id(), rt_stages.get());
+        _send_control_event(pipeline_event);
+        auto status = _event_receiver.wait_for_response_status(pipeline_event.returnable_event()->event_id(), RT_EVENT_TIMEOUT);
+        if (status == receiver::ResponseStatus::TIMED_OUT)
+        {
+            /* The rt thread could still set the stages at a later point, or be using the
+             * current ones, so none of the hosts can be freed */
+            SUSHI_LOG_ERROR("Failed to set pipeline stages of track {} in realtime thread", track->name());
+            [[maybe_unused]] auto unreleased_stages = rt_stages.release();
+            for (auto& host : hosts)
+            {
+                [[maybe_unused]] auto unreleased_host = host.release();
+            }
+            return false;
+        }
+        set = status == receiver::ResponseStatus::HANDLED_OK;
+    }
+    else
+    {
+        set = track->set_pipeline(*rt_stages);
+    }
+
+    /* If set, hosts left over are no longer on the track and can be deleted. Otherwise the
+     * track still has its previous stages, and hosts created for new stages were never used */
+    SUSHI_LOG_DEBUG_IF(set, "Split track {} into {} pipeline stages", track->name(), stage_lengths.size());
+    hosts.resize(set ? rt_stages->size() : previous_hosts);
+    pipeline.hosts = std::move(hosts);
+    return set;
+}
+
+void AudioEngine::_update_pipeline_after_change(Track* track)
+{
+    std::scoped_lock lock(_pipeline_lock);
+    auto pipeline = _pipelines.find(track->id());
+    if (pipeline != _pipelines.end() && _update_pipeline(track, pipeline->second, false) == false)
+    {
+        SUSHI_LOG_WARNING("Failed to update pipeline stages of track {}", track->name());
+    }
+}
+
+void AudioEngine::_update_pipelines()
+{
+    std::scoped_lock lock(_pipeline_lock);
+    for (auto& [track_id, pipeline] : _pipelines)
+    {
+        auto track = _processors.mutable_track(track_id);
+        if (track && _update_pipeline(track.get(), pipeline, false) == false)
+        {
+            SUSHI_LOG_WARNING("Failed to update pipeline stages of track {}", track->name());
+        }
+    }
+}
+
+std::pair<EngineReturnStatus, int> AudioEngine::track_latency(ObjectId track_id) const
+{
+    std::scoped_lock lock(_latency_lock);
+    auto latency = _track_latencies.find(track_id);
+    if (latency == _track_latencies.end())
+    {
+        return {EngineReturnStatus::INVALID_TRACK, 0};
+    }
+    return {EngineReturnStatus::OK, latency->second.latency};
+}
+
+int AudioEngine::processing_latency() const
+{
+    std::scoped_lock lock(_latency_lock);
+    return _processing_latency;
+}
+
+int AudioEngine::_plugin_latency(const Track* track) const
+{
+    /* Buses of a track are delayed along with the rest of the track, so they can't be
+     * compensated individually, the one with the most latency counts */
+    int latency = 0;
+    std::array<int, MAX_TRACK_BUSES> bus_latencies{};
+    for (const auto& processor : _processors.processors_on_track(track->id()))
+    {
+        int processor_latency = processor->latency();
+        if (_async_hosts.count(processor->id()) > 0)
+        {
+            processor_latency += AsyncProcessorHost::latency();
+        }
+        auto bus = track->processor_bus(processor->id());
+        (bus.has_value() ? bus_latencies[*bus] : latency) += processor_latency;
+    }
+    latency += *std::max_element(bus_latencies.begin(), bus_latencies.end());
+    if (track->frozen())
+    {
+        /* Played back in sync with the transport, with the latency of the processors in the
+         * rendered audio as when they render live, but not rendered through a pipeline */
+        return latency;
+    }
+
+    {
+        std::scoped_lock lock(_pipeline_lock);
+        auto pipeline = _pipelines.find(track->id());
+        if (pipeline != _pipelines.end())
+        {
+            latency += static_cast<int>(pipeline->second.hosts.size()) * AsyncProcessorHost::latency();
+        }
+    }
+    // Tracks rendered ahead are rendered for the time they are played, and add no latency
+    return latency;
+}
+
+void AudioEngine::_update_latency_compensation()
+{
+    std::scoped_lock lock(_latency_lock);
+    std::vector<std::shared_ptr<Track>> tracks;
+    for (const auto& track : _processors.all_tracks())
+    {
+        if (track->type() == TrackType::REGULAR)
+        {
+            tracks.push_back(_processors.mutable_track(track->id()));
+        }
+    }
+
+    /* The latency of a group includes that of its members, the graph can't have cycles so
+     * every group is visited once its members are, taking at most one pass per level */
+    std::unordered_map<ObjectId, int> input_latencies;
+    std::unordered_map<ObjectId, int> latencies;
+    while (latencies.size() < tracks.size())
+    {
+        size_t visited = latencies.size();
+        for (const auto& track : tracks)
+        {
+            if (latencies.count(track->id()) > 0)
+            {
+                continue;
+            }
+            int input_latency = 0;
+            bool members_visited = true;
+            for (const auto& member : tracks)
+            {
+                if (member->output_group() == track.get())
+                {
+                    auto member_latency = latencies.find(member->id());
+                    if (member_latency == latencies.end())
+                    {
+                        members_visited = false;
+                        break;
+                    }
+                    input_latency = std::max(input_latency, member_latency->second);
+                }
+            }
+            if (members_visited)
+            {
+                input_latencies[track->id()] = input_latency;
+                latencies[track->id()] = input_latency + _plugin_latency(track.get());
+            }
+        }
+        if (latencies.size() == visited)
+        {
+            SUSHI_LOG_ERROR("Failed to calculate latency, tracks form a cycle");
+            return;
+        }
+    }
+
+    int processing_latency = 0;
+    for (const auto& track : tracks)
+    {
+        if (track->output_group() == nullptr)
+        {
+            processing_latency = std::max(processing_latency, latencies[track->id()]);
+        }
+    }
+
+    auto swap = std::make_unique<StorageSwap>();
+    std::unordered_map<ObjectId, TrackLatency> track_latencies;
+    for (const auto& track : tracks)
+    {
+        int latency = latencies[track->id()];
+        auto group = track->output_group();
+        int target = group ? input_latencies[group->id()] : processing_latency;
+        int delay = std::min(target - latency, MAX_COMPENSATION_DELAY);
+        SUSHI_LOG_WARNING_IF(delay < target - latency, "Latency of track {} can't be fully compensated", track->name());
+
+        auto previous = _track_latencies.find(track->id());
+        int previous_delay = previous != _track_latencies.end() ? previous->second.delay : 0;
+        if (delay != previous_delay)
+        {
+            track->set_compensation_delay(*swap, delay);
+        }
+        track_latencies[track->id()] = {latency, delay};
+    }
+    if (swap->empty() == false && _swap_storage(std::move(swap)) == false)
+    {
+        SUSHI_LOG_ERROR("Failed to update latency compensation delays");
+        return;
+    }
+    SUSHI_LOG_INFO_IF(processing_latency != _processing_latency, "Processing latency is now {} samples", processing_latency);
+    _track_latencies = std::move(track_latencies);
+    _processing_latency = processing_latency;
+}
+
 bool AudioEngine::_remove_track(Track* track)
 {
     bool removed = false;
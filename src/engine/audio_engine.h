@@ -21,9 +21,14 @@
 #ifndef SUSHI_ENGINE_H
 #define SUSHI_ENGINE_H
 
+#include <array>
+#include <atomic>
 #include <vector>
 #include <utility>
 #include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <functional>
 
 #include "twine/twine.h"
 
@@ -38,7 +43,14 @@
 #include "engine/plugin_library.h"
 #include "engine/controller/controller.h"
 #include "engine/audio_graph.h"
+#include "engine/audio_routing.h"
+#include "engine/track_balancer.h"
+#include "engine/overload_shedder.h"
+#include "engine/plugin_cost_model.h"
 #include "engine/connection_storage.h"
+#include "engine/processor_table.h"
+#include "engine/render_ahead_host.h"
+#include "engine/storage_swap.h"
 #include "library/time.h"
 #include "library/sample_buffer.h"
 #include "library/internal_plugin.h"
@@ -51,6 +63,15 @@
 namespace sushi {
 namespace engine {
 
+/* The maximum number of tracks whose plugins are rendered ahead of time */
+constexpr int MAX_RENDER_AHEAD_TRACKS = 16;
+
+enum class CpuBudgetPolicy
+{
+    WARN,
+    REJECT
+};
+
 class ClipDetector
 {
 public:
@@ -79,8 +100,6 @@ private:
     std::vector<unsigned int> _output_clip_count;
 };
 
-constexpr int MAX_RT_PROCESSOR_ID = 100000;
-
 class AudioEngine : public BaseEngine
 {
 public:
@@ -97,11 +116,16 @@ public:
      *                      multicore mode.
      * @param event_dispatcher A pointer to a BaseEventDispatcher instance, which AudioEngine takes over ownership of.
      *                         If nullptr, a normal EventDispatcher is created and used.
+     * @param scheduling How tracks are distributed over the cpu cores in multicore mode.
+     * @param worker_priority The rt priority of the parallel threads in multicore mode.
+     *                        The first core is always processed in the rt callback.
      */
     explicit AudioEngine(float sample_rate,
                          int rt_cpu_cores = 1,
                          bool debug_mode_sw = false,
-                         dispatcher::BaseEventDispatcher* event_dispatcher = nullptr);
+                         dispatcher::BaseEventDispatcher* event_dispatcher = nullptr,
+                         TrackScheduling scheduling = TrackScheduling::STATIC,
+                         int worker_priority = DEFAULT_WORKER_PRIORITY);
 
      ~AudioEngine() override;
 
@@ -386,6 +410,193 @@ public:
      */
     EngineReturnStatus delete_track(ObjectId track_id) override;
 
+    /**
+     * @brief Pin a track to a given cpu core, so that it is always processed by that core.
+     *        Tracks that are not pinned are moved between cores based on their measured
+     *        processing load if timings are enabled and more than one core is used.
+     * @param track_id The id of the track to pin
+     * @param core The core to pin the track to, if no value, any previous pinning is removed
+     * @return EngineReturnStatus::OK in case of success, different error code otherwise.
+     */
+    EngineReturnStatus pin_track_to_core(ObjectId track_id, std::optional<int> core) override;
+
+    /**
+     * @brief Route the output of a track into a group track. The group sums the output of
+     *        all its members, with their gain and pan applied, into its input, and can in
+     *        turn be routed into another group. The group replaces the output connections
+     *        of the member, which are kept but not mixed to the engine outputs while the
+     *        member is in the group, so that it isn't heard twice.
+     * @param track_id The id of the track to add to the group
+     * @param group_id The id of the group track
+     * @return EngineReturnStatus::OK in case of success, INVALID_TRACK if either track is
+     *         not found or not a regular track, ERROR if the connection would create a cycle.
+     */
+    EngineReturnStatus connect_track_to_group(ObjectId track_id, ObjectId group_id) override;
+
+    /**
+     * @brief Remove a track from the group it is routed to, if any
+     * @param track_id The id of the track
+     * @return EngineReturnStatus::OK in case of success, different error code otherwise.
+     */
+    EngineReturnStatus disconnect_track_from_group(ObjectId track_id) override;
+
+    /**
+     * @brief Render the processors of a track ahead of time into memory and play back the
+     *        result in sync with the transport instead of processing them, until
+     *        unfreeze_track() is called.
+     *        Meant for tracks whose output doesn't depend on live input or incoming events,
+     *        such as tracks with generators or instruments driven by a sequencer on the same
+     *        track. The track is taken out of the rt processing while rendering, which is
+     *        done in the calling thread with silent input and without events, and events
+     *        sent to it or its processors meanwhile are lost. Tracks that render only silence
+     *        this way are refused. Playback follows the transport position, with the
+     *        start of the audio at position 0, and jumps along with the transport. It is
+     *        silent while the transport is stopped and outside of the rendered audio. The
+     *        gain and pan of the track are still applied on playback.
+     * @param track_id The id of the track to freeze
+     * @param duration The length of the audio to render, rounded up to whole chunks
+     * @return EngineReturnStatus::OK in case of success, different error code otherwise.
+     */
+    EngineReturnStatus freeze_track(ObjectId track_id, Time duration) override;
+
+    /**
+     * @brief Return a frozen track to processing its processors
+     * @param track_id The id of the track
+     * @return EngineReturnStatus::OK in case of success, different error code otherwise.
+     */
+    EngineReturnStatus unfreeze_track(ObjectId track_id) override;
+
+    /**
+     * @brief Render the plugins of a track that takes no live input ahead of time, in a low
+     *        priority thread, and only mix in the rendered audio in the rt thread. The track
+     *        is rendered with silent input, against the transport as it will be when each
+     *        chunk is played, so its audio is not delayed. Events to it or its plugins take
+     *        effect in the chunk rendered next, so they are heard up to chunks *
+     *        AUDIO_CHUNK_SIZE samples late. Plugins can't be added to or removed from the
+     *        track while enabled. Refused for tracks with audio input connections, or sends
+     *        to them from other tracks, and audio inputs can't be connected while enabled.
+     * @param track_id The id of the track
+     * @param chunks The number of chunks to render ahead, 0 returns the track to normal
+     *        processing
+     * @return EngineReturnStatus::OK in case of success, different error code otherwise.
+     */
+    EngineReturnStatus set_track_render_ahead(ObjectId track_id, int chunks) override;
+
+    /**
+     * @brief Adapt the number of cpu cores used for processing to the measured load, so
+     *        that tracks are gathered on fewer cores when the load is low and the workers
+     *        of the remaining cores are not woken up. Enables the performance timer, as
+     *        the load is measured with it. Only has an effect in multicore mode.
+     * @param enabled If true, enable elastic core activation, otherwise all cores are used
+     */
+    void set_elastic_cores(bool enabled);
+
+    /**
+     * @brief Stop rendering the tracks with the lowest priority, one priority at a time,
+     *        when processing a chunk has taken close to the whole chunk period for several
+     *        chunks in a row, and render them again once the load has stayed low for a
+     *        while. Shed tracks are faded out and in over one chunk and their output is
+     *        silent meanwhile. Tracks with the highest priority are never shed. The number
+     *        of shed tracks is reported with the engine timing notifications. Enables the
+     *        performance timer, as the load is measured with it.
+     * @param enabled If true, enable overload shedding, otherwise all tracks are rendered
+     */
+    void set_overload_shedding(bool enabled);
+
+    /**
+     * @brief Set the priority of a track, tracks with lower priority are shed first when
+     *        the engine is overloaded and overload shedding is enabled.
+     * @param track_id The id of the track
+     * @param priority The priority, higher is more important, tracks default to
+     *        DEFAULT_TRACK_PRIORITY
+     * @return EngineReturnStatus::OK in case of success, INVALID_TRACK if the track was
+     *         not found or is a pre or post track
+     */
+    EngineReturnStatus set_track_priority(ObjectId track_id, int priority) override;
+
+    /**
+     * @brief Watch the workers of the cpu cores in multicore mode, and if one hasn't
+     *        finished rendering within a number of chunk periods, i.e. because a plugin
+     *        has hung, stop waiting for it. The tracks of that core are silent until its
+     *        worker finishes, while the other cores keep rendering. The core, track and
+     *        processor the worker hung in are sent as a CoreStallNotificationEvent, and
+     *        again when it recovers. The first core is rendered by the audio thread and
+     *        can't be watched.
+     * @param chunk_periods The time to wait for the workers, in chunk periods, 0 waits
+     *        for them indefinitely
+     */
+    void set_worker_watchdog(float chunk_periods);
+
+    /**
+     * @brief Set a budget for the load of the most loaded cpu core. Adding a plugin to a
+     *        track is checked against it, using the current load of the cores and the
+     *        cost of the plugin learned from the timings of its instances. Plugins moved
+     *        between tracks are not checked again. Enables the performance timer, as both
+     *        the load and the costs are measured with it. The costs are learned only from
+     *        chunks the plugins processed, not from chunks skipped while they were idle.
+     * @param budget The budget, in fractions of the audio chunk period, or nothing to not
+     *        check plugins
+     * @param policy Whether plugins over budget are rejected, or only logged
+     */
+    void set_cpu_budget(std::optional<float> budget, CpuBudgetPolicy policy = CpuBudgetPolicy::REJECT);
+
+    /**
+     * @brief Load the costs of plugins learned in earlier sessions from a file, which the
+     *        costs are periodically saved to. Call before the engine is started.
+     * @param path The path of the file, which doesn't need to exist
+     */
+    void set_plugin_cost_file(const std::string& path);
+
+    /**
+     * @brief Predict the load of the most loaded cpu core if an instance of a plugin was
+     *        added to a track, from the learned cost of the plugin.
+     * @param plugin_uid The uid of the plugin
+     * @param track_id The id of the track
+     * @return The prediction, and EngineReturnStatus::OK, or INVALID_TRACK if the track
+     *         was not found
+     */
+    std::pair<EngineReturnStatus, LoadPrediction> predict_plugin_load(const std::string& plugin_uid,
+                                                                      ObjectId track_id) override;
+
+    /**
+     * @brief Process the plugin chain of a track as a pipeline of stages, each running in
+     *        its own realtime thread, in parallel with the others. Every stage adds
+     *        AsyncProcessorHost::latency() samples of latency to the track's output. The
+     *        chain is split so that the stages are as evenly loaded as possible, based on
+     *        the timings of the plugins, and is split again when the timings change.
+     * @param track_id The id of the track
+     * @param stages The number of stages, limited to the number of plugins on the track.
+     *        0 returns the track to normal processing.
+     * @return EngineReturnStatus::OK in case of success, different error code otherwise.
+     */
+    EngineReturnStatus set_track_pipeline_stages(ObjectId track_id, int stages) override;
+
+    /**
+     * @brief Return the stages of a track processed as a pipeline
+     * @param track_id The id of the track
+     * @return The stages of the track, in processing order, empty if the track is not
+     *         processed as a pipeline
+     */
+    std::vector<PipelineStage> track_pipeline(ObjectId track_id) const override;
+
+    /**
+     * @brief Return the latency of the output of a track, from its plugins, including those
+     *        of the tracks in it if it is a group, and from asynchronous, pipelined and
+     *        render ahead processing. Excludes the delay added to compensate for the
+     *        latency of other tracks.
+     * @param track_id The id of the track
+     * @return The latency in samples, and EngineReturnStatus::OK, or INVALID_TRACK if the
+     *         track was not found
+     */
+    std::pair<EngineReturnStatus, int> track_latency(ObjectId track_id) const override;
+
+    /**
+     * @brief Return the latency of the engine output, which the output of all tracks is
+     *        delayed to match. This is the highest latency of any track not in a group.
+     * @return The latency in samples
+     */
+    int processing_latency() const override;
+
     /**
      * @brief Create a processor instance, either from internal plugins or loaded from file.
      *        The created plugin can then be added to tracks.
@@ -417,6 +628,32 @@ public:
      */
     EngineReturnStatus remove_plugin_from_track(ObjectId plugin_id, ObjectId track_id) override;
 
+    /**
+     * @brief Process a plugin asynchronously in a dedicated realtime thread, in parallel
+     *        with the rest of its track. This adds AsyncProcessorHost::latency() samples
+     *        of latency to the plugin's output, but lets a single expensive plugin run
+     *        without stalling the rest of the track.
+     * @param plugin_id The id of the plugin
+     * @param track_id The id of the track that contains the plugin
+     * @param enabled If true, process the plugin asynchronously, if false, process it
+     *        normally as part of the track
+     * @return EngineReturnStatus::OK in case of success, different error code otherwise
+     */
+    EngineReturnStatus set_processor_async(ObjectId plugin_id, ObjectId track_id, bool enabled) override;
+
+    /**
+     * @brief Assign a plugin on a multibus track to one of the track's stereo buses, so
+     *        that it only processes the channels of that bus, or return it to processing
+     *        all channels of the track. When all plugins on a track are assigned to a bus,
+     *        the buses are rendered independently, in parallel if several cores are used.
+     *        The plugin is briefly removed from the track to change its channel setup.
+     * @param plugin_id The id of the plugin
+     * @param track_id The id of the track that contains the plugin
+     * @param bus The index of the bus, if no value, the plugin processes all channels
+     * @return EngineReturnStatus::OK in case of success, different error code otherwise
+     */
+    EngineReturnStatus set_processor_bus(ObjectId plugin_id, ObjectId track_id, std::optional<int> bus) override;
+
     /**
      * @brief Delete and unload a plugin instance from Sushi. The plugin must
      *        not currently be active on any track.
@@ -425,6 +662,54 @@ public:
      */
     EngineReturnStatus delete_plugin(ObjectId plugin_id) override;
 
+    /**
+     * @brief Open a transaction to collect graph edits into. Only edits made through
+     *        run_in_graph_transaction() with the returned id are part of it, other edits
+     *        take effect directly. Only one transaction can be open at a time. If it is
+     *        neither committed nor aborted before it expires, it is rolled back. If the
+     *        engine is not running in realtime mode, edits are applied directly and the
+     *        transaction has no effect.
+     * @param expiry How long the transaction may stay open
+     * @return EngineReturnStatus::OK and the id of the transaction in case of success,
+     *         ALREADY_IN_USE if another transaction is open.
+     */
+    std::pair<EngineReturnStatus, int> begin_graph_transaction(Time expiry) override;
+
+    /**
+     * @brief Make graph edits as part of an open transaction. Creating and deleting tracks
+     *        and plugins, adding and removing plugins from tracks, and connecting and
+     *        disconnecting audio channels, made from the calling thread while edits runs,
+     *        only prepare the change and return without waiting for the rt thread. Other
+     *        calls take effect directly.
+     * @param transaction_id The id returned by begin_graph_transaction()
+     * @param edits A function making the edits
+     * @return EngineReturnStatus::OK in case of success, ERROR if the transaction isn't
+     *         open, or has expired, in which case edits is not run.
+     */
+    EngineReturnStatus run_in_graph_transaction(int transaction_id, const std::function<void()>& edits) override;
+
+    /**
+     * @brief Apply all edits made in a transaction in the rt thread, with a single event,
+     *        so that they all take effect in the same audio chunk, and close it. If any
+     *        edit fails, all of them are reverted.
+     * @param transaction_id The id returned by begin_graph_transaction()
+     * @return EngineReturnStatus::OK in case of success, ERROR if the transaction isn't
+     *         open, has expired, or its edits were reverted, or if the rt thread didn't
+     *         respond in time, in which case the edits may still take effect later and
+     *         can't be reverted.
+     */
+    EngineReturnStatus commit_graph_transaction(int transaction_id) override;
+
+    /**
+     * @brief Revert all edits made in a transaction, without them reaching the rt thread,
+     *        and close it.
+     * @param transaction_id The id returned by begin_graph_transaction()
+     * @return EngineReturnStatus::OK in case of success, ERROR if the transaction isn't
+     *         open or has expired, or if the engine is not running in realtime mode, in
+     *         which case the edits have already taken effect.
+     */
+    EngineReturnStatus abort_graph_transaction(int transaction_id) override;
+
     /**
      * @brief Enable audio clip detection on engine inputs
      * @param enabled Enable if true, disable if false
@@ -500,7 +785,8 @@ public:
     }
 
     /**
-     * @brief Print the current processor timings (in enabled) in the log
+     * @brief Print the current processor timings (in enabled) in the log and
+     *        rebalance the tracks over the cpu cores in multicore mode.
      */
     void update_timings() override;
 
@@ -540,6 +826,49 @@ private:
      */
     bool _remove_processor_from_realtime_part(ObjectId processor);
 
+    /**
+     * @brief Resize the table of realtime processors if the number of registered
+     *        processors no longer fits in it, or if it has become mostly empty.
+     * @return True if the table was resized or didn't need to be
+     */
+    bool _resize_realtime_processors();
+
+    /**
+     * @brief Make room for another processor on a track, if the track is full
+     * @param track The track to add a processor to
+     * @return True if there is room for another processor on the track
+     */
+    bool _reserve_track_processor(Track* track);
+
+    /**
+     * @brief Make room for another track in the audio graph, if it is full
+     * @return True if there is room for another track
+     */
+    bool _reserve_graph_track();
+
+    /**
+     * @brief Make room in the audio graph for the dependencies between tracks that another
+     *        track or plugin could add, if it is full
+     * @return True if there is room for the dependencies
+     */
+    bool _reserve_graph_dependencies();
+
+    /**
+     * @brief Make room for another audio connection in each direction, if the connection
+     *        storage is full
+     * @return True if there is room for another connection
+     */
+    bool _reserve_audio_connection();
+
+    /**
+     * @brief Replace storage used by the rt thread with storage allocated outside of it.
+     *        In realtime mode, the swap is done by the rt thread and the previous storage
+     *        is freed when it has been acknowledged, and can no longer be referenced.
+     * @param swap The storage to swap in
+     * @return True if the storage was swapped in
+     */
+    bool _swap_storage(std::unique_ptr<StorageSwap> swap);
+
     /**
      * @brief Remove all audio connections from track
      * @param track_id The id of the track to remove from
@@ -569,6 +898,99 @@ private:
 
     void _process_internal_rt_events();
 
+    /**
+     * @brief Apply an event that adds or removes a processor, a track or an audio
+     *        connection. Called from the rt thread, or if not running, from a non-rt thread.
+     * @param event The event to apply
+     * @return True if successful, false otherwise
+     */
+    bool _apply_graph_event(const RtEvent& event);
+
+    /**
+     * @brief Apply a batch of graph events in order. If one of them fails, the events
+     *        already applied are reverted with the corresponding undo events.
+     * @param events The events to apply
+     * @param undo_events For every event, an event that reverts it
+     * @return True if all events were applied, false if they were reverted
+     */
+    bool _apply_graph_transaction(const std::vector<RtEvent>& events, const std::vector<RtEvent>& undo_events);
+
+    /**
+     * @brief Apply a batch of graph events outside of any open transaction, in the rt thread
+     *        if running, otherwise directly, and wait for them to take effect.
+     * @param events The events to apply
+     * @param undo_events For every event, an event that reverts it
+     * @return True if all events were applied, false if they were reverted or the rt
+     *         thread didn't respond in time
+     */
+    bool _apply_graph_events(std::vector<RtEvent> events, std::vector<RtEvent> undo_events);
+
+    /**
+     * @brief Temporarily take a track and its processors out of the rt part, so that it
+     *        can be modified from the calling thread, or put them back.
+     * @param track The track
+     * @param remove If true, take the track out of the rt part, otherwise put it back
+     * @param processors If false, only the track itself is taken out or put back
+     * @return True if successful, false otherwise
+     */
+    bool _set_track_offline(Track* track, bool remove, bool processors = true);
+
+    /**
+     * @brief Whether the plugins of a track are rendered ahead of time
+     * @param track_id The id of the track
+     * @return true if the track has a render ahead host
+     */
+    bool _is_rendered_ahead(ObjectId track_id) const
+    {
+        return _render_ahead_hosts.count(track_id) > 0;
+    }
+
+    /**
+     * @brief Add a graph event to the open transaction
+     * @param event The event to send to the rt thread on commit
+     * @param undo_event An event that reverts event, used if the transaction fails
+     * @param undo_action Reverts the non-rt part of the edit if the transaction fails
+     */
+    void _add_to_transaction(const RtEvent& event, const RtEvent& undo_event, std::function<void()> undo_action);
+
+    /**
+     * @brief Roll back the edits of the open transaction, if it has expired. Must be called
+     *        with _transaction_lock held.
+     */
+    void _expire_graph_transaction();
+
+    /**
+     * @brief Revert the non-rt part of the edits of the open transaction and close it. Must
+     *        be called with _transaction_lock held.
+     */
+    void _roll_back_graph_transaction();
+
+    /**
+     * @brief Return whether edits should be added to the open transaction, i.e. if they
+     *        are made from run_in_graph_transaction(). Other edits take effect directly.
+     * @return true if the calling thread is making edits in the open transaction
+     */
+    bool _in_transaction() const
+    {
+        return _transaction_thread.load(std::memory_order_acquire) == std::this_thread::get_id() && _transaction;
+    }
+
+    /**
+     * @brief Run an action once the rt part of an edit has taken effect, directly if
+     *        not in a transaction, otherwise when the transaction has been committed.
+     * @param action The action to run
+     */
+    void _on_graph_change(std::function<void()> action);
+
+    /**
+     * @brief Check if a processor is on a track in the engine's mirror of the track
+     *        chains, which, unlike Processor::active_rt_processing(), includes edits
+     *        made in an open transaction.
+     * @param processor_id The id of the processor
+     * @return True if the processor is on a track
+     */
+    bool _is_on_track(ObjectId processor_id) const;
+
     void _send_rt_events_to_processors();
 
     void _send_rt_event(const RtEvent& event);
@@ -599,17 +1021,122 @@ private:
  */
     bool _remove_track(Track* track);
 
+    /**
+     * @brief Move a track to another cpu core, if engine is running, this is done with an RtEvent
+     * @param track The track to move
+     * @param core The core to move the track to
+     * @return True if successful, false otherwise
+     */
+    bool _move_track_to_core(Track* track, int core);
+
+    /**
+     * @brief Move tracks between cpu cores based on their recorded timings to even out
+     *        the load between cores. Called periodically from a non-rt thread.
+     */
+    void _rebalance_tracks();
+
+    /**
+     * @brief Shed or restore tracks from the load of the chunk being processed, or restore
+     *        all shed tracks if overload shedding is disabled. Called from the rt thread
+     *        after the tracks are rendered.
+     * @param chunk_start The timestamp taken when processing of the chunk started
+     */
+    void _update_overload_shedding(performance::TimePoint chunk_start);
+
+    /**
+     * @brief Send notifications for cores whose worker has stalled or recovered since
+     *        the last chunk. Called from the rt thread after the tracks are rendered.
+     */
+    void _report_stalled_cores();
+
+    /**
+     * @brief Predict the load of the most loaded core if a plugin is added to a track
+     * @param track The track
+     * @param plugin_load The cost of the plugin, if known
+     * @return The prediction
+     */
+    LoadPrediction _predict_load(const Track* track, std::optional<float> plugin_load);
+
+    /**
+     * @brief Check that adding a plugin to a track keeps the predicted load within the cpu
+     *        budget, if a budget is set and the plugin has not been on a track before.
+     *        Exceeding the budget is posted as a CpuBudgetNotificationEvent, so that
+     *        controller clients learn why the plugin was not added.
+     * @param plugin_id The id of the plugin
+     * @param track The track
+     * @return true if the plugin can be added, false if it is rejected
+     */
+    bool _check_cpu_budget(ObjectId plugin_id, const Track* track);
+
+    /**
+     * @brief Whether a track takes live audio, from the engine inputs or sent from other tracks
+     * @param track The track
+     * @return true if audio is connected or sent to the track
+     */
+    bool _has_live_input(const Track* track) const;
+
+    struct TrackPipeline
+    {
+        int stages{0};
+        std::vector<std::unique_ptr<AsyncProcessorHost>> hosts;
+    };
+
+    /**
+     * @brief Split the plugin chain of a track into pipeline stages, if the split differs
+     *        from the current one. If engine is running, the stages are swapped in with an
+     *        RtEvent. Must be called with _pipeline_lock held.
+     * @param track The track to split
+     * @param pipeline The current pipeline of the track, updated if the stages are swapped
+     * @param force If false, only split the chain again if the track's plugins have changed
+     *        or if this makes the most loaded stage significantly less loaded
+     * @return True if successful, false otherwise
+     */
+    bool _update_pipeline(Track* track, TrackPipeline& pipeline, bool force);
+
+    /**
+     * @brief Split the plugin chain of a track processed as a pipeline again after
+     *        plugins were added or removed
+     * @param track The track
+     */
+    void _update_pipeline_after_change(Track* track);
+
+    /**
+     * @brief Split the plugin chains of tracks processed as pipelines again if their
+     *        timings have changed. Called periodically from a non-rt thread.
+     */
+    void _update_pipelines();
+
+    /**
+     * @brief Return the latency that the plugins of a track add to its output, including
+     *        asynchronous and pipelined processing, but not that of its input. Rendering
+     *        ahead adds none.
+     * @param track The track
+     * @return The latency in samples
+     */
+    int _plugin_latency(const Track* track) const;
+
+    /**
+     * @brief Calculate the latency of every track and delay the outputs of all tracks
+     *        going into the same group, or to the engine outputs, to line up with the one
+     *        with the most latency. Called after changes to the graph and periodically from
+     *        a non-rt thread, to pick up changes in the latency reported by plugins.
+     */
+    void _update_latency_compensation();
+
     void print_timings_to_file(const std::string& filename);
 
     void _route_cv_gate_ins(ControlBuffer& buffer);
 
+    inline void _wait_for_async_processing();
+
     PluginRegistry _plugin_registry;
     ProcessorContainer _processors;
 
-    // Processors in the realtime part indexed by their unique 32 bit id
-    // Only to be accessed from the process callback in rt mode.
-    std::vector<Processor*>    _realtime_processors{MAX_RT_PROCESSOR_ID, nullptr};
+    // Processors in the realtime part by their unique 32 bit id. Only to be accessed
+    // from the process callback in rt mode, and resized through _swap_storage()
+    ProcessorTable             _realtime_processors;
     AudioGraph                 _audio_graph;
+    TrackBalancer              _track_balancer;
 
     Track* _pre_track{nullptr};
     Track* _post_track{nullptr};
@@ -618,6 +1145,8 @@ private:
 
     ConnectionStorage<AudioConnection> _audio_in_connections;
     ConnectionStorage<AudioConnection> _audio_out_connections;
+    // Compiled from the rt part of the connections above, updated whenever they change
+    AudioRouting                       _audio_routing;
     std::vector<CvConnection>    _cv_in_connections;
     std::vector<GateConnection>  _gate_in_connections;
 
@@ -642,12 +1171,70 @@ private:
     performance::PerformanceTimer _process_timer;
     int  _log_timing_print_counter{0};
 
+    std::atomic_bool _overload_shedding{false};
+    OverloadShedder  _overload_shedder;
+    int              _reported_shed_tracks{0};
+
+    float             _watchdog_periods{0.0f};
+    /* Stall state of each core as last reported from the rt thread */
+    std::vector<bool> _reported_stalls;
+    int               _logged_stalled_cores{0};
+    int               _logged_dropped_dependencies{0};
+
+    PluginCostModel      _plugin_costs;
+    std::string          _plugin_cost_file;
+    std::optional<float> _cpu_budget;
+    CpuBudgetPolicy      _cpu_budget_policy{CpuBudgetPolicy::REJECT};
+    mutable std::mutex   _cpu_budget_lock;
+
     bool _input_clip_detection_enabled{false};
     bool _output_clip_detection_enabled{false};
     ClipDetector _clip_detector;
 
     bool _master_limiter_enabled{false};
     std::vector<dsp::MasterLimiter<AUDIO_CHUNK_SIZE>> _master_limiters;
+
+    // Hosts for asynchronously processed plugins, indexed by plugin id
+    std::unordered_map<ObjectId, std::unique_ptr<AsyncProcessorHost>> _async_hosts;
+
+    // Tracks processed as pipelines, indexed by track id
+    std::unordered_map<ObjectId, TrackPipeline> _pipelines;
+    mutable std::mutex _pipeline_lock;
+
+    // Hosts of tracks rendered ahead of time, indexed by track id
+    std::unordered_map<ObjectId, std::unique_ptr<RenderAheadHost>> _render_ahead_hosts;
+    /* The same hosts as seen from the rt thread, which passes them the events to the
+     * processors they host, as those are not in the rt processor table */
+    std::array<std::atomic<RenderAheadHost*>, MAX_RENDER_AHEAD_TRACKS> _rt_render_ahead_hosts{};
+
+    // Latency of tracks and the delay added to their output, indexed by track id
+    struct TrackLatency
+    {
+        int latency;
+        int delay;
+    };
+    std::unordered_map<ObjectId, TrackLatency> _track_latencies;
+    int _processing_latency{0};
+    mutable std::mutex _latency_lock;
+
+    /* Graph edits made in a transaction, undo_events and undo_actions are only used if
+     * the transaction fails or is rolled back, commit_actions only if it succeeds */
+    struct GraphTransaction
+    {
+        int id;
+        std::chrono::steady_clock::time_point expiry;
+        std::vector<RtEvent> events;
+        std::vector<RtEvent> undo_events;
+        std::vector<std::function<void()>> undo_actions;
+        std::vector<std::function<void()>> commit_actions;
+    };
+    /* Held while a transaction is opened, edited, committed or rolled back */
+    std::mutex                        _transaction_lock;
+    std::unique_ptr<GraphTransaction> _transaction;
+    int                               _next_transaction_id{1};
+    /* The thread running run_in_graph_transaction(), if any */
+    std::atomic<std::thread::id>      _transaction_thread{std::thread::id()};
+    std::atomic_bool                  _transaction_open{false};
 };
 
 /**
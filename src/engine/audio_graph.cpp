@@ -19,6 +19,10 @@
  * @copyright 2017-2022 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
  */
 
+#include <algorithm>
+#include <mutex>
+#include <optional>
+
 #include "twine/src/twine_internal.h"
 
 #include "audio_graph.h"
@@ -27,49 +31,85 @@ namespace sushi {
 namespace engine {
 
 constexpr bool DISABLE_DENORMALS = true;
+constexpr int  UNASSIGNED_LEVEL = -1;
+constexpr int  WATCHDOG_SPINS_BEFORE_BLOCKING = 256;
 
-void external_render_callback(void* data)
+AudioGraph::AudioGraph(int cpu_cores,
+                       int max_no_tracks,
+                       bool debug_mode_switches,
+                       TrackScheduling scheduling,
+                       int worker_priority) : _audio_graph(cpu_cores),
+                                                     _core_watch(cpu_cores),
+                                                     _event_outputs(cpu_cores),
+                                                     _work_queues(cpu_cores),
+                                                     _scheduling(scheduling),
+                                                     _max_tracks(max_no_tracks),
+                                                     _cores(cpu_cores),
+                                                     _current_core(0)
 {
-    /* Signal that this is a realtime audio processing thread */
-    twine::ThreadRtFlag rt_flag;
+    assert(cpu_cores > 0);
+    for (auto& i : _audio_graph)
+    {
+        i.reserve(max_no_tracks);
+    }
+    _nodes.reserve(max_no_tracks);
+    _bus_nodes.reserve(max_no_tracks * MAX_TRACK_BUSES);
+    _bus_tracks.reserve(max_no_tracks);
+    _dependencies.reserve(2 * max_no_tracks);
+    _prev_dependencies.reserve(2 * max_no_tracks);
+    _groups.reserve(max_no_tracks);
+    _group_members.reserve(max_no_tracks);
 
-    auto tracks = reinterpret_cast<std::vector<Track*>*>(data);
-    for (auto i : *tracks)
+    _worker_data.reserve(_cores);
+    _woken_workers.resize(_cores, false);
+    for (int core = 0; core < _cores; ++core)
     {
-        i->render();
+        _worker_data.push_back({this, core});
+        if (core > 0)
+        {
+            auto worker = twine::WorkerPool::create_worker_pool(_cores, DISABLE_DENORMALS, debug_mode_switches);
+            worker->add_worker(_render_worker, &_worker_data.back(), worker_priority, core);
+            _workers.push_back(std::move(worker));
+        }
     }
 }
 
-AudioGraph::AudioGraph(int cpu_cores,
-                       int max_no_tracks,
-                       bool debug_mode_switches) : _audio_graph(cpu_cores),
-                                                   _event_outputs(cpu_cores),
-                                                   _cores(cpu_cores),
-                                                   _current_core(0)
+void AudioGraph::grow(StorageSwap& swap, int max_no_tracks)
 {
-    assert(cpu_cores > 0);
-    if (_cores > 1)
+    if (max_no_tracks <= _max_tracks)
     {
-        _worker_pool = twine::WorkerPool::create_worker_pool(_cores, DISABLE_DENORMALS, debug_mode_switches);
-        for (auto& i : _audio_graph)
-        {
-            _worker_pool->add_worker(external_render_callback, &i);
-            i.reserve(max_no_tracks);
-        }
+        return;
     }
-    else
+    for (auto& slot : _audio_graph)
+    {
+        swap.add_vector(&slot, max_no_tracks);
+    }
+    swap.add_vector(&_nodes, max_no_tracks);
+    swap.add_vector(&_bus_nodes, max_no_tracks * MAX_TRACK_BUSES);
+    swap.add_vector(&_bus_tracks, max_no_tracks);
+    swap.add_vector(&_groups, max_no_tracks);
+    swap.add_vector(&_group_members, max_no_tracks);
+    // _nodes points into the track lists, so it needs to be rebuilt on the next render
+    swap.on_swap([this]() {_order_changed = true;});
+    _max_tracks = max_no_tracks;
+}
+
+void AudioGraph::grow_dependencies(StorageSwap& swap, int max_dependencies)
+{
+    if (max_dependencies <= this->max_dependencies())
     {
-        _audio_graph[0].reserve(max_no_tracks);
+        return;
     }
+    swap.add_vector(&_dependencies, max_dependencies);
+    swap.add_vector(&_prev_dependencies, max_dependencies);
+    // Dependencies that didn't fit before need to be collected again
+    swap.on_swap([this]() {_order_changed = true;});
 }
 
 bool AudioGraph::add(Track* track)
 {
-    auto& slot = _audio_graph[_current_core];
-    if (slot.size() < slot.capacity())
+    if (add_to_core(track, _current_core))
     {
-        track->set_event_output(&_event_outputs[_current_core]);
-        slot.push_back(track);
         _current_core = (_current_core + 1) % _cores;
         return true;
     }
@@ -83,7 +123,31 @@ bool AudioGraph::add_to_core(Track* track, int core)
     if (slot.size() < slot.capacity())
     {
         track->set_event_output(&_event_outputs[core]);
-        slot.push_back(track);
+        track->set_assigned_core(core);
+        slot.push_back({track, 0});
+        _order_changed = true;
+        return true;
+    }
+    return false;
+}
+
+bool AudioGraph::move_to_core(Track* track, int core)
+{
+    assert(core < _cores);
+    if (track->assigned_core() == core)
+    {
+        return true;
+    }
+    // Check for room first, a track that is removed but not added again would never be rendered
+    auto& slot = _audio_graph[core];
+    if (slot.size() >= slot.capacity())
+    {
+        return false;
+    }
+    if (remove(track))
+    {
+        [[maybe_unused]] bool added = add_to_core(track, core);
+        assert(added);
         return true;
     }
     return false;
@@ -95,9 +159,11 @@ bool AudioGraph::remove(Track* track)
     {
         for (auto i = slot.begin(); i != slot.end(); ++i)
         {
-            if (*i == track)
+            if (i->track == track)
             {
+                track->set_assigned_core(UNASSIGNED_CORE);
                 slot.erase(i);
+                _order_changed = true;
                 return true;
             }
         }
@@ -107,17 +173,614 @@ bool AudioGraph::remove(Track* track)
 
 void AudioGraph::render()
 {
+    _update_dependencies();
+    _update_shed_tracks();
+    if (_stalled_cores.load(std::memory_order_relaxed) > 0)
+    {
+        _recover_stalled_cores();
+    }
+
     if (_cores == 1)
     {
-        for (auto& track : _audio_graph[0])
+        // Tracks are kept sorted by level, so rendering them in order respects all dependencies
+        for (auto& node : _audio_graph[0])
         {
-            track->render();
+            _sum_group_members(node);
+            node.track->render();
         }
     }
     else
     {
-        _worker_pool->wakeup_and_wait();
+        _render_start = twine::current_rt_time();
+        for (_current_level = 0; _current_level < _levels; ++_current_level)
+        {
+            _prepare_work_queues(_current_level);
+            _prepare_bus_nodes(_current_level);
+            _wake_workers();
+            // The calling thread works as the worker of core 0
+            _render_level(0);
+            _wait_for_workers();
+            _finish_bus_nodes();
+        }
+    }
+}
+
+bool AudioGraph::shed_lowest_priority()
+{
+    std::optional<int> lowest;
+    int highest = std::numeric_limits<int>::min();
+    for (const auto& slot : _audio_graph)
+    {
+        for (const auto& node : slot)
+        {
+            int priority = node.track->priority();
+            highest = std::max(highest, priority);
+            if (priority >= _shed_below && (lowest.has_value() == false || priority < *lowest))
+            {
+                lowest = priority;
+            }
+        }
+    }
+    if (lowest.has_value() == false || *lowest >= highest)
+    {
+        return false;
+    }
+    _shed_below = *lowest + 1;
+    return true;
+}
+
+bool AudioGraph::restore_shed_priority()
+{
+    std::optional<int> highest_shed;
+    for (const auto& slot : _audio_graph)
+    {
+        for (const auto& node : slot)
+        {
+            int priority = node.track->priority();
+            if (priority < _shed_below && (highest_shed.has_value() == false || priority > *highest_shed))
+            {
+                highest_shed = priority;
+            }
+        }
+    }
+    if (highest_shed.has_value() == false)
+    {
+        _shed_below = std::numeric_limits<int>::min();
+        return false;
+    }
+    _shed_below = *highest_shed;
+    return true;
+}
+
+void AudioGraph::wait_for_async_processing()
+{
+    for (auto& slot : _audio_graph)
+    {
+        for (auto& node : slot)
+        {
+            node.track->wait_for_async_processing();
+        }
+    }
+}
+
+void AudioGraph::_update_shed_tracks()
+{
+    int shed_tracks = 0;
+    for (auto& slot : _audio_graph)
+    {
+        for (auto& node : slot)
+        {
+            bool shed = node.track->priority() < _shed_below;
+            node.track->set_shed(shed);
+            shed_tracks += shed ? 1 : 0;
+        }
+    }
+    if (shed_tracks == 0)
+    {
+        // Tracks added later with a low priority should not be shed without an overload
+        _shed_below = std::numeric_limits<int>::min();
+    }
+    _shed_tracks.store(shed_tracks, std::memory_order_relaxed);
+}
+
+void AudioGraph::_render_worker(void* data)
+{
+    /* Signal that this is a realtime audio processing thread */
+    twine::ThreadRtFlag rt_flag;
+
+    auto worker_data = reinterpret_cast<WorkerData*>(data);
+    auto& watch = worker_data->instance->_core_watch[worker_data->core];
+    worker_data->instance->_render_level(worker_data->core);
+    watch.track.store(nullptr, std::memory_order_relaxed);
+    // Sequentially consistent with the waiting flag, so a blocked waiter is always woken up
+    watch.done.store(true);
+    if (watch.waiting.load())
+    {
+        std::scoped_lock lock(watch.lock);
+        watch.finished.notify_one();
+    }
+}
+
+void AudioGraph::_render_level(int core)
+{
+    if (_scheduling == TrackScheduling::WORK_STEALING)
+    {
+        _render_core_work_stealing(core);
+    }
+    else
+    {
+        _render_core(core);
+    }
+}
+
+void AudioGraph::_render_core(int core)
+{
+    _render_bus_nodes(core);
+    auto& watch = _core_watch[core];
+    for (auto& node : _audio_graph[core])
+    {
+        if (node.level == _current_level && node.track->independent_buses() == false && node.track->stalled() == false)
+        {
+            _sum_group_members(node);
+            watch.track.store(node.track, std::memory_order_relaxed);
+            node.track->render();
+            if (watch.abandoned.load(std::memory_order_relaxed))
+            {
+                // The graph may have changed while the track was rendered
+                return;
+            }
+        }
+        else if (node.level > _current_level)
+        {
+            break;
+        }
+    }
+}
+
+void AudioGraph::_render_core_work_stealing(int core)
+{
+    _render_bus_nodes(core);
+    auto& watch = _core_watch[core];
+    // Start with the tracks assigned to this core, then help out the other cores
+    for (int i = 0; i < _cores; ++i)
+    {
+        int queue_core = (core + i) % _cores;
+        auto& queue = _work_queues[queue_core];
+        auto& tracks = _audio_graph[queue_core];
+
+        for (int index = queue.next.fetch_add(1, std::memory_order_relaxed); index < queue.end;
+             index = queue.next.fetch_add(1, std::memory_order_relaxed))
+        {
+            auto& node = tracks[index];
+            auto track = node.track;
+            if (track->independent_buses() || track->stalled())
+            {
+                continue;
+            }
+            /* Event fifos are single producer, so events must go to the fifo of the
+             * core that actually renders the track */
+            track->set_event_output(&_event_outputs[core]);
+            _sum_group_members(node);
+            watch.track.store(track, std::memory_order_relaxed);
+            track->render();
+            if (watch.abandoned.load(std::memory_order_relaxed))
+            {
+                // The work queues may be in use for a later chunk by now
+                return;
+            }
+        }
+    }
+}
+
+void AudioGraph::_prepare_work_queues(int level)
+{
+    for (int core = 0; core < _cores; ++core)
+    {
+        auto& tracks = _audio_graph[core];
+        auto& queue = _work_queues[core];
+        int begin = level == 0 ? 0 : queue.end;
+        int end = begin;
+        while (end < static_cast<int>(tracks.size()) && tracks[end].level == level)
+        {
+            end++;
+        }
+        queue.end = end;
+        // Nobody should take over the tracks of a stalled core
+        queue.next.store(_core_watch[core].stall.stalled ? end : begin, std::memory_order_relaxed);
+    }
+}
+
+void AudioGraph::_sum_group_members(const TrackNode& node)
+{
+    for (int i = node.first_member; i < node.first_member + node.members; ++i)
+    {
+        if (_group_members[i]->stalled() == false)
+        {
+            node.track->add_group_input(*_group_members[i]);
+        }
+    }
+}
+
+void AudioGraph::_wake_workers()
+{
+    int bus_nodes = static_cast<int>(_bus_nodes.size());
+    int tracks = 0;
+    for (const auto& queue : _work_queues)
+    {
+        tracks += queue.end - queue.next.load(std::memory_order_relaxed);
+    }
+
+    _active_workers = 0;
+    for (int core = 1; core < _cores; ++core)
+    {
+        bool has_work;
+        if (_core_watch[core].stall.stalled)
+        {
+            has_work = false;
+        }
+        else if (_scheduling == TrackScheduling::WORK_STEALING)
+        {
+            // Any core can take any track, so there is only use for as many cores as there are tracks
+            has_work = core < tracks + bus_nodes;
+        }
+        else
+        {
+            const auto& queue = _work_queues[core];
+            has_work = core < bus_nodes || queue.end > queue.next.load(std::memory_order_relaxed);
+        }
+        _woken_workers[core] = has_work;
+        if (has_work)
+        {
+            _core_watch[core].done.store(false, std::memory_order_relaxed);
+            _workers[core - 1]->wakeup_workers();
+            _active_workers++;
+        }
+    }
+}
+
+void AudioGraph::_wait_for_workers()
+{
+    auto timeout = _watchdog_timeout.load(std::memory_order_relaxed);
+    for (int core = 1; core < _cores; ++core)
+    {
+        if (_woken_workers[core] == false)
+        {
+            continue;
+        }
+        if (timeout.count() > 0 && _wait_until_done(core, _render_start + timeout) == false)
+        {
+            _stall_core(core);
+            continue;
+        }
+        _workers[core - 1]->wait_for_workers_idle();
+    }
+}
+
+/* Tell the cpu it is in a spin-wait loop, to save power and free up execution resources
+ * for a hyperthread sibling, which may well be running one of the workers */
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    asm volatile("yield");
+#endif
+}
+
+bool AudioGraph::_wait_until_done(int core, std::chrono::nanoseconds deadline)
+{
+    auto& watch = _core_watch[core];
+    // Levels are usually done within a few spins
+    for (int spins = 0; spins < WATCHDOG_SPINS_BEFORE_BLOCKING; ++spins)
+    {
+        if (watch.done.load(std::memory_order_acquire))
+        {
+            return true;
+        }
+        cpu_relax();
+    }
+
+    /* After that, block until the worker is done instead of keeping the cpu busy at rt
+     * priority, which could starve the worker itself if it shares the cpu */
+    std::unique_lock lock(watch.lock);
+    watch.waiting.store(true);
+    auto remaining = deadline - twine::current_rt_time();
+    bool done = watch.finished.wait_for(lock, remaining, [&]() {return watch.done.load();});
+    watch.waiting.store(false);
+    return done;
+}
+
+void AudioGraph::_stall_core(int core)
+{
+    auto& watch = _core_watch[core];
+    watch.abandoned.store(true, std::memory_order_relaxed);
+    auto track = watch.track.load(std::memory_order_relaxed);
+    auto processor = track ? track->current_processor() : nullptr;
+    watch.stall.stalled = true;
+    watch.stall.track = track ? track->id() : ObjectId(0);
+    // If the worker wasn't inside a processor, the track itself is to blame
+    watch.stall.processor = processor ? processor->id() : watch.stall.track;
+    _stalled_cores.fetch_add(1, std::memory_order_relaxed);
+    _update_stalled_tracks();
+}
+
+void AudioGraph::_recover_stalled_cores()
+{
+    for (int core = 1; core < _cores; ++core)
+    {
+        auto& watch = _core_watch[core];
+        if (watch.stall.stalled && watch.done.load(std::memory_order_acquire))
+        {
+            _workers[core - 1]->wait_for_workers_idle();
+            watch.stall = CoreStall();
+            watch.abandoned.store(false, std::memory_order_relaxed);
+            _stalled_cores.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    // Also picks up tracks added to or moved to a stalled core
+    _update_stalled_tracks();
+}
+
+void AudioGraph::_update_stalled_tracks()
+{
+    for (int core = 0; core < _cores; ++core)
+    {
+        for (auto& node : _audio_graph[core])
+        {
+            bool stalled = _core_watch[core].stall.stalled;
+            for (int c = 1; c < _cores && stalled == false; ++c)
+            {
+                stalled = _core_watch[c].stall.stalled && _core_watch[c].track.load(std::memory_order_relaxed) == node.track;
+            }
+            node.track->set_stalled(stalled);
+        }
+    }
+}
+
+void AudioGraph::_prepare_bus_nodes(int level)
+{
+    _bus_nodes.clear();
+    _bus_tracks.clear();
+    for (auto& slot : _audio_graph)
+    {
+        for (auto& node : slot)
+        {
+            if (node.level == level && node.track->independent_buses() && node.track->stalled() == false)
+            {
+                _sum_group_members(node);
+                node.track->begin_bus_render();
+                _bus_tracks.push_back(node.track);
+                for (int bus = 0; bus < node.track->buses(); ++bus)
+                {
+                    _bus_nodes.push_back({node.track, bus});
+                }
+            }
+        }
+    }
+    _next_bus_node.store(0, std::memory_order_relaxed);
+}
+
+void AudioGraph::_render_bus_nodes(int core)
+{
+    auto& watch = _core_watch[core];
+    int bus_nodes = static_cast<int>(_bus_nodes.size());
+    for (int index = _next_bus_node.fetch_add(1, std::memory_order_relaxed); index < bus_nodes;
+         index = _next_bus_node.fetch_add(1, std::memory_order_relaxed))
+    {
+        watch.track.store(_bus_nodes[index].track, std::memory_order_relaxed);
+        _bus_nodes[index].track->render_bus(_bus_nodes[index].bus);
+        if (watch.abandoned.load(std::memory_order_relaxed))
+        {
+            return;
+        }
+    }
+}
+
+void AudioGraph::_finish_bus_nodes()
+{
+    // Called from the rendering thread when all workers are idle, so the tracks' event outputs can be used safely
+    for (auto track : _bus_tracks)
+    {
+        // A stalled track may still have buses being rendered by a hung worker
+        if (track->stalled() == false)
+        {
+            track->end_bus_render();
+        }
+    }
+}
+
+void AudioGraph::_update_dependencies()
+{
+    // Read before collecting, so that changes made meanwhile are picked up on the next call
+    auto routing_version = Processor::routing_version();
+    if (_order_changed == false && routing_version == _routing_version)
+    {
+        return;
+    }
+    _routing_version = routing_version;
+    _index_nodes();
+
+    _dependencies.clear();
+    _groups.clear();
+    int dropped = 0;
+    // Tracks have at most one group each, and there is always room for one dependency per
+    // track, so collecting groups first means that only sends can be dropped
+    for (auto node : _nodes)
+    {
+        auto group = node->track->output_group();
+        if (group != nullptr && group != node->track && _node_of(group) != nullptr)
+        {
+            if (_dependencies.size() < _dependencies.capacity())
+            {
+                _groups.emplace_back(node->track, group);
+                _dependencies.emplace_back(node->track, group);
+            }
+            else
+            {
+                dropped++;
+            }
+        }
+    }
+    for (auto node : _nodes)
+    {
+        for (auto processor : node->track->processors())
+        {
+            auto destination = _track_containing(processor->send_destination());
+            if (destination == nullptr || destination == node->track)
+            {
+                continue;
+            }
+            Dependency dependency(node->track, destination);
+            if (std::find(_dependencies.begin(), _dependencies.end(), dependency) == _dependencies.end())
+            {
+                if (_dependencies.size() < _dependencies.capacity())
+                {
+                    _dependencies.push_back(dependency);
+                }
+                else
+                {
+                    dropped++;
+                }
+            }
+        }
+    }
+    _dropped_dependencies.store(dropped, std::memory_order_relaxed);
+
+    if (_order_changed || _dependencies != _prev_dependencies)
+    {
+        _update_render_order();
+        _prev_dependencies = _dependencies;
+        _order_changed = false;
+    }
+}
+
+void AudioGraph::_update_render_order()
+{
+    for (auto node : _nodes)
+    {
+        node->level = UNASSIGNED_LEVEL;
+    }
+
+    int level = 0;
+    int remaining = static_cast<int>(_nodes.size());
+    while (remaining > 0)
+    {
+        int assigned = 0;
+        for (auto node : _nodes)
+        {
+            if (node->level != UNASSIGNED_LEVEL)
+            {
+                continue;
+            }
+            bool ready = true;
+            for (const auto& [source, destination] : _dependencies)
+            {
+                if (destination == node->track)
+                {
+                    int source_level = _node_of(source)->level;
+                    if (source_level == UNASSIGNED_LEVEL || source_level == level)
+                    {
+                        ready = false;
+                        break;
+                    }
+                }
+            }
+            if (ready)
+            {
+                node->level = level;
+                assigned++;
+            }
+        }
+
+        if (assigned == 0)
+        {
+            // Only tracks in dependency cycles remain, these can't be ordered
+            for (auto node : _nodes)
+            {
+                if (node->level == UNASSIGNED_LEVEL)
+                {
+                    node->level = level;
+                }
+            }
+            break;
+        }
+        remaining -= assigned;
+        if (remaining > 0)
+        {
+            level++;
+        }
+    }
+    _levels = level + 1;
+
+    // Insertion sort by level, stable and does not allocate
+    for (auto& slot : _audio_graph)
+    {
+        for (auto i = slot.begin(); i != slot.end(); ++i)
+        {
+            std::rotate(std::upper_bound(slot.begin(), i, *i, [](const auto& a, const auto& b) {return a.level < b.level;}), i, i + 1);
+        }
+    }
+
+    // Sorting moved the nodes, and with them the tracks _nodes points to
+    _index_nodes();
+
+    std::sort(_groups.begin(), _groups.end(), [](const auto& a, const auto& b) {return std::less<>()(a.second, b.second);});
+    _group_members.clear();
+    for (auto node : _nodes)
+    {
+        node->first_member = static_cast<int>(_group_members.size());
+        auto members = std::equal_range(_groups.begin(), _groups.end(), Dependency(nullptr, node->track),
+                                        [](const auto& a, const auto& b) {return std::less<>()(a.second, b.second);});
+        for (auto i = members.first; i != members.second; ++i)
+        {
+            // Members in a dependency cycle with the group could still be rendering
+            if (_node_of(i->first)->level < node->level)
+            {
+                _group_members.push_back(i->first);
+            }
+        }
+        node->members = static_cast<int>(_group_members.size()) - node->first_member;
+    }
+}
+
+void AudioGraph::_index_nodes()
+{
+    _nodes.clear();
+    for (auto& slot : _audio_graph)
+    {
+        for (auto& node : slot)
+        {
+            _nodes.push_back(&node);
+        }
+    }
+    std::sort(_nodes.begin(), _nodes.end(), [](auto a, auto b) {return std::less<>()(a->track, b->track);});
+}
+
+AudioGraph::TrackNode* AudioGraph::_node_of(const Track* track) const
+{
+    auto node = std::lower_bound(_nodes.begin(), _nodes.end(), track, [](auto n, auto t) {return std::less<>()(n->track, t);});
+    if (node != _nodes.end() && (*node)->track == track)
+    {
+        return *node;
+    }
+    return nullptr;
+}
+
+const Track* AudioGraph::_track_containing(const Processor* processor) const
+{
+    if (processor == nullptr)
+    {
+        return nullptr;
+    }
+    for (auto node : _nodes)
+    {
+        const auto& processors = node->track->processors();
+        if (std::find(processors.begin(), processors.end(), processor) != processors.end())
+        {
+            return node->track;
+        }
     }
+    return nullptr;
 }
 
 } // namespace engine
@@ -23,6 +23,12 @@
  */
 
 #include <vector>
+#include <utility>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <limits>
+#include <mutex>
 
 #include "twine/twine.h"
 
@@ -31,6 +37,24 @@
 namespace sushi {
 namespace engine {
 
+/* Rt priority of the worker threads rendering cores other than core 0 */
+constexpr int DEFAULT_WORKER_PRIORITY = 75;
+
+enum class TrackScheduling
+{
+    STATIC,        // Tracks are always rendered on the core they are assigned to
+    WORK_STEALING  // Cores that run out of tracks take over tracks assigned to other cores
+};
+
+/* The worker of a core that has not finished rendering in time, and the track and
+ * processor it was rendering when it was given up on */
+struct CoreStall
+{
+    bool     stalled{false};
+    ObjectId track{0};
+    ObjectId processor{0};
+};
+
 class AudioGraph
 {
 public:
@@ -38,12 +62,21 @@ public:
      * @brief create an AudioGraph instance
      * @param cpu_cores The number of cores to use for audio processing. Must not
      *                  exceed the number of cores on the architecture
-     * @param max_no_tracks The maximum number of tracks to reserve space for. As
+     * @param max_no_tracks The number of tracks to initially reserve space for. As
      *                      add() and remove() could be called from an rt thread
-     *                      they must not (de)allocate memory-
+     *                      they must not (de)allocate memory, use grow() to make
+     *                      room for more tracks. Room is also reserved for a group
+     *                      and a send per track, use grow_dependencies() for more.
      * @param debug_mode_switches Enable xenomai-specific thread debugging
+     * @param scheduling How tracks are distributed over the cores when rendering
+     * @param worker_priority The rt priority of the worker threads. Core 0 is always
+     *                        rendered in the calling thread, at its priority
      */
-    AudioGraph(int cpu_cores, int max_no_tracks, bool debug_mode_switches = false);
+    AudioGraph(int cpu_cores,
+               int max_no_tracks,
+               bool debug_mode_switches = false,
+               TrackScheduling scheduling = TrackScheduling::STATIC,
+               int worker_priority = DEFAULT_WORKER_PRIORITY);
 
     /**
      * @brief Add a track to the graph. The track will be assigned to a cpu
@@ -63,6 +96,63 @@ public:
      */
     bool add_to_core(Track* track, int core);
 
+    /**
+     * @brief Move a track that is already in the graph to another cpu core.
+     *        Must not be called concurrently with render()
+     * @param track The track instance to move
+     * @param core The cpu core that should be used to process the track.
+     * @return true if the track was found and moved, false otherwise
+     */
+    bool move_to_core(Track* track, int core);
+
+    /**
+     * @brief Return the number of tracks the graph has room for. Only changes
+     *        through grow(), not safe to call concurrently with it.
+     * @return The maximum number of tracks
+     */
+    int max_tracks() const
+    {
+        return _max_tracks;
+    }
+
+    /**
+     * @brief Make room for more tracks. The storage is allocated in the calling thread
+     *        and replaced when the StorageSwap is swapped in, which must not be done
+     *        concurrently with render().
+     * @param swap The StorageSwap to add the storage to
+     * @param max_no_tracks The number of tracks to make room for
+     */
+    void grow(StorageSwap& swap, int max_no_tracks);
+
+    /**
+     * @brief Return the number of dependencies between tracks the graph has room for. Only
+     *        changes through grow_dependencies(), not safe to call concurrently with it.
+     * @return The maximum number of dependencies
+     */
+    int max_dependencies() const
+    {
+        return static_cast<int>(_dependencies.capacity());
+    }
+
+    /**
+     * @brief Make room for more dependencies between tracks. A track depends on at most
+     *        its group, and every processor on at most its send destination, so this is
+     *        needed as tracks and processors are added. The storage is replaced when the
+     *        StorageSwap is swapped in, which must not be done concurrently with render().
+     * @param swap The StorageSwap to add the storage to
+     * @param max_dependencies The number of dependencies to make room for
+     */
+    void grow_dependencies(StorageSwap& swap, int max_dependencies);
+
+    /**
+     * @brief Return the number of cpu cores used for processing
+     * @return The number of cores
+     */
+    int cores() const
+    {
+        return _cores;
+    }
+
     /**
      * @brief Remove a track from the audio graph. Must not be called concurrently
      *        with render()
@@ -82,18 +172,308 @@ public:
     }
 
     /**
-     * @brief Render all tracks. If cpu_cores = 1 all processing is done in the
-     *        calling thread. With higher number of cores, the calling thread
-     *        sleeps while processing is running.
+     * @brief Render all tracks. Tracks are rendered in dependency order, i.e. a track
+     *        that receives audio from other tracks is rendered after those, so that
+     *        audio passed between tracks arrives within the same chunk. Tracks without
+     *        dependencies between them are rendered in parallel. The calling thread
+     *        renders the tracks of core 0, and with higher number of cores, a worker
+     *        thread per core renders the tracks of the other cores. Only the workers
+     *        of cores that have work on the current level are woken up. In work stealing
+     *        mode, a core that has rendered all its tracks continues with unrendered
+     *        tracks assigned to other cores. Tracks with independent buses have their
+     *        buses rendered in parallel, on any core, and are finished by the calling
+     *        thread. Group tracks are rendered on the level after their last member and
+     *        sum the output of their members into their input before rendering, so groups
+     *        on the same level are summed in parallel and nested groups form a tree that
+     *        is reduced one level at a time.
      */
     void render();
 
+    /**
+     * @brief Return the number of worker threads woken up when the last level was rendered.
+     *        Only meant for diagnostics and testing, not safe to call concurrently with
+     *        render().
+     * @return The number of worker threads, not counting the calling thread
+     */
+    int active_workers() const
+    {
+        return _active_workers;
+    }
+
+    /**
+     * @brief Stop rendering the tracks with the lowest priority among the tracks still
+     *        rendered, to relieve an overloaded cpu. Tracks with the highest priority in
+     *        the graph are never shed. Takes effect from the next render(), must not be
+     *        called concurrently with it.
+     * @return true if tracks were shed, false if only tracks with the highest priority
+     *         are left
+     */
+    bool shed_lowest_priority();
+
+    /**
+     * @brief Start rendering the tracks with the highest priority among the shed tracks
+     *        again. Takes effect from the next render(), must not be called concurrently
+     *        with it.
+     * @return true if tracks were restored, false if no tracks were shed
+     */
+    bool restore_shed_priority();
+
+    /**
+     * @brief Return the number of tracks not rendered because they were shed when the last
+     *        chunk was rendered. Safe to call from any thread.
+     * @return The number of shed tracks
+     */
+    int shed_tracks() const
+    {
+        return _shed_tracks.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Give up waiting for the worker of a core if it hasn't finished rendering
+     *        within a time from the start of render(), i.e. if a plugin has hung. The
+     *        core is then stalled: its worker is not woken up again until it has
+     *        finished, and the tracks assigned to it, and the track the worker was
+     *        rendering, are skipped and their output is silent meanwhile. Core 0 is
+     *        rendered by the calling thread and can't be watched. While enabled, the
+     *        calling thread polls the workers instead of blocking on them. Safe to
+     *        call from any thread.
+     * @param timeout The time to wait, 0 waits for the workers indefinitely
+     */
+    void set_watchdog_timeout(std::chrono::nanoseconds timeout)
+    {
+        _watchdog_timeout.store(timeout, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Return whether the worker of a core is stalled, and on what. Only safe to
+     *        call from the rt thread, when not rendering.
+     * @param core The core
+     * @return The stall state of the core
+     */
+    const CoreStall& core_stall(int core) const
+    {
+        return _core_watch[core].stall;
+    }
+
+    /**
+     * @brief Return the number of cores whose worker is stalled. Safe to call from any thread.
+     * @return The number of stalled cores
+     */
+    int stalled_cores() const
+    {
+        return _stalled_cores.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Return the number of dependencies between tracks that didn't fit in the
+     *        storage reserved for them the last time the render order was updated. Audio
+     *        passed along these is delayed by one chunk. Group memberships are collected first
+     *        and always fit, so only sends are dropped. Safe to call from any thread.
+     * @return The number of dropped dependencies
+     */
+    int dropped_dependencies() const
+    {
+        return _dropped_dependencies.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Wait for asynchronously processed processors on all tracks to finish.
+     *        Must not be called concurrently with render()
+     */
+    void wait_for_async_processing();
+
 private:
-    std::vector<std::vector<Track*>>   _audio_graph;
-    std::unique_ptr<twine::WorkerPool> _worker_pool;
-    std::vector<RtEventFifo<>>         _event_outputs;
-    int _cores;
-    int _current_core;
+    struct TrackNode
+    {
+        Track* track;
+        int    level;
+        /* Members of the track if it is a group, as a range of indexes into _group_members */
+        int    first_member{0};
+        int    members{0};
+    };
+
+    struct WorkerData
+    {
+        AudioGraph* instance;
+        int         core;
+    };
+
+    /* Tracks of the current level assigned to a core, as a range of indexes into the
+     * core's track list. Cores claim tracks by incrementing next, which is lock free
+     * and lets several cores take tracks from the same queue */
+    struct WorkQueue
+    {
+        std::atomic<int> next{0};
+        int              end{0};
+    };
+
+    /* Progress of the worker of a core, to detect when it has hung. done and track are
+     * written by the worker, the rest by the calling thread */
+    struct CoreWatch
+    {
+        std::atomic<bool>   done{true};
+        std::atomic<Track*> track{nullptr};
+        /* Set when the worker is stalled, to stop it from taking more work when it returns */
+        std::atomic<bool>   abandoned{false};
+        CoreStall           stall;
+        /* For blocking until the worker is done, waiting is set while anyone is blocked */
+        std::atomic<bool>       waiting{false};
+        std::mutex              lock;
+        std::condition_variable finished;
+    };
+
+    /* A bus of a track with independent buses, rendered separately from the other buses */
+    struct BusNode
+    {
+        Track* track;
+        int    bus;
+    };
+
+    /* Dependencies as pairs of (source, destination) tracks */
+    using Dependency = std::pair<const Track*, const Track*>;
+
+    static void _render_worker(void* data);
+
+    void _render_level(int core);
+
+    void _render_core(int core);
+
+    void _render_core_work_stealing(int core);
+
+    void _prepare_work_queues(int level);
+
+    /**
+     * @brief Sum the output of the members of a group track into its input. Called right
+     *        before the track is rendered, from the thread that renders it.
+     * @param node The node of the track
+     */
+    void _sum_group_members(const TrackNode& node);
+
+    /**
+     * @brief Wake up the workers of the cores that have tracks or buses to render on the
+     *        current level. Must be called after the work queues and bus nodes of the level
+     *        have been prepared.
+     */
+    void _wake_workers();
+
+    void _wait_for_workers();
+
+    /**
+     * @brief Wait until the worker of a core has finished rendering the current level.
+     *        Polls for a short while, then blocks until the worker signals it is done.
+     * @param core The core
+     * @param deadline The time to give up at
+     * @return true if the worker finished, false if the deadline passed
+     */
+    bool _wait_until_done(int core, std::chrono::nanoseconds deadline);
+
+    /**
+     * @brief Give up on the worker of a core, marking the core and its tracks as stalled
+     * @param core The core
+     */
+    void _stall_core(int core);
+
+    /**
+     * @brief Take stalled cores whose worker has finished back into use. Called at the
+     *        start of render().
+     */
+    void _recover_stalled_cores();
+
+    /**
+     * @brief Tell every track whether it is stalled, from the state of the cores
+     */
+    void _update_stalled_tracks();
+
+    /**
+     * @brief Collect the buses of all tracks with independent buses on the given level
+     *        and prepare the tracks for rendering their buses separately.
+     * @param level The dependency level about to be rendered
+     */
+    void _prepare_bus_nodes(int level);
+
+    void _render_bus_nodes(int core);
+
+    void _finish_bus_nodes();
+
+    /**
+     * @brief Collect the audio dependencies between tracks, from sends and from group
+     *        membership, and update the render order if they, or the set of tracks, have
+     *        changed since the last call. Does nothing unless tracks were added or removed,
+     *        or Processor::routing_version() has changed. Called from render(), does not
+     *        allocate memory.
+     */
+    void _update_dependencies();
+
+    /**
+     * @brief Sort the tracks into levels so that a track is always on a higher level
+     *        than the tracks it depends on, and collect the members of every group track.
+     *        Tracks that are part of a dependency cycle are placed together on the last
+     *        level. Does not allocate memory.
+     */
+    void _update_render_order();
+
+    /**
+     * @brief Tell every track whether it is shed, from its current priority, so that
+     *        changes in priority and added tracks are picked up. Called from render().
+     */
+    void _update_shed_tracks();
+
+    const Track* _track_containing(const Processor* processor) const;
+
+    /**
+     * @brief Collect pointers to all nodes in _nodes, sorted on track so that _node_of()
+     *        can search it. Needs to be called again after the nodes are moved.
+     */
+    void _index_nodes();
+
+    /**
+     * @brief Find the node of a track in _nodes, in O(log n).
+     * @param track The track to find
+     * @return The node of the track, or nullptr if the track is not in the graph
+     */
+    TrackNode* _node_of(const Track* track) const;
+
+    std::vector<std::vector<TrackNode>> _audio_graph;
+    std::vector<WorkerData>             _worker_data;
+    /* One single threaded pool per core except core 0, which is rendered by the calling
+     * thread, so that workers can be woken up individually */
+    std::vector<std::unique_ptr<twine::WorkerPool>> _workers;
+    /* Whether the worker of each core was woken up for the current level */
+    std::vector<bool>                   _woken_workers;
+    std::vector<CoreWatch>              _core_watch;
+    std::vector<RtEventFifo<>>          _event_outputs;
+    std::vector<WorkQueue>              _work_queues;
+    std::vector<BusNode>                _bus_nodes;
+    std::vector<Track*>                 _bus_tracks;
+    std::atomic<int>                    _next_bus_node{0};
+
+    /* All nodes, sorted on track */
+    std::vector<TrackNode*>             _nodes;
+    std::vector<Dependency>             _dependencies;
+    std::vector<Dependency>             _prev_dependencies;
+    /* Group memberships as pairs of (member, group) tracks, also part of _dependencies */
+    std::vector<Dependency>             _groups;
+    std::vector<const Track*>           _group_members;
+
+    TrackScheduling _scheduling;
+    int             _max_tracks;
+
+    int  _cores;
+    int  _current_core;
+    int  _levels{1};
+    int  _current_level{0};
+    int  _active_workers{0};
+    bool _order_changed{false};
+    unsigned int _routing_version{0};
+    std::atomic<int> _dropped_dependencies{0};
+
+    /* Tracks with a priority lower than this are shed */
+    int              _shed_below{std::numeric_limits<int>::min()};
+    std::atomic<int> _shed_tracks{0};
+
+    std::atomic<std::chrono::nanoseconds> _watchdog_timeout{std::chrono::nanoseconds(0)};
+    std::chrono::nanoseconds              _render_start{0};
+    std::atomic<int>                      _stalled_cores{0};
 };
 
 } // namespace engine
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Routing of audio between the engine inputs and outputs and the tracks
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#include <algorithm>
+#include <cassert>
+#include <tuple>
+
+#include "audio_routing.h"
+#include "processor_table.h"
+#include "track.h"
+
+namespace sushi {
+namespace engine {
+
+AudioRouting::AudioRouting(int max_connections)
+{
+    _sorted_connections.reserve(max_connections);
+    _input_routes.reserve(max_connections);
+    _output_routes.reserve(max_connections);
+}
+
+void AudioRouting::grow(StorageSwap& swap, int max_connections)
+{
+    if (max_connections > static_cast<int>(_sorted_connections.capacity()))
+    {
+        swap.add_vector(&_sorted_connections, max_connections);
+        swap.add_vector(&_input_routes, max_connections);
+        swap.add_vector(&_output_routes, max_connections);
+    }
+}
+
+void AudioRouting::update(const std::vector<AudioConnection>& input_connections,
+                          const std::vector<AudioConnection>& output_connections)
+{
+    _compile_inputs(input_connections);
+    _compile_outputs(output_connections);
+}
+
+void AudioRouting::route_inputs(ChunkSampleBuffer& input, const ProcessorTable& tracks) const
+{
+    for (const auto& route : _input_routes)
+    {
+        auto track = static_cast<Track*>(tracks.processor(route.track));
+        if (track == nullptr || track->stalled())
+        {
+            // Tracks can be temporarily taken out of the rt part, i.e. when frozen, and
+            // the input of stalled tracks may still be read by a hung worker
+            continue;
+        }
+        if (route.direct)
+        {
+            track->set_external_input(ChunkSampleBuffer::create_non_owning_buffer(input, route.engine_channel, route.channels));
+            continue;
+        }
+        for (int c = 0; c < route.channels; ++c)
+        {
+            auto track_in = track->input_channel(route.track_channel + c);
+            track_in.replace(0, route.engine_channel + c, input);
+        }
+    }
+}
+
+void AudioRouting::mix_outputs(ChunkSampleBuffer& output, const ProcessorTable& tracks) const
+{
+    /* Routes are sorted on engine channel, so channels skipped over have no connections */
+    int next_channel = 0;
+    for (const auto& route : _output_routes)
+    {
+        if (route.engine_channel > next_channel)
+        {
+            auto unused = ChunkSampleBuffer::create_non_owning_buffer(output, next_channel, route.engine_channel - next_channel);
+            unused.clear();
+        }
+        auto track = static_cast<Track*>(tracks.processor(route.track));
+        // Tracks in a group are summed by the group track instead
+        if (track && track->output_group() == nullptr)
+        {
+            track->mix_output_channel(route.track_channel, output, route.engine_channel, route.direct);
+        }
+        else if (route.direct)
+        {
+            auto channel = ChunkSampleBuffer::create_non_owning_buffer(output, route.engine_channel, 1);
+            channel.clear();
+        }
+        next_channel = std::max(next_channel, route.engine_channel + 1);
+    }
+    if (next_channel < output.channel_count())
+    {
+        auto unused = ChunkSampleBuffer::create_non_owning_buffer(output, next_channel, output.channel_count() - next_channel);
+        unused.clear();
+    }
+}
+
+void AudioRouting::_compile_inputs(const std::vector<AudioConnection>& connections)
+{
+    assert(connections.size() <= _sorted_connections.capacity());
+    _sorted_connections.clear();
+    for (const auto& connection : connections)
+    {
+        _sorted_connections.push_back({connection, static_cast<int>(_sorted_connections.size())});
+    }
+    /* Grouped by track and ordered by track channel. If a track channel has several
+     * connections, the last one should win, as each of them replaces the channel */
+    std::sort(_sorted_connections.begin(), _sorted_connections.end(), [](const auto& lhs, const auto& rhs)
+    {
+        return std::tie(lhs.connection.track, lhs.connection.track_channel, lhs.index) <
+               std::tie(rhs.connection.track, rhs.connection.track_channel, rhs.index);
+    });
+
+    _input_routes.clear();
+    for (const auto& sorted : _sorted_connections)
+    {
+        const auto& connection = sorted.connection;
+        if (_input_routes.empty() == false)
+        {
+            auto& last = _input_routes.back();
+            if (last.track == connection.track &&
+                last.track_channel + last.channels == connection.track_channel &&
+                last.engine_channel + last.channels == connection.engine_channel)
+            {
+                last.channels++;
+                continue;
+            }
+        }
+        _input_routes.push_back({connection.track, connection.engine_channel, connection.track_channel, 1, false});
+    }
+
+    /* A track can read its input in place if all its connections form a single block
+     * starting at its first channel */
+    for (size_t i = 0; i < _input_routes.size(); ++i)
+    {
+        auto& route = _input_routes[i];
+        bool single_route = (i == 0 || _input_routes[i - 1].track != route.track) &&
+                            (i + 1 == _input_routes.size() || _input_routes[i + 1].track != route.track);
+        route.direct = single_route && route.track_channel == 0;
+    }
+}
+
+void AudioRouting::_compile_outputs(const std::vector<AudioConnection>& connections)
+{
+    assert(connections.size() <= _sorted_connections.capacity());
+    _sorted_connections.clear();
+    for (const auto& connection : connections)
+    {
+        _sorted_connections.push_back({connection, static_cast<int>(_sorted_connections.size())});
+    }
+    std::sort(_sorted_connections.begin(), _sorted_connections.end(), [](const auto& lhs, const auto& rhs)
+    {
+        return std::tie(lhs.connection.engine_channel, lhs.index) < std::tie(rhs.connection.engine_channel, rhs.index);
+    });
+
+    _output_routes.clear();
+    for (const auto& sorted : _sorted_connections)
+    {
+        const auto& connection = sorted.connection;
+        bool first = _output_routes.empty() || _output_routes.back().engine_channel != connection.engine_channel;
+        _output_routes.push_back({connection.track, connection.engine_channel, connection.track_channel, 1, first});
+    }
+}
+
+} // namespace engine
+} // namespace sushi
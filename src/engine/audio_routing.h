@@ -0,0 +1,120 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Routing of audio between the engine inputs and outputs and the tracks
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_AUDIO_ROUTING_H
+#define SUSHI_AUDIO_ROUTING_H
+
+#include <vector>
+
+#include "library/connection_types.h"
+#include "library/sample_buffer.h"
+#include "engine/storage_swap.h"
+
+namespace sushi {
+namespace engine {
+
+class ProcessorTable;
+
+/**
+ * @brief Audio connections between the engine and the tracks, compiled into a list of
+ *        block copies for every chunk. Connections that map consecutive engine inputs
+ *        one to one onto all connected channels of a track are not copied at all, the
+ *        track reads them directly from the engine input buffer instead. On the output
+ *        side, the first connection to every engine output replaces its contents and
+ *        the rest are added to it, so the output buffer doesn't need to be cleared first.
+ *        The routing is compiled without allocating memory, so update() can be called
+ *        from the rt thread whenever the connections change.
+ */
+class AudioRouting
+{
+public:
+    /**
+     * @brief Create an empty routing
+     * @param max_connections The maximum number of connections in each direction
+     */
+    explicit AudioRouting(int max_connections);
+
+    /**
+     * @brief Make room for more connections. The storage is replaced when the StorageSwap
+     *        is swapped in, which must not be done concurrently with update() or routing.
+     * @param swap The StorageSwap to add the storage to
+     * @param max_connections The maximum number of connections in each direction
+     */
+    void grow(StorageSwap& swap, int max_connections);
+
+    /**
+     * @brief Compile the routing from the current connections. Does not allocate memory as
+     *        long as there are no more connections than given to the constructor.
+     * @param input_connections Connections from engine inputs to track inputs
+     * @param output_connections Connections from track outputs to engine outputs
+     */
+    void update(const std::vector<AudioConnection>& input_connections,
+                const std::vector<AudioConnection>& output_connections);
+
+    /**
+     * @brief Pass audio from the engine inputs to the tracks. Called from the rt thread
+     *        before the tracks are rendered, and input must stay valid until they are.
+     * @param input The engine input buffer
+     * @param tracks The tracks by id
+     */
+    void route_inputs(ChunkSampleBuffer& input, const ProcessorTable& tracks) const;
+
+    /**
+     * @brief Mix the output of the tracks into the engine outputs, applying the gain and pan
+     *        of tracks that defer it. Tracks routed to a group track are skipped. Outputs
+     *        without any connections are set to silence. Called from the rt thread.
+     * @param output The engine output buffer
+     * @param tracks The tracks by id
+     */
+    void mix_outputs(ChunkSampleBuffer& output, const ProcessorTable& tracks) const;
+
+private:
+    /* A block of consecutive channels, from engine channels to track channels or back */
+    struct Route
+    {
+        ObjectId track;
+        int      engine_channel;
+        int      track_channel;
+        int      channels;
+        /* Input route read in place by the track, or output route replacing the contents of
+         * the engine channels instead of adding to them */
+        bool     direct;
+    };
+
+    /* A connection and its position in the list of connections, to keep the order among
+     * connections to the same channel when sorting */
+    struct IndexedConnection
+    {
+        AudioConnection connection;
+        int             index;
+    };
+
+    void _compile_inputs(const std::vector<AudioConnection>& connections);
+    void _compile_outputs(const std::vector<AudioConnection>& connections);
+
+    std::vector<IndexedConnection> _sorted_connections;
+    std::vector<Route>             _input_routes;
+    std::vector<Route>             _output_routes;
+};
+
+} // namespace engine
+} // namespace sushi
+
+#endif //SUSHI_AUDIO_ROUTING_H
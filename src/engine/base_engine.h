@@ -26,7 +26,9 @@
 #include <vector>
 #include <utility>
 #include <bitset>
+#include <functional>
 #include <limits>
+#include <optional>
 #include <string>
 
 #include "library/constants.h"
@@ -67,7 +69,8 @@ enum class EngineReturnStatus
     INVALID_BUS,
     INVALID_CHANNEL,
     ALREADY_IN_USE,
-    QUEUE_FULL
+    QUEUE_FULL,
+    CPU_BUDGET_EXCEEDED
 };
 
 enum class RealtimeState
@@ -80,6 +83,16 @@ enum class RealtimeState
 
 constexpr int ENGINE_TIMING_ID = -1;
 
+/**
+ * @brief A stage of a track processed as a pipeline, the processing time of the stage
+ *        is recorded under timing_id
+ */
+struct PipelineStage
+{
+    ObjectId timing_id;
+    std::vector<ObjectId> processors;
+};
+
 class BaseEngine
 {
 public:
@@ -289,6 +302,67 @@ public:
         return EngineReturnStatus::OK;
     }
 
+    virtual EngineReturnStatus pin_track_to_core(ObjectId /*track_id*/, std::optional<int> /*core*/)
+    {
+        return EngineReturnStatus::OK;
+    }
+
+    virtual EngineReturnStatus set_track_priority(ObjectId /*track_id*/, int /*priority*/)
+    {
+        return EngineReturnStatus::OK;
+    }
+
+    virtual EngineReturnStatus connect_track_to_group(ObjectId /*track_id*/, ObjectId /*group_id*/)
+    {
+        return EngineReturnStatus::OK;
+    }
+
+    virtual EngineReturnStatus disconnect_track_from_group(ObjectId /*track_id*/)
+    {
+        return EngineReturnStatus::OK;
+    }
+
+    virtual EngineReturnStatus freeze_track(ObjectId /*track_id*/, Time /*duration*/)
+    {
+        return EngineReturnStatus::OK;
+    }
+
+    virtual EngineReturnStatus unfreeze_track(ObjectId /*track_id*/)
+    {
+        return EngineReturnStatus::OK;
+    }
+
+    virtual EngineReturnStatus set_track_render_ahead(ObjectId /*track_id*/, int /*chunks*/)
+    {
+        return EngineReturnStatus::OK;
+    }
+
+    virtual EngineReturnStatus set_track_pipeline_stages(ObjectId /*track_id*/, int /*stages*/)
+    {
+        return EngineReturnStatus::OK;
+    }
+
+    virtual std::vector<PipelineStage> track_pipeline(ObjectId /*track_id*/) const
+    {
+        return {};
+    }
+
+    virtual std::pair<EngineReturnStatus, int> track_latency(ObjectId /*track_id*/) const
+    {
+        return {EngineReturnStatus::OK, 0};
+    }
+
+    virtual int processing_latency() const
+    {
+        return 0;
+    }
+
+    virtual std::pair<EngineReturnStatus, LoadPrediction> predict_plugin_load(const std::string& /*plugin_uid*/,
+                                                                              ObjectId /*track_id*/)
+    {
+        return {EngineReturnStatus::OK, LoadPrediction{0, 0.0f, 0.0f, false, 0.0f, std::nullopt, true}};
+    }
+
     virtual std::pair <EngineReturnStatus, ObjectId> create_processor(const PluginInfo& /*plugin_info*/,
                                                                       const std::string& /*processor_name*/)
     {
@@ -308,11 +382,46 @@ public:
         return EngineReturnStatus::OK;
     }
 
+    virtual EngineReturnStatus set_processor_async(ObjectId /*plugin_id*/,
+                                                   ObjectId /*track_id*/,
+                                                   bool /*enabled*/)
+    {
+        return EngineReturnStatus::OK;
+    }
+
+    virtual EngineReturnStatus set_processor_bus(ObjectId /*plugin_id*/,
+                                                 ObjectId /*track_id*/,
+                                                 std::optional<int> /*bus*/)
+    {
+        return EngineReturnStatus::OK;
+    }
+
     virtual EngineReturnStatus delete_plugin(ObjectId /*plugin_id*/)
     {
         return EngineReturnStatus::OK;
     }
 
+    virtual std::pair<EngineReturnStatus, int> begin_graph_transaction(Time /*expiry*/)
+    {
+        return {EngineReturnStatus::OK, 0};
+    }
+
+    virtual EngineReturnStatus run_in_graph_transaction(int /*transaction_id*/, const std::function<void()>& edits)
+    {
+        edits();
+        return EngineReturnStatus::OK;
+    }
+
+    virtual EngineReturnStatus commit_graph_transaction(int /*transaction_id*/)
+    {
+        return EngineReturnStatus::OK;
+    }
+
+    virtual EngineReturnStatus abort_graph_transaction(int /*transaction_id*/)
+    {
+        return EngineReturnStatus::OK;
+    }
+
     virtual dispatcher::BaseEventDispatcher* event_dispatcher()
     {
         return nullptr;
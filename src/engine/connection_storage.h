@@ -24,12 +24,14 @@
 
 #include <vector>
 #include <mutex>
+#include <atomic>
 #include <type_traits>
 #include <cassert>
 
 #include <twine/twine.h>
 
 #include <library/rt_event_pipe.h>
+#include <engine/storage_swap.h>
 
 namespace sushi {
 
@@ -79,7 +81,7 @@ public:
     {
         assert(twine::is_current_thread_realtime() == false);
         std::scoped_lock<std::mutex> lock(_non_rt_lock);
-        if (_items.size() < _capacity)
+        if (_items.size() < capacity())
         {
             _items.push_back(element);
             if (add_to_rt)
@@ -99,7 +101,7 @@ public:
     bool add_rt(const T& element)
     {
         assert(twine::is_current_thread_realtime());
-        assert(_items_rt.size() < _capacity);
+        assert(_items_rt.size() < capacity());
         _items_rt.push_back(element);
         return true;
     }
@@ -141,7 +143,23 @@ public:
 
     size_t capacity() const
     {
-        return _capacity;
+        return _capacity.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Make room for more elements. The rt part is replaced when the StorageSwap is
+     *        swapped in, and the new capacity only takes effect then. Should only be
+     *        called from a non-rt thread.
+     * @param swap The StorageSwap to add the storage to
+     * @param max_connections The number of elements to make room for
+     */
+    void grow(engine::StorageSwap& swap, size_t max_connections)
+    {
+        if (max_connections > capacity())
+        {
+            swap.add_vector(&_items_rt, max_connections);
+            swap.on_swap([this, max_connections]() {_capacity.store(max_connections, std::memory_order_release);});
+        }
     }
 
 private:
@@ -151,7 +169,7 @@ private:
 
     std::vector<T>      _items;
     std::vector<T>      _items_rt;
-    size_t              _capacity;
+    std::atomic<size_t> _capacity;
     mutable std::mutex  _non_rt_lock;
 };
 
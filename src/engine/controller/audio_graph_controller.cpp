@@ -18,6 +18,12 @@
  * @copyright 2017-2020 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
  */
 
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <optional>
+
 #include "audio_graph_controller.h"
 #include "library/processor_state.h"
 #include "logging.h"
@@ -28,6 +34,48 @@ namespace sushi {
 namespace engine {
 namespace controller_impl {
 
+/* Committing waits for the rt thread, which in turn times out after 200 ms */
+constexpr auto TRANSACTION_TIMEOUT = std::chrono::seconds(2);
+/* Transactions left open longer than this are rolled back */
+constexpr auto TRANSACTION_EXPIRY = std::chrono::seconds(30);
+
+/* The outcome of an event, shared with its completion callback so that it can outlive
+ * a wait that has timed out */
+struct EventOutcome
+{
+    std::mutex              lock;
+    std::condition_variable handled;
+    std::optional<int>      status;
+};
+
+void event_outcome_callback(void* arg, Event* /*event*/, int status)
+{
+    auto outcome = static_cast<std::shared_ptr<EventOutcome>*>(arg);
+    {
+        std::scoped_lock lock((*outcome)->lock);
+        (*outcome)->status = status;
+    }
+    (*outcome)->handled.notify_all();
+    delete outcome;
+}
+
+/* Post an event and wait until the dispatcher has handled it, for calls whose outcome
+ * the caller needs to know. Must not be called from the dispatcher thread */
+ext::ControlStatus post_and_wait(dispatcher::BaseEventDispatcher* dispatcher, Event* event)
+{
+    auto outcome = std::make_shared<EventOutcome>();
+    event->set_completion_cb(event_outcome_callback, new std::shared_ptr<EventOutcome>(outcome));
+    dispatcher->post_event(event);
+
+    std::unique_lock lock(outcome->lock);
+    if (outcome->handled.wait_for(lock, TRANSACTION_TIMEOUT, [&]() {return outcome->status.has_value();}) == false)
+    {
+        SUSHI_LOG_ERROR("Timed out waiting for event to be handled");
+        return ext::ControlStatus::ERROR;
+    }
+    return outcome->status.value() == EventStatus::HANDLED_OK ? ext::ControlStatus::OK : ext::ControlStatus::ERROR;
+}
+
 inline ext::ProcessorInfo to_external(const Processor* proc)
 {
     return ext::ProcessorInfo{.id = static_cast<int>(proc->id()),
@@ -227,7 +275,7 @@ ext::ControlStatus AudioGraphController::set_processor_bypass_state(int processo
     return ext::ControlStatus::NOT_FOUND;
 }
 
-ext::ControlStatus AudioGraphController::create_track(const std::string& name, int channels)
+ext::ControlStatus AudioGraphController::create_track(const std::string& name, int channels, std::optional<int> transaction_id)
 {
     SUSHI_LOG_DEBUG("create_track called with name {} and {} channels", name, channels);
 
@@ -237,12 +285,11 @@ ext::ControlStatus AudioGraphController::create_track(const std::string& name, i
         return status == EngineReturnStatus::OK? EventStatus::HANDLED_OK : EventStatus::ERROR;
     };
 
-    auto event = new LambdaEvent(lambda, IMMEDIATE_PROCESS);
-    _event_dispatcher->post_event(event);
+    _post_edit(lambda, transaction_id);
     return ext::ControlStatus::OK;
 }
 
-ext::ControlStatus AudioGraphController::create_multibus_track(const std::string& name, int buses)
+ext::ControlStatus AudioGraphController::create_multibus_track(const std::string& name, int buses, std::optional<int> transaction_id)
 {
     SUSHI_LOG_DEBUG("create_multibus_track called with name {} and {} buses ", name, buses);
     auto lambda = [=] () -> int
@@ -251,12 +298,11 @@ ext::ControlStatus AudioGraphController::create_multibus_track(const std::string
         return status == EngineReturnStatus::OK? EventStatus::HANDLED_OK : EventStatus::ERROR;
     };
 
-    auto event = new LambdaEvent(lambda, IMMEDIATE_PROCESS);
-    _event_dispatcher->post_event(event);
+    _post_edit(lambda, transaction_id);
     return ext::ControlStatus::OK;
 }
 
-ext::ControlStatus AudioGraphController::create_pre_track(const std::string& name)
+ext::ControlStatus AudioGraphController::create_pre_track(const std::string& name, std::optional<int> transaction_id)
 {
     SUSHI_LOG_DEBUG("create_pre_track called with name {}", name);
     auto lambda = [=] () -> int
@@ -265,12 +311,11 @@ ext::ControlStatus AudioGraphController::create_pre_track(const std::string& nam
         return status == EngineReturnStatus::OK? EventStatus::HANDLED_OK : EventStatus::ERROR;
     };
 
-    auto event = new LambdaEvent(lambda, IMMEDIATE_PROCESS);
-    _event_dispatcher->post_event(event);
+    _post_edit(lambda, transaction_id);
     return ext::ControlStatus::OK;
 }
 
-ext::ControlStatus AudioGraphController::create_post_track(const std::string& name)
+ext::ControlStatus AudioGraphController::create_post_track(const std::string& name, std::optional<int> transaction_id)
 {
     SUSHI_LOG_DEBUG("create_post_track called with name {}", name);
     auto lambda = [=] () -> int
@@ -279,15 +324,15 @@ ext::ControlStatus AudioGraphController::create_post_track(const std::string& na
         return status == EngineReturnStatus::OK? EventStatus::HANDLED_OK : EventStatus::ERROR;
     };
 
-    auto event = new LambdaEvent(lambda, IMMEDIATE_PROCESS);
-    _event_dispatcher->post_event(event);
+    _post_edit(lambda, transaction_id);
     return ext::ControlStatus::OK;
 }
 
 ext::ControlStatus AudioGraphController::move_processor_on_track(int processor_id,
                                                                  int source_track_id,
                                                                  int dest_track_id,
-                                                                 std::optional<int> before_processor_id)
+                                                                 std::optional<int> before_processor_id,
+                                                                 std::optional<int> transaction_id)
 {
     SUSHI_LOG_DEBUG("move_processor_on_track called with processor id {}, source track id and {} dest track id {}",
                     processor_id, source_track_id, dest_track_id);
@@ -335,8 +380,7 @@ ext::ControlStatus AudioGraphController::move_processor_on_track(int processor_i
         return status == EngineReturnStatus::OK? EventStatus::HANDLED_OK : EventStatus::ERROR;
     };
 
-    auto event = new LambdaEvent(lambda, IMMEDIATE_PROCESS);
-    _event_dispatcher->post_event(event);
+    _post_edit(lambda, transaction_id);
     return ext::ControlStatus::OK;
 }
 
@@ -345,7 +389,8 @@ ext::ControlStatus AudioGraphController::create_processor_on_track(const std::st
                                                                    const std::string& file,
                                                                    ext::PluginType type,
                                                                    int track_id,
-                                                                   std::optional<int> before_processor_id)
+                                                                   std::optional<int> before_processor_id,
+                                                                   std::optional<int> transaction_id)
 {
     SUSHI_LOG_DEBUG("create_processor_on_track called with name {}, uid {} from {} on track {}",
                                                                     name, uid, file, track_id);
@@ -373,12 +418,11 @@ ext::ControlStatus AudioGraphController::create_processor_on_track(const std::st
         return status == EngineReturnStatus::OK? EventStatus::HANDLED_OK : EventStatus::ERROR;
     };
 
-    auto event = new LambdaEvent(lambda, IMMEDIATE_PROCESS);
-    _event_dispatcher->post_event(event);
+    _post_edit(lambda, transaction_id);
     return ext::ControlStatus::OK;
 }
 
-ext::ControlStatus AudioGraphController::delete_processor_from_track(int processor_id, int track_id)
+ext::ControlStatus AudioGraphController::delete_processor_from_track(int processor_id, int track_id, std::optional<int> transaction_id)
 {
     SUSHI_LOG_DEBUG("delete processor_from_track called with processor id {} and track id {}",
                     processor_id, track_id);
@@ -392,12 +436,11 @@ ext::ControlStatus AudioGraphController::delete_processor_from_track(int process
         return status == EngineReturnStatus::OK? EventStatus::HANDLED_OK : EventStatus::ERROR;
     };
 
-    auto event = new LambdaEvent(lambda, IMMEDIATE_PROCESS);
-    _event_dispatcher->post_event(event);
+    _post_edit(lambda, transaction_id);
     return ext::ControlStatus::OK;
 }
 
-ext::ControlStatus AudioGraphController::delete_track(int track_id)
+ext::ControlStatus AudioGraphController::delete_track(int track_id, std::optional<int> transaction_id)
 {
     SUSHI_LOG_DEBUG("delete_track called with id {}", track_id);
     auto lambda = [=] () -> int
@@ -427,11 +470,63 @@ ext::ControlStatus AudioGraphController::delete_track(int track_id)
         return status == EngineReturnStatus::OK? EventStatus::HANDLED_OK : EventStatus::ERROR;
     };
 
+    _post_edit(lambda, transaction_id);
+    return ext::ControlStatus::OK;
+}
+
+ext::ControlStatus AudioGraphController::pin_track_to_core(int track_id, std::optional<int> core)
+{
+    SUSHI_LOG_DEBUG("pin_track_to_core called with track {} and core {}", track_id, core.value_or(-1));
+    auto lambda = [=] () -> int
+    {
+        auto status = _engine->pin_track_to_core(ObjectId(track_id), core);
+        return status == EngineReturnStatus::OK? EventStatus::HANDLED_OK : EventStatus::ERROR;
+    };
+
     auto event = new LambdaEvent(lambda, IMMEDIATE_PROCESS);
     _event_dispatcher->post_event(event);
     return ext::ControlStatus::OK;
 }
 
+std::pair<ext::ControlStatus, int> AudioGraphController::begin_transaction()
+{
+    SUSHI_LOG_DEBUG("begin_transaction called");
+    auto transaction_id = std::make_shared<int>(0);
+    auto lambda = [=] () -> int
+    {
+        auto [status, id] = _engine->begin_graph_transaction(TRANSACTION_EXPIRY);
+        *transaction_id = id;
+        return status == EngineReturnStatus::OK? EventStatus::HANDLED_OK : EventStatus::ERROR;
+    };
+
+    auto status = post_and_wait(_event_dispatcher, new LambdaEvent(lambda, IMMEDIATE_PROCESS));
+    return {status, status == ext::ControlStatus::OK ? *transaction_id : 0};
+}
+
+ext::ControlStatus AudioGraphController::commit_transaction(int transaction_id)
+{
+    SUSHI_LOG_DEBUG("commit_transaction called with id {}", transaction_id);
+    auto lambda = [=] () -> int
+    {
+        auto status = _engine->commit_graph_transaction(transaction_id);
+        return status == EngineReturnStatus::OK? EventStatus::HANDLED_OK : EventStatus::ERROR;
+    };
+
+    return post_and_wait(_event_dispatcher, new LambdaEvent(lambda, IMMEDIATE_PROCESS));
+}
+
+ext::ControlStatus AudioGraphController::abort_transaction(int transaction_id)
+{
+    SUSHI_LOG_DEBUG("abort_transaction called with id {}", transaction_id);
+    auto lambda = [=] () -> int
+    {
+        auto status = _engine->abort_graph_transaction(transaction_id);
+        return status == EngineReturnStatus::OK? EventStatus::HANDLED_OK : EventStatus::ERROR;
+    };
+
+    return post_and_wait(_event_dispatcher, new LambdaEvent(lambda, IMMEDIATE_PROCESS));
+}
+
 std::vector<int> AudioGraphController::_get_processor_ids(int track_id) const
 {
     std::vector<int> ids;
@@ -444,6 +539,23 @@ std::vector<int> AudioGraphController::_get_processor_ids(int track_id) const
     return ids;
 }
 
+void AudioGraphController::_post_edit(std::function<int()> edit, std::optional<int> transaction_id)
+{
+    auto lambda = [=] () -> int
+    {
+        if (transaction_id.has_value() == false)
+        {
+            return edit();
+        }
+        int status = EventStatus::ERROR;
+        _engine->run_in_graph_transaction(*transaction_id, [&]() {status = edit();});
+        return status;
+    };
+
+    auto event = new LambdaEvent(lambda, IMMEDIATE_PROCESS);
+    _event_dispatcher->post_event(event);
+}
+
 
 } // namespace controller_impl
 } // namespace engine
@@ -59,34 +59,51 @@ public:
 
     ext::ControlStatus set_processor_state(int processor_id, const ext::ProcessorState& state) override;
 
-    ext::ControlStatus create_track(const std::string& name, int channels) override;
+    ext::ControlStatus create_track(const std::string& name, int channels, std::optional<int> transaction_id) override;
 
-    ext::ControlStatus create_multibus_track(const std::string& name, int buses) override;
+    ext::ControlStatus create_multibus_track(const std::string& name, int buses, std::optional<int> transaction_id) override;
 
-    ext::ControlStatus create_pre_track(const std::string& name) override;
+    ext::ControlStatus create_pre_track(const std::string& name, std::optional<int> transaction_id) override;
 
-    ext::ControlStatus create_post_track(const std::string& name) override;
+    ext::ControlStatus create_post_track(const std::string& name, std::optional<int> transaction_id) override;
 
     ext::ControlStatus move_processor_on_track(int processor_id,
                                                int source_track_id,
                                                int dest_track_id,
-                                               std::optional<int> before_processor) override;
+                                               std::optional<int> before_processor,
+                                               std::optional<int> transaction_id) override;
 
     ext::ControlStatus create_processor_on_track(const std::string& name,
                                                  const std::string& uid,
                                                  const std::string& file,
                                                  ext::PluginType type,
                                                  int track_id,
-                                                 std::optional<int> before_processor_id) override;
+                                                 std::optional<int> before_processor_id,
+                                                 std::optional<int> transaction_id) override;
 
-    ext::ControlStatus delete_processor_from_track(int processor_id, int track_id) override;
+    ext::ControlStatus delete_processor_from_track(int processor_id, int track_id, std::optional<int> transaction_id) override;
 
-    ext::ControlStatus delete_track(int track_id) override;
+    ext::ControlStatus delete_track(int track_id, std::optional<int> transaction_id) override;
+
+    ext::ControlStatus pin_track_to_core(int track_id, std::optional<int> core) override;
+
+    std::pair<ext::ControlStatus, int> begin_transaction() override;
+
+    ext::ControlStatus commit_transaction(int transaction_id) override;
+
+    ext::ControlStatus abort_transaction(int transaction_id) override;
 
 
 private:
     std::vector<int> _get_processor_ids(int track_id) const;
 
+    /**
+     * @brief Post a graph edit to the dispatcher, to be made in a transaction if given one
+     * @param edit The edit, returning an EventStatus
+     * @param transaction_id The id of the transaction, or no value to make the edit directly
+     */
+    void _post_edit(std::function<int()> edit, std::optional<int> transaction_id);
+
     engine::BaseEngine*                     _engine;
     dispatcher::BaseEventDispatcher*        _event_dispatcher;
     const engine::BaseProcessorContainer*   _processors;
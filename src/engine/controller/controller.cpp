@@ -97,6 +97,13 @@ ext::ControlStatus Controller::subscribe_to_notifications(ext::NotificationType
             break;
         case ext::NotificationType::CPU_TIMING_UPDATE:
             _cpu_timing_update_listeners.push_back(listener);
+            break;
+        case ext::NotificationType::CORE_STALL_UPDATE:
+            _core_stall_listeners.push_back(listener);
+            break;
+        case ext::NotificationType::CPU_BUDGET_UPDATE:
+            _cpu_budget_listeners.push_back(listener);
+            break;
         default:
             break;
     }
@@ -167,6 +174,16 @@ void Controller::_handle_engine_notifications(const EngineNotificationEvent* eve
         auto typed_event = static_cast<const EngineTimingNotificationEvent*>(event);
         _notify_timing_listeners(typed_event);
     }
+    else if (event->is_core_stall_notification())
+    {
+        auto typed_event = static_cast<const CoreStallNotificationEvent*>(event);
+        _notify_core_stall_listeners(typed_event);
+    }
+    else if (event->is_cpu_budget_notification())
+    {
+        auto typed_event = static_cast<const CpuBudgetNotificationEvent*>(event);
+        _notify_cpu_budget_listeners(typed_event);
+    }
 }
 
 void Controller::_handle_audio_graph_notifications(const AudioGraphNotificationEvent* event)
@@ -280,13 +297,39 @@ void Controller::set_osc_frontend(control_frontend::OSCFrontend* osc_frontend)
 
 void Controller::_notify_timing_listeners(const EngineTimingNotificationEvent* event) const
 {
-    ext::CpuTimingNotification notification(to_external(event->timings()), event->time());
+    ext::CpuTimingNotification notification(to_external(event->timings()), event->time(), event->shed_tracks());
     for (auto& listener : _cpu_timing_update_listeners)
     {
         listener->notification(&notification);
     }
 }
 
+void Controller::_notify_core_stall_listeners(const CoreStallNotificationEvent* event) const
+{
+    ext::CoreStallNotification notification(event->core(),
+                                            static_cast<int>(event->track()),
+                                            static_cast<int>(event->processor()),
+                                            event->stalled(),
+                                            event->time());
+    for (auto& listener : _core_stall_listeners)
+    {
+        listener->notification(&notification);
+    }
+}
+
+void Controller::_notify_cpu_budget_listeners(const CpuBudgetNotificationEvent* event) const
+{
+    ext::CpuBudgetNotification notification(static_cast<int>(event->processor()),
+                                            static_cast<int>(event->track()),
+                                            to_external(event->prediction()),
+                                            event->rejected(),
+                                            event->time());
+    for (auto& listener : _cpu_budget_listeners)
+    {
+        listener->notification(&notification);
+    }
+}
+
 
 }// namespace engine
 }// namespace sushi
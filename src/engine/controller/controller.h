@@ -102,12 +102,18 @@ private:
 
     void _notify_timing_listeners(const EngineTimingNotificationEvent* event) const;
 
+    void _notify_core_stall_listeners(const CoreStallNotificationEvent* event) const;
+
+    void _notify_cpu_budget_listeners(const CpuBudgetNotificationEvent* event) const;
+
     std::vector<ext::ControlListener*>      _parameter_change_listeners;
     std::vector<ext::ControlListener*>      _property_change_listeners;
     std::vector<ext::ControlListener*>      _processor_update_listeners;
     std::vector<ext::ControlListener*>      _track_update_listeners;
     std::vector<ext::ControlListener*>      _transport_update_listeners;
     std::vector<ext::ControlListener*>      _cpu_timing_update_listeners;
+    std::vector<ext::ControlListener*>      _core_stall_listeners;
+    std::vector<ext::ControlListener*>      _cpu_budget_listeners;
 
     const engine::BaseProcessorContainer*   _processors;
 
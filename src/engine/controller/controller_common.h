@@ -83,6 +83,17 @@ inline ext::CpuTimings to_external(const sushi::performance::ProcessTimings& tim
             .max = timings.max_case};
 }
 
+inline ext::CpuLoadPrediction to_external(const sushi::LoadPrediction& prediction)
+{
+    return {prediction.core,
+            prediction.current_load,
+            prediction.plugin_load,
+            prediction.plugin_known,
+            prediction.predicted_load,
+            prediction.budget,
+            prediction.within_budget};
+}
+
 inline ext::TimeSignature to_external(sushi::TimeSignature internal)
 {
     return {internal.numerator, internal.denominator};
@@ -27,7 +27,8 @@ namespace sushi {
 namespace engine {
 namespace controller_impl {
 
-TimingController::TimingController(sushi::engine::BaseEngine* engine) : _performance_timer(engine->performance_timer())
+TimingController::TimingController(sushi::engine::BaseEngine* engine) : _engine(engine),
+                                                                        _performance_timer(engine->performance_timer())
 {}
 
 inline ext::CpuTimings to_external(sushi::performance::ProcessTimings& internal)
@@ -66,6 +67,45 @@ std::pair<ext::ControlStatus, ext::CpuTimings> TimingController::get_processor_t
     return _get_timings(processor_id);
 }
 
+std::pair<ext::ControlStatus, std::vector<ext::PipelineStageTimings>> TimingController::get_track_pipeline_timings(int track_id) const
+{
+    SUSHI_LOG_DEBUG("get_track_pipeline_timings called with track {}", track_id);
+    if (_performance_timer->enabled() == false)
+    {
+        return {ext::ControlStatus::UNSUPPORTED_OPERATION, {}};
+    }
+    std::vector<ext::PipelineStageTimings> stages;
+    for (const auto& stage : _engine->track_pipeline(static_cast<ObjectId>(track_id)))
+    {
+        auto& stage_timings = stages.emplace_back(ext::PipelineStageTimings{{}, {0, 0, 0}});
+        stage_timings.processors.assign(stage.processors.begin(), stage.processors.end());
+        auto timings = _performance_timer->timings_for_node(static_cast<int>(stage.timing_id));
+        if (timings.has_value())
+        {
+            stage_timings.timings = to_external(timings.value());
+        }
+    }
+    return {ext::ControlStatus::OK, stages};
+}
+
+std::pair<ext::ControlStatus, ext::CpuLoadPrediction> TimingController::get_plugin_load_prediction(const std::string& uid,
+                                                                                                    int track_id) const
+{
+    SUSHI_LOG_DEBUG("get_plugin_load_prediction called with plugin {} and track {}", uid, track_id);
+    auto [status, prediction] = _engine->predict_plugin_load(uid, static_cast<ObjectId>(track_id));
+    if (status != EngineReturnStatus::OK)
+    {
+        return {ext::ControlStatus::NOT_FOUND, {0, 0.0f, 0.0f, false, 0.0f, std::nullopt, true}};
+    }
+    return {ext::ControlStatus::OK, {prediction.core,
+                                     prediction.current_load,
+                                     prediction.plugin_load,
+                                     prediction.plugin_known,
+                                     prediction.predicted_load,
+                                     prediction.budget,
+                                     prediction.within_budget}};
+}
+
 ext::ControlStatus TimingController::reset_all_timings()
 {
     SUSHI_LOG_DEBUG("reset_all_timings called, returning ");
@@ -46,6 +46,10 @@ public:
 
     std::pair<ext::ControlStatus, ext::CpuTimings> get_processor_timings(int processor_id) const override;
 
+    std::pair<ext::ControlStatus, std::vector<ext::PipelineStageTimings>> get_track_pipeline_timings(int track_id) const override;
+
+    std::pair<ext::ControlStatus, ext::CpuLoadPrediction> get_plugin_load_prediction(const std::string& uid, int track_id) const override;
+
     ext::ControlStatus reset_all_timings() override;
 
     ext::ControlStatus reset_track_timings(int track_id) override;
@@ -55,6 +59,7 @@ public:
 private:
     std::pair<ext::ControlStatus, ext::CpuTimings> _get_timings(int node) const;
 
+    BaseEngine*                         _engine;
     performance::BasePerformanceTimer*  _performance_timer;
 };
 
@@ -58,6 +58,15 @@ public:
         return _transport;
     }
 
+    /**
+     * @brief Replace the transport returned by transport()
+     * @param transport The transport to use
+     */
+    void set_transport(engine::Transport* transport)
+    {
+        _transport = transport;
+    }
+
     /**
      * @brief Convert a relative plugin path to an absolute path,
      *        if a base plugin path has been set.
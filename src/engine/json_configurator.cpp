@@ -776,6 +776,24 @@ JsonConfigReturnStatus JsonConfigurator::_make_track(const rapidjson::Value& tra
     }
 
     SUSHI_LOG_DEBUG("Successfully added track \"{}\" to the engine", name);
+    if (type == TrackType::REGULAR && track_def.HasMember("core"))
+    {
+        status = _engine->pin_track_to_core(track_id, track_def["core"].GetInt());
+        if (status != EngineReturnStatus::OK)
+        {
+            SUSHI_LOG_ERROR("Failed to pin track {} to core {}", name, track_def["core"].GetInt());
+            return JsonConfigReturnStatus::INVALID_CONFIGURATION;
+        }
+    }
+    if (type == TrackType::REGULAR && track_def.HasMember("priority"))
+    {
+        status = _engine->set_track_priority(track_id, track_def["priority"].GetInt());
+        if (status != EngineReturnStatus::OK)
+        {
+            SUSHI_LOG_ERROR("Failed to set priority of track {}", name);
+            return JsonConfigReturnStatus::INVALID_CONFIGURATION;
+        }
+    }
     if (type == TrackType::REGULAR)
     {
         auto connect_status = _connect_audio_to_track(track_def, name, track_id);
@@ -794,6 +812,16 @@ JsonConfigReturnStatus JsonConfigurator::_make_track(const rapidjson::Value& tra
         }
     }
 
+    if (track_def.HasMember("pipeline_stages"))
+    {
+        status = _engine->set_track_pipeline_stages(track_id, track_def["pipeline_stages"].GetInt());
+        if (status != EngineReturnStatus::OK)
+        {
+            SUSHI_LOG_ERROR("Failed to process track {} in {} pipeline stages", name, track_def["pipeline_stages"].GetInt());
+            return JsonConfigReturnStatus::INVALID_CONFIGURATION;
+        }
+    }
+
     SUSHI_LOG_DEBUG("Successfully added {} Track {} to the engine", type == TrackType::REGULAR? "" :"Master", name);
     return JsonConfigReturnStatus::OK;
 }
@@ -1018,6 +1046,24 @@ JsonConfigReturnStatus JsonConfigurator::_add_plugin(const rapidjson::Value& plu
     {
         return JsonConfigReturnStatus::INVALID_CONFIGURATION;
     }
+    if (plugin_def.HasMember("bus"))
+    {
+        status = _engine->set_processor_bus(plugin_id, track_id, plugin_def["bus"].GetInt());
+        if (status != EngineReturnStatus::OK)
+        {
+            SUSHI_LOG_ERROR("Failed to assign plugin \"{}\" to bus {}", plugin_name, plugin_def["bus"].GetInt());
+            return JsonConfigReturnStatus::INVALID_CONFIGURATION;
+        }
+    }
+    if (plugin_def.HasMember("async") && plugin_def["async"].GetBool())
+    {
+        status = _engine->set_processor_async(plugin_id, track_id, true);
+        if (status != EngineReturnStatus::OK)
+        {
+            SUSHI_LOG_ERROR("Failed to set asynchronous processing of plugin \"{}\"", plugin_name);
+            return JsonConfigReturnStatus::INVALID_CONFIGURATION;
+        }
+    }
     SUSHI_LOG_DEBUG("Successfully added Plugin \"{}\" to track: \"{}\"", plugin_name, track_name);
 
     return JsonConfigReturnStatus::OK;
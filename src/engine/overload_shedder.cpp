@@ -0,0 +1,60 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Detection of sustained overload of the audio thread, to decide when to stop
+ *        rendering low priority tracks and when to start rendering them again
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#include "overload_shedder.h"
+
+namespace sushi {
+namespace engine {
+
+ShedAction OverloadShedder::update(float load, bool tracks_shed)
+{
+    _overloaded_chunks = load > OVERLOAD_THRESHOLD ? _overloaded_chunks + 1 : 0;
+    _underloaded_chunks = load < RESTORE_THRESHOLD ? _underloaded_chunks + 1 : 0;
+    if (_settle_chunks > 0)
+    {
+        _settle_chunks--;
+        return ShedAction::NONE;
+    }
+
+    if (_overloaded_chunks >= OVERLOAD_CHUNKS)
+    {
+        _overloaded_chunks = 0;
+        _settle_chunks = SETTLE_CHUNKS;
+        return ShedAction::SHED;
+    }
+    if (tracks_shed && _underloaded_chunks >= RESTORE_CHUNKS)
+    {
+        _underloaded_chunks = 0;
+        _settle_chunks = SETTLE_CHUNKS;
+        return ShedAction::RESTORE;
+    }
+    return ShedAction::NONE;
+}
+
+void OverloadShedder::reset()
+{
+    _overloaded_chunks = 0;
+    _underloaded_chunks = 0;
+    _settle_chunks = 0;
+}
+
+} // namespace engine
+} // namespace sushi
@@ -0,0 +1,79 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Detection of sustained overload of the audio thread, to decide when to stop
+ *        rendering low priority tracks and when to start rendering them again
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_OVERLOAD_SHEDDER_H
+#define SUSHI_OVERLOAD_SHEDDER_H
+
+namespace sushi {
+namespace engine {
+
+enum class ShedAction
+{
+    NONE,
+    SHED,
+    RESTORE
+};
+
+/**
+ * @brief Decides when to shed tracks from the load of every chunk, i.e. the time it took
+ *        to process as a fraction of the chunk period. Single spikes are let through, tracks
+ *        are only shed when the load has been close to the deadline for several chunks in a
+ *        row, one priority at a time to give the load time to settle. Shed tracks are
+ *        restored one priority at a time once the load has stayed well below the deadline
+ *        for a longer period. Does not allocate memory, called from the rt thread.
+ */
+class OverloadShedder
+{
+public:
+    /* Load above which a chunk is considered overloaded */
+    static constexpr float OVERLOAD_THRESHOLD = 0.9f;
+    /* Load below which shed tracks may be restored */
+    static constexpr float RESTORE_THRESHOLD = 0.6f;
+    /* Overloaded chunks in a row before tracks are shed */
+    static constexpr int OVERLOAD_CHUNKS = 3;
+    /* Chunks in a row below RESTORE_THRESHOLD before tracks are restored */
+    static constexpr int RESTORE_CHUNKS = 1000;
+    /* Chunks to wait after shedding before shedding more, the tracks fade out meanwhile */
+    static constexpr int SETTLE_CHUNKS = 8;
+
+    /**
+     * @brief Register the load of a chunk and decide whether to shed or restore tracks
+     * @param load The time it took to process the chunk, as a fraction of the chunk period
+     * @param tracks_shed Whether any tracks are currently shed
+     * @return The action to take
+     */
+    ShedAction update(float load, bool tracks_shed);
+
+    /**
+     * @brief Forget about previous chunks, i.e. when shedding is turned on
+     */
+    void reset();
+
+private:
+    int _overloaded_chunks{0};
+    int _underloaded_chunks{0};
+    int _settle_chunks{0};
+};
+
+} // namespace engine
+} // namespace sushi
+
+#endif //SUSHI_OVERLOAD_SHEDDER_H
@@ -0,0 +1,135 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Processing cost of plugins, learned from the timings of their instances, used
+ *        to predict the load of adding a plugin to a track
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#include <fstream>
+#include <sstream>
+
+#include "plugin_cost_model.h"
+
+namespace sushi {
+namespace engine {
+
+void PluginCostModel::add_instance(ObjectId processor, const std::string& uid)
+{
+    std::scoped_lock lock(_lock);
+    _instances[processor] = {uid, false};
+}
+
+void PluginCostModel::remove_instance(ObjectId processor)
+{
+    std::scoped_lock lock(_lock);
+    _instances.erase(processor);
+}
+
+void PluginCostModel::update(ObjectId processor, float load)
+{
+    std::scoped_lock lock(_lock);
+    auto instance = _instances.find(processor);
+    if (instance == _instances.end())
+    {
+        return;
+    }
+    auto [cost, added] = _costs.try_emplace(instance->second.uid, load);
+    if (added == false)
+    {
+        cost->second += COST_SMOOTHING * (load - cost->second);
+    }
+}
+
+void PluginCostModel::admit(ObjectId processor)
+{
+    std::scoped_lock lock(_lock);
+    auto instance = _instances.find(processor);
+    if (instance != _instances.end())
+    {
+        instance->second.admitted = true;
+    }
+}
+
+bool PluginCostModel::admitted(ObjectId processor) const
+{
+    std::scoped_lock lock(_lock);
+    auto instance = _instances.find(processor);
+    return instance != _instances.end() && instance->second.admitted;
+}
+
+std::optional<std::string> PluginCostModel::uid(ObjectId processor) const
+{
+    std::scoped_lock lock(_lock);
+    auto instance = _instances.find(processor);
+    if (instance == _instances.end())
+    {
+        return std::nullopt;
+    }
+    return instance->second.uid;
+}
+
+std::optional<float> PluginCostModel::cost(const std::string& uid) const
+{
+    std::scoped_lock lock(_lock);
+    auto cost = _costs.find(uid);
+    if (cost == _costs.end())
+    {
+        return std::nullopt;
+    }
+    return cost->second;
+}
+
+bool PluginCostModel::load(const std::string& path)
+{
+    std::ifstream file(path);
+    if (file.is_open() == false)
+    {
+        return false;
+    }
+    std::scoped_lock lock(_lock);
+    std::string line;
+    while (std::getline(file, line))
+    {
+        // The cost comes first, as the uid may contain spaces
+        std::istringstream stream(line);
+        float cost;
+        std::string uid;
+        if (stream >> cost >> std::ws && std::getline(stream, uid) && uid.empty() == false)
+        {
+            _costs[uid] = cost;
+        }
+    }
+    return true;
+}
+
+bool PluginCostModel::save(const std::string& path) const
+{
+    std::ofstream file(path);
+    if (file.is_open() == false)
+    {
+        return false;
+    }
+    std::scoped_lock lock(_lock);
+    for (const auto& [uid, cost] : _costs)
+    {
+        file << cost << " " << uid << "\n";
+    }
+    return file.good();
+}
+
+} // namespace engine
+} // namespace sushi
@@ -0,0 +1,125 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Processing cost of plugins, learned from the timings of their instances, used
+ *        to predict the load of adding a plugin to a track
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_PLUGIN_COST_MODEL_H
+#define SUSHI_PLUGIN_COST_MODEL_H
+
+#include <string>
+#include <unordered_map>
+#include <optional>
+#include <mutex>
+
+#include "library/id_generator.h"
+
+namespace sushi {
+namespace engine {
+
+/**
+ * @brief Keeps the cost of every plugin uid, in fractions of the audio chunk period, as a
+ *        moving average of the load of its instances, so that the cost of a plugin is
+ *        known before an instance of it is added to a track. The costs can be saved to and
+ *        loaded from a file, to keep them between sessions.
+ *        Safe to call from several non-rt threads, not used from the rt thread.
+ */
+class PluginCostModel
+{
+public:
+    /* Weight of a new measurement in the moving average of the cost */
+    static constexpr float COST_SMOOTHING = 0.25f;
+
+    /**
+     * @brief Register an instance of a plugin, so its load is attributed to the plugin
+     * @param processor The id of the instance
+     * @param uid The uid of the plugin
+     */
+    void add_instance(ObjectId processor, const std::string& uid);
+
+    /**
+     * @brief Forget about an instance, i.e. when it is deleted
+     * @param processor The id of the instance
+     */
+    void remove_instance(ObjectId processor);
+
+    /**
+     * @brief Update the cost of the plugin of an instance with a new measurement
+     * @param processor The id of the instance
+     * @param load The measured load of the instance, in fractions of the chunk period
+     */
+    void update(ObjectId processor, float load);
+
+    /**
+     * @brief Mark an instance as admitted to the engine, i.e. when first added to a track
+     * @param processor The id of the instance
+     */
+    void admit(ObjectId processor);
+
+    /**
+     * @brief Whether an instance has been admitted to the engine before
+     * @param processor The id of the instance
+     * @return true if the instance was admitted, false otherwise or if it is not registered
+     */
+    bool admitted(ObjectId processor) const;
+
+    /**
+     * @brief Return the uid of the plugin of an instance
+     * @param processor The id of the instance
+     * @return The uid, or nothing if the instance is not registered
+     */
+    std::optional<std::string> uid(ObjectId processor) const;
+
+    /**
+     * @brief Return the learned cost of a plugin
+     * @param uid The uid of the plugin
+     * @return The cost in fractions of the chunk period, or nothing if no instance of the
+     *         plugin has been measured
+     */
+    std::optional<float> cost(const std::string& uid) const;
+
+    /**
+     * @brief Load costs saved with save(), replacing the costs of plugins in the file
+     * @param path The file to read
+     * @return true if the file was read, false if it could not be opened
+     */
+    bool load(const std::string& path);
+
+    /**
+     * @brief Save all learned costs to a file, one plugin per line
+     * @param path The file to write
+     * @return true if the file was written, false otherwise
+     */
+    bool save(const std::string& path) const;
+
+private:
+    struct Instance
+    {
+        std::string uid;
+        bool        admitted;
+    };
+
+    std::unordered_map<ObjectId, Instance> _instances;
+    std::unordered_map<std::string, float> _costs;
+    mutable std::mutex                     _lock;
+};
+
+} // namespace engine
+} // namespace sushi
+
+#endif //SUSHI_PLUGIN_COST_MODEL_H
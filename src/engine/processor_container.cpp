@@ -18,6 +18,9 @@
  * @copyright 2017-2020 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
  */
 
+#include <algorithm>
+#include <thread>
+
 #include "processor_container.h"
 #include "logging.h"
 
@@ -26,120 +29,142 @@ namespace engine {
 
 SUSHI_GET_LOGGER_WITH_MODULE_NAME("engine");
 
+ProcessorContainer::ProcessorContainer() : _snapshot(new Snapshot)
+{}
+
+ProcessorContainer::~ProcessorContainer()
+{
+    delete _snapshot.load();
+}
+
 bool ProcessorContainer::add_processor(std::shared_ptr<Processor> processor)
 {
-    std::scoped_lock<std::mutex, std::mutex> lock(_processors_by_name_lock, _processors_by_id_lock);
-    if (_processors_by_name.count(processor->name()) > 0)
+    return _write([&](Snapshot& snapshot)
     {
-        return false;
-    }
-    _processors_by_name[processor->name()] = processor;
-    _processors_by_id[processor->id()] = processor;
-    return true;
+        if (snapshot.processors_by_name.count(processor->name()) > 0)
+        {
+            return false;
+        }
+        snapshot.processors_by_name[processor->name()] = processor;
+        snapshot.processors_by_id[processor->id()] = processor;
+        return true;
+    });
 }
 
 bool ProcessorContainer::add_track(std::shared_ptr<Track> track)
 {
-    std::scoped_lock<std::mutex> lock(_processors_by_track_lock);
-    if (_processors_by_track.count(track->id()) > 0)
+    return _write([&](Snapshot& snapshot)
     {
-        return false;
-    }
-    _processors_by_track[track->id()].clear();
-    return true;
+        if (snapshot.processors_by_track.count(track->id()) > 0)
+        {
+            return false;
+        }
+        snapshot.processors_by_track[track->id()].clear();
+        return true;
+    });
 }
 
 bool ProcessorContainer::remove_processor(ObjectId id)
 {
-    auto processor = this->processor(id);
-    if (processor == nullptr)
-    {
-        return false;
-    }
-    {
-        std::scoped_lock<std::mutex> lock(_processors_by_id_lock);
-        [[maybe_unused]] auto count = _processors_by_id.erase(processor->id());
-        SUSHI_LOG_WARNING_IF(count != 1, "Erased {} instances of processor {}", count, processor->name())
-    }
+    return _write([&](Snapshot& snapshot)
     {
-        std::scoped_lock<std::mutex> lock(_processors_by_name_lock);
-        [[maybe_unused]] auto count = _processors_by_name.erase(processor->name());
+        auto processor_node = snapshot.processors_by_id.find(id);
+        if (processor_node == snapshot.processors_by_id.end())
+        {
+            return false;
+        }
+        auto processor = processor_node->second;
+        snapshot.processors_by_id.erase(processor_node);
+        [[maybe_unused]] auto count = snapshot.processors_by_name.erase(processor->name());
         SUSHI_LOG_WARNING_IF(count != 1, "Erased {} instances of processor {}", count, processor->name())
-    }
-    return true;
+        return true;
+    });
 }
 
 bool ProcessorContainer::remove_track(ObjectId track_id)
 {
-    std::scoped_lock<std::mutex> lock(_processors_by_track_lock);
-    assert(_processors_by_track[track_id].empty());
-    _processors_by_track.erase(track_id);
+    _write([&](Snapshot& snapshot)
+    {
+        assert(snapshot.processors_by_track[track_id].empty());
+        snapshot.processors_by_track.erase(track_id);
+        return true;
+    });
     return true;
 }
 
 bool ProcessorContainer::add_to_track(std::shared_ptr<Processor> processor, ObjectId track_id,
                                       std::optional<ObjectId> before_id)
 {
-    std::scoped_lock<std::mutex> lock(_processors_by_track_lock);
-    auto& track_processors = _processors_by_track[track_id];
-
-    if (before_id.has_value())
+    _write([&](Snapshot& snapshot)
     {
-        for (auto i = track_processors.begin(); i != track_processors.end(); ++i)
+        auto& track_processors = snapshot.processors_by_track[track_id];
+        if (before_id.has_value())
         {
-            if ((*i)->id() == before_id.value())
+            for (auto i = track_processors.begin(); i != track_processors.end(); ++i)
             {
-                track_processors.insert(i, processor);
-                return true;
+                if ((*i)->id() == before_id.value())
+                {
+                    track_processors.insert(i, processor);
+                    return true;
+                }
             }
+            // If we end up here, the track's processing chain and processors_by_track has diverged.
+            assert(false);
         }
-        // If we end up here, the track's processing chain and _processors_by_track has diverged.
-        assert(false);
-    }
-    else
-    {
-        track_processors.push_back(processor);
-    }
+        else
+        {
+            track_processors.push_back(processor);
+        }
+        return true;
+    });
     return true;
 }
 
 bool ProcessorContainer::processor_exists(ObjectId id) const
 {
-    std::scoped_lock<std::mutex> lock(_processors_by_id_lock);
-    return _processors_by_id.count(id) > 0;
+    return _read([&](const Snapshot& snapshot)
+    {
+        return snapshot.processors_by_id.count(id) > 0;
+    });
 }
 
 bool ProcessorContainer::processor_exists(const std::string& name) const
 {
-    std::scoped_lock<std::mutex> lock(_processors_by_name_lock);
-    return _processors_by_name.count(name) > 0;
+    return _read([&](const Snapshot& snapshot)
+    {
+        return snapshot.processors_by_name.count(name) > 0;
+    });
 }
 
 bool ProcessorContainer::remove_from_track(ObjectId processor_id, ObjectId track_id)
 {
-    std::scoped_lock<std::mutex> lock(_processors_by_track_lock);
-    auto& track_processors = _processors_by_track[track_id];
-    for (auto i = track_processors.cbegin(); i != track_processors.cend(); ++i)
+    return _write([&](Snapshot& snapshot)
     {
-        if ((*i)->id() == processor_id)
+        auto& track_processors = snapshot.processors_by_track[track_id];
+        for (auto i = track_processors.cbegin(); i != track_processors.cend(); ++i)
         {
-            track_processors.erase(i);
-            return true;
+            if ((*i)->id() == processor_id)
+            {
+                track_processors.erase(i);
+                return true;
+            }
         }
-    }
-    return false;
+        return false;
+    });
 }
 
 std::vector<std::shared_ptr<const Processor>> ProcessorContainer::all_processors() const
 {
-    std::vector<std::shared_ptr<const Processor>> processors;
-    std::scoped_lock<std::mutex> lock(_processors_by_id_lock);
-    processors.reserve(_processors_by_id.size());
-    for (const auto& p : _processors_by_id)
+    return _read([&](const Snapshot& snapshot)
     {
-        processors.emplace_back(p.second);
-    }
-    return processors;
+        std::vector<std::shared_ptr<const Processor>> processors;
+        processors.reserve(snapshot.processors_by_id.size());
+        for (const auto& p : snapshot.processors_by_id)
+        {
+            processors.emplace_back(p.second);
+        }
+        return processors;
+    });
 }
 
 std::shared_ptr<Processor> ProcessorContainer::mutable_processor(ObjectId id) const
@@ -154,24 +179,28 @@ std::shared_ptr<Processor> ProcessorContainer::mutable_processor(const std::stri
 
 std::shared_ptr<const Processor> ProcessorContainer::processor(ObjectId id) const
 {
-    std::scoped_lock<std::mutex> lock(_processors_by_id_lock);
-    auto processor_node = _processors_by_id.find(id);
-    if (processor_node == _processors_by_id.end())
+    return _read([&](const Snapshot& snapshot) -> std::shared_ptr<const Processor>
     {
-        return nullptr;
-    }
-    return processor_node->second;
+        auto processor_node = snapshot.processors_by_id.find(id);
+        if (processor_node == snapshot.processors_by_id.end())
+        {
+            return nullptr;
+        }
+        return processor_node->second;
+    });
 }
 
 std::shared_ptr<const Processor> ProcessorContainer::processor(const std::string& name) const
 {
-    std::scoped_lock<std::mutex> lock(_processors_by_name_lock);
-    auto processor_node = _processors_by_name.find(name);
-    if (processor_node == _processors_by_name.end())
+    return _read([&](const Snapshot& snapshot) -> std::shared_ptr<const Processor>
     {
-        return nullptr;
-    }
-    return processor_node->second;
+        auto processor_node = snapshot.processors_by_name.find(name);
+        if (processor_node == snapshot.processors_by_name.end())
+        {
+            return nullptr;
+        }
+        return processor_node->second;
+    });
 }
 
 std::shared_ptr<Track> ProcessorContainer::mutable_track(ObjectId track_id) const
@@ -188,69 +217,95 @@ std::shared_ptr<const Track> ProcessorContainer::track(ObjectId track_id) const
 {
     /* Check if there is an entry for the ObjectId in the list of track processor
      * In that case we can safely look up the processor by its id and cast it */
-    std::scoped_lock<std::mutex> lock(_processors_by_track_lock);
-    if (_processors_by_track.count(track_id) > 0)
+    return _read([&](const Snapshot& snapshot) -> std::shared_ptr<const Track>
     {
-        std::scoped_lock<std::mutex> id_lock(_processors_by_id_lock);
-        auto track_node = _processors_by_id.find(track_id);
-        if (track_node != _processors_by_id.end())
+        if (snapshot.processors_by_track.count(track_id) > 0)
         {
-            return std::static_pointer_cast<const Track>(track_node->second);
+            auto track_node = snapshot.processors_by_id.find(track_id);
+            if (track_node != snapshot.processors_by_id.end())
+            {
+                return std::static_pointer_cast<const Track>(track_node->second);
+            }
         }
-    }
-    return nullptr;
+        return nullptr;
+    });
 }
 
 std::shared_ptr<const Track> ProcessorContainer::track(const std::string& track_name) const
 {
-    std::scoped_lock<std::mutex> _lock(_processors_by_name_lock);
-    auto track_node = _processors_by_name.find(track_name);
-    if (track_node != _processors_by_name.end())
+    return _read([&](const Snapshot& snapshot) -> std::shared_ptr<const Track>
     {
-        /* Check if there is an entry for the ObjectId in the list of track processor
-         * In that case we can safely look up the processor by its id and cast it */
-        std::scoped_lock<std::mutex> lock(_processors_by_track_lock);
-        if (_processors_by_track.count(track_node->second->id()) > 0)
+        auto track_node = snapshot.processors_by_name.find(track_name);
+        if (track_node != snapshot.processors_by_name.end() &&
+            snapshot.processors_by_track.count(track_node->second->id()) > 0)
         {
             return std::static_pointer_cast<const Track>(track_node->second);
         }
-    }
-    return nullptr;
+        return nullptr;
+    });
 }
 
 std::vector<std::shared_ptr<const Processor>> ProcessorContainer::processors_on_track(ObjectId track_id) const
 {
-    std::vector<std::shared_ptr<const Processor>> processors;
-    std::scoped_lock<std::mutex> lock(_processors_by_track_lock);
-    auto track_node = _processors_by_track.find(track_id);
-    if (track_node != _processors_by_track.end())
+    return _read([&](const Snapshot& snapshot)
     {
-        processors.reserve(track_node->second.size());
-        for (const auto& p : track_node->second)
+        std::vector<std::shared_ptr<const Processor>> processors;
+        auto track_node = snapshot.processors_by_track.find(track_id);
+        if (track_node != snapshot.processors_by_track.end())
         {
-            processors.push_back(p);
+            processors.assign(track_node->second.begin(), track_node->second.end());
         }
-    }
-    return processors;
+        return processors;
+    });
 }
 
 std::vector<std::shared_ptr<const Track>> ProcessorContainer::all_tracks() const
 {
-    std::vector<std::shared_ptr<const Track>> tracks;
+    return _read([&](const Snapshot& snapshot)
+    {
+        return snapshot.tracks;
+    });
+}
+
+void ProcessorContainer::_update_tracks(Snapshot& snapshot)
+{
+    snapshot.tracks.clear();
+    for (const auto& p : snapshot.processors_by_track)
+    {
+        auto processor_node = snapshot.processors_by_id.find(p.first);
+        if (processor_node != snapshot.processors_by_id.end())
+        {
+            snapshot.tracks.push_back(std::static_pointer_cast<const Track, Processor>(processor_node->second));
+        }
+    }
+    /* Sort the list so tracks are listed in the order they were created */
+    std::sort(snapshot.tracks.begin(), snapshot.tracks.end(), [](const auto& a, const auto& b) {return a->id() < b->id();});
+}
+
+int ProcessorContainer::_reader_slot()
+{
+    static std::atomic<int> next_slot{0};
+    thread_local int slot = next_slot.fetch_add(1, std::memory_order_relaxed) % READER_SLOTS;
+    return slot;
+}
+
+void ProcessorContainer::_wait_for_readers()
+{
+    /* Wait for both halves of readers to drain in turn, as in an rcu grace period. Readers
+     * that start after the new snapshot is published may be counted in either half, but
+     * will only ever read the new snapshot, and each wait is bounded since new readers are
+     * counted in the other half */
+    for (int phase = 0; phase < 2; ++phase)
     {
-        std::scoped_lock<std::mutex, std::mutex> lock(_processors_by_track_lock, _processors_by_id_lock);
-        for (const auto& p : _processors_by_track)
+        int previous_epoch = _reader_epoch.fetch_add(1) & 1;
+        for (const auto& reader : _readers[previous_epoch])
         {
-            auto processor_node = _processors_by_id.find(p.first);
-            if (processor_node != _processors_by_id.end())
+            while (reader.count.load() > 0)
             {
-                tracks.push_back(std::static_pointer_cast<const Track, Processor>(processor_node->second));
+                std::this_thread::yield();
             }
         }
     }
-    /* Sort the list so tracks are listed in the order they were created */
-    std::sort(tracks.begin(), tracks.end(), [](auto a, auto b) {return a->id() < b->id();});
-    return tracks;
 }
 
 } // namespace engine
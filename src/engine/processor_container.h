@@ -26,18 +26,31 @@
 #include <vector>
 #include <utility>
 #include <mutex>
+#include <atomic>
+#include <array>
 
 #include "base_processor_container.h"
 #include "track.h"
 #include "library/processor.h"
+#include "library/spinlock.h"
 
 namespace sushi {
 namespace engine {
 
+/**
+ * @brief Thread safe container of all processors and tracks. The contents are kept as an
+ *        immutable snapshot that is replaced on every modification. Queries only read the
+ *        current snapshot and never take a lock, so they are wait-free and don't block each
+ *        other or modifications. Modifications are serialized and wait until no queries are
+ *        reading the replaced snapshot before freeing it.
+ */
 class ProcessorContainer : public BaseProcessorContainer
 {
 public:
-    ProcessorContainer() = default;
+    ProcessorContainer();
+
+    ~ProcessorContainer();
+
     SUSHI_DECLARE_NON_COPYABLE(ProcessorContainer);
 
     /**
@@ -188,13 +201,77 @@ public:
     std::vector<std::shared_ptr<const Track>> all_tracks() const override;
 
 private:
-    std::unordered_map<std::string, std::shared_ptr<Processor>>           _processors_by_name;
-    std::unordered_map<ObjectId, std::shared_ptr<Processor>>              _processors_by_id;
-    std::unordered_map<ObjectId, std::vector<std::shared_ptr<Processor>>> _processors_by_track;
+    struct Snapshot
+    {
+        std::unordered_map<std::string, std::shared_ptr<Processor>>           processors_by_name;
+        std::unordered_map<ObjectId, std::shared_ptr<Processor>>              processors_by_id;
+        std::unordered_map<ObjectId, std::vector<std::shared_ptr<Processor>>> processors_by_track;
+        /* Sorted in the order the tracks were created */
+        std::vector<std::shared_ptr<const Track>>                             tracks;
+    };
+
+    /* Number of threads currently reading a snapshot. Spread out over several cache
+     * lines so that reading threads don't contend for the same counter */
+    struct alignas(ASSUMED_CACHE_LINE_SIZE) ReaderCount
+    {
+        std::atomic<int> count{0};
+    };
+
+    static constexpr int READER_SLOTS = 16;
+
+    /**
+     * @brief Call a function with the current snapshot, the snapshot is valid until
+     *        the function returns.
+     * @param function A function taking a const Snapshot& argument
+     * @return The return value of function
+     */
+    template <typename Function>
+    auto _read(Function function) const
+    {
+        auto& reader = _readers[_reader_epoch.load() & 1][_reader_slot()];
+        reader.count.fetch_add(1);
+        auto result = function(*_snapshot.load());
+        reader.count.fetch_sub(1);
+        return result;
+    }
+
+    /**
+     * @brief Modify a copy of the current snapshot and publish it if successful
+     * @param function A function taking a Snapshot& argument and returning true
+     *                 if the snapshot was modified.
+     * @return The return value of function
+     */
+    template <typename Function>
+    bool _write(Function function)
+    {
+        std::scoped_lock<std::mutex> lock(_write_lock);
+        std::unique_ptr<const Snapshot> previous(_snapshot.load());
+        auto snapshot = std::make_unique<Snapshot>(*previous);
+        if (function(*snapshot) == false)
+        {
+            previous.release();
+            return false;
+        }
+        _update_tracks(*snapshot);
+        _snapshot.store(snapshot.release());
+        _wait_for_readers();
+        return true;
+    }
+
+    static void _update_tracks(Snapshot& snapshot);
+
+    static int _reader_slot();
+
+    void _wait_for_readers();
+
+    std::atomic<const Snapshot*> _snapshot;
+    std::mutex                   _write_lock;
 
-    mutable std::mutex _processors_by_name_lock;
-    mutable std::mutex _processors_by_id_lock;
-    mutable std::mutex _processors_by_track_lock;
+    /* Readers count themselves in the half given by the lowest bit of _reader_epoch,
+     * which lets writers wait for the readers of a previous snapshot to finish while
+     * new readers are counted in the other half */
+    mutable std::array<std::array<ReaderCount, READER_SLOTS>, 2> _readers;
+    std::atomic<int>                                             _reader_epoch{0};
 };
 
 } // namespace engine
@@ -0,0 +1,139 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Lookup table from processor id to processor instance for the rt thread
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#include <algorithm>
+#include <cassert>
+
+#include "library/processor.h"
+
+#include "processor_table.h"
+
+namespace sushi {
+namespace engine {
+
+/* 2^32 divided by the golden ratio, spreads consecutive ids evenly over the table */
+constexpr uint32_t FIBONACCI_HASH_FACTOR = 2654435769u;
+constexpr int ID_BITS = 32;
+
+ProcessorTable::ProcessorTable(int capacity)
+{
+    int bits = 0;
+    while ((1 << bits) < std::max(capacity, MIN_CAPACITY))
+    {
+        bits++;
+    }
+    _entries.resize(1 << bits, {0, nullptr});
+    _shift = ID_BITS - bits;
+}
+
+int ProcessorTable::capacity_for(int processors)
+{
+    // Keep the table at most half full after it has been resized
+    int capacity = MIN_CAPACITY;
+    while (capacity < 2 * processors)
+    {
+        capacity *= 2;
+    }
+    return capacity;
+}
+
+Processor* ProcessorTable::processor(ObjectId id) const
+{
+    int slot = _find_slot(id);
+    return slot >= 0 ? _entries[slot].processor : nullptr;
+}
+
+bool ProcessorTable::insert(Processor* processor)
+{
+    assert(processor);
+    if (_size >= max_size() || _find_slot(processor->id()) >= 0)
+    {
+        return false;
+    }
+    int mask = capacity() - 1;
+    int slot = _home_slot(processor->id());
+    while (_entries[slot].processor != nullptr)
+    {
+        slot = (slot + 1) & mask;
+    }
+    _entries[slot] = {processor->id(), processor};
+    _size++;
+    return true;
+}
+
+bool ProcessorTable::remove(ObjectId id)
+{
+    int slot = _find_slot(id);
+    if (slot < 0)
+    {
+        return false;
+    }
+    /* Move following entries of the probe sequence back into the freed slot, unless
+     * that would put them before their home slot, so no tombstones are needed */
+    int mask = capacity() - 1;
+    int next = slot;
+    while (true)
+    {
+        next = (next + 1) & mask;
+        if (_entries[next].processor == nullptr)
+        {
+            break;
+        }
+        int home = _home_slot(_entries[next].id);
+        bool home_between = slot <= next ? (slot < home && home <= next) : (slot < home || home <= next);
+        if (home_between == false)
+        {
+            _entries[slot] = _entries[next];
+            slot = next;
+        }
+    }
+    _entries[slot] = {0, nullptr};
+    _size--;
+    return true;
+}
+
+void ProcessorTable::clear()
+{
+    std::fill(_entries.begin(), _entries.end(), Entry{0, nullptr});
+    _size = 0;
+}
+
+int ProcessorTable::_home_slot(ObjectId id) const
+{
+    return static_cast<int>((id * FIBONACCI_HASH_FACTOR) >> _shift);
+}
+
+int ProcessorTable::_find_slot(ObjectId id) const
+{
+    int mask = capacity() - 1;
+    int slot = _home_slot(id);
+    while (_entries[slot].processor != nullptr)
+    {
+        if (_entries[slot].id == id)
+        {
+            return slot;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return -1;
+}
+
+} // namespace engine
+} // namespace sushi
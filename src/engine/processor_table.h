@@ -0,0 +1,196 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Lookup table from processor id to processor instance for the rt thread
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_PROCESSOR_TABLE_H
+#define SUSHI_PROCESSOR_TABLE_H
+
+#include <vector>
+
+#include "library/id_generator.h"
+
+namespace sushi {
+
+class Processor;
+
+namespace engine {
+
+/**
+ * @brief Open addressing hash table of processors, keyed on processor id. Lookups,
+ *        insertions and removals never allocate memory and are safe to do from the rt
+ *        thread. The size is fixed at construction, so growing the table is done by
+ *        creating a larger one outside of the rt thread and swapping it in with assign()
+ *        and std::swap(), see StorageSwap.
+ */
+class ProcessorTable
+{
+    struct Entry
+    {
+        ObjectId   id;
+        Processor* processor;
+    };
+
+public:
+    static constexpr int MIN_CAPACITY = 64;
+
+    /**
+     * @brief Iterates over the processors in the table, in no particular order
+     */
+    class Iterator
+    {
+    public:
+        Iterator(const Entry* entry, const Entry* end) : _entry(entry), _end(end)
+        {
+            _skip_empty();
+        }
+
+        Processor* operator*() const {return _entry->processor;}
+
+        Iterator& operator++()
+        {
+            ++_entry;
+            _skip_empty();
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const {return _entry == other._entry;}
+        bool operator!=(const Iterator& other) const {return _entry != other._entry;}
+
+    private:
+        void _skip_empty()
+        {
+            while (_entry != _end && _entry->processor == nullptr)
+            {
+                ++_entry;
+            }
+        }
+
+        const Entry* _entry;
+        const Entry* _end;
+    };
+
+    /**
+     * @brief Create an empty table
+     * @param capacity The number of slots in the table, rounded up to the nearest
+     *                 power of 2, and at least MIN_CAPACITY.
+     */
+    explicit ProcessorTable(int capacity = MIN_CAPACITY);
+
+    /**
+     * @brief Return the capacity needed to hold a given number of processors while
+     *        leaving enough free slots for lookups to stay fast.
+     * @param processors The number of processors to hold
+     * @return A capacity to pass to the constructor
+     */
+    static int capacity_for(int processors);
+
+    /**
+     * @brief Look up a processor
+     * @param id The id of the processor
+     * @return A pointer to the processor, or nullptr if not in the table
+     */
+    Processor* processor(ObjectId id) const;
+
+    /**
+     * @brief Add a processor to the table
+     * @param processor The processor to add
+     * @return true if the processor was added, false if a processor with the same id is
+     *         already in the table or if the table is full, see max_size()
+     */
+    bool insert(Processor* processor);
+
+    /**
+     * @brief Remove a processor from the table
+     * @param id The id of the processor to remove
+     * @return true if the processor was removed, false if it was not in the table
+     */
+    bool remove(ObjectId id);
+
+    /**
+     * @brief Replace the contents of the table with a range of processors. Does not
+     *        allocate memory, processors that don't fit in the table are left out.
+     * @param first The first processor of the range
+     * @param last The end of the range
+     */
+    template <typename InputIt>
+    void assign(InputIt first, InputIt last)
+    {
+        clear();
+        for (auto i = first; i != last; ++i)
+        {
+            insert(*i);
+        }
+    }
+
+    /**
+     * @brief Remove all processors from the table
+     */
+    void clear();
+
+    /**
+     * @brief Return the number of processors in the table
+     * @return The number of processors
+     */
+    int size() const
+    {
+        return _size;
+    }
+
+    /**
+     * @brief Return the total number of slots in the table
+     * @return The capacity of the table
+     */
+    int capacity() const
+    {
+        return static_cast<int>(_entries.size());
+    }
+
+    /**
+     * @brief Return the number of processors the table will accept before insert() fails
+     * @return The maximum number of processors
+     */
+    int max_size() const
+    {
+        return capacity() - capacity() / 4;
+    }
+
+    Iterator begin() const
+    {
+        return Iterator(_entries.data(), _entries.data() + _entries.size());
+    }
+
+    Iterator end() const
+    {
+        return Iterator(_entries.data() + _entries.size(), _entries.data() + _entries.size());
+    }
+
+private:
+    int _home_slot(ObjectId id) const;
+
+    int _find_slot(ObjectId id) const;
+
+    std::vector<Entry> _entries;
+    int                _size{0};
+    int                _shift;
+};
+
+} // namespace engine
+} // namespace sushi
+
+#endif //SUSHI_PROCESSOR_TABLE_H
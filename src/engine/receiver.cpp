@@ -18,7 +18,7 @@
  * @copyright 2017-2019 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
  */
 
-#include <thread>
+#include <algorithm>
 
 #include "logging.h"
 #include "engine/receiver.h"
@@ -28,43 +28,121 @@ SUSHI_GET_LOGGER_WITH_MODULE_NAME("event_receiver");
 namespace sushi {
 namespace receiver {
 
-constexpr int MAX_RETRIES = 100;
+/* Only used if an rt condition variable can't be created, in which case waiting threads
+ * pick up responses themselves */
+constexpr auto POLL_PERIOD = std::chrono::milliseconds(2);
 
-bool AsynchronousEventReceiver::wait_for_response(EventId id, std::chrono::milliseconds timeout)
+/* An event that hasn't been returned this long after its waiter gave up most likely never
+ * will be, so there is no need to remember it any longer */
+constexpr auto TIMED_OUT_MAX_AGE = std::chrono::seconds(10);
+
+AsynchronousEventReceiver::AsynchronousEventReceiver(RtSafeRtEventFifo* queue) : _queue{queue}
+{
+    try
+    {
+        _rt_notifier = twine::RtConditionVariable::create_rt_condition_variable();
+    }
+    catch (const std::exception& e)
+    {
+        SUSHI_LOG_ERROR("Failed to instantiate RtConditionVariable ({}), falling back to polling", e.what());
+        return;
+    }
+    _running = true;
+    _worker = std::thread(&AsynchronousEventReceiver::_receive_worker, this);
+}
+
+AsynchronousEventReceiver::~AsynchronousEventReceiver()
 {
-    int retries = 0;
-    while (retries < MAX_RETRIES)
+    if (_worker.joinable())
     {
-        RtEvent event;
-        while (_queue->pop(event))
+        _running = false;
+        _rt_notifier->notify();
+        _worker.join();
+    }
+}
+
+ResponseStatus AsynchronousEventReceiver::wait_for_response_status(EventId id, std::chrono::milliseconds timeout)
+{
+    auto deadline = std::chrono::steady_clock::now() + timeout;
+    std::unique_lock<std::mutex> lock(_response_lock);
+    while (true)
+    {
+        /* Responses already in the queue are picked up directly, without waiting for
+         * the worker thread */
+        _receive_responses();
+        auto response = _responses.find(id);
+        if (response != _responses.end())
         {
-            if (is_returnable_event(event))
-            {
-                auto typed_event = event.returnable_event();
-                if (typed_event->event_id() == id)
-                {
-                    auto handled_ok = typed_event->status() == ReturnableRtEvent::EventStatus::HANDLED_OK;
-                    SUSHI_LOG_ERROR_IF(handled_ok == false, "RtEvent with id {} returned with error", id);
-                    return handled_ok;
-                }
-                bool status = (typed_event->status() == ReturnableRtEvent::EventStatus::HANDLED_OK);
-                _receive_list.push_back(Node{typed_event->event_id(), status});
-            }
+            bool handled_ok = response->second;
+            _responses.erase(response);
+            SUSHI_LOG_ERROR_IF(handled_ok == false, "RtEvent with id {} returned with error", id);
+            return handled_ok ? ResponseStatus::HANDLED_OK : ResponseStatus::HANDLED_ERROR;
         }
-        for (auto i = _receive_list.begin(); i != _receive_list.end(); ++i)
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= deadline)
         {
-            if (i->id == id)
+            break;
+        }
+        _response_received.wait_until(lock, _worker.joinable() ? deadline : std::min(deadline, now + POLL_PERIOD));
+    }
+    SUSHI_LOG_WARNING("Waiting for RtEvent with id {} timed out", id);
+    // Nobody will pick up the response if it arrives later
+    auto now = std::chrono::steady_clock::now();
+    _prune_timed_out(now);
+    _timed_out[id] = now;
+    return ResponseStatus::TIMED_OUT;
+}
+
+void AsynchronousEventReceiver::notify()
+{
+    if (_rt_notifier)
+    {
+        _rt_notifier->notify();
+    }
+}
+
+void AsynchronousEventReceiver::_receive_worker()
+{
+    while (_running)
+    {
+        _rt_notifier->wait();
+        std::scoped_lock<std::mutex> lock(_response_lock);
+        _receive_responses();
+        _response_received.notify_all();
+    }
+}
+
+void AsynchronousEventReceiver::_receive_responses()
+{
+    RtEvent event;
+    while (_queue->pop(event))
+    {
+        if (is_returnable_event(event))
+        {
+            auto typed_event = event.returnable_event();
+            if (_timed_out.erase(typed_event->event_id()) == 0)
             {
-                bool status = i->status;
-                _receive_list.erase(i);
-                return status;
+                _responses[typed_event->event_id()] = typed_event->status() == ReturnableRtEvent::EventStatus::HANDLED_OK;
             }
         }
-        std::this_thread::sleep_for(timeout / MAX_RETRIES);
-        retries++;
     }
-    SUSHI_LOG_WARNING("Waiting for RtEvent with id {} timed out", id);
-    return false;
 }
+
+void AsynchronousEventReceiver::_prune_timed_out(std::chrono::steady_clock::time_point now)
+{
+    for (auto i = _timed_out.begin(); i != _timed_out.end();)
+    {
+        if (now - i->second > TIMED_OUT_MAX_AGE)
+        {
+            i = _timed_out.erase(i);
+        }
+        else
+        {
+            ++i;
+        }
+    }
+}
+
 } // end namespace receiver
 } // end namespace sushi
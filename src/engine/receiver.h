@@ -21,8 +21,15 @@
 #ifndef SUSHI_ASYNCHRONOUS_RECEIVER_H
 #define SUSHI_ASYNCHRONOUS_RECEIVER_H
 
-#include <vector>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+
+#include "twine/twine.h"
 
 #include "library/id_generator.h"
 #include "library/rt_event_fifo.h"
@@ -30,29 +37,78 @@
 namespace sushi {
 namespace receiver {
 
+/* The outcome of waiting for a response. After a timeout the rt thread may still handle
+ * the event at a later point, so whatever the event points to must be kept alive */
+enum class ResponseStatus
+{
+    HANDLED_OK,
+    HANDLED_ERROR,
+    TIMED_OUT
+};
+
+/**
+ * @brief Collects the responses to returnable events sent to the rt thread. Responses are
+ *        picked up by a dedicated thread as soon as the rt thread signals that it has
+ *        returned events, and waiting threads are woken up when their response arrives.
+ */
 class AsynchronousEventReceiver
 {
 public:
-    explicit AsynchronousEventReceiver(RtSafeRtEventFifo* queue) : _queue{queue} {}
+    explicit AsynchronousEventReceiver(RtSafeRtEventFifo* queue);
+
+    ~AsynchronousEventReceiver();
 
     /**
-     * @brief Blocks the current thread while waiting for a response to a given event
+     * @brief Blocks the current thread while waiting for a response to a given event.
+     *        Safe to call from several threads concurrently.
      * @param id EventId of the event the thread is waiting for
      * @param timeout Maximum wait time
      * @return true if the event was received in time and handled properly, false otherwise
      */
-    bool wait_for_response(EventId id, std::chrono::milliseconds timeout);
+    bool wait_for_response(EventId id, std::chrono::milliseconds timeout)
+    {
+        return wait_for_response_status(id, timeout) == ResponseStatus::HANDLED_OK;
+    }
+
+    /**
+     * @brief Same as wait_for_response(), but tells an event that wasn't handled properly
+     *        apart from one that wasn't handled in time. A response that arrives after
+     *        the wait has timed out is dropped.
+     * @param id EventId of the event the thread is waiting for
+     * @param timeout Maximum wait time
+     * @return The status of the response
+     */
+    ResponseStatus wait_for_response_status(EventId id, std::chrono::milliseconds timeout);
+
+    /**
+     * @brief Signal that events have been returned to the queue. Called from the rt thread
+     *        after handling a batch of returnable events.
+     */
+    void notify();
 
 private:
-    struct Node
-    {
-        EventId id;
-        bool    status;
-    };
-    std::vector<Node> _receive_list;
+    void _receive_worker();
+
+    /* Must be called with _response_lock held */
+    void _receive_responses();
+
+    /* Must be called with _response_lock held */
+    void _prune_timed_out(std::chrono::steady_clock::time_point now);
+
     RtSafeRtEventFifo* _queue;
-};
 
+    std::mutex _response_lock;
+    std::condition_variable _response_received;
+    /* Responses not yet picked up by a waiting thread, indexed by event id */
+    std::unordered_map<EventId, bool> _responses;
+    /* Events whose waiter has timed out, with the time it did so. Their responses are
+     * dropped when they arrive, entries older than TIMED_OUT_MAX_AGE are pruned */
+    std::unordered_map<EventId, std::chrono::steady_clock::time_point> _timed_out;
+
+    std::unique_ptr<twine::RtConditionVariable> _rt_notifier;
+    std::atomic_bool _running{false};
+    std::thread _worker;
+};
 
 } // end namespace receiver
 } // end namespace sushi
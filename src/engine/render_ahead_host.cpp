@@ -0,0 +1,238 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Renders the processor chain of a track that takes no live input several chunks
+ *        ahead in a low priority thread, outside of the rt deadline.
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+#include "render_ahead_host.h"
+
+namespace sushi {
+namespace engine {
+
+RenderAheadHost::RenderAheadHost(std::vector<Processor*> processors,
+                                 int channels,
+                                 int chunks,
+                                 Transport* transport,
+                                 float sample_rate,
+                                 performance::PerformanceTimer* timer) : _processors(std::move(processors)),
+                                                                         _engine_transport(transport),
+                                                                         // Never advanced with set_time(), so it sends no events
+                                                                         _transport(sample_rate, nullptr),
+                                                                         _timer(timer),
+                                                                         _chunks(chunks, ChunkSampleBuffer(channels)),
+                                                                         _input_buffer(MAX_TRACK_CHANNELS),
+                                                                         _work_buffer(MAX_TRACK_CHANNELS)
+{
+    assert(chunks > 0);
+    for (auto processor : _processors)
+    {
+        processor->set_transport(&_transport);
+    }
+    _notifier = twine::RtConditionVariable::create_rt_condition_variable();
+    _worker_thread = std::thread(&RenderAheadHost::_worker, this);
+}
+
+RenderAheadHost::~RenderAheadHost()
+{
+    stop();
+}
+
+void RenderAheadHost::stop()
+{
+    if (_worker_thread.joinable() == false)
+    {
+        return;
+    }
+    _running = false;
+    _notifier->notify();
+    _worker_thread.join();
+    for (auto processor : _processors)
+    {
+        processor->set_transport(_engine_transport);
+    }
+}
+
+bool RenderAheadHost::pop(ChunkSampleBuffer& out)
+{
+    auto read = _read.load(std::memory_order_relaxed);
+    bool available = read < _written.load(std::memory_order_acquire);
+    if (available)
+    {
+        const auto& chunk = _chunks[read % _chunks.size()];
+        assert(out.channel_count() == chunk.channel_count());
+        out.replace(chunk);
+        _read.store(read + 1, std::memory_order_release);
+    }
+    else
+    {
+        out.clear();
+        // Nothing is rendered before the worker has its first transport snapshot
+        if (_started)
+        {
+            _underruns.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    _started |= available;
+
+    auto& slot = _transport_slots[_rt_slot];
+    slot.transport = _engine_transport->snapshot();
+    slot.read = _read.load(std::memory_order_relaxed);
+    _rt_slot = _published_slot.exchange(_rt_slot | NEW_TRANSPORT, std::memory_order_acq_rel) & ~NEW_TRANSPORT;
+    _notifier->notify();
+    return available;
+}
+
+bool RenderAheadHost::queue_event(const RtEvent& event)
+{
+    return _input_events.push(event);
+}
+
+void RenderAheadHost::forward_events(RtEventPipe* pipe)
+{
+    RtEvent event;
+    while (_output_events.pop(event))
+    {
+        pipe->send_event(event);
+    }
+}
+
+void RenderAheadHost::send_event(const RtEvent& event)
+{
+    _event_buffer.push(event);
+}
+
+bool RenderAheadHost::_take_transport()
+{
+    if ((_published_slot.load(std::memory_order_relaxed) & NEW_TRANSPORT) == 0)
+    {
+        return false;
+    }
+    _worker_slot = _published_slot.exchange(_worker_slot, std::memory_order_acq_rel) & ~NEW_TRANSPORT;
+    return true;
+}
+
+void RenderAheadHost::_worker()
+{
+    int64_t size = static_cast<int64_t>(_chunks.size());
+    bool has_transport = false;
+    while (_running)
+    {
+        while (_running && _written.load(std::memory_order_relaxed) - _read.load(std::memory_order_acquire) < size)
+        {
+            has_transport |= _take_transport();
+            if (has_transport == false)
+            {
+                break;
+            }
+            /* Events are passed on between chunks, so they take effect in the chunk rendered
+             * next, which is heard up to the number of chunks rendered ahead later */
+            RtEvent event;
+            while (_input_events.pop(event))
+            {
+                auto processor = std::find_if(_processors.begin(), _processors.end(), [&](auto p)
+                {
+                    return p->id() == event.processor_id();
+                });
+                if (processor != _processors.end())
+                {
+                    (*processor)->process_event(event);
+                }
+                else if (is_keyboard_event(event) && _processors.empty() == false)
+                {
+                    // Keyboard events sent to the track go to its first processor
+                    _processors.front()->process_event(event);
+                }
+            }
+            /* Chunks are popped one per rt cycle, starting in the one after the snapshot was
+             * taken, so this chunk is played one cycle after all chunks before it that were
+             * still waiting then */
+            const auto& slot = _transport_slots[_worker_slot];
+            auto written = _written.load(std::memory_order_relaxed);
+            auto ahead = written - slot.read + 1;
+            _transport.set_ahead_of(slot.transport, ahead * AUDIO_CHUNK_SIZE);
+            _render_chunk(_chunks[written % size]);
+            _written.store(written + 1, std::memory_order_release);
+        }
+        _notifier->wait();
+    }
+}
+
+void RenderAheadHost::_render_chunk(ChunkSampleBuffer& out)
+{
+    /* The input is silent and only read by the first processor, after that the input and
+     * work buffers are swapped between processors, like in a track */
+    std::array<ChunkSampleBuffer*, 2> buffers = {&_input_buffer, &_work_buffer};
+    int source = 0;
+    int output_channels = 0;
+    if (_processors.empty() == false)
+    {
+        auto input = ChunkSampleBuffer::create_non_owning_buffer(_input_buffer, 0, _processors.front()->input_channels());
+        input.clear();
+    }
+    for (size_t i = 0; i < _processors.size(); ++i)
+    {
+        auto processor = _processors[i];
+        auto timestamp = _timer->start_timer();
+        auto proc_in = ChunkSampleBuffer::create_non_owning_buffer(*buffers[source], 0, processor->input_channels());
+        auto proc_out = ChunkSampleBuffer::create_non_owning_buffer(*buffers[1 - source], 0, processor->output_channels());
+        processor->process_audio(proc_in, proc_out);
+        source = 1 - source;
+        output_channels = processor->output_channels();
+        _pass_on_events(i + 1 < _processors.size() ? _processors[i + 1] : nullptr);
+        _timer->stop_timer_rt_safe(timestamp, static_cast<int>(processor->id()));
+    }
+
+    for (int c = 0; c < out.channel_count(); ++c)
+    {
+        if (c < output_channels)
+        {
+            out.replace(c, c, *buffers[source]);
+        }
+        else
+        {
+            auto unused = ChunkSampleBuffer::create_non_owning_buffer(out, c, 1);
+            unused.clear();
+        }
+    }
+}
+
+void RenderAheadHost::_pass_on_events(Processor* next)
+{
+    /* Keyboard events are passed on to the next processor, like a track does, the next
+     * processor may put events back into the queue, hence only the events already in it
+     * are handled */
+    for (int events = _event_buffer.size(); events > 0; --events)
+    {
+        RtEvent event = _event_buffer.pop();
+        if (next && is_keyboard_event(event))
+        {
+            next->process_event(event);
+        }
+        else
+        {
+            _output_events.push(event);
+        }
+    }
+}
+
+} // namespace engine
+} // namespace sushi
@@ -0,0 +1,196 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Renders the processor chain of a track that takes no live input several chunks
+ *        ahead in a low priority thread, outside of the rt deadline.
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_RENDER_AHEAD_HOST_H
+#define SUSHI_RENDER_AHEAD_HOST_H
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "twine/twine.h"
+
+#include "library/processor.h"
+#include "library/rt_event_fifo.h"
+#include "library/rt_event_pipe.h"
+#include "library/sample_buffer.h"
+#include "library/performance_timer.h"
+#include "engine/transport.h"
+
+namespace sushi {
+namespace engine {
+
+class RenderAheadHost : public RtEventPipe
+{
+public:
+    SUSHI_DECLARE_NON_COPYABLE(RenderAheadHost);
+
+    /**
+     * @brief Create a host for the processors of a track and start a non-rt worker thread
+     *        to render them with silent input. Each chunk is rendered against a copy of the
+     *        transport moved ahead to the time the chunk is played, so the output is in time
+     *        with the rest of the engine. The worker never reads the engine transport, the rt
+     *        thread hands it a snapshot in pop(), so rendering starts with the first call to
+     *        pop(). The processors read their transport from the host until it is destroyed.
+     *        Must not be called from the rt thread, and the processors must not be processed
+     *        or passed events by anyone else while the host exists.
+     * @param processors The processors of the track, in processing order, not owned by the host
+     * @param channels The number of output channels of the track
+     * @param chunks The number of chunks to render ahead, must be at least 1
+     * @param transport The transport of the engine, read by pop() in the rt thread and
+     *                  returned to the processors when the host is destroyed
+     * @param sample_rate The sample rate of the engine
+     * @param timer A timer object used to record the processing time of the processors
+     */
+    RenderAheadHost(std::vector<Processor*> processors,
+                    int channels,
+                    int chunks,
+                    Transport* transport,
+                    float sample_rate,
+                    performance::PerformanceTimer* timer);
+
+    ~RenderAheadHost();
+
+    /**
+     * @brief Stop rendering and return the processors to the transport of the engine. The
+     *        host can still be called from the rt thread, but renders nothing more. Must not
+     *        be called from the rt thread. Called by the destructor if not called before.
+     */
+    void stop();
+
+    /**
+     * @brief Return the processors being hosted, in processing order
+     * @return A list of processors
+     */
+    const std::vector<Processor*>& processors() const
+    {
+        return _processors;
+    }
+
+    /**
+     * @brief Take the oldest rendered chunk, hand the worker a snapshot of the engine
+     *        transport and wake it up to render a new chunk. Called from the rt thread once
+     *        every chunk, after the engine transport is updated.
+     * @param out Filled with the rendered chunk, or silence if the worker has fallen behind
+     * @return true if a rendered chunk was available, false otherwise
+     */
+    bool pop(ChunkSampleBuffer& out);
+
+    /**
+     * @brief Return the number of chunks that weren't rendered in time. Safe to call from
+     *        any thread.
+     * @return The number of chunks replaced by silence since the first chunk was rendered
+     */
+    int underruns() const
+    {
+        return _underruns.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Whether a processor is one of the processors of the host
+     * @param processor The id of the processor
+     * @return true if the processor is hosted
+     */
+    bool hosts(ObjectId processor) const
+    {
+        return std::any_of(_processors.begin(), _processors.end(), [&](auto p) {return p->id() == processor;});
+    }
+
+    /**
+     * @brief Queue an event for one of the processors, or a keyboard event to the track, which
+     *        goes to the first processor. The worker passes it on before it renders the next
+     *        chunk. Called from the rt thread.
+     * @param event The event
+     * @return true if the event was queued, false if the queue is full
+     */
+    bool queue_event(const RtEvent& event);
+
+    /**
+     * @brief Pass on the events output by the processors. Called from the rt thread.
+     * @param pipe The event pipe to pass events to
+     */
+    void forward_events(RtEventPipe* pipe);
+
+    /* Inherited from RtEventPipe, only called by the processors from the worker thread */
+    void send_event(const RtEvent& event) override;
+
+private:
+    /* The engine transport as it was when a number of chunks had been read */
+    struct TransportSlot
+    {
+        TransportSnapshot transport;
+        int64_t           read{0};
+    };
+
+    /* Set in _published_slot when the rt thread has published a slot the worker hasn't taken */
+    static constexpr int NEW_TRANSPORT = 4;
+
+    void _worker();
+
+    bool _take_transport();
+
+    void _render_chunk(ChunkSampleBuffer& out);
+
+    void _pass_on_events(Processor* next);
+
+    std::vector<Processor*>        _processors;
+    Transport*                     _engine_transport;
+    /* Read by the processors, only accessed by the worker */
+    Transport                      _transport;
+
+    /* Snapshots of the engine transport, handed from the rt thread to the worker as a
+     * triple buffer, each side owns one slot and they swap through _published_slot */
+    std::array<TransportSlot, 3>   _transport_slots;
+    std::atomic<int>               _published_slot{0};
+    int                            _rt_slot{1};
+    int                            _worker_slot{2};
+    bool                           _started{false};
+    performance::PerformanceTimer* _timer;
+
+    /* Rendered chunks as a single producer, single consumer ring, indexed by the number
+     * of chunks written and read modulo its size */
+    std::vector<ChunkSampleBuffer> _chunks;
+    std::atomic<int64_t>           _written{0};
+    std::atomic<int64_t>           _read{0};
+    std::atomic<int>               _underruns{0};
+
+    ChunkSampleBuffer _input_buffer;
+    ChunkSampleBuffer _work_buffer;
+
+    /* Events to the processors, from the rt thread to the worker */
+    RtSafeRtEventFifo _input_events;
+    /* Events output by the processors, from the worker to the rt thread */
+    RtSafeRtEventFifo _output_events;
+    /* Events output by the processor being rendered, only used by the worker */
+    RtEventFifo<>     _event_buffer;
+
+    std::unique_ptr<twine::RtConditionVariable> _notifier;
+    std::atomic_bool                            _running{true};
+    std::thread                                 _worker_thread;
+};
+
+} // namespace engine
+} // namespace sushi
+
+#endif //SUSHI_RENDER_AHEAD_HOST_H
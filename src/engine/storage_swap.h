@@ -0,0 +1,116 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Replacement of containers used from the rt thread with larger ones, allocated
+ *        outside of the rt thread
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_STORAGE_SWAP_H
+#define SUSHI_STORAGE_SWAP_H
+
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace sushi {
+namespace engine {
+
+/**
+ * @brief A set of containers to replace with larger ones in one go. The replacements are
+ *        allocated when added, from a non-rt thread. swap_rt() is then called from the rt
+ *        thread, or with the rt thread stopped, and copies the contents of the containers
+ *        into the replacements and swaps them in, without allocating memory. The previous
+ *        storage ends up in the StorageSwap instance and is freed with it, which must then
+ *        be done from a non-rt thread once swap_rt() has returned.
+ */
+class StorageSwap
+{
+public:
+    /**
+     * @brief Add a container to replace. Not safe to call from the rt thread.
+     * @param target The container to replace, must outlive the call to swap_rt()
+     * @param replacement An empty container with room for the contents of target. Its
+     *                    assign() must not allocate memory when the contents fit.
+     */
+    template <typename Container>
+    void add(Container* target, Container replacement)
+    {
+        auto storage = std::make_shared<Container>(std::move(replacement));
+        _swaps.push_back([target, storage]()
+        {
+            storage->assign(target->begin(), target->end());
+            std::swap(*target, *storage);
+        });
+    }
+
+    /**
+     * @brief Add a vector to replace with one of at least the given capacity
+     * @param target The vector to replace, must outlive the call to swap_rt()
+     * @param capacity The capacity of the new vector
+     */
+    template <typename T>
+    void add_vector(std::vector<T>* target, size_t capacity)
+    {
+        std::vector<T> replacement;
+        replacement.reserve(capacity);
+        add(target, std::move(replacement));
+    }
+
+    /**
+     * @brief Add a function to call from the rt thread after all containers have been
+     *        replaced, i.e. to update references into the replaced containers.
+     * @param callback The function to call, must not allocate memory
+     */
+    void on_swap(std::function<void()> callback)
+    {
+        _callbacks.push_back(std::move(callback));
+    }
+
+    /**
+     * @brief Return whether there is anything to replace or call
+     * @return true if no containers or functions have been added
+     */
+    bool empty() const
+    {
+        return _swaps.empty() && _callbacks.empty();
+    }
+
+    /**
+     * @brief Replace the containers. Called once, from the rt thread.
+     */
+    void swap_rt()
+    {
+        for (auto& swap : _swaps)
+        {
+            swap();
+        }
+        for (auto& callback : _callbacks)
+        {
+            callback();
+        }
+    }
+
+private:
+    std::vector<std::function<void()>> _swaps;
+    std::vector<std::function<void()>> _callbacks;
+};
+
+} // namespace engine
+} // namespace sushi
+
+#endif //SUSHI_STORAGE_SWAP_H
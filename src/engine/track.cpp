@@ -19,6 +19,8 @@
  */
 
 #include <cassert>
+#include <cmath>
+#include <algorithm>
 
 #include "track.h"
 #include "library/constants.h"
@@ -26,7 +28,8 @@
 namespace sushi {
 namespace engine {
 
-constexpr int TRACK_MAX_PROCESSORS = 32;
+constexpr int TRACK_INITIAL_PROCESSORS = 32;
+constexpr int NO_BUS = -1;
 constexpr float PAN_GAIN_3_DB = 1.412537f;
 constexpr float DEFAULT_TRACK_GAIN = 1.0f;
 
@@ -47,6 +50,18 @@ inline std::pair<float, float> calc_l_r_gain(float gain, float pan)
     return {left_gain, right_gain};
 }
 
+/* Set the target gain of a smoother and return the gain to ramp over this chunk */
+inline std::pair<float, float> gain_ramp(ValueSmootherFilter<float>& smoother, float gain)
+{
+    smoother.set(gain);
+    if (smoother.stationary())
+    {
+        return {gain, gain};
+    }
+    float start = smoother.value();
+    return {start, smoother.next_value()};
+}
+
 Track::Track(HostControl host_control,
              int channels,
              performance::PerformanceTimer* timer,
@@ -73,6 +88,7 @@ Track::Track(HostControl host_control, int buses, performance::PerformanceTimer*
                                                                                           _timer{timer}
 {
     int channels = buses * 2;
+    _bus_event_pipes = std::vector<BusEventPipe>(buses);
     _max_input_channels = channels;
     _max_output_channels = channels;
     _current_input_channels = channels;
@@ -97,7 +113,7 @@ void Track::configure(float sample_rate)
 
 bool Track::add(Processor* processor, std::optional<ObjectId> before_position)
 {
-    if (_processors.size() >= TRACK_MAX_PROCESSORS || processor == this)
+    if (_processors.size() >= _processors.capacity() || processor == this)
     {
         // If a track adds itself to its process chain, endless loops can arise
         // In addition, _processors must not allocate if running in the rt-thread
@@ -108,6 +124,16 @@ bool Track::add(Processor* processor, std::optional<ObjectId> before_position)
     bool added = false;
     if (before_position.has_value())
     {
+        // Inserting in the middle of an asynchronous stage splits it, so the stage is returned to normal processing
+        auto host = std::find_if(_async_hosts.begin(), _async_hosts.end(), [&](const auto& h)
+        {
+            return h->processor()->id() != *before_position &&
+                   std::any_of(h->processors().begin(), h->processors().end(), [&](const auto& p) {return p->id() == *before_position;});
+        });
+        if (host != _async_hosts.end())
+        {
+            _remove_async_host(*before_position);
+        }
         for (auto i = _processors.cbegin(); i != _processors.cend(); ++i)
         {
             if ((*i)->id() == *before_position) // * accesses value without throwing
@@ -126,14 +152,29 @@ bool Track::add(Processor* processor, std::optional<ObjectId> before_position)
 
     if (added)
     {
-        processor->set_event_output(this);
+        auto bus = processor_bus(processor->id());
+        processor->set_event_output(bus.has_value() ? static_cast<RtEventPipe*>(&_bus_event_pipes[*bus]) : this);
         processor->set_active_rt_processing(true);
+        _update_plan();
+        notify_routing_changed();
     }
     return added;
 }
 
+void Track::grow(StorageSwap& swap, int processors)
+{
+    if (processors > processor_capacity())
+    {
+        swap.add_vector(&_processors, processors);
+        swap.add_vector(&_async_hosts, processors);
+        swap.add_vector(&_processor_buses, processors);
+        swap.add_vector(&_plan, processors);
+    }
+}
+
 bool Track::remove(ObjectId processor)
 {
+    _remove_async_host(processor);
     for (auto i = _processors.begin(); i != _processors.end(); ++i)
     {
         if ((*i)->id() == processor)
@@ -141,57 +182,362 @@ bool Track::remove(ObjectId processor)
             (*i)->set_event_output(nullptr);
             (*i)->set_active_rt_processing(false);
             _processors.erase(i);
+            set_processor_bus(processor, std::nullopt);
+            notify_routing_changed();
             return true;
         }
     }
     return false;
 }
 
-void Track::render()
+bool Track::set_async_host(ObjectId processor, AsyncProcessorHost* host)
 {
-    process_audio(_input_buffer, _output_buffer);
-    _input_buffer.clear();
+    auto instance = std::find_if(_processors.begin(), _processors.end(), [&](const auto& p)
+    {
+        return p->id() == processor;
+    });
+    if (instance == _processors.end())
+    {
+        return false;
+    }
+
+    _remove_async_host(processor);
+    if (host)
+    {
+        assert(host->processor() == *instance);
+        int position = static_cast<int>(std::distance(_processors.begin(), instance));
+        if (_fits_on_track(host, position) == false)
+        {
+            return false;
+        }
+        _add_async_host(host);
+    }
+    return true;
 }
 
-void Track::process_audio(const ChunkSampleBuffer& in, ChunkSampleBuffer& out)
+bool Track::set_pipeline(const std::vector<AsyncProcessorHost*>& stages)
 {
-    /* For Tracks, process function is called from render() and the input audio data
-     * should be copied to _input_buffer prior to this call. */
+    int position = 0;
+    for (auto stage : stages)
+    {
+        const auto& processors = stage->next_processors();
+        if (position + static_cast<int>(processors.size()) > static_cast<int>(_processors.size()) ||
+            std::equal(processors.begin(), processors.end(), _processors.begin() + position) == false)
+        {
+            return false;
+        }
+        if (std::any_of(processors.begin(), processors.end(), [&](const auto& p) {return processor_bus(p->id()).has_value();}))
+        {
+            return false;
+        }
+        position += static_cast<int>(processors.size());
+    }
+    if (stages.empty() == false && position != static_cast<int>(_processors.size()))
+    {
+        return false;
+    }
 
-    auto track_timestamp = _timer->start_timer();
+    while (_async_hosts.empty() == false)
+    {
+        _remove_async_host(_async_hosts.back()->processor()->id());
+    }
+    for (auto stage : stages)
+    {
+        // Hosts reused from the previous stages are idle now that they are removed
+        stage->apply_next_processors();
+        _add_async_host(stage);
+    }
+    return true;
+}
 
-    /* Process all the plugins in the chain, to guarantee that memory declared const is never
-     * written to, the const cast below is only done if in already points to _input_buffer
-     * (which is the case if process_audio() is called from render()), or if there is max 1
-     * plugin in the chain, in which case there will be no ping-pong copying between buffers. */
-    if (in.channel(0) == _input_buffer.channel(0) || _processors.size() <= 1)
+bool Track::set_processor_bus(ObjectId processor, std::optional<int> bus)
+{
+    if (bus.has_value() && (*bus < 0 || *bus >= static_cast<int>(_bus_event_pipes.size())))
     {
-        _process_plugins(const_cast<ChunkSampleBuffer&>(in), out);
+        return false;
     }
-    else
+    bool async = std::any_of(_async_hosts.begin(), _async_hosts.end(), [&](const auto& host)
     {
-        _input_buffer.replace(in);
-        _process_plugins(_input_buffer, out);
+        const auto& stage = host->processors();
+        return std::any_of(stage.begin(), stage.end(), [&](const auto& p) {return p->id() == processor;});
+    });
+    if (async)
+    {
+        return false;
     }
 
-    /* If there are keyboard events not consumed, pass them on upwards so the engine can process them */
+    auto assignment = std::find_if(_processor_buses.begin(), _processor_buses.end(), [&](const auto& a)
+    {
+        return a.first == processor;
+    });
+    if (bus.has_value())
+    {
+        if (assignment != _processor_buses.end())
+        {
+            assignment->second = *bus;
+        }
+        else if (_processor_buses.size() < _processor_buses.capacity())
+        {
+            _processor_buses.emplace_back(processor, *bus);
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else if (assignment != _processor_buses.end())
+    {
+        _processor_buses.erase(assignment);
+    }
+
+    auto instance = std::find_if(_processors.begin(), _processors.end(), [&](const auto& p)
+    {
+        return p->id() == processor;
+    });
+    if (instance != _processors.end())
+    {
+        (*instance)->set_event_output(bus.has_value() ? static_cast<RtEventPipe*>(&_bus_event_pipes[*bus]) : this);
+    }
+    _update_plan();
+    return true;
+}
+
+std::optional<int> Track::processor_bus(ObjectId processor) const
+{
+    for (const auto& [id, bus] : _processor_buses)
+    {
+        if (id == processor)
+        {
+            return bus;
+        }
+    }
+    return std::nullopt;
+}
+
+void Track::begin_bus_render()
+{
+    _prepare_external_input();
+    _bus_render_start = _timer->start_timer();
+    while (_kb_event_buffer.empty() == false)
+    {
+        const RtEvent& event = _kb_event_buffer.pop();
+        for (auto& pipe : _bus_event_pipes)
+        {
+            pipe.kb_events.push(event);
+        }
+    }
+}
+
+void Track::render_bus(int bus)
+{
+    assert(_independent_buses);
+    auto& events = _bus_event_pipes[bus];
+    std::array<ChunkSampleBuffer, 2> buffers = {input_bus(bus), output_bus(bus)};
+    /* Only the first processor reads the input, input_bus() is used as work buffer after that */
+    auto input = _external_input.channel_count() > 0 ? ChunkSampleBuffer::create_non_owning_buffer(_external_input, bus * 2, 2) :
+                                                       input_bus(bus);
+    bool first_step = true;
+    bool silent_input = false;
+
+    for (const auto& step : _plan)
+    {
+        if (step.bus != bus)
+        {
+            continue;
+        }
+        auto processor = step.processor;
+        auto processor_timestamp = _timer->start_timer();
+        _current_processor.store(processor, std::memory_order_relaxed);
+        int kb_events = events.kb_events.size();
+        bool keyboard_events = kb_events > 0;
+        for (; kb_events > 0; --kb_events)
+        {
+            processor->process_event(events.kb_events.pop());
+        }
+
+        auto& source = first_step ? input : buffers[step.bus_source];
+        auto& destination = buffers[1 - step.bus_source];
+        first_step = false;
+        ChunkSampleBuffer proc_in = ChunkSampleBuffer::create_non_owning_buffer(source, 0, step.input_channels);
+        ChunkSampleBuffer proc_out = ChunkSampleBuffer::create_non_owning_buffer(destination, 0, step.output_channels);
+        silent_input = _is_idle(processor, proc_in, silent_input, keyboard_events);
+        if (silent_input)
+        {
+            proc_out.clear();
+        }
+        else
+        {
+            processor->process_audio(proc_in, proc_out);
+        }
+        if (step.output_channels < 2)
+        {
+            auto unused = ChunkSampleBuffer::create_non_owning_buffer(destination, step.output_channels, 2 - step.output_channels);
+            unused.clear();
+        }
+        if (silent_input == false)
+        {
+            // Skipped chunks are not timed, the timings are the cost of processing audio
+            _timer->stop_timer_rt_safe(processor_timestamp, static_cast<int>(processor->id()));
+        }
+    }
+    _current_processor.store(nullptr, std::memory_order_relaxed);
+
+    if (_bus_output_sources[bus] == 0)
+    {
+        buffers[1].replace(first_step ? input : buffers[0]);
+    }
+}
+
+void Track::end_bus_render()
+{
+    for (auto& pipe : _bus_event_pipes)
+    {
+        while (pipe.kb_events.empty() == false)
+        {
+            _kb_event_buffer.push(pipe.kb_events.pop());
+        }
+        while (pipe.output_events.empty() == false)
+        {
+            output_event(pipe.output_events.pop());
+        }
+    }
     _process_output_events();
+    _apply_compensation_delay(_output_buffer);
+    _update_output_gains(_mute_parameter->processed_value());
+    if (_deferred_gain == false)
+    {
+        _apply_output_gains(_output_buffer);
+    }
+    _input_buffer.clear();
+    _external_input = ChunkSampleBuffer();
+    _timer->stop_timer_rt_safe(_bus_render_start, this->id());
+}
 
-    bool muted = _mute_parameter->processed_value();
+void Track::wait_for_async_processing()
+{
+    for (auto host : _async_hosts)
+    {
+        host->wait_for_processing();
+    }
+}
 
-    switch (_pan_mode)
+void Track::render()
+{
+    if (_shed && _shed_gain == 0.0f)
     {
-        case PanMode::GAIN_ONLY:
-            _apply_gain(out, muted);
-            break;
+        _render_shed();
+        return;
+    }
+    if (_frozen_audio.empty() == false || _render_ahead_host)
+    {
+        _render_playback();
+    }
+    else if (_independent_buses)
+    {
+        begin_bus_render();
+        for (int bus = 0; bus < _buses; ++bus)
+        {
+            render_bus(bus);
+        }
+        end_bus_render();
+    }
+    else
+    {
+        _prepare_external_input();
+        process_audio(_external_input.channel_count() > 0 ? _external_input : _input_buffer, _output_buffer);
+        _input_buffer.clear();
+        _external_input = ChunkSampleBuffer();
+    }
 
-        case PanMode::PAN_AND_GAIN:
-            _apply_pan_and_gain(out, muted);
-            break;
+    float shed_gain = _shed ? 0.0f : 1.0f;
+    if (shed_gain != _shed_gain)
+    {
+        _output_buffer.ramp(_shed_gain, shed_gain);
+        _shed_gain = shed_gain;
+    }
+}
 
-        case PanMode::PAN_AND_GAIN_PER_BUS:
-            _apply_pan_and_gain_per_bus(out, muted);
-            break;
+bool Track::freeze(int chunks)
+{
+    if (_async_hosts.empty() == false || _render_ahead_host)
+    {
+        return false;
+    }
+    std::vector<ChunkSampleBuffer> audio;
+    audio.reserve(chunks);
+
+    /* Render the processors only, without the gain and pan of the track, and keep events
+     * out of the rt thread. The audio graph sets a new event output when the track is
+     * added back to it */
+    bool deferred_gain = _deferred_gain;
+    _deferred_gain = true;
+    set_event_output(nullptr);
+    _input_buffer.clear();
+    _external_input = ChunkSampleBuffer();
+    bool silent = true;
+    for (int i = 0; i < chunks; ++i)
+    {
+        render();
+        audio.push_back(_output_buffer);
+        silent = silent && _output_buffer.is_silent();
+    }
+    _deferred_gain = deferred_gain;
+
+    // The track needs live input or events to make any sound, playing back silence is of no use
+    if (silent)
+    {
+        return false;
+    }
+    _frozen_audio = std::move(audio);
+    // Aligned with the transport position on the first chunk played back
+    _frozen_beats = FROZEN_NOT_PLAYING;
+    _frozen_position = 0;
+    _update_plan();
+    return true;
+}
+
+bool Track::set_render_ahead_host(RenderAheadHost* host)
+{
+    if (host && (_async_hosts.empty() == false || _frozen_audio.empty() == false))
+    {
+        return false;
+    }
+    _render_ahead_host = host;
+    for (auto processor : _processors)
+    {
+        auto bus = processor_bus(processor->id());
+        processor->set_event_output(host ? host : bus.has_value() ? static_cast<RtEventPipe*>(&_bus_event_pipes[*bus]) : this);
+    }
+    _update_plan();
+    return true;
+}
+
+void Track::unfreeze()
+{
+    _frozen_audio.clear();
+    _frozen_audio.shrink_to_fit();
+    _frozen_beats = FROZEN_NOT_PLAYING;
+    _frozen_position = 0;
+    _update_plan();
+}
+
+void Track::process_audio(const ChunkSampleBuffer& in, ChunkSampleBuffer& out)
+{
+    /* For Tracks, process function is called from render() and the input audio data
+     * should be copied to _input_buffer, or set with set_external_input(), prior to this call. */
+
+    auto track_timestamp = _timer->start_timer();
+
+    _process_plugins(in, out);
+
+    /* If there are keyboard events not consumed, pass them on upwards so the engine can process them */
+    _process_output_events();
+
+    _apply_compensation_delay(out);
+    _update_output_gains(_mute_parameter->processed_value());
+    if (_deferred_gain == false || out.channel(0) != _output_buffer.channel(0))
+    {
+        _apply_output_gains(out);
     }
 
     _timer->stop_timer_rt_safe(track_timestamp, this->id());
@@ -235,7 +581,10 @@ void Track::send_event(const RtEvent& event)
 
 void Track::_common_init(PanMode mode)
 {
-    _processors.reserve(TRACK_MAX_PROCESSORS);
+    _processors.reserve(TRACK_INITIAL_PROCESSORS);
+    _async_hosts.reserve(TRACK_INITIAL_PROCESSORS);
+    _processor_buses.reserve(TRACK_INITIAL_PROCESSORS);
+    _plan.reserve(TRACK_INITIAL_PROCESSORS);
     _pan_mode = mode;
 
     _gain_parameters.at(0) = register_float_parameter("gain", "Gain", "dB",
@@ -275,50 +624,102 @@ void Track::_common_init(PanMode mode)
         i[LEFT_CHANNEL_INDEX].set_direct(DEFAULT_TRACK_GAIN);
         i[RIGHT_CHANNEL_INDEX].set_direct(DEFAULT_TRACK_GAIN);
     }
+    for (int channel = 0; channel < MAX_TRACK_CHANNELS; ++channel)
+    {
+        _output_gains[channel] = {channel, DEFAULT_TRACK_GAIN, DEFAULT_TRACK_GAIN};
+    }
 }
 
-void Track::_process_plugins(ChunkSampleBuffer& in, ChunkSampleBuffer& out)
+void Track::_process_plugins(const ChunkSampleBuffer& in, ChunkSampleBuffer& out)
 {
-    /* Alias the buffers, so we can swap them cheaply, without copying the underlying data */
-
-    ChunkSampleBuffer aliased_in = ChunkSampleBuffer::create_non_owning_buffer(in);
-    ChunkSampleBuffer aliased_out = ChunkSampleBuffer::create_non_owning_buffer(out);
+    /* Processors alternate between the buffers, so no data needs to be copied between them.
+     * Only the first processor reads from in, _input_buffer takes its place after that so
+     * that memory declared const is never written to. Processors on a bus write their output
+     * back to their input though, so then the input is copied first. */
+    std::array<ChunkSampleBuffer*, 2> buffers = {&_input_buffer, &out};
+    const ChunkSampleBuffer* input = &in;
+    if (in.channel(0) != _input_buffer.channel(0) && _plan.empty() == false && _plan.front().bus != NO_BUS)
+    {
+        _input_buffer.replace(in);
+        input = &_input_buffer;
+    }
+    bool first_step = true;
+    /* Set when the output of the previous processor is known to be silent, to avoid checking it */
+    bool silent_input = false;
 
-    for (auto &processor : _processors)
+    for (const auto& step : _plan)
     {
+        auto processor = step.processor;
         auto processor_timestamp = _timer->start_timer();
+        _current_processor.store(processor, std::memory_order_relaxed);
+        if (step.async_host)
+        {
+            step.async_host->wait_for_processing();
+        }
         /* Note that processors can put events back into this queue, hence we're not draining the queue
          * but checking the size first to avoid an infinite loop */
-        for (int kb_events = _kb_event_buffer.size(); kb_events > 0; --kb_events)
+        int kb_events = _kb_event_buffer.size();
+        bool keyboard_events = kb_events > 0;
+        for (; kb_events > 0; --kb_events)
         {
             processor->process_event(_kb_event_buffer.pop());
         }
 
-        ChunkSampleBuffer proc_in = ChunkSampleBuffer::create_non_owning_buffer(aliased_in, 0, processor->input_channels());
-        ChunkSampleBuffer proc_out = ChunkSampleBuffer::create_non_owning_buffer(aliased_out, 0, processor->output_channels());
-        processor->process_audio(proc_in, proc_out);
+        auto& source = first_step ? const_cast<ChunkSampleBuffer&>(*input) : *buffers[step.source];
+        auto& destination = *buffers[1 - step.source];
+        first_step = false;
+        if (step.bus != NO_BUS)
+        {
+            _process_on_bus(step, source, destination);
+            _timer->stop_timer_rt_safe(processor_timestamp, static_cast<int>(processor->id()));
+            silent_input = false;
+            continue;
+        }
+
+        ChunkSampleBuffer proc_in = ChunkSampleBuffer::create_non_owning_buffer(source, 0, step.input_channels);
+        ChunkSampleBuffer proc_out = ChunkSampleBuffer::create_non_owning_buffer(destination, 0, step.output_channels);
+        if (step.async_host)
+        {
+            // Output is delayed one chunk, timings are recorded by the host
+            step.async_host->process(proc_in, proc_out);
+            silent_input = false;
+        }
+        else if (_is_idle(processor, proc_in, silent_input, keyboard_events))
+        {
+            proc_out.clear();
+            silent_input = true;
+        }
+        else
+        {
+            processor->process_audio(proc_in, proc_out);
+            silent_input = false;
+        }
 
-        int unused_channels = aliased_out.channel_count() - processor->output_channels();
+        int unused_channels = destination.channel_count() - step.output_channels;
         if (unused_channels > 0)
         {
             // If processor has fewer channels than the track, zero the rest to avoid passing garbage to the next processor
-            auto unused = ChunkSampleBuffer::create_non_owning_buffer(aliased_out, aliased_out.channel_count() - unused_channels, unused_channels);
+            auto unused = ChunkSampleBuffer::create_non_owning_buffer(destination, step.output_channels, unused_channels);
             unused.clear();
         }
 
-        swap(aliased_in, aliased_out);
-        _timer->stop_timer_rt_safe(processor_timestamp, static_cast<int>(processor->id()));
+        // Skipped chunks are not timed, the timings are the cost of processing audio
+        if (step.async_host == nullptr && silent_input == false)
+        {
+            _timer->stop_timer_rt_safe(processor_timestamp, static_cast<int>(processor->id()));
+        }
     }
+    _current_processor.store(nullptr, std::memory_order_relaxed);
 
-    int output_channels = _processors.empty() ? _current_output_channels : _processors.back()->output_channels();
+    int output_channels = _plan.empty() ? _current_output_channels : _plan_output_channels;
 
     if (output_channels > 0)
     {
-        /* aliased_out contains the output of the last processor. If the number of processors
-         * is even, then aliased_out already points to out, otherwise we need to copy to it */
-        if (aliased_in.channel(0) == in.channel(0))
+        /* If the number of processors is even, the output of the last one is already in out,
+         * otherwise we need to copy it there */
+        if (_plan_output_source == 0)
         {
-            out.replace(aliased_in);
+            out.replace(_plan.empty() ? *input : _input_buffer);
         }
     }
     else
@@ -327,6 +728,198 @@ void Track::_process_plugins(ChunkSampleBuffer& in, ChunkSampleBuffer& out)
     }
 }
 
+void Track::_prepare_external_input()
+{
+    int channels = _external_input.channel_count();
+    if (channels == 0)
+    {
+        return;
+    }
+    bool in_place;
+    if (_independent_buses || _plan.empty())
+    {
+        in_place = channels == _input_buffer.channel_count();
+    }
+    else
+    {
+        // Processors on a bus write their output back to their input
+        in_place = _plan.front().bus == NO_BUS && _plan.front().input_channels <= channels;
+    }
+    if (in_place == false)
+    {
+        auto input = ChunkSampleBuffer::create_non_owning_buffer(_input_buffer, 0, channels);
+        input.replace(_external_input);
+        _external_input = ChunkSampleBuffer();
+    }
+}
+
+bool Track::_is_idle(Processor* processor, const ChunkSampleBuffer& in, bool silent_input, bool keyboard_events)
+{
+    if (processor->tail_length() == TAIL_UNKNOWN)
+    {
+        // Avoid checking the input of processors that are never idle
+        return false;
+    }
+    return processor->update_idle_state(silent_input || in.is_silent(), keyboard_events);
+}
+
+AsyncProcessorHost* Track::_async_host(const Processor* processor) const
+{
+    for (auto host : _async_hosts)
+    {
+        if (host->processor() == processor)
+        {
+            return host;
+        }
+    }
+    return nullptr;
+}
+
+void Track::_process_on_bus(const PlanStep& step, ChunkSampleBuffer& buffer, ChunkSampleBuffer& work_buffer)
+{
+    int bus = step.bus;
+    auto bus_buffer = ChunkSampleBuffer::create_non_owning_buffer(buffer, bus * 2, 2);
+    auto bus_work_buffer = ChunkSampleBuffer::create_non_owning_buffer(work_buffer, bus * 2, 2);
+
+    ChunkSampleBuffer proc_in = ChunkSampleBuffer::create_non_owning_buffer(bus_buffer, 0, step.input_channels);
+    ChunkSampleBuffer proc_out = ChunkSampleBuffer::create_non_owning_buffer(bus_work_buffer, 0, step.output_channels);
+    step.processor->process_audio(proc_in, proc_out);
+    if (step.output_channels < 2)
+    {
+        auto unused = ChunkSampleBuffer::create_non_owning_buffer(bus_work_buffer, step.output_channels, 2 - step.output_channels);
+        unused.clear();
+    }
+    // Copy the result back instead of swapping buffers, so that the other buses are left untouched
+    bus_buffer.replace(bus_work_buffer);
+
+    auto& events = _bus_event_pipes[bus];
+    while (events.kb_events.empty() == false)
+    {
+        _kb_event_buffer.push(events.kb_events.pop());
+    }
+    while (events.output_events.empty() == false)
+    {
+        output_event(events.output_events.pop());
+    }
+}
+
+void Track::_update_plan()
+{
+    /* Called from the rt thread, so must not allocate, _plan has room for all processors */
+    _plan.clear();
+    int source = 0;
+    std::array<int, MAX_TRACK_BUSES> bus_sources{};
+    for (auto i = _processors.begin(); i != _processors.end();)
+    {
+        auto processor = *i;
+        PlanStep step{processor,
+                      _async_host(processor),
+                      processor_bus(processor->id()).value_or(NO_BUS),
+                      source,
+                      0,
+                      processor->input_channels(),
+                      processor->output_channels()};
+        if (step.bus != NO_BUS)
+        {
+            // Processors on a bus copy their output back to the bus instead of swapping buffers
+            step.input_channels = std::min(step.input_channels, 2);
+            step.output_channels = std::min(step.output_channels, 2);
+            step.bus_source = bus_sources[step.bus];
+            bus_sources[step.bus] = 1 - bus_sources[step.bus];
+            ++i;
+        }
+        else if (step.async_host)
+        {
+            // An asynchronous stage can contain several processors, output channels are those of the last one
+            step.output_channels = step.async_host->processors().back()->output_channels();
+            i += step.async_host->processors().size();
+            source = 1 - source;
+        }
+        else
+        {
+            ++i;
+            source = 1 - source;
+        }
+        _plan.push_back(step);
+    }
+    _plan_output_source = source;
+    _plan_output_channels = _processors.empty() ? 0 : _processors.back()->output_channels();
+    _bus_output_sources = bus_sources;
+
+    _independent_buses = _buses > 1 && _processors.empty() == false && _async_hosts.empty() &&
+                         _frozen_audio.empty() && _render_ahead_host == nullptr &&
+                         std::all_of(_processors.begin(), _processors.end(), [&](const auto& processor)
+                         {
+                             return processor_bus(processor->id()).has_value();
+                         });
+}
+
+bool Track::_fits_on_track(const AsyncProcessorHost* host, int position) const
+{
+    const auto& stage = host->processors();
+    if (position + static_cast<int>(stage.size()) > static_cast<int>(_processors.size()) ||
+        std::equal(stage.begin(), stage.end(), _processors.begin() + position) == false)
+    {
+        return false;
+    }
+    // Processors assigned to a bus can't be processed asynchronously
+    if (std::any_of(stage.begin(), stage.end(), [&](const auto& p) {return processor_bus(p->id()).has_value();}))
+    {
+        return false;
+    }
+    // Stages must not overlap
+    return std::none_of(stage.begin(), stage.end(), [&](const auto& processor)
+    {
+        return std::any_of(_async_hosts.begin(), _async_hosts.end(), [&](const auto& h)
+        {
+            return std::find(h->processors().begin(), h->processors().end(), processor) != h->processors().end();
+        });
+    });
+}
+
+void Track::_add_async_host(AsyncProcessorHost* host)
+{
+    host->set_event_output(this);
+    for (auto processor : host->processors())
+    {
+        processor->set_event_output(host);
+    }
+    _async_hosts.push_back(host);
+    _update_plan();
+}
+
+void Track::_remove_async_host(ObjectId processor)
+{
+    for (auto i = _async_hosts.begin(); i != _async_hosts.end(); ++i)
+    {
+        const auto& stage = (*i)->processors();
+        if (std::any_of(stage.begin(), stage.end(), [&](const auto& p) {return p->id() == processor;}))
+        {
+            (*i)->wait_for_processing();
+            (*i)->forward_events();
+            for (auto p : stage)
+            {
+                p->set_event_output(this);
+            }
+            _async_hosts.erase(i);
+            _update_plan();
+            return;
+        }
+    }
+}
+
+void Track::BusEventPipe::send_event(const RtEvent& event)
+{
+    if (is_keyboard_event(event))
+    {
+        kb_events.push(event);
+    }
+    else
+    {
+        output_events.push(event);
+    }
+}
+
 void Track::_process_output_events()
 {
     while (!_kb_event_buffer.empty())
@@ -379,83 +972,252 @@ void Track::_process_output_events()
     _kb_event_buffer.clear(); // Reset the read & write index to reuse the same memory area every time.
 }
 
-void Track::_apply_pan_and_gain(ChunkSampleBuffer& buffer, bool muted)
+void Track::_render_playback()
 {
-    assert(buffer.channel_count() <= 2);
+    auto track_timestamp = _timer->start_timer();
+    if (_render_ahead_host)
+    {
+        /* Keyboard events go to the processors through the host, and the events they output
+         * come back the same way, keyboard events among them are then passed on below */
+        while (_kb_event_buffer.empty() == false)
+        {
+            _render_ahead_host->queue_event(_kb_event_buffer.pop());
+        }
+        _render_ahead_host->forward_events(this);
+        _render_ahead_host->pop(_output_buffer);
+    }
+    else
+    {
+        /* The frozen audio follows the transport position, which starts from the beginning
+         * of the audio. It advances a chunk at a time while the transport plays on, and is
+         * realigned when the transport starts or jumps. The track is silent while stopped
+         * and outside of the audio */
+        auto transport = _host_control.transport();
+        double beats_per_chunk = transport->current_beats_per_chunk();
+        if (transport->playing() && beats_per_chunk > 0)
+        {
+            double beats = transport->current_beats();
+            if (transport->current_state_change() == PlayStateChange::STARTING ||
+                std::abs(beats - _frozen_beats - beats_per_chunk) > beats_per_chunk / 2)
+            {
+                _frozen_position = static_cast<int>(std::floor(beats / beats_per_chunk + 0.5));
+            }
+            else
+            {
+                _frozen_position++;
+            }
+            _frozen_beats = beats;
+        }
+        else
+        {
+            _frozen_beats = FROZEN_NOT_PLAYING;
+        }
+        if (_frozen_beats != FROZEN_NOT_PLAYING && _frozen_position >= 0 &&
+            _frozen_position < static_cast<int>(_frozen_audio.size()))
+        {
+            _output_buffer.replace(_frozen_audio[_frozen_position]);
+        }
+        else
+        {
+            _output_buffer.clear();
+        }
+    }
 
-    float gain = muted ? 0.0f : _gain_parameters.front()->processed_value();
-    float pan = _pan_parameters.front()->processed_value();
-    auto[left_gain, right_gain] = calc_l_r_gain(gain, pan);
+    // Keyboard events not consumed by any processor are passed on
+    _process_output_events();
 
-    auto& left_smoother = _smoothers.front()[LEFT_CHANNEL_INDEX];
-    auto& right_smoother = _smoothers.front()[RIGHT_CHANNEL_INDEX];
-    left_smoother.set(left_gain);
-    right_smoother.set(right_gain);
+    _apply_compensation_delay(_output_buffer);
+    _update_output_gains(_mute_parameter->processed_value());
+    if (_deferred_gain == false)
+    {
+        _apply_output_gains(_output_buffer);
+    }
+    _input_buffer.clear();
+    _external_input = ChunkSampleBuffer();
+    _timer->stop_timer_rt_safe(track_timestamp, this->id());
+}
 
-    ChunkSampleBuffer left = ChunkSampleBuffer::create_non_owning_buffer(buffer, LEFT_CHANNEL_INDEX, 1);
-    ChunkSampleBuffer right = ChunkSampleBuffer::create_non_owning_buffer(buffer, RIGHT_CHANNEL_INDEX, 1);
+void Track::_render_shed()
+{
+    while (_kb_event_buffer.empty() == false)
+    {
+        _kb_event_buffer.pop();
+    }
+    _output_buffer.clear();
+    _input_buffer.clear();
+    _external_input = ChunkSampleBuffer();
+}
 
-    if (_current_input_channels == 1)
+void Track::mix_output_channel(int channel, ChunkSampleBuffer& destination, int destination_channel, bool replace) const
+{
+    assert(channel < _max_output_channels);
+    if (_stalled)
     {
-        right.replace(left);
+        // The output buffer may still be written to by the hung worker
+        if (replace)
+        {
+            auto silent = ChunkSampleBuffer::create_non_owning_buffer(destination, destination_channel, 1);
+            silent.clear();
+        }
+        return;
+    }
+    if (_deferred_gain == false)
+    {
+        if (replace)
+        {
+            destination.replace(destination_channel, channel, _output_buffer);
+        }
+        else
+        {
+            destination.add(destination_channel, channel, _output_buffer);
+        }
+        return;
     }
 
-    if (left_smoother.stationary() && left_smoother.stationary())
+    const auto& gain = _output_gains[channel];
+    if (gain.start == gain.end)
+    {
+        if (replace)
+        {
+            destination.replace_with_gain(destination_channel, gain.source, _output_buffer, gain.start);
+        }
+        else
+        {
+            destination.add_with_gain(destination_channel, gain.source, _output_buffer, gain.start);
+        }
+    }
+    else if (replace)
     {
-        left.apply_gain(left_gain);
-        right.apply_gain(right_gain);
+        destination.replace_with_ramp(destination_channel, gain.source, _output_buffer, gain.start, gain.end);
     }
-    else // Value needs smoothing
+    else
     {
-        left.ramp(left_smoother.value(), left_smoother.next_value());
-        right.ramp(right_smoother.value(), right_smoother.next_value());
+        destination.add_with_ramp(destination_channel, gain.source, _output_buffer, gain.start, gain.end);
     }
 }
 
-void Track::_apply_pan_and_gain_per_bus(ChunkSampleBuffer& buffer, bool muted)
+void Track::add_group_input(const Track& member)
 {
-    for (int bus = 0; bus < _buses; ++bus)
+    if (_external_input.channel_count() > 0)
     {
-        auto bus_buffer = ChunkSampleBuffer::create_non_owning_buffer(buffer, bus * 2, 2);
-        float gain = muted ? 0.0f : _gain_parameters[bus]->processed_value();
-        float pan = _pan_parameters[bus]->processed_value();
-        auto[left_gain, right_gain] = calc_l_r_gain(gain, pan);
-        auto& left_smoother = _smoothers[bus][LEFT_CHANNEL_INDEX];
-        auto& right_smoother = _smoothers[bus][RIGHT_CHANNEL_INDEX];
-
-        left_smoother.set(left_gain);
-        right_smoother.set(right_gain);
+        // Input from the engine can't be summed in place, as it is shared with other tracks
+        auto input = ChunkSampleBuffer::create_non_owning_buffer(_input_buffer, 0, _external_input.channel_count());
+        input.replace(_external_input);
+        _external_input = ChunkSampleBuffer();
+    }
+    int channels = std::min(member._output_buffer.channel_count(), _input_buffer.channel_count());
+    for (int c = 0; c < channels; ++c)
+    {
+        member.mix_output_channel(c, _input_buffer, c, false);
+    }
+}
 
-        ChunkSampleBuffer left = ChunkSampleBuffer::create_non_owning_buffer(bus_buffer, LEFT_CHANNEL_INDEX, 1);
-        ChunkSampleBuffer right = ChunkSampleBuffer::create_non_owning_buffer(bus_buffer, RIGHT_CHANNEL_INDEX, 1);
+void Track::set_compensation_delay(StorageSwap& swap, int samples)
+{
+    auto delay_line = std::make_shared<std::vector<float>>(static_cast<size_t>(samples) * _output_buffer.channel_count(), 0.0f);
+    swap.on_swap([this, delay_line, samples]()
+    {
+        // The previous delay line ends up in delay_line and is freed with the swap
+        std::swap(_delay_line, *delay_line);
+        _compensation_delay = samples;
+        _delay_position = 0;
+    });
+}
 
-        if (left_smoother.stationary() && left_smoother.stationary())
+void Track::_apply_compensation_delay(ChunkSampleBuffer& buffer)
+{
+    if (_compensation_delay == 0)
+    {
+        return;
+    }
+    /* Every sample is swapped with the one written to the same position of the ring one
+     * delay length ago, which works for delays shorter than a chunk too */
+    int channels = std::min(buffer.channel_count(), _output_buffer.channel_count());
+    for (int c = 0; c < channels; ++c)
+    {
+        float* line = _delay_line.data() + c * _compensation_delay;
+        float* data = buffer.channel(c);
+        int position = _delay_position;
+        for (int i = 0; i < AUDIO_CHUNK_SIZE; ++i)
         {
-            left.apply_gain(left_gain);
-            right.apply_gain(right_gain);
+            std::swap(line[position], data[i]);
+            if (++position == _compensation_delay)
+            {
+                position = 0;
+            }
         }
-        else // Value needs smoothing
+    }
+    _delay_position = (_delay_position + AUDIO_CHUNK_SIZE) % _compensation_delay;
+}
+
+void Track::_update_output_gains(bool muted)
+{
+    switch (_pan_mode)
+    {
+        case PanMode::GAIN_ONLY:
         {
-            left.ramp(left_smoother.value(), left_smoother.next_value());
-            right.ramp(right_smoother.value(), right_smoother.next_value());
+            float gain = muted ? 0.0f : _gain_parameters.front()->processed_value();
+            auto [start, end] = gain_ramp(_smoothers.front()[LEFT_CHANNEL_INDEX], gain);
+            for (int channel = 0; channel < MAX_TRACK_CHANNELS; ++channel)
+            {
+                _output_gains[channel] = {channel, start, end};
+            }
+            break;
         }
+
+        case PanMode::PAN_AND_GAIN:
+            _update_bus_gains(0, muted);
+            if (_current_input_channels == 1)
+            {
+                // Mono tracks are panned by taking both outputs from the left channel
+                _output_gains[RIGHT_CHANNEL_INDEX].source = LEFT_CHANNEL_INDEX;
+            }
+            break;
+
+        case PanMode::PAN_AND_GAIN_PER_BUS:
+            for (int bus = 0; bus < _buses; ++bus)
+            {
+                _update_bus_gains(bus, muted);
+            }
+            break;
     }
 }
 
-void Track::_apply_gain(ChunkSampleBuffer& buffer, bool muted)
+void Track::_update_bus_gains(int bus, bool muted)
 {
-    float gain = muted ? 0.0f : _gain_parameters.front()->processed_value();
+    float gain = muted ? 0.0f : _gain_parameters[bus]->processed_value();
+    float pan = _pan_parameters[bus]->processed_value();
+    auto [left_gain, right_gain] = calc_l_r_gain(gain, pan);
+    auto [left_start, left_end] = gain_ramp(_smoothers[bus][LEFT_CHANNEL_INDEX], left_gain);
+    auto [right_start, right_end] = gain_ramp(_smoothers[bus][RIGHT_CHANNEL_INDEX], right_gain);
 
-    auto& gain_smoother = _smoothers.front()[LEFT_CHANNEL_INDEX];
-    gain_smoother.set(gain);
+    int left = bus * 2 + LEFT_CHANNEL_INDEX;
+    int right = bus * 2 + RIGHT_CHANNEL_INDEX;
+    _output_gains[left] = {left, left_start, left_end};
+    _output_gains[right] = {right, right_start, right_end};
+}
 
-    if (gain_smoother.stationary())
-    {
-        buffer.apply_gain(gain);
-    }
-    else // Value needs smoothing
+void Track::_apply_output_gains(ChunkSampleBuffer& buffer)
+{
+    assert(_pan_mode != PanMode::PAN_AND_GAIN || buffer.channel_count() <= 2);
+    /* Channels are only ever taken from a lower channel, so going backwards, they are
+     * copied before the gain of the channel they are taken from is applied */
+    for (int channel = buffer.channel_count() - 1; channel >= 0; --channel)
     {
-        buffer.ramp(gain_smoother.value(), gain_smoother.next_value());
+        const auto& gain = _output_gains[channel];
+        if (gain.source != channel)
+        {
+            buffer.replace(channel, gain.source, buffer);
+        }
+        if (gain.start == gain.end)
+        {
+            buffer.apply_gain(gain.start, channel);
+        }
+        else
+        {
+            auto channel_buffer = ChunkSampleBuffer::create_non_owning_buffer(buffer, channel, 1);
+            channel_buffer.ramp(gain.start, gain.end);
+        }
     }
 }
 
@@ -25,12 +25,17 @@
 #include <memory>
 #include <array>
 #include <vector>
+#include <atomic>
+#include <limits>
 
 #include "library/sample_buffer.h"
 #include "library/internal_plugin.h"
 #include "library/rt_event_fifo.h"
 #include "library/constants.h"
 #include "library/performance_timer.h"
+#include "engine/async_processor_host.h"
+#include "engine/render_ahead_host.h"
+#include "engine/storage_swap.h"
 
 #include "dsp_library/value_smoother.h"
 
@@ -40,6 +45,10 @@ namespace engine {
 /* No real technical limit, just something arbitrarily high enough */
 constexpr int MAX_TRACK_BUSES = MAX_TRACK_CHANNELS / 2;
 constexpr int KEYBOARD_EVENT_QUEUE_SIZE = 256;
+constexpr int UNASSIGNED_CORE = -1;
+constexpr int DEFAULT_TRACK_PRIORITY = 0;
+/* Transport position of frozen playback while the transport is not playing */
+constexpr double FROZEN_NOT_PLAYING = std::numeric_limits<double>::lowest();
 
 enum class TrackType
 {
@@ -81,6 +90,7 @@ public:
      * @brief Add a processor to the track's processing chain at the position before
      *        The processor with id before_position.
      *        Should be called from the audio thread or when the track is not processing.
+     *        The channel configuration of the processor must not change while it is on the track.
      * @param processor A pointer to the plugin instance to add.
      * @param before_position The ObjectId of the succeeding plugin, if not set, the
      *        processor will be added to the back of the track
@@ -95,6 +105,97 @@ public:
      */
     bool remove(ObjectId processor);
 
+    /**
+     * @brief Process a processor on the track asynchronously through a host, or return it
+     *        to normal processing. Should be called from the audio thread or when the track
+     *        is not processing.
+     * @param processor The ObjectId of the processor
+     * @param host The host to process the processor with, not owned by the track. If
+     *             nullptr, the processor is processed synchronously in the track. If the
+     *             host has a stage of several processors, they must follow the processor
+     *             on the track, in order.
+     * @return true if the processor was found on the track, false otherwise
+     */
+    bool set_async_host(ObjectId processor, AsyncProcessorHost* host);
+
+    /**
+     * @brief Process the whole chain of the track as a pipeline of stages, each hosted
+     *        in its own realtime thread, or return all processors to normal processing.
+     *        Replaces any previously set hosts. Should be called from the audio thread
+     *        or when the track is not processing.
+     * @param stages The hosts of the stages, in processing order, not owned by the track.
+     *               Together they must contain all processors on the track, in order,
+     *               counting the processors they are to take over if any were given to
+     *               them with AsyncProcessorHost::set_next_processors(). If empty, all
+     *               processors are processed synchronously in the track.
+     * @return true if the stages matched the processors on the track, false otherwise
+     */
+    bool set_pipeline(const std::vector<AsyncProcessorHost*>& stages);
+
+    /**
+     * @brief Assign a processor to one of the stereo buses of the track, or return it to
+     *        processing all channels of the track. A processor assigned to a bus only
+     *        processes the channels of that bus and should be configured with 2 channels
+     *        at most. The assignment is kept until the processor is removed from the track,
+     *        it can be made before the processor is added. Should be called from the
+     *        audio thread or when the track is not processing.
+     * @param processor The ObjectId of the processor
+     * @param bus The index of the bus, if no value, the processor processes all channels
+     * @return true if successful, false if the bus is out of range or if the processor is
+     *         processed asynchronously
+     */
+    bool set_processor_bus(ObjectId processor, std::optional<int> bus);
+
+    /**
+     * @brief Return the bus a processor is assigned to
+     * @param processor The ObjectId of the processor
+     * @return The index of the bus, or no value if the processor processes all channels
+     */
+    std::optional<int> processor_bus(ObjectId processor) const;
+
+    /**
+     * @brief Whether the buses of the track can be rendered independently of each other,
+     *        which is the case for multibus tracks where all processors are assigned to
+     *        a bus and none are processed asynchronously. The buses of such a track can
+     *        then be rendered in parallel with render_bus().
+     *        Only safe to call from the rt thread or when the track is not processing.
+     * @return true if the buses can be rendered independently
+     */
+    bool independent_buses() const
+    {
+        return _independent_buses && _shed == false && _shed_gain == 1.0f;
+    }
+
+    /**
+     * @brief Prepare for rendering the buses of the track independently. Must be called
+     *        before render_bus() is called for any bus, after process_event() has been
+     *        called for all events this chunk. Keyboard events sent to the track are
+     *        passed on to the processors of every bus.
+     */
+    void begin_bus_render();
+
+    /**
+     * @brief Render the processors assigned to one bus. Buses can be rendered concurrently
+     *        with each other, from different threads. Only valid if independent_buses()
+     *        returns true.
+     * @param bus The index of the bus to render
+     */
+    void render_bus(int bus);
+
+    /**
+     * @brief Finish rendering the buses of the track independently. Passes on events output
+     *        by the processors and applies the pan and gain of each bus. Must be called
+     *        after render_bus() has returned for all buses.
+     */
+    void end_bus_render();
+
+    /**
+     * @brief Wait for all asynchronously processed processors on the track to finish.
+     *        Must be called from the audio thread before any events are passed to the
+     *        processors of the track.
+     */
+    void wait_for_async_processing();
+
     /**
      * @brief Return a SampleBuffer to an input bus
      * @param bus The index of the bus, must not be greater than the number of buses configured
@@ -139,6 +240,94 @@ public:
         return ChunkSampleBuffer::create_non_owning_buffer(_output_buffer, index, 1);
     }
 
+    /**
+     * @brief Make the next render of the track read its input directly from a buffer owned
+     *        by the caller, instead of having it copied to input_channel() first. If the
+     *        processors can't read the input in place, it is copied to the input buffer when
+     *        rendering starts. Called from the rt thread, and the buffer must stay valid until
+     *        render() or end_bus_render() has returned.
+     * @param input A non-owning buffer with the first input_channels() channels of the track
+     */
+    void set_external_input(ChunkSampleBuffer input)
+    {
+        assert(input.channel_count() <= _input_buffer.channel_count());
+        _external_input = std::move(input);
+    }
+
+    /**
+     * @brief Leave the gain and pan of the track to be applied when its output is mixed
+     *        with mix_output_channel(), instead of applying them to the output buffer when
+     *        rendering. Saves a pass over the output buffer for tracks whose output is only
+     *        read through mix_output_channel(). process_audio() with another output buffer
+     *        than that of the track always applies them.
+     * @param deferred If true, output_bus() and output_channel() return the output of the
+     *                 processors without the gain and pan of the track
+     */
+    void set_deferred_gain(bool deferred)
+    {
+        _deferred_gain = deferred;
+    }
+
+    /**
+     * @brief Mix an output channel of the track into a channel of another buffer, with the
+     *        gain and pan of the track applied if they are deferred, in a single pass.
+     *        Called from the rt thread after the track is rendered.
+     * @param channel The output channel of the track
+     * @param destination The buffer to mix into
+     * @param destination_channel The channel of destination to mix into
+     * @param replace If true, overwrite the destination channel instead of adding to it
+     */
+    void mix_output_channel(int channel, ChunkSampleBuffer& destination, int destination_channel, bool replace) const;
+
+    /**
+     * @brief Route the output of the track into the input of a group track instead of to
+     *        the engine outputs. The audio graph renders the group after the track and sums
+     *        the output of all its members, with their gain and pan applied, into its input.
+     *        Safe to call from any thread.
+     * @param group The group track, or nullptr to disconnect the track from its group
+     */
+    void set_output_group(Track* group)
+    {
+        _output_group.store(group, std::memory_order_release);
+        notify_routing_changed();
+    }
+
+    /**
+     * @brief Return the group track that the output of the track is routed to. Safe to call
+     *        from any thread.
+     * @return The group track, or nullptr if the track is not in a group
+     */
+    Track* output_group() const
+    {
+        return _output_group.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Add the output of a member track to the input of this track. Called from the rt
+     *        thread, after the member has been rendered and before this track is.
+     * @param member A track that has this track as its output group
+     */
+    void add_group_input(const Track& member);
+
+    /**
+     * @brief Delay the output of the track, to keep it in sync with tracks whose processors
+     *        have more latency. The delay line is allocated in the calling thread and replaced
+     *        when the StorageSwap is swapped in from the rt thread, which also clears it.
+     * @param swap The StorageSwap to add the delay line to
+     * @param samples The delay in samples, 0 for no delay
+     */
+    void set_compensation_delay(StorageSwap& swap, int samples);
+
+    /**
+     * @brief Return the delay set with set_compensation_delay(). Only safe to call from the rt
+     *        thread or when the track is not processing.
+     * @return The delay in samples
+     */
+    int compensation_delay() const
+    {
+        return _compensation_delay;
+    }
+
     /**
      * @brief Return the number of stereo buses of the track.
      * @return The number of stereo buses on the track.
@@ -148,12 +337,95 @@ public:
         return _buses;
     }
 
+    /**
+     * @brief Return the processors in the track's processing chain, in processing order.
+     *        Only safe to call from the rt thread or when the track is not processing.
+     * @return A list of non-owning processor pointers
+     */
+    const std::vector<Processor*>& processors() const
+    {
+        return _processors;
+    }
+
+    /**
+     * @brief Return the number of processors the track has room for. add() fails when
+     *        the track is full. Only changes through grow(), so safe to call from any thread.
+     * @return The maximum number of processors
+     */
+    int processor_capacity() const
+    {
+        return static_cast<int>(_processors.capacity());
+    }
+
+    /**
+     * @brief Make room for more processors. The storage is allocated in the calling thread
+     *        and replaced when the StorageSwap is swapped in from the rt thread.
+     * @param swap The StorageSwap to add the storage to
+     * @param processors The number of processors to make room for
+     */
+    void grow(StorageSwap& swap, int processors);
+
     /**
      * @brief Render all processors of the track. Should be called after process_event() and
      *        after input buffers have been filled
      */
     void render();
 
+    /**
+     * @brief Render the processors of the track ahead of time, with silent input and no
+     *        incoming events, and play back the result instead of rendering the processors
+     *        from then on. Playback follows the transport position: the start of the
+     *        audio is played at position 0, playback jumps along with the transport, and
+     *        the track is silent while the transport is stopped and outside of the audio.
+     *        The gain and pan of the track are still applied on playback. Allocates memory
+     *        and renders as fast as possible, so must be called from a non-rt thread when
+     *        the track and its processors are not reachable from the rt thread. Events
+     *        output while rendering are dropped, and the event output of the track is reset.
+     * @param chunks The number of chunks to render
+     * @return true if the track was frozen, false if it has asynchronously processed
+     *         processors, which can't be rendered ahead of time, or if it rendered only
+     *         silence, as tracks that process live input or play the events sent to them do
+     */
+    bool freeze(int chunks);
+
+    /**
+     * @brief Return the track to rendering its processors and free the frozen audio. Must be
+     *        called from a non-rt thread when the track is not processing.
+     */
+    void unfreeze();
+
+    /**
+     * @brief Play back the output of the processors rendered ahead of time by a host, instead
+     *        of rendering them, or return to rendering them. Keyboard events to the track are
+     *        passed on through the host. Should be called from the audio thread or when the
+     *        track is not processing.
+     * @param host The host rendering the processors of the track, not owned by the track.
+     *             If nullptr, the processors are rendered by the track again.
+     * @return true if successful, false if the track has asynchronously processed processors
+     *         or is frozen
+     */
+    bool set_render_ahead_host(RenderAheadHost* host);
+
+    /**
+     * @brief Return the host rendering the processors of the track ahead of time, if any.
+     *        Only safe to call from the rt thread or when the track is not processing.
+     * @return The host, or nullptr if the track renders its processors itself
+     */
+    RenderAheadHost* render_ahead_host() const
+    {
+        return _render_ahead_host;
+    }
+
+    /**
+     * @brief Whether the track plays back audio rendered by freeze() instead of rendering its
+     *        processors. Changes only through freeze() and unfreeze().
+     * @return true if the track is frozen
+     */
+    bool frozen() const
+    {
+        return _frozen_audio.empty() == false;
+    }
+
     /**
      * @brief Static render function for passing to a thread manager
      * @param arg Void* pointing to an instance of a Track.
@@ -168,6 +440,97 @@ public:
         return _type;
     }
 
+    /**
+     * @brief Set the priority of the track when the engine is overloaded. Tracks with lower
+     *        priority stop being rendered first. Safe to call from any thread.
+     * @param priority The priority, higher is more important
+     */
+    void set_priority(int priority)
+    {
+        _priority.store(priority, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Return the priority of the track. Safe to call from any thread.
+     * @return The priority, higher is more important
+     */
+    int priority() const
+    {
+        return _priority.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Stop rendering the track to relieve an overloaded cpu, or start rendering it
+     *        again. The output is faded out over the next rendered chunk before the track
+     *        stops rendering, and faded in over the first chunk when it starts again. While
+     *        the track is not rendered, its output is silent and keyboard events sent to it
+     *        are dropped. Called by the audio graph from the rt thread before rendering.
+     * @param shed If true, stop rendering the track
+     */
+    void set_shed(bool shed)
+    {
+        _shed = shed;
+    }
+
+    /**
+     * @brief Whether the track is not rendered, or fading out, to relieve an overloaded cpu.
+     *        Only safe to call from the rt thread or when the track is not processing.
+     * @return true if the track is shed
+     */
+    bool shed() const
+    {
+        return _shed;
+    }
+
+    /**
+     * @brief Mark the track as stalled, when the worker thread rendering it, or the worker
+     *        of the core it is assigned to, has hung. A stalled track is not rendered, its
+     *        buffers are not touched, and its output is silent when mixed with
+     *        mix_output_channel(). Called by the audio graph from the rt thread.
+     * @param stalled If true, the track is stalled
+     */
+    void set_stalled(bool stalled)
+    {
+        _stalled = stalled;
+    }
+
+    /**
+     * @brief Whether the track is stalled. Only safe to call from the rt thread.
+     * @return true if the track is stalled
+     */
+    bool stalled() const
+    {
+        return _stalled;
+    }
+
+    /**
+     * @brief Return the processor the track is currently processing, to find the culprit
+     *        if rendering hangs. Safe to call from any thread.
+     * @return The processor, or nullptr if not processing any processor
+     */
+    const Processor* current_processor() const
+    {
+        return _current_processor.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Set the cpu core the track is assigned to. Called by the audio graph
+     * @param core The index of the core, or UNASSIGNED_CORE if not assigned to any core
+     */
+    void set_assigned_core(int core)
+    {
+        _assigned_core.store(core, std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Return the cpu core the track is assigned to. Safe to call from any thread.
+     * @return The index of the core, or UNASSIGNED_CORE if not assigned to any core
+     */
+    int assigned_core() const
+    {
+        return _assigned_core.load(std::memory_order_relaxed);
+    }
+
     /* Inherited from Processor */
     void process_event(const RtEvent& event) override;
 
@@ -187,19 +550,110 @@ private:
     };
 
     void _common_init(PanMode mode);
-    void _process_plugins(ChunkSampleBuffer& in, ChunkSampleBuffer& out);
+    void _process_plugins(const ChunkSampleBuffer& in, ChunkSampleBuffer& out);
+    void _prepare_external_input();
     void _process_output_events();
-    void _apply_pan_and_gain(ChunkSampleBuffer& buffer, bool muted);
-    void _apply_pan_and_gain_per_bus(ChunkSampleBuffer& buffer, bool muted);
-    void _apply_gain(ChunkSampleBuffer& buffer, bool muted);
+    void _render_playback();
+    void _render_shed();
+    void _update_output_gains(bool muted);
+    void _update_bus_gains(int bus, bool muted);
+    void _apply_output_gains(ChunkSampleBuffer& buffer);
+    void _apply_compensation_delay(ChunkSampleBuffer& buffer);
+
+    /* Gain of an output channel for the current chunk, ramped from start to end. The output
+     * is taken from the source channel, which differs for mono tracks with pan, where both
+     * outputs are taken from the left channel */
+    struct OutputGain
+    {
+        int   source;
+        float start;
+        float end;
+    };
+    /* A step of the execution plan of the track. The plan is compiled from the processing
+     * chain every time the chain changes, so that rendering a chunk doesn't need to look up
+     * hosts, bus assignments or channel counts. Buffers are referred to by index, where 0
+     * is the input and 1 the output buffer of the chunk, and processors alternate between
+     * them. */
+    struct PlanStep
+    {
+        Processor*          processor;
+        /* Set for the first processor of an asynchronous stage, the step covers the whole stage */
+        AsyncProcessorHost* async_host;
+        int                 bus;
+        /* Buffer with the input of the step when rendering the whole track */
+        int                 source;
+        /* Buffer with the input of the step when rendering the bus independently */
+        int                 bus_source;
+        int                 input_channels;
+        int                 output_channels;
+    };
+
+    void _process_on_bus(const PlanStep& step, ChunkSampleBuffer& buffer, ChunkSampleBuffer& work_buffer);
+    void _update_plan();
+    /**
+     * @brief Check if processing of a chunk can be skipped, because the processor's tail
+     *        has elapsed since its input became silent. Skipped chunks are not timed.
+     * @param processor The processor to check
+     * @param in The audio input to the processor for this chunk
+     * @param silent_input True if in is already known to be silent
+     * @param keyboard_events True if keyboard events were passed to the processor this chunk
+     * @return true if the processor is idle and its output should be set to silence
+     */
+    static bool _is_idle(Processor* processor, const ChunkSampleBuffer& in, bool silent_input, bool keyboard_events);
+    AsyncProcessorHost* _async_host(const Processor* processor) const;
+    bool _fits_on_track(const AsyncProcessorHost* host, int position) const;
+    void _add_async_host(AsyncProcessorHost* host);
+    void _remove_async_host(ObjectId processor);
+
+    /* Event output of the processors assigned to a bus, written to from the thread
+     * rendering the bus and read by the track after all buses are rendered */
+    class BusEventPipe : public RtEventPipe
+    {
+    public:
+        void send_event(const RtEvent& event) override;
+
+        RtEventFifo<KEYBOARD_EVENT_QUEUE_SIZE> kb_events;
+        RtEventFifo<KEYBOARD_EVENT_QUEUE_SIZE> output_events;
+    };
 
     std::vector<Processor*> _processors;
+    std::vector<AsyncProcessorHost*> _async_hosts;
+    std::vector<std::pair<ObjectId, int>> _processor_buses;
+    std::vector<BusEventPipe> _bus_event_pipes;
+    std::vector<PlanStep> _plan;
+    int _plan_output_source{0};
+    int _plan_output_channels{0};
+    std::array<int, MAX_TRACK_BUSES> _bus_output_sources{};
+    bool _independent_buses{false};
+    performance::TimePoint _bus_render_start;
+    /* Output of the processors rendered by freeze(), one buffer per chunk */
+    std::vector<ChunkSampleBuffer> _frozen_audio;
+    /* Chunk of the frozen audio played this chunk, and the transport position it was played at */
+    int _frozen_position{0};
+    double _frozen_beats{FROZEN_NOT_PLAYING};
+    RenderAheadHost* _render_ahead_host{nullptr};
     ChunkSampleBuffer _input_buffer;
     ChunkSampleBuffer _output_buffer;
+    /* Input read in place this chunk, empty if the input is in _input_buffer */
+    ChunkSampleBuffer _external_input;
+    std::array<OutputGain, MAX_TRACK_CHANNELS> _output_gains;
+    bool _deferred_gain{false};
+    /* One ring of _compensation_delay samples per output channel, one after the other */
+    std::vector<float> _delay_line;
+    int _compensation_delay{0};
+    int _delay_position{0};
 
     int _buses;
     PanMode _pan_mode;
     TrackType _type;
+    std::atomic<int> _assigned_core{UNASSIGNED_CORE};
+    std::atomic<int> _priority{DEFAULT_TRACK_PRIORITY};
+    bool _shed{false};
+    bool _stalled{false};
+    std::atomic<const Processor*> _current_processor{nullptr};
+    /* Gain at the end of the last rendered chunk, 0 once the track has faded out when shed */
+    float _shed_gain{1.0f};
+    std::atomic<Track*> _output_group{nullptr};
 
     BoolParameterValue*                               _mute_parameter;
     std::array<FloatParameterValue*, MAX_TRACK_BUSES> _gain_parameters;
@@ -0,0 +1,262 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Load based distribution of tracks over the cpu cores used for audio processing,
+ *        and of long processor chains over pipeline stages
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <numeric>
+
+#include "track_balancer.h"
+
+namespace sushi {
+namespace engine {
+
+/* How much of the distance between the average and the worst case timings to add to the
+ * estimated load of a track */
+constexpr float PEAK_LOAD_WEIGHT = 0.25f;
+/* Don't balance unless the most and least loaded cores differ by at least this much */
+constexpr float IMBALANCE_THRESHOLD = 0.1f;
+/* Only move a track if it lowers the load of the most loaded core by at least this much */
+constexpr float MIN_IMPROVEMENT = 0.02f;
+constexpr int   MAX_MOVES_PER_UPDATE = 4;
+/* Number of updates to skip after tracks have been moved */
+constexpr int   COOLDOWN_UPDATES = 3;
+/* In elastic mode, activate another core when the average load of the active cores exceeds
+ * this, and deactivate one when the load would stay below the lower limit without it */
+constexpr float CORE_ACTIVATION_LOAD = 0.7f;
+constexpr float CORE_DEACTIVATION_LOAD = 0.5f;
+
+float TrackBalancer::track_load(const performance::ProcessTimings& timings)
+{
+    return timings.avg_case + PEAK_LOAD_WEIGHT * std::max(0.0f, timings.max_case - timings.avg_case);
+}
+
+std::vector<int> TrackBalancer::split_chain(const std::vector<float>& loads, int stages)
+{
+    int processors = static_cast<int>(loads.size());
+    stages = std::min(stages, processors);
+    if (stages <= 0)
+    {
+        return {};
+    }
+
+    std::vector<float> cumulative_load(processors + 1, 0.0f);
+    for (int i = 0; i < processors; ++i)
+    {
+        cumulative_load[i + 1] = cumulative_load[i] + loads[i];
+    }
+
+    /* max_load[s][p] is the lowest possible load of the most loaded stage when splitting
+     * the first p processors into s stages, and split[s][p] where the last of them starts */
+    constexpr float NO_SPLIT = std::numeric_limits<float>::max();
+    std::vector<std::vector<float>> max_load(stages + 1, std::vector<float>(processors + 1, NO_SPLIT));
+    std::vector<std::vector<int>> split(stages + 1, std::vector<int>(processors + 1, 0));
+    max_load[0][0] = 0.0f;
+    for (int s = 1; s <= stages; ++s)
+    {
+        for (int p = s; p <= processors; ++p)
+        {
+            for (int start = s - 1; start < p; ++start)
+            {
+                if (max_load[s - 1][start] == NO_SPLIT)
+                {
+                    continue;
+                }
+                float load = std::max(max_load[s - 1][start], cumulative_load[p] - cumulative_load[start]);
+                if (load < max_load[s][p])
+                {
+                    max_load[s][p] = load;
+                    split[s][p] = start;
+                }
+            }
+        }
+    }
+
+    std::vector<int> stage_lengths(stages);
+    int end = processors;
+    for (int s = stages; s > 0; --s)
+    {
+        stage_lengths[s - 1] = end - split[s][end];
+        end = split[s][end];
+    }
+    return stage_lengths;
+}
+
+float TrackBalancer::max_stage_load(const std::vector<float>& loads, const std::vector<int>& stage_lengths)
+{
+    float max_load = 0.0f;
+    auto processor = loads.begin();
+    for (auto length : stage_lengths)
+    {
+        auto stage_end = processor + std::min(length, static_cast<int>(std::distance(processor, loads.end())));
+        max_load = std::max(max_load, std::accumulate(processor, stage_end, 0.0f));
+        processor = stage_end;
+    }
+    return max_load;
+}
+
+bool TrackBalancer::pin_track(ObjectId track, std::optional<int> core)
+{
+    std::scoped_lock lock(_pinned_lock);
+    if (core.has_value() == false)
+    {
+        _pinned_tracks.erase(track);
+        return true;
+    }
+    if (core.value() < 0 || core.value() >= _cores)
+    {
+        return false;
+    }
+    _pinned_tracks[track] = core.value();
+    return true;
+}
+
+std::optional<int> TrackBalancer::pinned_core(ObjectId track) const
+{
+    std::scoped_lock lock(_pinned_lock);
+    auto pinned = _pinned_tracks.find(track);
+    if (pinned != _pinned_tracks.end())
+    {
+        return pinned->second;
+    }
+    return std::nullopt;
+}
+
+std::vector<TrackMove> TrackBalancer::rebalance(const std::vector<TrackLoad>& tracks)
+{
+    std::vector<TrackMove> moves;
+    std::vector<TrackLoad> assignment;
+    std::vector<bool> movable;
+    std::vector<float> core_loads(_cores, 0.0f);
+
+    for (const auto& track : tracks)
+    {
+        auto pinned = pinned_core(track.track);
+        auto& current = assignment.emplace_back(track);
+        if (pinned.has_value() && pinned.value() != track.core)
+        {
+            current.core = pinned.value();
+            moves.push_back({track.track, current.core});
+        }
+        movable.push_back(pinned.has_value() == false);
+        if (current.core >= 0 && current.core < _cores)
+        {
+            core_loads[current.core] += current.load;
+        }
+    }
+
+    // More cores are activated at once when overloaded, cooldown or not
+    float total_load = std::accumulate(core_loads.begin(), core_loads.end(), 0.0f);
+    bool overloaded = _elastic && _active_cores < _cores && total_load > _active_cores * CORE_ACTIVATION_LOAD;
+    if (_cooldown > 0 && overloaded == false)
+    {
+        _cooldown--;
+        return moves;
+    }
+
+    int balancing_moves = 0;
+    if (_elastic)
+    {
+        _update_active_cores(total_load);
+        // Move all tracks off inactive cores, not limited by MAX_MOVES_PER_UPDATE as these cores should become idle
+        for (int i = 0; i < static_cast<int>(assignment.size()); ++i)
+        {
+            auto& track = assignment[i];
+            if (track.core >= _active_cores && track.core < _cores && movable[i])
+            {
+                auto to_core = std::min_element(core_loads.begin(), core_loads.begin() + _active_cores);
+                core_loads[track.core] -= track.load;
+                *to_core += track.load;
+                track.core = static_cast<int>(std::distance(core_loads.begin(), to_core));
+                moves.push_back({track.track, track.core});
+                balancing_moves++;
+            }
+        }
+    }
+
+    int active_cores = _active_cores;
+    while (balancing_moves < MAX_MOVES_PER_UPDATE)
+    {
+        auto [min_load, max_load] = std::minmax_element(core_loads.begin(), core_loads.begin() + active_cores);
+        if (*max_load - *min_load < IMBALANCE_THRESHOLD)
+        {
+            break;
+        }
+        int from_core = static_cast<int>(std::distance(core_loads.begin(), max_load));
+        int to_core = static_cast<int>(std::distance(core_loads.begin(), min_load));
+
+        // Find the track that results in the lowest load on the two cores when moved
+        int best_track = -1;
+        float best_load = *max_load - MIN_IMPROVEMENT;
+        for (int i = 0; i < static_cast<int>(assignment.size()); ++i)
+        {
+            const auto& track = assignment[i];
+            if (track.core == from_core && movable[i])
+            {
+                float new_load = std::max(*max_load - track.load, *min_load + track.load);
+                if (new_load < best_load)
+                {
+                    best_load = new_load;
+                    best_track = i;
+                }
+            }
+        }
+        if (best_track < 0)
+        {
+            break;
+        }
+
+        auto& track = assignment[best_track];
+        core_loads[from_core] -= track.load;
+        core_loads[to_core] += track.load;
+        track.core = to_core;
+        moves.push_back({track.track, to_core});
+        balancing_moves++;
+    }
+
+    if (balancing_moves > 0)
+    {
+        _cooldown = COOLDOWN_UPDATES;
+    }
+    return moves;
+}
+
+void TrackBalancer::set_elastic(bool enabled)
+{
+    _elastic = enabled;
+    _active_cores = _cores;
+}
+
+void TrackBalancer::_update_active_cores(float total_load)
+{
+    if (total_load > _active_cores * CORE_ACTIVATION_LOAD)
+    {
+        int needed = static_cast<int>(std::ceil(total_load / CORE_ACTIVATION_LOAD));
+        _active_cores = std::clamp(needed, 1, _cores);
+    }
+    else if (_active_cores > 1 && total_load < (_active_cores - 1) * CORE_DEACTIVATION_LOAD)
+    {
+        _active_cores--;
+    }
+}
+
+} // namespace engine
+} // namespace sushi
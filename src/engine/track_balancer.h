@@ -0,0 +1,152 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Load based distribution of tracks over the cpu cores used for audio processing,
+ *        and of long processor chains over pipeline stages
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_TRACK_BALANCER_H
+#define SUSHI_TRACK_BALANCER_H
+
+#include <vector>
+#include <unordered_map>
+#include <optional>
+#include <mutex>
+
+#include "library/id_generator.h"
+#include "library/base_performance_timer.h"
+
+namespace sushi {
+namespace engine {
+
+struct TrackLoad
+{
+    ObjectId track;
+    int      core;
+    float    load;
+};
+
+struct TrackMove
+{
+    ObjectId track;
+    int      core;
+};
+
+/**
+ * @brief Calculates which tracks to move between cores in order to keep the load of the
+ *        most loaded core as low as possible. Tracks are only moved when the difference
+ *        between cores is significant, and after a move, no further balancing is done
+ *        for a few updates, to give the timings time to settle.
+ *        In elastic mode, tracks are only balanced over as many cores as the total load
+ *        requires, tracks on the remaining cores are moved away from them so that their
+ *        workers are not woken up.
+ *        Not used from the rt thread.
+ */
+class TrackBalancer
+{
+public:
+    explicit TrackBalancer(int cores) : _cores(cores), _active_cores(cores) {}
+
+    /**
+     * @brief Calculate the load of a track, in fractions of the audio chunk period,
+     *        from its performance timings. Weighs in the worst case a bit, so that
+     *        tracks with occasional spikes are not underestimated.
+     * @param timings The recorded timings for the track
+     * @return The estimated load
+     */
+    static float track_load(const performance::ProcessTimings& timings);
+
+    /**
+     * @brief Split a chain of processors into stages of consecutive processors, so that
+     *        the load of the most loaded stage is as low as possible.
+     * @param loads The estimated load of each processor in the chain, in processing order
+     * @param stages The number of stages to split the chain into, limited to the number
+     *               of processors
+     * @return The number of processors in each stage, in processing order
+     */
+    static std::vector<int> split_chain(const std::vector<float>& loads, int stages);
+
+    /**
+     * @brief Calculate the load of the most loaded stage of a chain split into stages
+     * @param loads The estimated load of each processor in the chain, in processing order
+     * @param stage_lengths The number of processors in each stage, in processing order
+     * @return The load of the most loaded stage
+     */
+    static float max_stage_load(const std::vector<float>& loads, const std::vector<int>& stage_lengths);
+
+    /**
+     * @brief Pin a track to a cpu core, or remove a previous pinning
+     * @param track The id of the track
+     * @param core The core to pin the track to, or no value to let the track be moved freely
+     * @return true if successful, false if the core is out of range
+     */
+    bool pin_track(ObjectId track, std::optional<int> core);
+
+    /**
+     * @brief Return the core a track is pinned to
+     * @param track The id of the track
+     * @return The core if the track is pinned, otherwise no value
+     */
+    std::optional<int> pinned_core(ObjectId track) const;
+
+    /**
+     * @brief Calculate which tracks should be moved to other cores. Pinned tracks that are not
+     *        on their core are always moved.
+     * @param tracks The current core and load of all tracks in the audio graph
+     * @return A list of the tracks to move and the core to move them to.
+     */
+    std::vector<TrackMove> rebalance(const std::vector<TrackLoad>& tracks);
+
+    /**
+     * @brief Enable or disable elastic mode, where the number of cores used is adapted
+     *        to the total load of the tracks. When disabled, all cores are used.
+     * @param enabled If true, enable elastic mode
+     */
+    void set_elastic(bool enabled);
+
+    /**
+     * @brief Return the number of cores tracks are currently balanced over, the first
+     *        active_cores() cores are used. Pinned tracks are always kept on their core.
+     * @return The number of active cores
+     */
+    int active_cores() const
+    {
+        return _active_cores;
+    }
+
+private:
+    /**
+     * @brief Update the number of active cores from the total load of all tracks. Cores
+     *        are activated as soon as the load requires it, but only deactivated once the
+     *        load would fit comfortably on fewer cores.
+     * @param total_load The sum of the loads of all tracks
+     */
+    void _update_active_cores(float total_load);
+
+    int _cores;
+    int _active_cores;
+    bool _elastic{false};
+    int _cooldown{0};
+
+    mutable std::mutex _pinned_lock;
+    std::unordered_map<ObjectId, int> _pinned_tracks;
+};
+
+} // namespace engine
+} // namespace sushi
+
+#endif //SUSHI_TRACK_BALANCER_H
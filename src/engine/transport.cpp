@@ -142,6 +142,59 @@ void Transport::set_time(Time timestamp, int64_t samples)
     }
 }
 
+TransportSnapshot Transport::snapshot() const
+{
+    TransportSnapshot snapshot;
+    snapshot.sample_count = _sample_count;
+    snapshot.time = _time;
+    snapshot.latency = _latency;
+    snapshot.samplerate = _samplerate;
+    snapshot.current_bar_beat_count = _current_bar_beat_count;
+    snapshot.beat_count = _beat_count;
+    snapshot.bar_start_beat_count = _bar_start_beat_count;
+    snapshot.beats_per_chunk = _beats_per_chunk;
+    snapshot.beats_per_bar = _beats_per_bar;
+    snapshot.tempo = _tempo;
+    snapshot.playmode = _playmode;
+    snapshot.syncmode = _syncmode;
+    snapshot.time_signature = _time_signature;
+    snapshot.state_change = _state_change;
+    return snapshot;
+}
+
+void Transport::set_ahead_of(const TransportSnapshot& source, int64_t samples)
+{
+    _samplerate = source.samplerate;
+    _latency = source.latency;
+    _time = source.time + std::chrono::microseconds(static_cast<int64_t>(samples * 1'000'000.0 / _samplerate));
+    _sample_count = source.sample_count + samples;
+    _state_change = source.state_change;
+    _playmode = source.playmode;
+    _set_playmode = _playmode;
+    _syncmode = source.syncmode;
+    _tempo = source.tempo;
+    _set_tempo = _tempo;
+    _time_signature = source.time_signature;
+    _beats_per_bar = source.beats_per_bar;
+    _beats_per_chunk = source.beats_per_chunk;
+    _beat_count = source.beat_count;
+    _current_bar_beat_count = source.current_bar_beat_count;
+    _bar_start_beat_count = source.bar_start_beat_count;
+
+    if (_playmode != PlayingMode::STOPPED)
+    {
+        double beats = _beats_per_chunk * static_cast<double>(samples) / AUDIO_CHUNK_SIZE;
+        _beat_count += beats;
+        _current_bar_beat_count += beats;
+        if (_current_bar_beat_count > _beats_per_bar)
+        {
+            double bars = std::floor(_current_bar_beat_count / _beats_per_bar);
+            _current_bar_beat_count -= bars * _beats_per_bar;
+            _bar_start_beat_count += bars * _beats_per_bar;
+        }
+    }
+}
+
 void Transport::process_event(const RtEvent& event)
 {
     switch (event.type())
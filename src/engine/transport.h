@@ -53,6 +53,28 @@ class SushiLink;
 
 constexpr float DEFAULT_TEMPO = 120;
 
+/**
+ * @brief The state of a Transport at one point in time, copied out of the audio thread
+ *        so that it can be rendered against in another thread
+ */
+struct TransportSnapshot
+{
+    int64_t         sample_count{0};
+    Time            time{0};
+    Time            latency{0};
+    float           samplerate{0};
+    double          current_bar_beat_count{0.0};
+    double          beat_count{0.0};
+    double          bar_start_beat_count{0.0};
+    double          beats_per_chunk{0.0};
+    double          beats_per_bar{0.0};
+    float           tempo{DEFAULT_TEMPO};
+    PlayingMode     playmode{PlayingMode::STOPPED};
+    SyncMode        syncmode{SyncMode::INTERNAL};
+    TimeSignature   time_signature{4, 4};
+    PlayStateChange state_change{PlayStateChange::STARTING};
+};
+
 class Transport
 {
 public:
@@ -66,6 +88,23 @@ public:
      */
     void set_time(Time timestamp, int64_t samples);
 
+    /**
+     * @brief Copy the current state of the transport. Called from the audio thread, after
+     *        set_time(), to hand the state over to another thread.
+     * @return The state of the transport
+     */
+    TransportSnapshot snapshot() const;
+
+    /**
+     * @brief Set the state of this transport to that of a snapshot of another transport a
+     *        number of samples later, as it will be if its tempo and playing mode don't
+     *        change meanwhile. Used to render ahead of the time the audio is played. No
+     *        events are sent.
+     * @param source The snapshot to copy the state from
+     * @param samples The number of samples ahead of source
+     */
+    void set_ahead_of(const TransportSnapshot& source, int64_t samples);
+
     /**
      * @brief Set the output latency, i.e. the time it takes for the audio to travel through
      *        the driver stack to a physical output, including any DAC latency. Should be
@@ -205,6 +244,14 @@ public:
      */
     double current_bar_start_beats() const {return _bar_start_beat_count;}
 
+    /**
+     * @brief Query how far, in beats (quarter notes), the transport moves in one chunk at the
+     *        current tempo. Safe to call from rt and non-rt context but will only return
+     *        approximate values if called from a non-rt context
+     * @return A double representing the length of a chunk in quarter notes
+     */
+    double current_beats_per_chunk() const {return _beats_per_chunk;}
+
     /**
      * @brief Query any playing state changes occuring during the current processing chunk.
      *        For instance, if Transport is starting, during the first chunk, Transport
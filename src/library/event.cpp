@@ -148,6 +148,12 @@ Event* Event::from_rt_event(const RtEvent& rt_event, Time timestamp)
                                                             ClippingNotificationEvent::ClipChannelType::OUTPUT;
             return new ClippingNotificationEvent(typed_ev->channel(), channel_type, timestamp);
         }
+        case RtEventType::CORE_STALL_NOTIFICATION:
+        {
+            auto typed_ev = rt_event.core_stall_notification_event();
+            return new CoreStallNotificationEvent(typed_ev->core(), typed_ev->track(), typed_ev->processor_id(),
+                                                  typed_ev->stalled(), timestamp);
+        }
         case RtEventType::DELETE:
         {
             auto typed_ev = rt_event.delete_data_event();
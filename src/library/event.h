@@ -504,6 +504,12 @@ public:
     /* Convertible to TimingTickNotification */
     virtual bool is_timing_tick_notification() const {return false;}
 
+    /* Convertible to CoreStallNotification */
+    virtual bool is_core_stall_notification() const {return false;}
+
+    /* Convertible to CpuBudgetNotification */
+    virtual bool is_cpu_budget_notification() const {return false;}
+
 protected:
     EngineNotificationEvent(Time timestamp) : Event(timestamp) {}
 };
@@ -616,14 +622,70 @@ class EngineTimingNotificationEvent : public EngineNotificationEvent
 {
 public:
     EngineTimingNotificationEvent(const performance::ProcessTimings& timings,
+                                  int shed_tracks,
                                   Time timestamp) : EngineNotificationEvent(timestamp),
-                                                    _timings(timings){}
+                                                    _timings(timings),
+                                                    _shed_tracks(shed_tracks) {}
 
     bool is_timing_notification() const override {return true;}
     const performance::ProcessTimings& timings() const {return _timings;}
+    int shed_tracks() const {return _shed_tracks;}
 
 private:
     performance::ProcessTimings _timings;
+    int _shed_tracks;
+};
+
+class CoreStallNotificationEvent : public EngineNotificationEvent
+{
+public:
+    CoreStallNotificationEvent(int core,
+                               ObjectId track,
+                               ObjectId processor,
+                               bool stalled,
+                               Time timestamp) : EngineNotificationEvent(timestamp),
+                                                 _core(core),
+                                                 _track(track),
+                                                 _processor(processor),
+                                                 _stalled(stalled) {}
+
+    bool is_core_stall_notification() const override {return true;}
+    int core() const {return _core;}
+    ObjectId track() const {return _track;}
+    ObjectId processor() const {return _processor;}
+    bool stalled() const {return _stalled;}
+
+private:
+    int      _core;
+    ObjectId _track;
+    ObjectId _processor;
+    bool     _stalled;
+};
+
+class CpuBudgetNotificationEvent : public EngineNotificationEvent
+{
+public:
+    CpuBudgetNotificationEvent(ObjectId processor,
+                               ObjectId track,
+                               const LoadPrediction& prediction,
+                               bool rejected,
+                               Time timestamp) : EngineNotificationEvent(timestamp),
+                                                 _processor(processor),
+                                                 _track(track),
+                                                 _prediction(prediction),
+                                                 _rejected(rejected) {}
+
+    bool is_cpu_budget_notification() const override {return true;}
+    ObjectId processor() const {return _processor;}
+    ObjectId track() const {return _track;}
+    const LoadPrediction& prediction() const {return _prediction;}
+    bool rejected() const {return _rejected;}
+
+private:
+    ObjectId       _processor;
+    ObjectId       _track;
+    LoadPrediction _prediction;
+    bool           _rejected;
 };
 
 class EngineTimingTickNotificationEvent : public EngineNotificationEvent
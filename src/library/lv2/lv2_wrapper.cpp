@@ -716,7 +716,7 @@ void LV2_Wrapper::_deliver_outputs_from_plugin(bool /*send_ui_updates*/)
                         if (_model->plugin_latency() != current_port->control_value())
                         {
                             _model->set_plugin_latency(current_port->control_value());
-                            // TODO: Introduce latency compensation reporting to Sushi
+                            set_latency(_model->plugin_latency());
                         }
                     }
                     else
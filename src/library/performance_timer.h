@@ -109,6 +109,21 @@ public:
         }
     }
 
+    /**
+     * @brief Return the time elapsed since a timing section was entered, as a fraction of
+     *        the timing period, without recording it. Safe to call from the rt thread.
+     * @param start_time A timestamp from a previous call to start_timer()
+     * @return The elapsed time relative to the timing period, 0 if timings are disabled
+     */
+    float elapsed_load(TimePoint start_time) const
+    {
+        if (_enabled && _period > 0)
+        {
+            return static_cast<float>((twine::current_rt_time() - start_time).count()) / _period;
+        }
+        return 0.0f;
+    }
+
     /**
      * @brief Enable or disable timings
      * @param enabled Enable timings if true, disable if false
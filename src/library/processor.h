@@ -22,6 +22,8 @@
 #ifndef SUSHI_PROCESSOR_H
 #define SUSHI_PROCESSOR_H
 
+#include <algorithm>
+#include <atomic>
 #include <map>
 #include <unordered_map>
 #include <vector>
@@ -78,6 +80,10 @@ struct PluginInfo
 class Processor
 {
 public:
+    /* Tail length of processors that can produce audio without audio input, or whose
+     * tail is not known */
+    static constexpr int TAIL_UNKNOWN = -1;
+
     explicit Processor(HostControl host_control) : _host_control(host_control) {}
 
     virtual ~Processor();
@@ -152,6 +158,16 @@ public:
         _output_pipe = pipe;
     }
 
+    /**
+     * @brief Set the transport the processor reads tempo and position from, in place of
+     *        the engine's. Must not be called while the processor is processing.
+     * @param transport The transport to use
+     */
+    void set_transport(engine::Transport* transport)
+    {
+        _host_control.set_transport(transport);
+    }
+
     /**
      * @brief Get the number of parameters of this processor.
      * @return The number of registered parameters for this processor.
@@ -386,6 +402,80 @@ public:
         return _on_track;
     }
 
+    /**
+     * @brief Return the processor, if any, that this processor sends audio to outside of
+     *        its track's processing chain. Used by the audio graph to render tracks in an
+     *        order where audio sent between tracks arrives within the same audio chunk.
+     *        Safe to call from the rt thread.
+     * @return A pointer to the destination processor, nullptr if there is none.
+     */
+    virtual const Processor* send_destination() const
+    {
+        return nullptr;
+    }
+
+    /**
+     * @brief Return a counter that is incremented whenever audio passed between tracks may
+     *        have been rerouted, i.e. when the send destination of a processor, the processors
+     *        on a track or the group of a track change. Lets the audio graph skip collecting
+     *        the dependencies between tracks when nothing has changed. Safe to call from any
+     *        thread.
+     * @return The current value of the counter
+     */
+    static unsigned int routing_version()
+    {
+        return _routing_version.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Return for how long the processor can keep producing audio after its audio
+     *        input has become silent, i.e. the length of a delay or the decay of a filter.
+     *        Once the input has been silent for longer than this, and no keyboard events
+     *        are sent to the processor, its track may skip processing it until there is
+     *        audio or keyboard input again.
+     * @return The tail length in samples, or TAIL_UNKNOWN, the default, if the processor
+     *         should always be processed.
+     */
+    virtual int tail_length() const
+    {
+        return _tail_length;
+    }
+
+    /**
+     * @brief Return the latency of the processor's audio output, i.e. the delay of a
+     *        look-ahead limiter. The engine delays the output of other tracks so that they
+     *        are heard in sync. Safe to call from any thread.
+     * @return The latency in samples, 0 by default
+     */
+    int latency() const
+    {
+        return _latency.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Called from the rt thread by the processor's track before processing a chunk,
+     *        to keep track of for how long the processor's audio input has been silent.
+     * @param silent_input True if the audio input of the chunk is silent
+     * @param keyboard_events True if keyboard events are passed to the processor in the chunk
+     * @return true if the processor is idle, i.e. its tail has elapsed and it would only
+     *         output silence, so processing the chunk can be skipped.
+     */
+    bool update_idle_state(bool silent_input, bool keyboard_events)
+    {
+        int tail = tail_length();
+        if (silent_input == false || keyboard_events || tail == TAIL_UNKNOWN)
+        {
+            _silent_input_samples = 0;
+            return false;
+        }
+        if (_silent_input_samples >= tail)
+        {
+            return true;
+        }
+        _silent_input_samples += AUDIO_CHUNK_SIZE;
+        return false;
+    }
+
     /**
      * @brief  Set the complete state of the Processor (bypass state, program, parameters)
      *         according to the supplied state object.
@@ -438,6 +528,26 @@ protected:
      */
     void output_midi_event_as_internal(MidiDataByte midi_data, int sample_offset);
 
+    /**
+     * @brief Report the latency of the processor's audio output, as returned by latency().
+     *        Safe to call from any thread, including the rt thread. Changes are picked up
+     *        by the engine periodically.
+     * @param samples The latency in samples
+     */
+    void set_latency(int samples)
+    {
+        _latency.store(std::max(samples, 0), std::memory_order_relaxed);
+    }
+
+    /**
+     * @brief Signal that audio passed between tracks may have been rerouted, see
+     *        routing_version(). Safe to call from any thread, including the rt thread.
+     */
+    static void notify_routing_changed()
+    {
+        _routing_version.fetch_add(1, std::memory_order_release);
+    }
+
     void output_event(const RtEvent& event)
     {
         if (_output_pipe)
@@ -511,10 +621,15 @@ protected:
     bool _bypassed{false};
     bool _on_track{false};
 
+    int _tail_length{TAIL_UNKNOWN};
+
     HostControl _host_control;
 
 private:
     RtEventPipe* _output_pipe{nullptr};
+    int _silent_input_samples{0};
+    std::atomic<int> _latency{0};
+    inline static std::atomic<unsigned int> _routing_version{0};
     /* Automatically generated unique id for identifying this processor */
     ObjectId _id{ProcessorIdGenerator::new_id()};
 
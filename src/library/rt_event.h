@@ -22,6 +22,7 @@
 #define SUSHI_RT_EVENTS_H
 
 #include <string>
+#include <vector>
 #include <cassert>
 #include <optional>
 
@@ -81,6 +82,12 @@ enum class RtEventType
     REMOVE_PROCESSOR_FROM_TRACK,
     ADD_TRACK,
     REMOVE_TRACK,
+    MOVE_TRACK,
+    SET_ASYNC_PROCESSING,
+    SET_TRACK_PIPELINE,
+    SET_PROCESSOR_BUS,
+    GRAPH_TRANSACTION,
+    SWAP_STORAGE,
     ASYNC_WORK,
     ASYNC_WORK_NOTIFICATION,
     /* Routing events */
@@ -97,6 +104,7 @@ enum class RtEventType
     TIMING_TICK,
     /* Engine notification events */
     CLIP_NOTIFICATION,
+    CORE_STALL_NOTIFICATION,
 };
 
 class BaseRtEvent
@@ -425,6 +433,8 @@ protected:
 
 class Processor;
 
+namespace engine {class AsyncProcessorHost; class StorageSwap;}
+
 class ProcessorOperationRtEvent : public ReturnableRtEvent
 {
 public:
@@ -457,6 +467,110 @@ private:
     std::optional<ObjectId> _before_processor;
 };
 
+class MoveTrackRtEvent : public ReturnableRtEvent
+{
+public:
+    MoveTrackRtEvent(ObjectId track, int core) : ReturnableRtEvent(RtEventType::MOVE_TRACK, 0),
+                                                 _track{track},
+                                                 _core{core} {}
+
+    ObjectId track() const {return _track;}
+    int core() const {return _core;}
+
+private:
+    ObjectId _track;
+    int _core;
+};
+
+/* Attaches a host to a processor on a track, in order to process it asynchronously.
+ * A null host returns the processor to normal, synchronous processing */
+class AsyncProcessingRtEvent : public ReturnableRtEvent
+{
+public:
+    AsyncProcessingRtEvent(ObjectId processor,
+                           ObjectId track,
+                           engine::AsyncProcessorHost* host) : ReturnableRtEvent(RtEventType::SET_ASYNC_PROCESSING, processor),
+                                                               _track{track},
+                                                               _host{host} {}
+
+    ObjectId track() const {return _track;}
+    engine::AsyncProcessorHost* host() const {return _host;}
+
+private:
+    ObjectId _track;
+    engine::AsyncProcessorHost* _host;
+};
+
+class ProcessorBusRtEvent : public ReturnableRtEvent
+{
+public:
+    ProcessorBusRtEvent(ObjectId processor,
+                        ObjectId track,
+                        std::optional<int> bus) : ReturnableRtEvent(RtEventType::SET_PROCESSOR_BUS, 0),
+                                                  _processor{processor},
+                                                  _track{track},
+                                                  _bus{bus.value_or(NO_BUS)} {}
+
+    ObjectId processor() const {return _processor;}
+    ObjectId track() const {return _track;}
+    std::optional<int> bus() const {return _bus == NO_BUS ? std::nullopt : std::optional<int>(_bus);}
+
+private:
+    static constexpr int NO_BUS = -1;
+    ObjectId _processor;
+    ObjectId _track;
+    int _bus;
+};
+
+class TrackPipelineRtEvent : public ReturnableRtEvent
+{
+public:
+    TrackPipelineRtEvent(ObjectId track,
+                         const std::vector<engine::AsyncProcessorHost*>* stages) : ReturnableRtEvent(RtEventType::SET_TRACK_PIPELINE, 0),
+                                                                                  _track{track},
+                                                                                  _stages{stages} {}
+
+    ObjectId track() const {return _track;}
+    const std::vector<engine::AsyncProcessorHost*>* stages() const {return _stages;}
+
+private:
+    ObjectId _track;
+    const std::vector<engine::AsyncProcessorHost*>* _stages;
+};
+
+/* Carries a batch of graph editing events to be applied in the same chunk. If one of them
+ * fails, the ones already applied are reverted with the undo event at the same index */
+class GraphTransactionRtEvent : public ReturnableRtEvent
+{
+public:
+    GraphTransactionRtEvent(const std::vector<RtEvent>* events,
+                            const std::vector<RtEvent>* undo_events) : ReturnableRtEvent(RtEventType::GRAPH_TRANSACTION, 0),
+                                                                       _events{events},
+                                                                       _undo_events{undo_events} {}
+
+    const std::vector<RtEvent>* events() const {return _events;}
+    const std::vector<RtEvent>* undo_events() const {return _undo_events;}
+
+private:
+    const std::vector<RtEvent>* _events;
+    const std::vector<RtEvent>* _undo_events;
+};
+
+/* Carries a set of containers, allocated outside the rt thread, to swap in place of the
+ * ones currently used by the rt thread. The previous containers are freed by the sender
+ * when the event is returned */
+class StorageSwapRtEvent : public ReturnableRtEvent
+{
+public:
+    explicit StorageSwapRtEvent(engine::StorageSwap* swap) : ReturnableRtEvent(RtEventType::SWAP_STORAGE, 0),
+                                                            _swap{swap} {}
+
+    engine::StorageSwap* swap() const {return _swap;}
+
+private:
+    engine::StorageSwap* _swap;
+};
+
 typedef int (*AsyncWorkCallback)(void* data, EventId id);
 
 class AsyncWorkRtEvent: public ReturnableRtEvent
@@ -634,6 +748,28 @@ private:
     ClipChannelType _channel_type;
 };
 
+/* RtEvent for notifying the engine that the worker of a cpu core has hung, or recovered.
+ * processor_id is the processor it hung in, or the track if not inside a processor */
+class CoreStallNotificationRtEvent : public BaseRtEvent
+{
+public:
+    CoreStallNotificationRtEvent(int core, ObjectId track, ObjectId processor, bool stalled) : BaseRtEvent(RtEventType::CORE_STALL_NOTIFICATION,
+                                                                                                           processor,
+                                                                                                           0),
+                                                                                               _core(core),
+                                                                                               _track(track),
+                                                                                               _stalled(stalled) {}
+
+    int core() const {return _core;}
+    ObjectId track() const {return _track;}
+    bool stalled() const {return _stalled;}
+
+private:
+    int      _core;
+    ObjectId _track;
+    bool     _stalled;
+};
+
 /**
  * @brief Class for passing deletable data out from the rt domain
  */
@@ -785,6 +921,78 @@ public:
         return &_processor_reorder_event;
     }
 
+    const MoveTrackRtEvent* move_track_event() const
+    {
+        assert(_move_track_event.type() == RtEventType::MOVE_TRACK);
+        return &_move_track_event;
+    }
+
+    MoveTrackRtEvent* move_track_event()
+    {
+        assert(_move_track_event.type() == RtEventType::MOVE_TRACK);
+        return &_move_track_event;
+    }
+
+    const AsyncProcessingRtEvent* async_processing_event() const
+    {
+        assert(_async_processing_event.type() == RtEventType::SET_ASYNC_PROCESSING);
+        return &_async_processing_event;
+    }
+
+    AsyncProcessingRtEvent* async_processing_event()
+    {
+        assert(_async_processing_event.type() == RtEventType::SET_ASYNC_PROCESSING);
+        return &_async_processing_event;
+    }
+
+    const ProcessorBusRtEvent* processor_bus_event() const
+    {
+        assert(_processor_bus_event.type() == RtEventType::SET_PROCESSOR_BUS);
+        return &_processor_bus_event;
+    }
+
+    ProcessorBusRtEvent* processor_bus_event()
+    {
+        assert(_processor_bus_event.type() == RtEventType::SET_PROCESSOR_BUS);
+        return &_processor_bus_event;
+    }
+
+    const TrackPipelineRtEvent* track_pipeline_event() const
+    {
+        assert(_track_pipeline_event.type() == RtEventType::SET_TRACK_PIPELINE);
+        return &_track_pipeline_event;
+    }
+
+    TrackPipelineRtEvent* track_pipeline_event()
+    {
+        assert(_track_pipeline_event.type() == RtEventType::SET_TRACK_PIPELINE);
+        return &_track_pipeline_event;
+    }
+
+    const GraphTransactionRtEvent* graph_transaction_event() const
+    {
+        assert(_graph_transaction_event.type() == RtEventType::GRAPH_TRANSACTION);
+        return &_graph_transaction_event;
+    }
+
+    GraphTransactionRtEvent* graph_transaction_event()
+    {
+        assert(_graph_transaction_event.type() == RtEventType::GRAPH_TRANSACTION);
+        return &_graph_transaction_event;
+    }
+
+    const StorageSwapRtEvent* storage_swap_event() const
+    {
+        assert(_storage_swap_event.type() == RtEventType::SWAP_STORAGE);
+        return &_storage_swap_event;
+    }
+
+    StorageSwapRtEvent* storage_swap_event()
+    {
+        assert(_storage_swap_event.type() == RtEventType::SWAP_STORAGE);
+        return &_storage_swap_event;
+    }
+
     const AsyncWorkRtEvent* async_work_event() const
     {
         assert(_async_work_event.type() == RtEventType::ASYNC_WORK);
@@ -879,6 +1087,12 @@ public:
         return &_clip_notification_event;
     }
 
+    const CoreStallNotificationRtEvent* core_stall_notification_event() const
+    {
+        assert(_core_stall_notification_event.type() == RtEventType::CORE_STALL_NOTIFICATION);
+        return &_core_stall_notification_event;
+    }
+
     const DeleteDataRtEvent* delete_data_event() const
     {
         assert(_delete_data_event.type() == RtEventType::DELETE);
@@ -1021,6 +1235,42 @@ public:
         return RtEvent(typed_event);
     }
 
+    static RtEvent make_move_track_event(ObjectId track, int core)
+    {
+        MoveTrackRtEvent typed_event(track, core);
+        return RtEvent(typed_event);
+    }
+
+    static RtEvent make_async_processing_event(ObjectId processor, ObjectId track, engine::AsyncProcessorHost* host)
+    {
+        AsyncProcessingRtEvent typed_event(processor, track, host);
+        return RtEvent(typed_event);
+    }
+
+    static RtEvent make_processor_bus_event(ObjectId processor, ObjectId track, std::optional<int> bus)
+    {
+        ProcessorBusRtEvent typed_event(processor, track, bus);
+        return RtEvent(typed_event);
+    }
+
+    static RtEvent make_track_pipeline_event(ObjectId track, const std::vector<engine::AsyncProcessorHost*>* stages)
+    {
+        TrackPipelineRtEvent typed_event(track, stages);
+        return RtEvent(typed_event);
+    }
+
+    static RtEvent make_graph_transaction_event(const std::vector<RtEvent>* events, const std::vector<RtEvent>* undo_events)
+    {
+        GraphTransactionRtEvent typed_event(events, undo_events);
+        return RtEvent(typed_event);
+    }
+
+    static RtEvent make_storage_swap_event(engine::StorageSwap* swap)
+    {
+        StorageSwapRtEvent typed_event(swap);
+        return RtEvent(typed_event);
+    }
+
     static RtEvent make_async_work_event(AsyncWorkCallback callback, ObjectId processor, void* data)
     {
         AsyncWorkRtEvent typed_event(callback, processor, data);
@@ -1153,6 +1403,12 @@ public:
         return typed_event;
     }
 
+    static RtEvent make_core_stall_notification_event(int core, ObjectId track, ObjectId processor, bool stalled)
+    {
+        CoreStallNotificationRtEvent typed_event(core, track, processor, stalled);
+        return typed_event;
+    }
+
     static RtEvent make_delete_data_event(RtDeletable* data)
     {
         DeleteDataRtEvent typed_event(data);
@@ -1175,6 +1431,12 @@ private:
     RtEvent(const ReturnableRtEvent& e)                 : _returnable_event(e) {}
     RtEvent(const ProcessorOperationRtEvent& e)         : _processor_operation_event(e) {}
     RtEvent(const ProcessorReorderRtEvent& e)           : _processor_reorder_event(e) {}
+    RtEvent(const MoveTrackRtEvent& e)                  : _move_track_event(e) {}
+    RtEvent(const AsyncProcessingRtEvent& e)            : _async_processing_event(e) {}
+    RtEvent(const TrackPipelineRtEvent& e)              : _track_pipeline_event(e) {}
+    RtEvent(const ProcessorBusRtEvent& e)               : _processor_bus_event(e) {}
+    RtEvent(const GraphTransactionRtEvent& e)           : _graph_transaction_event(e) {}
+    RtEvent(const StorageSwapRtEvent& e)                : _storage_swap_event(e) {}
     RtEvent(const AsyncWorkRtEvent& e)                  : _async_work_event(e) {}
     RtEvent(const AsyncWorkRtCompletionEvent& e)        : _async_work_completion_event(e) {}
     RtEvent(const AudioConnectionRtEvent& e)            : _audio_connection_event(e) {}
@@ -1187,6 +1449,7 @@ private:
     RtEvent(const PlayingModeRtEvent& e)                : _playing_mode_event(e) {}
     RtEvent(const SyncModeRtEvent& e)                   : _sync_mode_event(e) {}
     RtEvent(const ClipNotificationRtEvent& e)           : _clip_notification_event(e) {}
+    RtEvent(const CoreStallNotificationRtEvent& e)      : _core_stall_notification_event(e) {}
     RtEvent(const DeleteDataRtEvent& e)                 : _delete_data_event(e) {}
     RtEvent(const TimingTickRtEvent& e)                 : _timing_tick_event(e) {}
     /* Data storage */
@@ -1207,6 +1470,12 @@ private:
         ReturnableRtEvent             _returnable_event;
         ProcessorOperationRtEvent     _processor_operation_event;
         ProcessorReorderRtEvent       _processor_reorder_event;
+        MoveTrackRtEvent              _move_track_event;
+        AsyncProcessingRtEvent        _async_processing_event;
+        TrackPipelineRtEvent          _track_pipeline_event;
+        ProcessorBusRtEvent           _processor_bus_event;
+        GraphTransactionRtEvent       _graph_transaction_event;
+        StorageSwapRtEvent            _storage_swap_event;
         AsyncWorkRtEvent              _async_work_event;
         AsyncWorkRtCompletionEvent    _async_work_completion_event;
         AudioConnectionRtEvent        _audio_connection_event;
@@ -1219,6 +1488,7 @@ private:
         PlayingModeRtEvent            _playing_mode_event;
         SyncModeRtEvent               _sync_mode_event;
         ClipNotificationRtEvent       _clip_notification_event;
+        CoreStallNotificationRtEvent  _core_stall_notification_event;
         DeleteDataRtEvent             _delete_data_event;
         TimingTickRtEvent             _timing_tick_event;
     };
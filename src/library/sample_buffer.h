@@ -26,11 +26,14 @@
 #include <cmath>
 
 #include "constants.h"
+#include "sample_buffer_kernels.h"
 
 namespace sushi {
 
 constexpr int LEFT_CHANNEL_INDEX = 0;
 constexpr int RIGHT_CHANNEL_INDEX = 1;
+/* Samples below this level, about -120 dB, are considered silent */
+constexpr float SILENCE_THRESHOLD = 1.0e-6f;
 
 template<int size>
 class SampleBuffer;
@@ -324,10 +327,7 @@ public:
      */
     void apply_gain(float gain)
     {
-        for (int i = 0; i < size * _channel_count; ++i)
-        {
-            _buffer[i] *= gain;
-        }
+        simd::active_kernels->apply_gain(_buffer, gain, size * _channel_count);
     }
 
     /**
@@ -335,11 +335,7 @@ public:
     */
     void apply_gain(float gain, int channel)
     {
-        float* data = _buffer + size * channel;
-        for (int i = 0; i < size; ++i)
-        {
-            data[i] *= gain;
-        }
+        simd::active_kernels->apply_gain(_buffer + size * channel, gain, size);
     }
 
     /**
@@ -388,18 +384,11 @@ public:
         {
             for (int channel = 0; channel < _channel_count; ++channel)
             {
-                float* dest = _buffer + size * channel;
-                for (int i = 0; i < size; ++i)
-                {
-                    dest[i] += source._buffer[i];
-                }
+                simd::active_kernels->add(_buffer + size * channel, source._buffer, size);
             }
         } else if (source.channel_count() == _channel_count)
         {
-            for (int i = 0; i < size * _channel_count; ++i)
-            {
-                _buffer[i] += source._buffer[i];
-            }
+            simd::active_kernels->add(_buffer, source._buffer, size * _channel_count);
         }
     }
 
@@ -409,12 +398,7 @@ public:
      */
     void add(int dest_channel, int source_channel, const SampleBuffer& source)
     {
-        float* source_data = source._buffer + size * source_channel;
-        float* dest_data = _buffer + size * dest_channel;
-        for (int i = 0; i < size; ++i)
-        {
-            dest_data[i] += source_data[i];
-        }
+        simd::active_kernels->add(_buffer + size * dest_channel, source._buffer + size * source_channel, size);
     }
 
     /**
@@ -431,18 +415,11 @@ public:
         {
             for (int channel = 0; channel < _channel_count; ++channel)
             {
-                float* dest = _buffer + size * channel;
-                for (int i = 0; i < size; ++i)
-                {
-                    dest[i] += source._buffer[i] * gain;
-                }
+                simd::active_kernels->add_with_gain(_buffer + size * channel, source._buffer, gain, size);
             }
         } else if (source.channel_count() == _channel_count)
         {
-            for (int i = 0; i < size * _channel_count; ++i)
-            {
-                _buffer[i] += source._buffer[i] * gain;
-            }
+            simd::active_kernels->add_with_gain(_buffer, source._buffer, gain, size * _channel_count);
         }
     }
 
@@ -451,12 +428,7 @@ public:
      */
     void add_with_gain(int dest_channel, int source_channel, const SampleBuffer& source, float gain)
     {
-        float* source_data = source._buffer + size * source_channel;
-        float* dest_data = _buffer + size * dest_channel;
-        for (int i = 0; i < size; ++i)
-        {
-            dest_data[i] += source_data[i] * gain;
-        }
+        simd::active_kernels->add_with_gain(_buffer + size * dest_channel, source._buffer + size * source_channel, gain, size);
     }
 
     /**
@@ -477,22 +449,13 @@ public:
         {
             for (int channel = 0; channel < _channel_count; ++channel)
             {
-                float* dest = _buffer + size * channel;
-                for (int i = 0; i < size; ++i)
-                {
-                    dest[i] += source._buffer[i] * (start + i * inc);
-                }
+                simd::active_kernels->add_with_ramp(_buffer + size * channel, source._buffer, start, inc, size);
             }
         } else if (source.channel_count() == _channel_count)
         {
             for (int channel = 0; channel < _channel_count; ++channel)
             {
-                float* source_data = _buffer + size * channel;
-                float* dest_data = _buffer + size * channel;
-                for (int i = 0; i < size; ++i)
-                {
-                    dest_data[i] += source_data[i] * (start + i * inc);
-                }
+                simd::active_kernels->add_with_ramp(_buffer + size * channel, source._buffer + size * channel, start, inc, size);
             }
         }
     }
@@ -504,12 +467,25 @@ public:
     void add_with_ramp(int dest_channel, int source_channel, const SampleBuffer& source, float start, float end)
     {
         float inc = (end - start) / (size - 1);
-        float* source_data = source._buffer + size * source_channel;
-        float* dest_data = _buffer + size * dest_channel;
-        for (int i = 0; i < size; ++i)
-        {
-            dest_data[i] += source_data[i] * (start + i * inc);
-        }
+        simd::active_kernels->add_with_ramp(_buffer + size * dest_channel, source._buffer + size * source_channel, start, inc, size);
+    }
+
+    /**
+     * @brief Copy one channel of source buffer into one channel of the buffer after applying gain.
+     */
+    void replace_with_gain(int dest_channel, int source_channel, const SampleBuffer& source, float gain)
+    {
+        simd::active_kernels->replace_with_gain(_buffer + size * dest_channel, source._buffer + size * source_channel, gain, size);
+    }
+
+    /**
+    * @brief Copy one channel of source buffer into one channel of the buffer after applying
+    *        a linear gain ramp.
+    */
+    void replace_with_ramp(int dest_channel, int source_channel, const SampleBuffer& source, float start, float end)
+    {
+        float inc = (end - start) / (size - 1);
+        simd::active_kernels->replace_with_ramp(_buffer + size * dest_channel, source._buffer + size * source_channel, start, inc, size);
     }
 
     /**
@@ -522,11 +498,7 @@ public:
         float inc = (end - start) / (size - 1);
         for (int channel = 0; channel < _channel_count; ++channel)
         {
-            float* data = _buffer + size * channel;
-            for (int i = 0; i < size; ++i)
-            {
-                data[i] *= start + i * inc;
-            }
+            simd::active_kernels->ramp(_buffer + size * channel, start, inc, size);
         }
     }
 
@@ -582,6 +554,24 @@ public:
         return max;
     }
 
+    /**
+     * @brief Check if all channels of the buffer are silent
+     * @return true if the absolute value of all samples is below SILENCE_THRESHOLD
+     */
+    bool is_silent() const
+    {
+        // Returns at the first sample above the threshold, so audible audio is rarely read in full
+        int samples = size * _channel_count;
+        for (int i = 0 ; i < samples; ++i)
+        {
+            if (std::abs(_buffer[i]) >= SILENCE_THRESHOLD)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
     /**
      * @brief Calculate the root-mean-square average for one channel
      * @param channel The channel to analyse, must not exceed the buffer's channelcount
@@ -0,0 +1,569 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Vectorised kernels for the arithmetic of SampleBuffer, with an implementation
+ *        for every instruction set the compiler supports and the fastest one the cpu
+ *        supports selected at startup.
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#include <initializer_list>
+
+#include "sample_buffer_kernels.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SUSHI_SIMD_X86
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_NEON)
+#define SUSHI_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
+namespace sushi {
+namespace simd {
+
+/* The x86 kernels are compiled for their instruction set with target attributes, so that
+ * the rest of the code doesn't need to be built for a particular cpu. Every kernel runs
+ * the vectorised loop over whole vectors and leaves the remaining samples to the kernel
+ * of the next narrower instruction set. Ramps are calculated as start + index * inc, like the scalar kernels,
+ * rather than accumulated, so that they don't drift over long arrays. The file is built
+ * without floating point contraction, as fused multiply-adds would round differently */
+
+namespace scalar {
+
+void apply_gain(float* data, float gain, int samples)
+{
+    for (int i = 0; i < samples; ++i)
+    {
+        data[i] *= gain;
+    }
+}
+
+void ramp(float* data, float start, float inc, int samples)
+{
+    for (int i = 0; i < samples; ++i)
+    {
+        data[i] *= start + i * inc;
+    }
+}
+
+void add(float* dest, const float* source, int samples)
+{
+    for (int i = 0; i < samples; ++i)
+    {
+        dest[i] += source[i];
+    }
+}
+
+void add_with_gain(float* dest, const float* source, float gain, int samples)
+{
+    for (int i = 0; i < samples; ++i)
+    {
+        dest[i] += source[i] * gain;
+    }
+}
+
+void add_with_ramp(float* dest, const float* source, float start, float inc, int samples)
+{
+    for (int i = 0; i < samples; ++i)
+    {
+        dest[i] += source[i] * (start + i * inc);
+    }
+}
+
+void replace_with_gain(float* dest, const float* source, float gain, int samples)
+{
+    for (int i = 0; i < samples; ++i)
+    {
+        dest[i] = source[i] * gain;
+    }
+}
+
+void replace_with_ramp(float* dest, const float* source, float start, float inc, int samples)
+{
+    for (int i = 0; i < samples; ++i)
+    {
+        dest[i] = source[i] * (start + i * inc);
+    }
+}
+
+constexpr SampleKernels KERNELS = {apply_gain, ramp, add, add_with_gain, add_with_ramp, replace_with_gain, replace_with_ramp};
+
+} // namespace scalar
+
+#ifdef SUSHI_SIMD_X86
+namespace sse {
+
+constexpr int WIDTH = 4;
+
+__attribute__((target("sse"))) inline __m128 ramp_gain(int i, __m128 start, __m128 inc)
+{
+    __m128 index = _mm_add_ps(_mm_set1_ps(static_cast<float>(i)), _mm_set_ps(3.0f, 2.0f, 1.0f, 0.0f));
+    return _mm_add_ps(start, _mm_mul_ps(index, inc));
+}
+
+__attribute__((target("sse"))) void apply_gain(float* data, float gain, int samples)
+{
+    __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), g));
+    }
+    scalar::apply_gain(data + i, gain, samples - i);
+}
+
+__attribute__((target("sse"))) void ramp(float* data, float start, float inc, int samples)
+{
+    __m128 s = _mm_set1_ps(start);
+    __m128 d = _mm_set1_ps(inc);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        _mm_storeu_ps(data + i, _mm_mul_ps(_mm_loadu_ps(data + i), ramp_gain(i, s, d)));
+    }
+    scalar::ramp(data + i, start + i * inc, inc, samples - i);
+}
+
+__attribute__((target("sse"))) void add(float* dest, const float* source, int samples)
+{
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), _mm_loadu_ps(source + i)));
+    }
+    scalar::add(dest + i, source + i, samples - i);
+}
+
+__attribute__((target("sse"))) void add_with_gain(float* dest, const float* source, float gain, int samples)
+{
+    __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        __m128 s = _mm_mul_ps(_mm_loadu_ps(source + i), g);
+        _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), s));
+    }
+    scalar::add_with_gain(dest + i, source + i, gain, samples - i);
+}
+
+__attribute__((target("sse"))) void add_with_ramp(float* dest, const float* source, float start, float inc, int samples)
+{
+    __m128 s = _mm_set1_ps(start);
+    __m128 d = _mm_set1_ps(inc);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        __m128 r = _mm_mul_ps(_mm_loadu_ps(source + i), ramp_gain(i, s, d));
+        _mm_storeu_ps(dest + i, _mm_add_ps(_mm_loadu_ps(dest + i), r));
+    }
+    scalar::add_with_ramp(dest + i, source + i, start + i * inc, inc, samples - i);
+}
+
+__attribute__((target("sse"))) void replace_with_gain(float* dest, const float* source, float gain, int samples)
+{
+    __m128 g = _mm_set1_ps(gain);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_loadu_ps(source + i), g));
+    }
+    scalar::replace_with_gain(dest + i, source + i, gain, samples - i);
+}
+
+__attribute__((target("sse"))) void replace_with_ramp(float* dest, const float* source, float start, float inc, int samples)
+{
+    __m128 s = _mm_set1_ps(start);
+    __m128 d = _mm_set1_ps(inc);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        _mm_storeu_ps(dest + i, _mm_mul_ps(_mm_loadu_ps(source + i), ramp_gain(i, s, d)));
+    }
+    scalar::replace_with_ramp(dest + i, source + i, start + i * inc, inc, samples - i);
+}
+
+constexpr SampleKernels KERNELS = {apply_gain, ramp, add, add_with_gain, add_with_ramp, replace_with_gain, replace_with_ramp};
+
+} // namespace sse
+
+namespace avx2 {
+
+constexpr int WIDTH = 8;
+
+__attribute__((target("avx2"))) inline __m256 ramp_gain(int i, __m256 start, __m256 inc)
+{
+    __m256 index = _mm256_add_ps(_mm256_set1_ps(static_cast<float>(i)),
+                                 _mm256_set_ps(7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f));
+    return _mm256_add_ps(start, _mm256_mul_ps(index, inc));
+}
+
+__attribute__((target("avx2"))) void apply_gain(float* data, float gain, int samples)
+{
+    __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        _mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_loadu_ps(data + i), g));
+    }
+    sse::apply_gain(data + i, gain, samples - i);
+}
+
+__attribute__((target("avx2"))) void ramp(float* data, float start, float inc, int samples)
+{
+    __m256 s = _mm256_set1_ps(start);
+    __m256 d = _mm256_set1_ps(inc);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        _mm256_storeu_ps(data + i, _mm256_mul_ps(_mm256_loadu_ps(data + i), ramp_gain(i, s, d)));
+    }
+    sse::ramp(data + i, start + i * inc, inc, samples - i);
+}
+
+__attribute__((target("avx2"))) void add(float* dest, const float* source, int samples)
+{
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        _mm256_storeu_ps(dest + i, _mm256_add_ps(_mm256_loadu_ps(dest + i), _mm256_loadu_ps(source + i)));
+    }
+    sse::add(dest + i, source + i, samples - i);
+}
+
+__attribute__((target("avx2"))) void add_with_gain(float* dest, const float* source, float gain, int samples)
+{
+    __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        __m256 s = _mm256_mul_ps(_mm256_loadu_ps(source + i), g);
+        _mm256_storeu_ps(dest + i, _mm256_add_ps(_mm256_loadu_ps(dest + i), s));
+    }
+    sse::add_with_gain(dest + i, source + i, gain, samples - i);
+}
+
+__attribute__((target("avx2"))) void add_with_ramp(float* dest, const float* source, float start, float inc, int samples)
+{
+    __m256 s = _mm256_set1_ps(start);
+    __m256 d = _mm256_set1_ps(inc);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        __m256 r = _mm256_mul_ps(_mm256_loadu_ps(source + i), ramp_gain(i, s, d));
+        _mm256_storeu_ps(dest + i, _mm256_add_ps(_mm256_loadu_ps(dest + i), r));
+    }
+    sse::add_with_ramp(dest + i, source + i, start + i * inc, inc, samples - i);
+}
+
+__attribute__((target("avx2"))) void replace_with_gain(float* dest, const float* source, float gain, int samples)
+{
+    __m256 g = _mm256_set1_ps(gain);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        _mm256_storeu_ps(dest + i, _mm256_mul_ps(_mm256_loadu_ps(source + i), g));
+    }
+    sse::replace_with_gain(dest + i, source + i, gain, samples - i);
+}
+
+__attribute__((target("avx2"))) void replace_with_ramp(float* dest, const float* source, float start, float inc, int samples)
+{
+    __m256 s = _mm256_set1_ps(start);
+    __m256 d = _mm256_set1_ps(inc);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        _mm256_storeu_ps(dest + i, _mm256_mul_ps(_mm256_loadu_ps(source + i), ramp_gain(i, s, d)));
+    }
+    sse::replace_with_ramp(dest + i, source + i, start + i * inc, inc, samples - i);
+}
+
+constexpr SampleKernels KERNELS = {apply_gain, ramp, add, add_with_gain, add_with_ramp, replace_with_gain, replace_with_ramp};
+
+} // namespace avx2
+
+namespace avx512 {
+
+constexpr int WIDTH = 16;
+
+__attribute__((target("avx512f"))) inline __m512 ramp_gain(int i, __m512 start, __m512 inc)
+{
+    __m512 index = _mm512_add_ps(_mm512_set1_ps(static_cast<float>(i)),
+                                 _mm512_set_ps(15.0f, 14.0f, 13.0f, 12.0f, 11.0f, 10.0f, 9.0f, 8.0f,
+                                               7.0f, 6.0f, 5.0f, 4.0f, 3.0f, 2.0f, 1.0f, 0.0f));
+    return _mm512_add_ps(start, _mm512_mul_ps(index, inc));
+}
+
+__attribute__((target("avx512f"))) void apply_gain(float* data, float gain, int samples)
+{
+    __m512 g = _mm512_set1_ps(gain);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        _mm512_storeu_ps(data + i, _mm512_mul_ps(_mm512_loadu_ps(data + i), g));
+    }
+    avx2::apply_gain(data + i, gain, samples - i);
+}
+
+__attribute__((target("avx512f"))) void ramp(float* data, float start, float inc, int samples)
+{
+    __m512 s = _mm512_set1_ps(start);
+    __m512 d = _mm512_set1_ps(inc);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        _mm512_storeu_ps(data + i, _mm512_mul_ps(_mm512_loadu_ps(data + i), ramp_gain(i, s, d)));
+    }
+    avx2::ramp(data + i, start + i * inc, inc, samples - i);
+}
+
+__attribute__((target("avx512f"))) void add(float* dest, const float* source, int samples)
+{
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        _mm512_storeu_ps(dest + i, _mm512_add_ps(_mm512_loadu_ps(dest + i), _mm512_loadu_ps(source + i)));
+    }
+    avx2::add(dest + i, source + i, samples - i);
+}
+
+__attribute__((target("avx512f"))) void add_with_gain(float* dest, const float* source, float gain, int samples)
+{
+    __m512 g = _mm512_set1_ps(gain);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        __m512 s = _mm512_mul_ps(_mm512_loadu_ps(source + i), g);
+        _mm512_storeu_ps(dest + i, _mm512_add_ps(_mm512_loadu_ps(dest + i), s));
+    }
+    avx2::add_with_gain(dest + i, source + i, gain, samples - i);
+}
+
+__attribute__((target("avx512f"))) void add_with_ramp(float* dest, const float* source, float start, float inc, int samples)
+{
+    __m512 s = _mm512_set1_ps(start);
+    __m512 d = _mm512_set1_ps(inc);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        __m512 r = _mm512_mul_ps(_mm512_loadu_ps(source + i), ramp_gain(i, s, d));
+        _mm512_storeu_ps(dest + i, _mm512_add_ps(_mm512_loadu_ps(dest + i), r));
+    }
+    avx2::add_with_ramp(dest + i, source + i, start + i * inc, inc, samples - i);
+}
+
+__attribute__((target("avx512f"))) void replace_with_gain(float* dest, const float* source, float gain, int samples)
+{
+    __m512 g = _mm512_set1_ps(gain);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        _mm512_storeu_ps(dest + i, _mm512_mul_ps(_mm512_loadu_ps(source + i), g));
+    }
+    avx2::replace_with_gain(dest + i, source + i, gain, samples - i);
+}
+
+__attribute__((target("avx512f"))) void replace_with_ramp(float* dest, const float* source, float start, float inc, int samples)
+{
+    __m512 s = _mm512_set1_ps(start);
+    __m512 d = _mm512_set1_ps(inc);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        _mm512_storeu_ps(dest + i, _mm512_mul_ps(_mm512_loadu_ps(source + i), ramp_gain(i, s, d)));
+    }
+    avx2::replace_with_ramp(dest + i, source + i, start + i * inc, inc, samples - i);
+}
+
+constexpr SampleKernels KERNELS = {apply_gain, ramp, add, add_with_gain, add_with_ramp, replace_with_gain, replace_with_ramp};
+
+} // namespace avx512
+#endif // SUSHI_SIMD_X86
+
+#ifdef SUSHI_SIMD_NEON
+namespace neon {
+
+constexpr int WIDTH = 4;
+
+inline float32x4_t ramp_gain(int i, float32x4_t start, float32x4_t inc)
+{
+    static const float lanes[WIDTH] = {0.0f, 1.0f, 2.0f, 3.0f};
+    float32x4_t index = vaddq_f32(vdupq_n_f32(static_cast<float>(i)), vld1q_f32(lanes));
+    return vaddq_f32(start, vmulq_f32(index, inc));
+}
+
+void apply_gain(float* data, float gain, int samples)
+{
+    float32x4_t g = vdupq_n_f32(gain);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        vst1q_f32(data + i, vmulq_f32(vld1q_f32(data + i), g));
+    }
+    scalar::apply_gain(data + i, gain, samples - i);
+}
+
+void ramp(float* data, float start, float inc, int samples)
+{
+    float32x4_t s = vdupq_n_f32(start);
+    float32x4_t d = vdupq_n_f32(inc);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        vst1q_f32(data + i, vmulq_f32(vld1q_f32(data + i), ramp_gain(i, s, d)));
+    }
+    scalar::ramp(data + i, start + i * inc, inc, samples - i);
+}
+
+void add(float* dest, const float* source, int samples)
+{
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        vst1q_f32(dest + i, vaddq_f32(vld1q_f32(dest + i), vld1q_f32(source + i)));
+    }
+    scalar::add(dest + i, source + i, samples - i);
+}
+
+void add_with_gain(float* dest, const float* source, float gain, int samples)
+{
+    float32x4_t g = vdupq_n_f32(gain);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        vst1q_f32(dest + i, vaddq_f32(vld1q_f32(dest + i), vmulq_f32(vld1q_f32(source + i), g)));
+    }
+    scalar::add_with_gain(dest + i, source + i, gain, samples - i);
+}
+
+void add_with_ramp(float* dest, const float* source, float start, float inc, int samples)
+{
+    float32x4_t s = vdupq_n_f32(start);
+    float32x4_t d = vdupq_n_f32(inc);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        float32x4_t r = vmulq_f32(vld1q_f32(source + i), ramp_gain(i, s, d));
+        vst1q_f32(dest + i, vaddq_f32(vld1q_f32(dest + i), r));
+    }
+    scalar::add_with_ramp(dest + i, source + i, start + i * inc, inc, samples - i);
+}
+
+void replace_with_gain(float* dest, const float* source, float gain, int samples)
+{
+    float32x4_t g = vdupq_n_f32(gain);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        vst1q_f32(dest + i, vmulq_f32(vld1q_f32(source + i), g));
+    }
+    scalar::replace_with_gain(dest + i, source + i, gain, samples - i);
+}
+
+void replace_with_ramp(float* dest, const float* source, float start, float inc, int samples)
+{
+    float32x4_t s = vdupq_n_f32(start);
+    float32x4_t d = vdupq_n_f32(inc);
+    int i = 0;
+    for (; i + WIDTH <= samples; i += WIDTH)
+    {
+        vst1q_f32(dest + i, vmulq_f32(vld1q_f32(source + i), ramp_gain(i, s, d)));
+    }
+    scalar::replace_with_ramp(dest + i, source + i, start + i * inc, inc, samples - i);
+}
+
+constexpr SampleKernels KERNELS = {apply_gain, ramp, add, add_with_gain, add_with_ramp, replace_with_gain, replace_with_ramp};
+
+} // namespace neon
+#endif // SUSHI_SIMD_NEON
+
+const SampleKernels* kernels(SimdLevel level)
+{
+    switch (level)
+    {
+        case SimdLevel::SCALAR:
+            return &scalar::KERNELS;
+
+#ifdef SUSHI_SIMD_X86
+        case SimdLevel::SSE:
+            return __builtin_cpu_supports("sse") ? &sse::KERNELS : nullptr;
+
+        case SimdLevel::AVX2:
+            return __builtin_cpu_supports("avx2") ? &avx2::KERNELS : nullptr;
+
+        case SimdLevel::AVX512:
+            return __builtin_cpu_supports("avx512f") ? &avx512::KERNELS : nullptr;
+#endif
+
+#ifdef SUSHI_SIMD_NEON
+        // Only built when the compiler targets NEON, in which case the cpu has it
+        case SimdLevel::NEON:
+            return &neon::KERNELS;
+#endif
+
+        default:
+            return nullptr;
+    }
+}
+
+/* Constant initialised, so that it is valid before the kernels are selected below */
+const SampleKernels* active_kernels = &scalar::KERNELS;
+
+namespace {
+
+SimdLevel select_kernels()
+{
+#ifdef SUSHI_SIMD_X86
+    // The cpu features may not have been detected yet when called from a static initialiser
+    __builtin_cpu_init();
+#endif
+    for (auto level : {SimdLevel::AVX512, SimdLevel::AVX2, SimdLevel::SSE, SimdLevel::NEON})
+    {
+        if (auto selected = kernels(level); selected)
+        {
+            active_kernels = selected;
+            return level;
+        }
+    }
+    return SimdLevel::SCALAR;
+}
+
+const SimdLevel selected_level = select_kernels();
+
+} // namespace
+
+SimdLevel active_level()
+{
+    return selected_level;
+}
+
+const char* to_string(SimdLevel level)
+{
+    switch (level)
+    {
+        case SimdLevel::SSE:    return "SSE";
+        case SimdLevel::AVX2:   return "AVX2";
+        case SimdLevel::AVX512: return "AVX-512";
+        case SimdLevel::NEON:   return "NEON";
+        default:                return "scalar";
+    }
+}
+
+} // namespace simd
+} // namespace sushi
@@ -0,0 +1,82 @@
+/*
+ * Copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk
+ *
+ * SUSHI is free software: you can redistribute it and/or modify it under the terms of
+ * the GNU Affero General Public License as published by the Free Software Foundation,
+ * either version 3 of the License, or (at your option) any later version.
+ *
+ * SUSHI is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ * without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ * PURPOSE.  See the GNU Affero General Public License for more details.
+ *
+ * You should have received a copy of the GNU Affero General Public License along with
+ * SUSHI.  If not, see http://www.gnu.org/licenses/
+ */
+
+/**
+ * @brief Vectorised kernels for the arithmetic of SampleBuffer, with an implementation
+ *        for every instruction set the compiler supports and the fastest one the cpu
+ *        supports selected at startup.
+ * @copyright 2017-2023 Modern Ancient Instruments Networked AB, dba Elk, Stockholm
+ */
+
+#ifndef SUSHI_SAMPLE_BUFFER_KERNELS_H
+#define SUSHI_SAMPLE_BUFFER_KERNELS_H
+
+namespace sushi {
+namespace simd {
+
+enum class SimdLevel
+{
+    SCALAR,
+    SSE,
+    AVX2,
+    AVX512,
+    NEON
+};
+
+/**
+ * @brief Operations on contiguous arrays of samples. Ramps go linearly from start,
+ *        increasing by inc for every sample. Arrays may be unaligned and of any length,
+ *        and source and dest may be the same array, but must not overlap otherwise.
+ */
+struct SampleKernels
+{
+    void (*apply_gain)(float* data, float gain, int samples);
+    void (*ramp)(float* data, float start, float inc, int samples);
+    void (*add)(float* dest, const float* source, int samples);
+    void (*add_with_gain)(float* dest, const float* source, float gain, int samples);
+    void (*add_with_ramp)(float* dest, const float* source, float start, float inc, int samples);
+    void (*replace_with_gain)(float* dest, const float* source, float gain, int samples);
+    void (*replace_with_ramp)(float* dest, const float* source, float start, float inc, int samples);
+};
+
+/* The kernels in use, set to the fastest kernels supported before main() is entered.
+ * Only the scalar kernels are used if called from other static initialisers before that */
+extern const SampleKernels* active_kernels;
+
+/**
+ * @brief Return the kernels for a given instruction set
+ * @param level The instruction set
+ * @return The kernels, or nullptr if either the compiler or the cpu doesn't support
+ *         the instruction set
+ */
+const SampleKernels* kernels(SimdLevel level);
+
+/**
+ * @brief Return the instruction set of the kernels in use
+ * @return The instruction set selected at startup
+ */
+SimdLevel active_level();
+
+/**
+ * @brief Return the name of an instruction set, for logging
+ * @param level The instruction set
+ * @return The name of the instruction set
+ */
+const char* to_string(SimdLevel level);
+
+} // namespace simd
+} // namespace sushi
+
+#endif //SUSHI_SAMPLE_BUFFER_KERNELS_H
@@ -24,6 +24,7 @@
 #include <array>
 #include <cstdint>
 #include <cstddef>
+#include <optional>
 
 namespace sushi {
 
@@ -62,6 +63,21 @@ inline bool operator!=(const TimeSignature& lhs, const TimeSignature& rhs)
     return ! (lhs == rhs);
 }
 
+/**
+ * @brief The predicted load of adding a plugin to a track, in fractions of the audio
+ *        chunk period. plugin_load is 0 if the cost of the plugin is not yet known.
+ */
+struct LoadPrediction
+{
+    int                  core;
+    float                current_load;
+    float                plugin_load;
+    bool                 plugin_known;
+    float                predicted_load;
+    std::optional<float> budget;
+    bool                 within_budget;
+};
+
 /**
  * @brief baseclass for objects that can returned from a realtime thread for destruction
  */
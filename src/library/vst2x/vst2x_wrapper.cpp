@@ -100,6 +100,7 @@ ProcessorReturnCode Vst2xWrapper::init(float sample_rate)
     _vst_dispatcher(effOpen, 0, 0, nullptr, 0);
     _vst_dispatcher(effSetSampleRate, 0, 0, nullptr, _sample_rate);
     _vst_dispatcher(effSetBlockSize, 0, AUDIO_CHUNK_SIZE, nullptr, 0);
+    set_latency(_plugin_handle->initialDelay);
 
     // Register internal parameters
     if (!_register_parameters())
@@ -150,6 +151,8 @@ void Vst2xWrapper::set_enabled(bool enabled)
     {
         _vst_dispatcher(effMainsChanged, 0, 1, nullptr, 0.0f);
         _vst_dispatcher(effStartProcess, 0, 0, nullptr, 0.0f);
+        // Plugins may only change their latency while suspended
+        set_latency(_plugin_handle->initialDelay);
     }
     else
     {
@@ -57,6 +57,10 @@ Steinberg::tresult ComponentHandler::performEdit(Steinberg::Vst::ParamID paramet
 Steinberg::tresult ComponentHandler::restartComponent(Steinberg::int32 flags)
 {
     SUSHI_LOG_DEBUG("restartComponent called");
+    if (flags & Steinberg::Vst::kLatencyChanged)
+    {
+        _wrapper_instance->set_latency(static_cast<int>(_wrapper_instance->_instance.processor()->getLatencySamples()));
+    }
     if (flags | (Steinberg::Vst::kParamValuesChanged & Steinberg::Vst::kReloadComponent))
     {
         _host_control->post_event(new AudioGraphNotificationEvent(AudioGraphNotificationEvent::Action::PROCESSOR_UPDATED,
@@ -195,6 +195,7 @@ ProcessorReturnCode Vst3xWrapper::init(float sample_rate)
     {
         return ProcessorReturnCode::PLUGIN_INIT_ERROR;
     }
+    set_latency(static_cast<int>(_instance.processor()->getLatencySamples()));
     if (!_register_parameters())
     {
         return ProcessorReturnCode::PARAMETER_ERROR;
@@ -364,6 +365,7 @@ void Vst3xWrapper::set_enabled(bool enabled)
     {
         _instance.component()->setActive(true);
         _instance.processor()->setProcessing(true);
+        set_latency(static_cast<int>(_instance.processor()->getLatencySamples()));
     }
     else
     {
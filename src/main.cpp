@@ -167,6 +167,14 @@ int main(int argc, char* argv[])
     bool connect_ports = false;
     bool debug_mode_switches = false;
     int  rt_cpu_cores = 1;
+    bool work_stealing = false;
+    bool elastic_cores = false;
+    bool overload_shedding = false;
+    float worker_watchdog = 0.0f;
+    int  worker_priority = sushi::engine::DEFAULT_WORKER_PRIORITY;
+    std::optional<float> cpu_budget;
+    bool cpu_budget_warn_only = false;
+    std::string plugin_cost_file;
     bool enable_timings = false;
     bool enable_flush_interval = false;
     bool enable_parameter_dump = false;
@@ -282,6 +290,38 @@ int main(int argc, char* argv[])
             rt_cpu_cores = atoi(opt.arg);
             break;
 
+        case OPT_IDX_WORK_STEALING:
+            work_stealing = true;
+            break;
+
+        case OPT_IDX_ELASTIC_CORES:
+            elastic_cores = true;
+            break;
+
+        case OPT_IDX_OVERLOAD_SHEDDING:
+            overload_shedding = true;
+            break;
+
+        case OPT_IDX_WORKER_WATCHDOG:
+            worker_watchdog = std::strtof(opt.arg, nullptr);
+            break;
+
+        case OPT_IDX_WORKER_PRIORITY:
+            worker_priority = atoi(opt.arg);
+            break;
+
+        case OPT_IDX_CPU_BUDGET:
+            cpu_budget = std::strtof(opt.arg, nullptr) / 100.0f;
+            break;
+
+        case OPT_IDX_CPU_BUDGET_WARN_ONLY:
+            cpu_budget_warn_only = true;
+            break;
+
+        case OPT_IDX_PLUGIN_COST_FILE:
+            plugin_cost_file = std::string(opt.arg);
+            break;
+
         case OPT_IDX_TIMINGS_STATISTICS:
             enable_timings = true;
             break;
@@ -367,11 +407,28 @@ int main(int argc, char* argv[])
     auto engine = std::make_unique<sushi::engine::AudioEngine>(SUSHI_SAMPLE_RATE_DEFAULT,
                                                                rt_cpu_cores,
                                                                debug_mode_switches,
-                                                               nullptr);
+                                                               nullptr,
+                                                               work_stealing ? sushi::engine::TrackScheduling::WORK_STEALING :
+                                                                               sushi::engine::TrackScheduling::STATIC,
+                                                               worker_priority);
+    SUSHI_LOG_INFO("Using {} sample buffer kernels", sushi::simd::to_string(sushi::simd::active_level()));
     if (! base_plugin_path.empty())
     {
         engine->set_base_plugin_path(base_plugin_path);
     }
+    if (worker_watchdog > 0.0f)
+    {
+        engine->set_worker_watchdog(worker_watchdog);
+    }
+    if (! plugin_cost_file.empty())
+    {
+        engine->set_plugin_cost_file(plugin_cost_file);
+    }
+    if (cpu_budget.has_value())
+    {
+        engine->set_cpu_budget(cpu_budget, cpu_budget_warn_only ? sushi::engine::CpuBudgetPolicy::WARN :
+                                                                  sushi::engine::CpuBudgetPolicy::REJECT);
+    }
     auto event_dispatcher = engine->event_dispatcher();
     auto midi_dispatcher = std::make_unique<sushi::midi_dispatcher::MidiDispatcher>(engine->event_dispatcher());
     auto configurator = std::make_unique<sushi::jsonconfig::JsonConfigurator>(engine.get(),
@@ -613,6 +670,14 @@ int main(int argc, char* argv[])
     {
         engine->performance_timer()->enable(true);
     }
+    if (elastic_cores)
+    {
+        engine->set_elastic_cores(true);
+    }
+    if (overload_shedding)
+    {
+        engine->set_overload_shedding(true);
+    }
 
     audio_frontend->run();
     event_dispatcher->run();
@@ -127,6 +127,14 @@ enum OptionIndex
     OPT_IDX_USE_XENOMAI_RASPA,
     OPT_IDX_XENOMAI_DEBUG_MODE_SW,
     OPT_IDX_MULTICORE_PROCESSING,
+    OPT_IDX_WORK_STEALING,
+    OPT_IDX_ELASTIC_CORES,
+    OPT_IDX_OVERLOAD_SHEDDING,
+    OPT_IDX_WORKER_WATCHDOG,
+    OPT_IDX_WORKER_PRIORITY,
+    OPT_IDX_CPU_BUDGET,
+    OPT_IDX_CPU_BUDGET_WARN_ONLY,
+    OPT_IDX_PLUGIN_COST_FILE,
     OPT_IDX_TIMINGS_STATISTICS,
     OPT_IDX_OSC_RECEIVE_PORT,
     OPT_IDX_OSC_SEND_PORT,
@@ -348,6 +356,70 @@ const optionparser::Descriptor usage[] =
         SushiArg::Numeric,
         "\t\t-m <n>, --multicore-processing=<n> \tProcess audio multithreaded with n cores [default n=1 (off)]."
     },
+    {
+        OPT_IDX_WORK_STEALING,
+        OPT_TYPE_DISABLED,
+        "",
+        "work-stealing",
+        SushiArg::Optional,
+        "\t\t--work-stealing \tLet idle cores render tracks assigned to other cores in multicore mode."
+    },
+    {
+        OPT_IDX_ELASTIC_CORES,
+        OPT_TYPE_DISABLED,
+        "",
+        "elastic-cores",
+        SushiArg::Optional,
+        "\t\t--elastic-cores \tIn multicore mode, only use as many cores as the processing load requires. Enables timings."
+    },
+    {
+        OPT_IDX_OVERLOAD_SHEDDING,
+        OPT_TYPE_DISABLED,
+        "",
+        "overload-shedding",
+        SushiArg::Optional,
+        "\t\t--overload-shedding \tStop rendering the tracks with the lowest priority while the processing load is too high. Enables timings."
+    },
+    {
+        OPT_IDX_WORKER_WATCHDOG,
+        OPT_TYPE_UNUSED,
+        "",
+        "worker-watchdog",
+        SushiArg::NonEmpty,
+        "\t\t--worker-watchdog=<periods> \tIn multicore mode, stop waiting for a core that hasn't finished rendering within this many audio periods and silence its tracks until it does."
+    },
+    {
+        OPT_IDX_WORKER_PRIORITY,
+        OPT_TYPE_UNUSED,
+        "",
+        "worker-priority",
+        SushiArg::Numeric,
+        "\t\t--worker-priority=<n> \tIn multicore mode, run the processing threads of all but the first core at rt priority n. The first core is always processed in the audio frontend's thread [default n=75]."
+    },
+    {
+        OPT_IDX_CPU_BUDGET,
+        OPT_TYPE_UNUSED,
+        "",
+        "cpu-budget",
+        SushiArg::NonEmpty,
+        "\t\t--cpu-budget=<percent> \tRefuse to add plugins to tracks if the predicted load of the most loaded core would exceed this percentage of the audio period. Enables timings."
+    },
+    {
+        OPT_IDX_CPU_BUDGET_WARN_ONLY,
+        OPT_TYPE_DISABLED,
+        "",
+        "cpu-budget-warn-only",
+        SushiArg::Optional,
+        "\t\t--cpu-budget-warn-only \tOnly log a warning when a plugin exceeds the cpu budget, instead of refusing it."
+    },
+    {
+        OPT_IDX_PLUGIN_COST_FILE,
+        OPT_TYPE_UNUSED,
+        "",
+        "plugin-cost-file",
+        SushiArg::NonEmpty,
+        "\t\t--plugin-cost-file=<filename> \tLoad the processing cost of plugins used for the cpu budget from this file, and save them to it."
+    },
     {
         OPT_IDX_TIMINGS_STATISTICS,
         OPT_TYPE_DISABLED,
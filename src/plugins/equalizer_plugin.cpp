@@ -27,6 +27,9 @@ namespace equalizer_plugin {
 
 constexpr auto PLUGIN_UID = "sushi.testing.equalizer";
 constexpr auto DEFAULT_LABEL = "Equalizer";
+/* Time for the impulse response of the lowest, most resonant filter setting to decay below
+ * the silence threshold */
+constexpr float TAIL_TIME = 2.5f;
 
 EqualizerPlugin::EqualizerPlugin(HostControl host_control) : InternalPlugin(host_control)
 {
@@ -57,6 +60,7 @@ EqualizerPlugin::EqualizerPlugin(HostControl host_control) : InternalPlugin(host
 ProcessorReturnCode EqualizerPlugin::init(float sample_rate)
 {
     _sample_rate = sample_rate;
+    _tail_length = static_cast<int>(sample_rate * TAIL_TIME);
     _reset_filters();
     return ProcessorReturnCode::OK;
 }
@@ -64,6 +68,7 @@ ProcessorReturnCode EqualizerPlugin::init(float sample_rate)
 void EqualizerPlugin::configure(float sample_rate)
 {
     _sample_rate = sample_rate;
+    _tail_length = static_cast<int>(sample_rate * TAIL_TIME);
     _reset_filters();
     return;
 }
@@ -32,6 +32,7 @@ GainPlugin::GainPlugin(HostControl host_control) : InternalPlugin(host_control)
 {
     Processor::set_name(PLUGIN_UID);
     Processor::set_label(DEFAULT_LABEL);
+    _tail_length = 0;
     _gain_parameter = register_float_parameter("gain", "Gain", "dB",
                                                0.0f, -120.0f, 24.0f,
                                                Direction::AUTOMATABLE,
@@ -30,6 +30,7 @@ MonoSummingPlugin::MonoSummingPlugin(HostControl host_control) : InternalPlugin(
 {
     Processor::set_name(PLUGIN_UID);
     Processor::set_label(DEFAULT_LABEL);
+    _tail_length = 0;
 }
 
 MonoSummingPlugin::~MonoSummingPlugin() = default;
@@ -30,6 +30,7 @@ PassthroughPlugin::PassthroughPlugin(HostControl host_control) : InternalPlugin(
 {
     Processor::set_name(PLUGIN_UID);
     Processor::set_label(DEFAULT_LABEL);
+    _tail_length = 0;
 }
 
 PassthroughPlugin::~PassthroughPlugin() = default;
@@ -51,7 +51,7 @@ void ReturnPlugin::send_audio(const ChunkSampleBuffer& buffer, int start_channel
 {
     std::scoped_lock<SpinLock> lock(_buffer_lock);
 
-    _maybe_swap_buffers(_host_control.transport()->current_process_time());
+    _discard_stale_audio(_host_control.transport()->current_process_time());
 
     int max_channels = std::max(0, std::min(buffer.channel_count(), _current_output_channels - start_channel));
 
@@ -66,7 +66,7 @@ void ReturnPlugin::send_audio_with_ramp(const ChunkSampleBuffer& buffer, int sta
 {
     std::scoped_lock<SpinLock> lock(_buffer_lock);
 
-    _maybe_swap_buffers(_host_control.transport()->current_process_time());
+    _discard_stale_audio(_host_control.transport()->current_process_time());
 
     int max_channels = std::max(0, std::min(buffer.channel_count(), _current_output_channels - start_channel));
 
@@ -143,8 +143,11 @@ void ReturnPlugin::process_event(const RtEvent& event)
 void ReturnPlugin::process_audio(const ChunkSampleBuffer& /*in_buffer*/, ChunkSampleBuffer& out_buffer)
 {
     {
+        /* Audio sent from tracks rendered before this one in the current chunk is output
+         * directly, audio sent after this point is output in the next chunk */
         std::scoped_lock<SpinLock> lock(_buffer_lock);
-        _maybe_swap_buffers(_host_control.transport()->current_process_time());
+        _swap_buffers();
+        _last_process_time.store(_host_control.transport()->current_process_time(), std::memory_order_release);
     }
 
     if (_bypass_manager.should_process())
@@ -184,13 +187,17 @@ void inline ReturnPlugin::_swap_buffers()
     _active_in->clear();
 }
 
-void inline ReturnPlugin::_maybe_swap_buffers(Time current_time)
+void inline ReturnPlugin::_discard_stale_audio(Time current_time)
 {
-    Time last_time = _last_process_time.load(std::memory_order_acquire);
-    if (last_time != current_time)
+    if (_last_send_time != current_time)
     {
-        _last_process_time.store(current_time, std::memory_order_release);
-        _swap_buffers();
+        /* If the return was not processed since audio was last sent to it, i.e. it's not
+         * active on a track, that audio was never output and should not accumulate */
+        if (_last_send_time > _last_process_time.load(std::memory_order_acquire))
+        {
+            _active_in->clear();
+        }
+        _last_send_time = current_time;
     }
 }
 
@@ -78,7 +78,7 @@ private:
 
     void inline _swap_buffers();
 
-    void inline _maybe_swap_buffers(Time current_time);
+    void inline _discard_stale_audio(Time current_time);
 
     float                                 _sample_rate;
     int                                   _return_id;
@@ -96,6 +96,7 @@ private:
     BypassManager                         _bypass_manager;
 
     std::atomic<Time>                     _last_process_time{Time(0)};
+    Time                                  _last_send_time{Time(0)};
 
     static_assert(decltype(_last_process_time)::is_always_lock_free);
 };
@@ -32,6 +32,7 @@ SampleDelayPlugin::SampleDelayPlugin(HostControl host_control) : InternalPlugin(
 {
     Processor::set_name(PLUGIN_UID);
     Processor::set_label(DEFAULT_LABEL);
+    _tail_length = MAX_DELAY;
     _sample_delay = register_int_parameter("sample_delay", 
                                            "Sample delay", 
                                            "samples", 
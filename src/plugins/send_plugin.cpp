@@ -73,6 +73,7 @@ SendPlugin::~SendPlugin()
 void SendPlugin::clear_destination()
 {
     _destination = nullptr;
+    notify_routing_changed();
     set_property_value(DEST_PROPERTY_ID, DEFAULT_DEST);
 }
 
@@ -86,6 +87,7 @@ void SendPlugin::_set_destination(return_plugin::ReturnPlugin* destination)
     }
     _destination = destination;
     destination->add_sender(this);
+    notify_routing_changed();
 }
 
 ProcessorReturnCode SendPlugin::init(float sample_rate)
@@ -182,6 +184,11 @@ ProcessorReturnCode SendPlugin::set_property_value(ObjectId property_id, const s
     return InternalPlugin::set_property_value(property_id, value);
 }
 
+const Processor* SendPlugin::send_destination() const
+{
+    return _destination;
+}
+
 std::string_view SendPlugin::static_uid()
 {
     return PLUGIN_UID;
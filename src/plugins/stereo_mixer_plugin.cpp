@@ -59,6 +59,7 @@ StereoMixerPlugin::StereoMixerPlugin(HostControl HostControl): InternalPlugin(Ho
     _max_output_channels = MAX_CHANNELS_SUPPORTED;
     Processor::set_name(PLUGIN_UID);
     Processor::set_label(DEFAULT_LABEL);
+    _tail_length = 0;
 
     _ch1_pan = register_float_parameter("ch1_pan", "Channel 1 Pan", "",
                                         -1.0, -1.0, 1.0,
@@ -0,0 +1,138 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "engine/async_processor_host.cpp"
+#undef private
+
+#include "test_utils/test_utils.h"
+#include "test_utils/host_control_mockup.h"
+#include "test_utils/dummy_processor.h"
+
+using namespace sushi;
+using namespace engine;
+
+constexpr int TEST_CHANNEL_COUNT = 2;
+constexpr auto SLOW_PROCESSING_TIME = std::chrono::milliseconds(20);
+
+/* Doubles its input, optionally taking far longer than a chunk period to do so */
+class SlowProcessor : public DummyProcessor
+{
+public:
+    explicit SlowProcessor(HostControl host_control) : DummyProcessor(host_control) {}
+
+    void process_event(const RtEvent& event) override
+    {
+        output_event(event);
+    }
+
+    void process_audio(const ChunkSampleBuffer& in_buffer, ChunkSampleBuffer& out_buffer) override
+    {
+        started = true;
+        if (slow)
+        {
+            std::this_thread::sleep_for(SLOW_PROCESSING_TIME);
+        }
+        out_buffer.replace(in_buffer);
+        out_buffer.apply_gain(2.0f);
+        process_calls++;
+    }
+
+    bool slow{false};
+    std::atomic_bool started{false};
+    std::atomic_int process_calls{0};
+};
+
+class AsyncProcessorHostTest : public ::testing::Test
+{
+protected:
+    AsyncProcessorHostTest() {}
+
+    HostControlMockup _host_control;
+    performance::PerformanceTimer _timer;
+    SlowProcessor _processor{_host_control.make_host_control_mockup()};
+    ChunkSampleBuffer _in{TEST_CHANNEL_COUNT};
+    ChunkSampleBuffer _out{TEST_CHANNEL_COUNT};
+};
+
+TEST_F(AsyncProcessorHostTest, TestHandOff)
+{
+    AsyncProcessorHost module_under_test(&_processor, &_timer);
+    EXPECT_EQ(&_processor, module_under_test.processor());
+
+    // The first call only hands over the input, the output is that of the previous chunk
+    test_utils::fill_sample_buffer(_in, 1.0f);
+    module_under_test.process(_in, _out);
+    test_utils::assert_buffer_value(0.0f, _out);
+    EXPECT_TRUE(module_under_test._processing);
+
+    module_under_test.wait_for_processing();
+    EXPECT_FALSE(module_under_test._processing);
+    EXPECT_EQ(1, _processor.process_calls.load());
+
+    // The input may be reused as soon as process() returns
+    test_utils::fill_sample_buffer(_in, 3.0f);
+    module_under_test.process(_in, _out);
+    test_utils::assert_buffer_value(2.0f, _out);
+    module_under_test.wait_for_processing();
+    module_under_test.process(_in, _out);
+    test_utils::assert_buffer_value(6.0f, _out);
+    module_under_test.wait_for_processing();
+    EXPECT_EQ(3, _processor.process_calls.load());
+
+    // Waiting when nothing is processing returns immediately
+    module_under_test.wait_for_processing();
+    EXPECT_EQ(3, _processor.process_calls.load());
+}
+
+TEST_F(AsyncProcessorHostTest, TestEventsForwarded)
+{
+    RtSafeRtEventFifo event_queue;
+    AsyncProcessorHost module_under_test(&_processor, &_timer);
+    module_under_test.set_event_output(&event_queue);
+    _processor.set_event_output(&module_under_test);
+
+    // Events output by a processor outside of processing are passed on when idle
+    _processor.process_event(RtEvent::make_note_on_event(0, 0, 0, 48, 1.0f));
+    module_under_test.forward_events();
+    RtEvent event;
+    ASSERT_TRUE(event_queue.pop(event));
+    EXPECT_EQ(RtEventType::NOTE_ON, event.type());
+    EXPECT_FALSE(event_queue.pop(event));
+}
+
+TEST_F(AsyncProcessorHostTest, TestMissedDeadline)
+{
+    AsyncProcessorHost module_under_test(&_processor, &_timer);
+    _processor.slow = true;
+    test_utils::fill_sample_buffer(_in, 1.0f);
+    module_under_test.process(_in, _out);
+
+    // When processing takes longer than a chunk, the rt thread waits for it instead of
+    // picking up a partially written output
+    auto start = std::chrono::steady_clock::now();
+    module_under_test.process(_in, _out);
+    EXPECT_GE(std::chrono::steady_clock::now() - start, SLOW_PROCESSING_TIME / 2);
+    test_utils::assert_buffer_value(2.0f, _out);
+    module_under_test.wait_for_processing();
+    EXPECT_EQ(2, _processor.process_calls.load());
+}
+
+TEST_F(AsyncProcessorHostTest, TestDeleteWhileProcessing)
+{
+    auto module_under_test = std::make_unique<AsyncProcessorHost>(&_processor, &_timer);
+    _processor.slow = true;
+    test_utils::fill_sample_buffer(_in, 1.0f);
+    module_under_test->process(_in, _out);
+    while (_processor.started == false)
+    {
+        std::this_thread::yield();
+    }
+
+    // The host should wait for the worker to finish before it is destroyed
+    module_under_test.reset();
+    EXPECT_EQ(1, _processor.process_calls.load());
+}
@@ -1,3 +1,4 @@
+#include <ctime>
 #include <thread>
 
 #include "gtest/gtest.h"
@@ -9,12 +10,50 @@
 
 #include "engine/audio_graph.cpp"
 #include "test_utils/host_control_mockup.h"
+#include "test_utils/dummy_processor.h"
+#include "test_utils/test_utils.h"
 
 constexpr float SAMPLE_RATE = 44000;
 constexpr int TEST_MAX_TRACKS = 2;
 using namespace sushi;
 using namespace sushi::engine;
 
+class DummySendProcessor : public DummyProcessor
+{
+public:
+    explicit DummySendProcessor(HostControl host_control) : DummyProcessor(host_control) {}
+
+    const Processor* send_destination() const override
+    {
+        return destination;
+    }
+
+    void set_destination(const Processor* new_destination)
+    {
+        destination = new_destination;
+        notify_routing_changed();
+    }
+
+    const Processor* destination{nullptr};
+};
+
+
+class BlockingProcessor : public DummyProcessor
+{
+public:
+    explicit BlockingProcessor(HostControl host_control) : DummyProcessor(host_control) {}
+
+    void process_audio(const ChunkSampleBuffer& in_buffer, ChunkSampleBuffer& out_buffer) override
+    {
+        while (blocked)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(100));
+        }
+        out_buffer = in_buffer;
+    }
+
+    std::atomic<bool> blocked{false};
+};
 
 class TestAudioGraph : public ::testing::Test
 {
@@ -22,9 +61,9 @@ protected:
     using ::testing::Test::SetUp; // Hide error of hidden overload of virtual function in clang when signatures differ but the name is the same
     TestAudioGraph() {}
 
-    void SetUp(int cores)
+    void SetUp(int cores, TrackScheduling scheduling = TrackScheduling::STATIC)
     {
-        _module_under_test = std::make_unique<AudioGraph>(cores, TEST_MAX_TRACKS);
+        _module_under_test = std::make_unique<AudioGraph>(cores, TEST_MAX_TRACKS, false, scheduling);
     }
 
     HostControlMockup             _hc;
@@ -76,6 +115,65 @@ TEST_F(TestAudioGraph, TestMultiCoreOperation)
     EXPECT_EQ(0, queues[2].size());
 }
 
+TEST_F(TestAudioGraph, TestWorkerPriority)
+{
+    _module_under_test = std::make_unique<AudioGraph>(2, TEST_MAX_TRACKS, false, TrackScheduling::STATIC,
+                                                      DEFAULT_WORKER_PRIORITY - 10);
+    ASSERT_EQ(1u, _module_under_test->_workers.size());
+    ASSERT_TRUE(_module_under_test->add_to_core(&_track_1, 0));
+    ASSERT_TRUE(_module_under_test->add_to_core(&_track_2, 1));
+
+    // Tracks on core 1 are rendered by a worker with the given priority
+    auto event = RtEvent::make_note_on_event(_track_1.id(), 0, 0, 48, 1.0f);
+    _track_1.process_event(event);
+    _track_2.process_event(event);
+    _module_under_test->render();
+    auto queues = _module_under_test->event_outputs();
+    EXPECT_EQ(1, queues[0].size());
+    EXPECT_EQ(1, queues[1].size());
+}
+
+TEST_F(TestAudioGraph, TestIdleCoresNotWoken)
+{
+    SetUp(3);
+    _module_under_test->render();
+    EXPECT_EQ(0, _module_under_test->active_workers());
+
+    // Tracks on core 0 are rendered by the calling thread
+    ASSERT_TRUE(_module_under_test->add_to_core(&_track_1, 0));
+    _module_under_test->render();
+    EXPECT_EQ(0, _module_under_test->active_workers());
+
+    ASSERT_TRUE(_module_under_test->add_to_core(&_track_2, 2));
+    auto event = RtEvent::make_note_on_event(_track_2.id(), 0, 0, 48, 1.0f);
+    _track_2.process_event(event);
+    _module_under_test->render();
+    EXPECT_EQ(1, _module_under_test->active_workers());
+    EXPECT_TRUE(_module_under_test->_woken_workers[2]);
+    EXPECT_FALSE(_module_under_test->_woken_workers[1]);
+    EXPECT_EQ(1, _module_under_test->event_outputs()[2].size());
+}
+
+TEST_F(TestAudioGraph, TestMoveToFullCore)
+{
+    SetUp(2);
+    Track track_3(_hc.make_host_control_mockup(SAMPLE_RATE), 2, &_timer);
+    ASSERT_TRUE(_module_under_test->add_to_core(&_track_1, 1));
+    ASSERT_TRUE(_module_under_test->add_to_core(&_track_2, 1));
+    ASSERT_TRUE(_module_under_test->add_to_core(&track_3, 0));
+
+    // The track should be left on its core when there is no room on the other
+    EXPECT_FALSE(_module_under_test->move_to_core(&track_3, 1));
+    EXPECT_EQ(0, track_3.assigned_core());
+    ASSERT_EQ(1u, _module_under_test->_audio_graph[0].size());
+    EXPECT_EQ(&track_3, _module_under_test->_audio_graph[0][0].track);
+
+    EXPECT_TRUE(_module_under_test->move_to_core(&_track_1, 0));
+    EXPECT_EQ(0, _track_1.assigned_core());
+    EXPECT_EQ(2u, _module_under_test->_audio_graph[0].size());
+    EXPECT_EQ(1u, _module_under_test->_audio_graph[1].size());
+}
+
 TEST_F(TestAudioGraph, TestMaxNumberOfTracks)
 {
     SetUp(1);
@@ -85,4 +183,310 @@ TEST_F(TestAudioGraph, TestMaxNumberOfTracks)
 
     ASSERT_EQ(1u, _module_under_test->_audio_graph.size());
     ASSERT_EQ(2u, _module_under_test->_audio_graph[0].size());
-}
\ No newline at end of file
+}
+TEST_F(TestAudioGraph, TestDependencyOrdering)
+{
+    SetUp(1);
+    DummyProcessor return_processor(_hc.make_host_control_mockup(SAMPLE_RATE));
+    DummySendProcessor send_processor(_hc.make_host_control_mockup(SAMPLE_RATE));
+    ASSERT_TRUE(_track_1.add(&return_processor));
+    ASSERT_TRUE(_track_2.add(&send_processor));
+
+    ASSERT_TRUE(_module_under_test->add(&_track_1));
+    ASSERT_TRUE(_module_under_test->add(&_track_2));
+    _module_under_test->render();
+    EXPECT_EQ(1, _module_under_test->_levels);
+    EXPECT_EQ(&_track_1, _module_under_test->_audio_graph[0][0].track);
+
+    // Track 2 now sends to track 1, so it should be rendered first
+    send_processor.set_destination(&return_processor);
+    _module_under_test->render();
+    EXPECT_EQ(2, _module_under_test->_levels);
+    EXPECT_EQ(&_track_2, _module_under_test->_audio_graph[0][0].track);
+    EXPECT_EQ(0, _module_under_test->_audio_graph[0][0].level);
+    EXPECT_EQ(&_track_1, _module_under_test->_audio_graph[0][1].track);
+    EXPECT_EQ(1, _module_under_test->_audio_graph[0][1].level);
+
+    // Removing the send should remove the dependency
+    send_processor.set_destination(nullptr);
+    _module_under_test->render();
+    EXPECT_EQ(1, _module_under_test->_levels);
+
+    // Dependencies are only collected again after a change has been signalled
+    send_processor.destination = &return_processor;
+    _module_under_test->render();
+    EXPECT_EQ(1, _module_under_test->_levels);
+    send_processor.set_destination(&return_processor);
+    _module_under_test->render();
+    EXPECT_EQ(2, _module_under_test->_levels);
+    EXPECT_EQ(0, _module_under_test->dropped_dependencies());
+
+    _track_1.remove(return_processor.id());
+    _track_2.remove(send_processor.id());
+}
+
+TEST_F(TestAudioGraph, TestMultiCoreDependencies)
+{
+    SetUp(2);
+    DummySendProcessor processor_1(_hc.make_host_control_mockup(SAMPLE_RATE));
+    DummySendProcessor processor_2(_hc.make_host_control_mockup(SAMPLE_RATE));
+    ASSERT_TRUE(_track_1.add(&processor_1));
+    ASSERT_TRUE(_track_2.add(&processor_2));
+    ASSERT_TRUE(_module_under_test->add(&_track_1));
+    ASSERT_TRUE(_module_under_test->add(&_track_2));
+
+    processor_1.set_destination(&processor_2);
+    _module_under_test->render();
+    EXPECT_EQ(2, _module_under_test->_levels);
+    EXPECT_EQ(0, _module_under_test->_audio_graph[0][0].level);
+    EXPECT_EQ(1, _module_under_test->_audio_graph[1][0].level);
+
+    // A cycle can't be ordered, both tracks should end up on the same level
+    processor_2.set_destination(&processor_1);
+    _module_under_test->render();
+    EXPECT_EQ(1, _module_under_test->_levels);
+    EXPECT_EQ(0, _module_under_test->_audio_graph[0][0].level);
+    EXPECT_EQ(0, _module_under_test->_audio_graph[1][0].level);
+
+    _track_1.remove(processor_1.id());
+    _track_2.remove(processor_2.id());
+}
+
+TEST_F(TestAudioGraph, TestWorkStealing)
+{
+    SetUp(2, TrackScheduling::WORK_STEALING);
+    // Put both tracks on the same core so that the other core has to steal work
+    ASSERT_TRUE(_module_under_test->add_to_core(&_track_1, 0));
+    ASSERT_TRUE(_module_under_test->add_to_core(&_track_2, 0));
+    ASSERT_EQ(2u, _module_under_test->_audio_graph[0].size());
+    ASSERT_EQ(0u, _module_under_test->_audio_graph[1].size());
+
+    auto event = RtEvent::make_note_on_event(_track_1.id(), 0, 0, 48, 1.0f);
+    _track_1.process_event(event);
+    _track_2.process_event(event);
+    _module_under_test->render();
+
+    // Both tracks should have been rendered exactly once, regardless of which core rendered them
+    auto queues = _module_under_test->event_outputs();
+    EXPECT_EQ(2, queues[0].size() + queues[1].size());
+    EXPECT_GE(_module_under_test->_work_queues[0].next.load(), 2);
+    EXPECT_EQ(2, _module_under_test->_work_queues[0].end);
+
+    // Dependent tracks must still be rendered on separate levels
+    DummySendProcessor processor_1(_hc.make_host_control_mockup(SAMPLE_RATE));
+    DummySendProcessor processor_2(_hc.make_host_control_mockup(SAMPLE_RATE));
+    ASSERT_TRUE(_track_1.add(&processor_1));
+    ASSERT_TRUE(_track_2.add(&processor_2));
+    processor_2.set_destination(&processor_1);
+    _module_under_test->render();
+    EXPECT_EQ(2, _module_under_test->_levels);
+    EXPECT_EQ(&_track_2, _module_under_test->_audio_graph[0][0].track);
+
+    _module_under_test->_prepare_work_queues(0);
+    EXPECT_EQ(0, _module_under_test->_work_queues[0].next.load());
+    EXPECT_EQ(1, _module_under_test->_work_queues[0].end);
+    _module_under_test->_prepare_work_queues(1);
+    EXPECT_EQ(1, _module_under_test->_work_queues[0].next.load());
+    EXPECT_EQ(2, _module_under_test->_work_queues[0].end);
+
+    _track_1.remove(processor_1.id());
+    _track_2.remove(processor_2.id());
+}
+
+TEST_F(TestAudioGraph, TestIndependentBuses)
+{
+    SetUp(2);
+    _track_1.init(SAMPLE_RATE);
+    DummyProcessor processor_1(_hc.make_host_control_mockup(SAMPLE_RATE));
+    DummyProcessor processor_2(_hc.make_host_control_mockup(SAMPLE_RATE));
+    ASSERT_TRUE(_track_1.set_processor_bus(processor_1.id(), 0));
+    ASSERT_TRUE(_track_1.set_processor_bus(processor_2.id(), 1));
+    ASSERT_TRUE(_track_1.add(&processor_1));
+    ASSERT_TRUE(_track_1.add(&processor_2));
+    ASSERT_TRUE(_track_1.independent_buses());
+    ASSERT_TRUE(_module_under_test->add(&_track_1));
+    ASSERT_TRUE(_module_under_test->add(&_track_2));
+
+    auto in_bus_0 = _track_1.input_bus(0);
+    auto in_bus_1 = _track_1.input_bus(1);
+    test_utils::fill_sample_buffer(in_bus_0, 1.0f);
+    test_utils::fill_sample_buffer(in_bus_1, 0.5f);
+    _module_under_test->render();
+
+    // Each bus should have been rendered as a separate unit, and the track finished once
+    EXPECT_EQ(2u, _module_under_test->_bus_nodes.size());
+    ASSERT_EQ(1u, _module_under_test->_bus_tracks.size());
+    EXPECT_EQ(&_track_1, _module_under_test->_bus_tracks[0]);
+    EXPECT_GE(_module_under_test->_next_bus_node.load(), 2);
+    test_utils::assert_buffer_value(1.0f, _track_1.output_bus(0), test_utils::DECIBEL_ERROR);
+    test_utils::assert_buffer_value(0.5f, _track_1.output_bus(1), test_utils::DECIBEL_ERROR);
+
+    // Unassigning a processor should return the track to normal rendering
+    ASSERT_TRUE(_track_1.set_processor_bus(processor_2.id(), std::nullopt));
+    EXPECT_FALSE(_track_1.independent_buses());
+    _module_under_test->render();
+    EXPECT_TRUE(_module_under_test->_bus_nodes.empty());
+
+    _track_1.remove(processor_1.id());
+    _track_1.remove(processor_2.id());
+}
+
+TEST_F(TestAudioGraph, TestGroupTracks)
+{
+    SetUp(2);
+    _track_1.init(SAMPLE_RATE);
+    _track_2.init(SAMPLE_RATE);
+    ASSERT_TRUE(_module_under_test->add(&_track_1));
+    ASSERT_TRUE(_module_under_test->add(&_track_2));
+    _track_2.set_output_group(&_track_1);
+
+    auto input = _track_2.input_bus(0);
+    test_utils::fill_sample_buffer(input, 0.5f);
+    _module_under_test->render();
+
+    // The group should be rendered after its member and have its output as input
+    EXPECT_EQ(2, _module_under_test->_levels);
+    ASSERT_EQ(1u, _module_under_test->_group_members.size());
+    EXPECT_EQ(&_track_2, _module_under_test->_group_members[0]);
+    EXPECT_EQ(1, _module_under_test->_audio_graph[0][0].members);
+    EXPECT_EQ(1, _module_under_test->_audio_graph[0][0].level);
+    test_utils::assert_buffer_value(0.5f, _track_1.output_bus(0), test_utils::DECIBEL_ERROR);
+
+    // The output of the member should not be summed twice
+    test_utils::fill_sample_buffer(input, 0.25f);
+    auto group_input = _track_1.input_bus(0);
+    test_utils::fill_sample_buffer(group_input, 0.5f);
+    _module_under_test->render();
+    test_utils::assert_buffer_value(0.75f, _track_1.output_bus(0), test_utils::DECIBEL_ERROR);
+
+    _track_2.set_output_group(nullptr);
+    _module_under_test->render();
+    EXPECT_EQ(1, _module_under_test->_levels);
+    EXPECT_TRUE(_module_under_test->_group_members.empty());
+    test_utils::assert_buffer_value(0.0f, _track_1.output_bus(0), test_utils::DECIBEL_ERROR);
+}
+
+TEST_F(TestAudioGraph, TestShedding)
+{
+    SetUp(1);
+    _track_1.init(SAMPLE_RATE);
+    _track_2.init(SAMPLE_RATE);
+    _track_1.set_priority(1);
+    ASSERT_TRUE(_module_under_test->add(&_track_1));
+    ASSERT_TRUE(_module_under_test->add(&_track_2));
+
+    // Only the track with the lowest priority can be shed
+    EXPECT_TRUE(_module_under_test->shed_lowest_priority());
+    EXPECT_FALSE(_module_under_test->shed_lowest_priority());
+    _module_under_test->render();
+    EXPECT_EQ(1, _module_under_test->shed_tracks());
+    EXPECT_FALSE(_track_1.shed());
+    EXPECT_TRUE(_track_2.shed());
+
+    EXPECT_TRUE(_module_under_test->restore_shed_priority());
+    _module_under_test->render();
+    EXPECT_EQ(0, _module_under_test->shed_tracks());
+    EXPECT_FALSE(_track_2.shed());
+    EXPECT_FALSE(_module_under_test->restore_shed_priority());
+
+    // Tracks with the highest priority are never shed
+    _track_1.set_priority(DEFAULT_TRACK_PRIORITY);
+    EXPECT_FALSE(_module_under_test->shed_lowest_priority());
+    _module_under_test->render();
+    EXPECT_EQ(0, _module_under_test->shed_tracks());
+}
+
+TEST_F(TestAudioGraph, TestWatchdog)
+{
+    SetUp(2);
+    BlockingProcessor processor(_hc.make_host_control_mockup(SAMPLE_RATE));
+    _track_1.init(SAMPLE_RATE);
+    _track_2.init(SAMPLE_RATE);
+    _track_2.add(&processor);
+    ASSERT_TRUE(_module_under_test->add(&_track_1));
+    ASSERT_TRUE(_module_under_test->add(&_track_2));
+    _module_under_test->set_watchdog_timeout(std::chrono::milliseconds(50));
+
+    _module_under_test->render();
+    EXPECT_EQ(0, _module_under_test->stalled_cores());
+    EXPECT_FALSE(_track_2.stalled());
+
+    // A hung plugin should not keep the graph from rendering the other cores
+    processor.blocked = true;
+    _module_under_test->render();
+    EXPECT_EQ(1, _module_under_test->stalled_cores());
+    const auto& stall = _module_under_test->core_stall(1);
+    EXPECT_TRUE(stall.stalled);
+    EXPECT_EQ(_track_2.id(), stall.track);
+    EXPECT_EQ(processor.id(), stall.processor);
+    EXPECT_TRUE(_track_2.stalled());
+    EXPECT_FALSE(_track_1.stalled());
+
+    _module_under_test->render();
+    EXPECT_EQ(1, _module_under_test->stalled_cores());
+
+    // The core should be used again once the worker has finished
+    processor.blocked = false;
+    while (_module_under_test->_core_watch[1].done == false)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    _module_under_test->render();
+    EXPECT_EQ(0, _module_under_test->stalled_cores());
+    EXPECT_FALSE(_module_under_test->core_stall(1).stalled);
+    EXPECT_FALSE(_track_2.stalled());
+    _track_2.remove(processor.id());
+}
+
+TEST_F(TestAudioGraph, TestWatchdogBlocksOnStalledWorker)
+{
+    SetUp(2);
+    BlockingProcessor processor(_hc.make_host_control_mockup(SAMPLE_RATE));
+    _track_1.init(SAMPLE_RATE);
+    _track_2.init(SAMPLE_RATE);
+    _track_2.add(&processor);
+    ASSERT_TRUE(_module_under_test->add(&_track_1));
+    ASSERT_TRUE(_module_under_test->add(&_track_2));
+    constexpr auto TIMEOUT = std::chrono::milliseconds(50);
+    _module_under_test->set_watchdog_timeout(TIMEOUT);
+    _module_under_test->render();
+
+    // While waiting for a stalled worker, the rendering thread should block, not spin
+    auto cpu_time = []()
+    {
+        timespec time;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+        return std::chrono::seconds(time.tv_sec) + std::chrono::nanoseconds(time.tv_nsec);
+    };
+    processor.blocked = true;
+    auto start = std::chrono::steady_clock::now();
+    auto start_cpu_time = cpu_time();
+    _module_under_test->render();
+    auto used_cpu_time = cpu_time() - start_cpu_time;
+    EXPECT_GE(std::chrono::steady_clock::now() - start, TIMEOUT);
+    EXPECT_LT(used_cpu_time, TIMEOUT / 5);
+    EXPECT_EQ(1, _module_under_test->stalled_cores());
+    EXPECT_FALSE(_module_under_test->_core_watch[1].waiting);
+
+    // A worker finishing while the rendering thread is blocked should wake it up
+    processor.blocked = false;
+    while (_module_under_test->_core_watch[1].done == false)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    _module_under_test->render();
+    EXPECT_EQ(0, _module_under_test->stalled_cores());
+
+    processor.blocked = true;
+    std::thread unblock([&]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        processor.blocked = false;
+    });
+    start = std::chrono::steady_clock::now();
+    _module_under_test->render();
+    unblock.join();
+    EXPECT_LT(std::chrono::steady_clock::now() - start, TIMEOUT);
+    EXPECT_EQ(0, _module_under_test->stalled_cores());
+    _track_2.remove(processor.id());
+}
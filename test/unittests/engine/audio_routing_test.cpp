@@ -0,0 +1,123 @@
+#include "gtest/gtest.h"
+
+#define private public
+
+#include "engine/audio_routing.cpp"
+#include "engine/processor_table.h"
+#include "engine/track.h"
+#include "test_utils/test_utils.h"
+#include "test_utils/host_control_mockup.h"
+
+using namespace sushi;
+using namespace sushi::engine;
+
+constexpr float TEST_SAMPLE_RATE = 48000;
+constexpr int TEST_CHANNELS = 4;
+
+class TestAudioRouting : public ::testing::Test
+{
+protected:
+    TestAudioRouting() {}
+
+    void SetUp()
+    {
+        _track_1.init(TEST_SAMPLE_RATE);
+        _track_2.init(TEST_SAMPLE_RATE);
+        _tracks.insert(&_track_1);
+        _tracks.insert(&_track_2);
+        for (int c = 0; c < TEST_CHANNELS; ++c)
+        {
+            auto channel = ChunkSampleBuffer::create_non_owning_buffer(_input, c, 1);
+            test_utils::fill_sample_buffer(channel, static_cast<float>(c + 1));
+        }
+    }
+
+    HostControlMockup _host_control;
+    performance::PerformanceTimer _timer;
+    Track _track_1{_host_control.make_host_control_mockup(), 2, &_timer, false};
+    Track _track_2{_host_control.make_host_control_mockup(), 2, &_timer, false};
+    ProcessorTable _tracks;
+    ChunkSampleBuffer _input{TEST_CHANNELS};
+    AudioRouting _module_under_test{16};
+};
+
+TEST_F(TestAudioRouting, TestInputRouting)
+{
+    std::vector<AudioConnection> connections = {{0, 0, _track_1.id()},
+                                                {1, 1, _track_1.id()},
+                                                {3, 1, _track_2.id()}};
+    _module_under_test.update(connections, {});
+    ASSERT_EQ(2u, _module_under_test._input_routes.size());
+
+    // Consecutive connections to all channels of a track should be read in place
+    _module_under_test.route_inputs(_input, _tracks);
+    ASSERT_EQ(2, _track_1._external_input.channel_count());
+    EXPECT_EQ(_input.channel(0), _track_1._external_input.channel(0));
+    test_utils::assert_buffer_value(0.0f, _track_1.input_channel(0));
+
+    // Anything else should be copied
+    EXPECT_EQ(0, _track_2._external_input.channel_count());
+    test_utils::assert_buffer_value(0.0f, _track_2.input_channel(0));
+    test_utils::assert_buffer_value(4.0f, _track_2.input_channel(1));
+
+    _track_1.render();
+    _track_2.render();
+    EXPECT_EQ(0, _track_1._external_input.channel_count());
+    test_utils::assert_buffer_value(1.0f, _track_1.output_channel(0));
+    test_utils::assert_buffer_value(2.0f, _track_1.output_channel(1));
+
+    // If a channel has several connections, the last one wins
+    connections = {{2, 0, _track_1.id()},
+                   {0, 0, _track_1.id()},
+                   {1, 1, _track_1.id()}};
+    _module_under_test.update(connections, {});
+    _module_under_test.route_inputs(_input, _tracks);
+    EXPECT_EQ(0, _track_1._external_input.channel_count());
+    test_utils::assert_buffer_value(1.0f, _track_1.input_channel(0));
+    test_utils::assert_buffer_value(2.0f, _track_1.input_channel(1));
+}
+
+TEST_F(TestAudioRouting, TestOutputMixing)
+{
+    std::vector<AudioConnection> connections = {{1, 1, _track_2.id()},
+                                                {0, 0, _track_1.id()},
+                                                {1, 1, _track_1.id()}};
+    _module_under_test.update({}, connections);
+    test_utils::fill_sample_buffer(_track_1._output_buffer, 1.0f);
+    test_utils::fill_sample_buffer(_track_2._output_buffer, 2.0f);
+
+    // Channels without connections should be cleared, the rest replaced or mixed
+    ChunkSampleBuffer output(TEST_CHANNELS);
+    test_utils::fill_sample_buffer(output, 5.0f);
+    _module_under_test.mix_outputs(output, _tracks);
+    test_utils::assert_buffer_value(1.0f, ChunkSampleBuffer::create_non_owning_buffer(output, 0, 1));
+    test_utils::assert_buffer_value(3.0f, ChunkSampleBuffer::create_non_owning_buffer(output, 1, 1));
+    test_utils::assert_buffer_value(0.0f, ChunkSampleBuffer::create_non_owning_buffer(output, 2, 2));
+
+    _module_under_test.update({}, {});
+    test_utils::fill_sample_buffer(output, 5.0f);
+    _module_under_test.mix_outputs(output, _tracks);
+    test_utils::assert_buffer_value(0.0f, output);
+}
+
+TEST_F(TestAudioRouting, TestGroupMembersNotMixed)
+{
+    std::vector<AudioConnection> connections = {{1, 1, _track_2.id()},
+                                                {0, 0, _track_1.id()},
+                                                {1, 1, _track_1.id()}};
+    _module_under_test.update({}, connections);
+    test_utils::fill_sample_buffer(_track_1._output_buffer, 1.0f);
+    test_utils::fill_sample_buffer(_track_2._output_buffer, 2.0f);
+
+    // A track in a group is only heard through the group, not through its own connections
+    _track_2.set_output_group(&_track_1);
+    ChunkSampleBuffer output(TEST_CHANNELS);
+    test_utils::fill_sample_buffer(output, 5.0f);
+    _module_under_test.mix_outputs(output, _tracks);
+    test_utils::assert_buffer_value(1.0f, ChunkSampleBuffer::create_non_owning_buffer(output, 0, 1));
+    test_utils::assert_buffer_value(1.0f, ChunkSampleBuffer::create_non_owning_buffer(output, 1, 1));
+
+    _track_2.set_output_group(nullptr);
+    _module_under_test.mix_outputs(output, _tracks);
+    test_utils::assert_buffer_value(3.0f, ChunkSampleBuffer::create_non_owning_buffer(output, 1, 1));
+}
@@ -87,7 +87,7 @@ TEST_F(AudioGraphControllerTest, TestGettingProcessors)
 
 TEST_F(AudioGraphControllerTest, TestCreatingAndRemovingTracks)
 {
-    auto status = _module_under_test->create_track("Track 2", 2);
+    auto status = _module_under_test->create_track("Track 2", 2, std::nullopt);
     ASSERT_EQ(ext::ControlStatus::OK, status);
 
     auto execution_status1 = _event_dispatcher_mockup->execute_engine_event(_audio_engine.get());
@@ -99,19 +99,19 @@ TEST_F(AudioGraphControllerTest, TestCreatingAndRemovingTracks)
     EXPECT_EQ(2, tracks[1]->input_channels());
     EXPECT_EQ(2, tracks[1]->output_channels());
 
-    status = _module_under_test->create_multibus_track("Track 3", 2);
+    status = _module_under_test->create_multibus_track("Track 3", 2, std::nullopt);
     ASSERT_EQ(ext::ControlStatus::OK, status);
 
     auto execution_status2 = _event_dispatcher_mockup->execute_engine_event(_audio_engine.get());
     ASSERT_EQ(execution_status2, EventStatus::HANDLED_OK);
 
-    status = _module_under_test->create_pre_track("Track 4");
+    status = _module_under_test->create_pre_track("Track 4", std::nullopt);
     ASSERT_EQ(ext::ControlStatus::OK, status);
 
     auto execution_status_3 = _event_dispatcher_mockup->execute_engine_event(_audio_engine.get());
     ASSERT_EQ(execution_status_3, EventStatus::HANDLED_OK);
 
-    status = _module_under_test->create_post_track("Track 5");
+    status = _module_under_test->create_post_track("Track 5", std::nullopt);
     ASSERT_EQ(ext::ControlStatus::OK, status);
 
     auto execution_status_4 = _event_dispatcher_mockup->execute_engine_event(_audio_engine.get());
@@ -122,7 +122,7 @@ TEST_F(AudioGraphControllerTest, TestCreatingAndRemovingTracks)
     EXPECT_EQ("Track 3", tracks[2]->name());
     EXPECT_EQ(2, tracks[2]->buses());
 
-    status = _module_under_test->delete_track(tracks[2]->id());
+    status = _module_under_test->delete_track(tracks[2]->id(), std::nullopt);
     ASSERT_EQ(ext::ControlStatus::OK, status);
 
     auto execution_status_5 = _event_dispatcher_mockup->execute_engine_event(_audio_engine.get());
@@ -139,6 +139,7 @@ TEST_F(AudioGraphControllerTest, TestCreatingAndRemovingProcessors)
                                                                 "",
                                                                 ext::PluginType::INTERNAL,
                                                                 _track_id,
+                                                                std::nullopt,
                                                                 std::nullopt);
     ASSERT_EQ(ext::ControlStatus::OK, status);
 
@@ -154,7 +155,7 @@ TEST_F(AudioGraphControllerTest, TestCreatingAndRemovingProcessors)
     auto [track_status, track_2_id] = _audio_engine->create_track("Track 2", 2);
     ASSERT_EQ(EngineReturnStatus::OK, track_status);
 
-    status = _module_under_test->move_processor_on_track(proc_id, _track_id, track_2_id, std::nullopt);
+    status = _module_under_test->move_processor_on_track(proc_id, _track_id, track_2_id, std::nullopt, std::nullopt);
     ASSERT_EQ(ext::ControlStatus::OK, status);
 
     auto execution_status2 = _event_dispatcher_mockup->execute_engine_event(_audio_engine.get());
@@ -164,7 +165,7 @@ TEST_F(AudioGraphControllerTest, TestCreatingAndRemovingProcessors)
     EXPECT_EQ(1u, _audio_engine->processor_container()->processors_on_track(track_2_id).size());
 
     // Delete the processor from the new track
-    status = _module_under_test->delete_processor_from_track(proc_id, track_2_id);
+    status = _module_under_test->delete_processor_from_track(proc_id, track_2_id, std::nullopt);
     ASSERT_EQ(ext::ControlStatus::OK, status);
 
     auto execution_status4 = _event_dispatcher_mockup->execute_engine_event(_audio_engine.get());
@@ -173,3 +174,26 @@ TEST_F(AudioGraphControllerTest, TestCreatingAndRemovingProcessors)
     processors = _audio_engine->processor_container()->processors_on_track(track_2_id);
     EXPECT_EQ(0u, processors.size());
 }
+
+TEST_F(AudioGraphControllerTest, TestEditsInTransaction)
+{
+    _audio_engine->enable_realtime(true);
+    auto [begin_status, transaction] = _audio_engine->begin_graph_transaction(std::chrono::seconds(10));
+    ASSERT_EQ(EngineReturnStatus::OK, begin_status);
+
+    // Edits given the id of the open transaction are made in it, without the rt thread
+    auto status = _module_under_test->create_track("Track 2", 2, transaction);
+    ASSERT_EQ(ext::ControlStatus::OK, status);
+    EXPECT_EQ(EventStatus::HANDLED_OK, _event_dispatcher_mockup->execute_engine_event(_audio_engine.get()));
+    EXPECT_TRUE(_audio_engine->processor_container()->processor_exists("Track 2"));
+
+    // Edits given another id are refused
+    status = _module_under_test->create_track("Track 3", 2, transaction + 1);
+    ASSERT_EQ(ext::ControlStatus::OK, status);
+    EXPECT_EQ(EventStatus::ERROR, _event_dispatcher_mockup->execute_engine_event(_audio_engine.get()));
+    EXPECT_FALSE(_audio_engine->processor_container()->processor_exists("Track 3"));
+
+    EXPECT_EQ(EngineReturnStatus::OK, _audio_engine->abort_graph_transaction(transaction));
+    EXPECT_FALSE(_audio_engine->processor_container()->processor_exists("Track 2"));
+    _audio_engine->enable_realtime(false);
+}
@@ -172,7 +172,7 @@ TEST_F(TestEngine, TestCreateEmptyTrack)
     ASSERT_TRUE(_processors->processor_exists("left"));
     auto left_track_id = track_id;
     ASSERT_EQ(_module_under_test->_audio_graph._audio_graph[0].size(),1u);
-    ASSERT_EQ(_module_under_test->_audio_graph._audio_graph[0][0]->name(),"left");
+    ASSERT_EQ(_module_under_test->_audio_graph._audio_graph[0][0].track->name(),"left");
 
     /* Test invalid name */
     std::tie(status, track_id) = _module_under_test->create_track("left", 1);
@@ -249,9 +249,9 @@ TEST_F(TestEngine, TestAddAndRemovePlugin)
     /* Check that processors exists and in the right order on track "main" */
     ASSERT_TRUE(_processors->processor_exists("gain"));
     ASSERT_TRUE(_processors->processor_exists("synth"));
-    ASSERT_EQ(2u, _module_under_test->_audio_graph._audio_graph[0][0]->_processors.size());
-    ASSERT_EQ("synth", _module_under_test->_audio_graph._audio_graph[0][0]->_processors[0]->name());
-    ASSERT_EQ("gain", _module_under_test->_audio_graph._audio_graph[0][0]->_processors[1]->name());
+    ASSERT_EQ(2u, _module_under_test->_audio_graph._audio_graph[0][0].track->_processors.size());
+    ASSERT_EQ("synth", _module_under_test->_audio_graph._audio_graph[0][0].track->_processors[0]->name());
+    ASSERT_EQ("gain", _module_under_test->_audio_graph._audio_graph[0][0].track->_processors[1]->name());
 
     /* Move a processor from 1 track to another */
     auto [right_track_status, right_track_id] = _module_under_test->create_track("right", 2);
@@ -279,8 +279,8 @@ TEST_F(TestEngine, TestAddAndRemovePlugin)
     ASSERT_EQ(EngineReturnStatus::OK, status);
 
     ASSERT_FALSE(_processors->processor_exists("gain"));
-    ASSERT_EQ(0u, _module_under_test->_audio_graph._audio_graph[0][0]->_processors.size());
-    ASSERT_EQ("synth", _module_under_test->_audio_graph._audio_graph[0][1]->_processors[0]->name());
+    ASSERT_EQ(0u, _module_under_test->_audio_graph._audio_graph[0][0].track->_processors.size());
+    ASSERT_EQ("synth", _module_under_test->_audio_graph._audio_graph[0][1].track->_processors[0]->name());
 
     /* Negative tests */
     ObjectId id;
@@ -373,7 +373,7 @@ TEST_F(TestEngine, TestRealtimeConfiguration)
     rt.join();
     ASSERT_EQ(EngineReturnStatus::OK, status);
 
-    ASSERT_EQ(1u, _module_under_test->_audio_graph._audio_graph[0][0]->_processors.size());
+    ASSERT_EQ(1u, _module_under_test->_audio_graph._audio_graph[0][0].track->_processors.size());
 
     // Remove the plugin and track.
 
@@ -385,7 +385,7 @@ TEST_F(TestEngine, TestRealtimeConfiguration)
     status = _module_under_test->remove_plugin_from_track(plugin_id, track_id);
     rt.join();
     ASSERT_EQ(EngineReturnStatus::OK, status);
-    ASSERT_EQ(0u, _module_under_test->_audio_graph._audio_graph[0][0]->_processors.size());
+    ASSERT_EQ(0u, _module_under_test->_audio_graph._audio_graph[0][0].track->_processors.size());
 
     rt = std::thread(faux_rt_thread, _module_under_test.get());
     status = _module_under_test->delete_plugin(plugin_id);
@@ -403,8 +403,273 @@ TEST_F(TestEngine, TestRealtimeConfiguration)
     ASSERT_FALSE(_processors->processor_exists("gain_0_r"));
     ASSERT_FALSE(_processors->processor_exists(plugin_id));
     ASSERT_FALSE(_processors->processor_exists(track_id));
-    ASSERT_FALSE(_module_under_test->_realtime_processors[track_id]);
-    ASSERT_FALSE(_module_under_test->_realtime_processors[plugin_id]);
+    ASSERT_FALSE(_module_under_test->_realtime_processors.processor(track_id));
+    ASSERT_FALSE(_module_under_test->_realtime_processors.processor(plugin_id));
+}
+
+TEST_F(TestEngine, TestGraphTransaction)
+{
+    auto faux_rt_thread = [](AudioEngine* e)
+    {
+        SampleBuffer<AUDIO_CHUNK_SIZE> in_buffer(2);
+        SampleBuffer<AUDIO_CHUNK_SIZE> out_buffer(2);
+        ControlBuffer control_buffer;
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        e->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+    };
+
+    PluginInfo gain_plugin_info;
+    gain_plugin_info.uid = "sushi.testing.gain";
+    gain_plugin_info.path = "";
+    gain_plugin_info.type = PluginType::INTERNAL;
+
+    // While a transaction is open, edits should not need the rt thread to be running
+    _module_under_test->enable_realtime(true);
+    auto [begin_status, transaction] = _module_under_test->begin_graph_transaction(std::chrono::seconds(10));
+    ASSERT_EQ(EngineReturnStatus::OK, begin_status);
+    EXPECT_EQ(EngineReturnStatus::ALREADY_IN_USE, _module_under_test->begin_graph_transaction(std::chrono::seconds(10)).first);
+    EXPECT_EQ(EngineReturnStatus::ERROR, _module_under_test->run_in_graph_transaction(transaction + 1, [](){}));
+
+    ObjectId track_id(0);
+    ObjectId plugin_id(0);
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->run_in_graph_transaction(transaction, [&]()
+    {
+        auto [track_status, new_track_id] = _module_under_test->create_track("main", 2);
+        ASSERT_EQ(EngineReturnStatus::OK, track_status);
+        track_id = new_track_id;
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->connect_audio_input_channel(0, 0, track_id));
+        auto [load_status, new_plugin_id] = _module_under_test->create_processor(gain_plugin_info, "gain_0");
+        ASSERT_EQ(EngineReturnStatus::OK, load_status);
+        plugin_id = new_plugin_id;
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->add_plugin_to_track(plugin_id, track_id));
+        EXPECT_EQ(EngineReturnStatus::ERROR, _module_under_test->add_plugin_to_track(plugin_id, track_id));
+    }));
+
+    // Edits made outside of run_in_graph_transaction(), even from the same thread, are not part of it
+    EXPECT_FALSE(_module_under_test->_in_transaction());
+
+    EXPECT_EQ(5u, _module_under_test->_transaction->events.size());
+    EXPECT_FALSE(_module_under_test->_realtime_processors.processor(track_id));
+    EXPECT_FALSE(_module_under_test->_realtime_processors.processor(plugin_id));
+    EXPECT_EQ(1u, _processors->processors_on_track(track_id).size());
+
+    // All edits should take effect in the same chunk
+    auto rt = std::thread(faux_rt_thread, _module_under_test.get());
+    auto status = _module_under_test->commit_graph_transaction(transaction);
+    rt.join();
+    ASSERT_EQ(EngineReturnStatus::OK, status);
+    EXPECT_FALSE(_module_under_test->_transaction);
+    EXPECT_EQ(EngineReturnStatus::ERROR, _module_under_test->commit_graph_transaction(transaction));
+    ASSERT_TRUE(_module_under_test->_realtime_processors.processor(track_id));
+    ASSERT_TRUE(_module_under_test->_realtime_processors.processor(plugin_id));
+    ASSERT_EQ(1u, _module_under_test->_audio_graph._audio_graph[0].size());
+    EXPECT_EQ(1u, _module_under_test->_audio_graph._audio_graph[0][0].track->_processors.size());
+    EXPECT_EQ(1u, _module_under_test->audio_input_connections().size());
+
+    // If an edit fails, all edits in the transaction should be reverted
+    std::tie(begin_status, transaction) = _module_under_test->begin_graph_transaction(std::chrono::seconds(10));
+    ASSERT_EQ(EngineReturnStatus::OK, begin_status);
+    ObjectId new_plugin_id(0);
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->run_in_graph_transaction(transaction, [&]()
+    {
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->remove_plugin_from_track(plugin_id, track_id));
+        auto [load_status, loaded_plugin_id] = _module_under_test->create_processor(gain_plugin_info, "gain_1");
+        ASSERT_EQ(EngineReturnStatus::OK, load_status);
+        new_plugin_id = loaded_plugin_id;
+        EXPECT_EQ(EngineReturnStatus::INVALID_PROCESSOR, _module_under_test->add_plugin_to_track(new_plugin_id, track_id, ObjectId(12345)));
+        // Only one pre track is allowed, which is not known until the tracks are added in the rt thread
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->create_pre_track("pre_1").first);
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->create_pre_track("pre_2").first);
+    }));
+
+    rt = std::thread(faux_rt_thread, _module_under_test.get());
+    status = _module_under_test->commit_graph_transaction(transaction);
+    rt.join();
+    ASSERT_EQ(EngineReturnStatus::ERROR, status);
+    EXPECT_FALSE(_module_under_test->_realtime_processors.processor(new_plugin_id));
+    EXPECT_FALSE(_processors->processor_exists("gain_1"));
+    EXPECT_FALSE(_processors->processor_exists("pre_1"));
+    EXPECT_FALSE(_module_under_test->_pre_track);
+    ASSERT_EQ(1u, _processors->processors_on_track(track_id).size());
+    EXPECT_EQ(plugin_id, _processors->processors_on_track(track_id)[0]->id());
+    EXPECT_EQ(1u, _module_under_test->_audio_graph._audio_graph[0][0].track->_processors.size());
+    EXPECT_TRUE(_processors->mutable_processor(plugin_id)->enabled());
+
+    // Tear everything down in one transaction
+    std::tie(begin_status, transaction) = _module_under_test->begin_graph_transaction(std::chrono::seconds(10));
+    ASSERT_EQ(EngineReturnStatus::OK, begin_status);
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->run_in_graph_transaction(transaction, [&]()
+    {
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->remove_plugin_from_track(plugin_id, track_id));
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->delete_plugin(plugin_id));
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->delete_track(track_id));
+    }));
+
+    rt = std::thread(faux_rt_thread, _module_under_test.get());
+    status = _module_under_test->commit_graph_transaction(transaction);
+    rt.join();
+    ASSERT_EQ(EngineReturnStatus::OK, status);
+    EXPECT_FALSE(_processors->processor_exists(plugin_id));
+    EXPECT_FALSE(_processors->processor_exists(track_id));
+    EXPECT_FALSE(_module_under_test->_realtime_processors.processor(track_id));
+    EXPECT_FALSE(_module_under_test->_realtime_processors.processor(plugin_id));
+    EXPECT_TRUE(_module_under_test->_audio_graph._audio_graph[0].empty());
+    EXPECT_EQ(0u, _module_under_test->audio_input_connections().size());
+
+    // Outside of realtime mode, transactions have no effect
+    _module_under_test->enable_realtime(false);
+    std::tie(begin_status, transaction) = _module_under_test->begin_graph_transaction(std::chrono::seconds(10));
+    ASSERT_EQ(EngineReturnStatus::OK, begin_status);
+    EXPECT_FALSE(_module_under_test->_transaction);
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->commit_graph_transaction(transaction));
+}
+
+TEST_F(TestEngine, TestGraphTransactionAbort)
+{
+    PluginInfo gain_plugin_info;
+    gain_plugin_info.uid = "sushi.testing.gain";
+    gain_plugin_info.path = "";
+    gain_plugin_info.type = PluginType::INTERNAL;
+
+    ObjectId track_id(0);
+    ObjectId plugin_id(0);
+    EngineReturnStatus status;
+    std::tie(status, track_id) = _module_under_test->create_track("main", 2);
+    ASSERT_EQ(EngineReturnStatus::OK, status);
+    std::tie(status, plugin_id) = _module_under_test->create_processor(gain_plugin_info, "gain_0");
+    ASSERT_EQ(EngineReturnStatus::OK, status);
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->add_plugin_to_track(plugin_id, track_id));
+
+    _module_under_test->enable_realtime(true);
+    auto [begin_status, transaction] = _module_under_test->begin_graph_transaction(std::chrono::seconds(10));
+    ASSERT_EQ(EngineReturnStatus::OK, begin_status);
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->run_in_graph_transaction(transaction, [&]()
+    {
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->remove_plugin_from_track(plugin_id, track_id));
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->create_track("second", 2).first);
+    }));
+    EXPECT_TRUE(_processors->processors_on_track(track_id).empty());
+    EXPECT_TRUE(_processors->processor_exists("second"));
+
+    // Aborting should revert the edits without them reaching the rt thread, and close the transaction
+    EXPECT_EQ(EngineReturnStatus::ERROR, _module_under_test->abort_graph_transaction(transaction + 1));
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->abort_graph_transaction(transaction));
+    EXPECT_FALSE(_module_under_test->_transaction);
+    EXPECT_FALSE(_processors->processor_exists("second"));
+    ASSERT_EQ(1u, _processors->processors_on_track(track_id).size());
+    EXPECT_EQ(plugin_id, _processors->processors_on_track(track_id)[0]->id());
+    EXPECT_EQ(1u, _module_under_test->_audio_graph._audio_graph[0][0].track->_processors.size());
+
+    EXPECT_EQ(EngineReturnStatus::ERROR, _module_under_test->commit_graph_transaction(transaction));
+    EXPECT_EQ(EngineReturnStatus::ERROR, _module_under_test->abort_graph_transaction(transaction));
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->begin_graph_transaction(std::chrono::seconds(10)).first);
+}
+
+TEST_F(TestEngine, TestGraphTransactionExpiry)
+{
+    _module_under_test->enable_realtime(true);
+    auto [begin_status, transaction] = _module_under_test->begin_graph_transaction(std::chrono::milliseconds(10));
+    ASSERT_EQ(EngineReturnStatus::OK, begin_status);
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->run_in_graph_transaction(transaction, [&]()
+    {
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->create_track("main", 2).first);
+    }));
+    EXPECT_TRUE(_processors->processor_exists("main"));
+
+    // A transaction left open is rolled back once it expires, and can't be used anymore
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    _module_under_test->update_timings();
+    EXPECT_FALSE(_module_under_test->_transaction);
+    EXPECT_FALSE(_processors->processor_exists("main"));
+    EXPECT_EQ(EngineReturnStatus::ERROR, _module_under_test->run_in_graph_transaction(transaction, [](){}));
+    EXPECT_EQ(EngineReturnStatus::ERROR, _module_under_test->commit_graph_transaction(transaction));
+
+    // An expired transaction doesn't keep others from opening a new one
+    std::tie(begin_status, transaction) = _module_under_test->begin_graph_transaction(std::chrono::milliseconds(10));
+    ASSERT_EQ(EngineReturnStatus::OK, begin_status);
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    auto [new_status, new_transaction] = _module_under_test->begin_graph_transaction(std::chrono::seconds(10));
+    EXPECT_EQ(EngineReturnStatus::OK, new_status);
+    EXPECT_NE(transaction, new_transaction);
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->abort_graph_transaction(new_transaction));
+}
+
+TEST_F(TestEngine, TestGrowingRealtimeStorage)
+{
+    PluginInfo gain_plugin_info;
+    gain_plugin_info.uid = "sushi.testing.gain";
+    gain_plugin_info.path = "";
+    gain_plugin_info.type = PluginType::INTERNAL;
+
+    auto& rt_processors = _module_under_test->_realtime_processors;
+    int initial_capacity = rt_processors.capacity();
+    auto [track_status, track_id] = _module_under_test->create_track("main", 2);
+    ASSERT_EQ(EngineReturnStatus::OK, track_status);
+    auto track = _processors->mutable_track(track_id);
+    int initial_track_capacity = track->processor_capacity();
+
+    // Add more processors than fit in the initial rt table and on a track
+    std::vector<ObjectId> plugins;
+    for (int i = 0; i < initial_capacity; ++i)
+    {
+        auto [status, id] = _module_under_test->create_processor(gain_plugin_info, "gain_" + std::to_string(i));
+        ASSERT_EQ(EngineReturnStatus::OK, status);
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->add_plugin_to_track(id, track_id));
+        plugins.push_back(id);
+    }
+    EXPECT_GT(rt_processors.capacity(), initial_capacity);
+    EXPECT_GT(track->processor_capacity(), initial_track_capacity);
+    EXPECT_EQ(initial_capacity, static_cast<int>(track->processors().size()));
+    for (auto id : plugins)
+    {
+        EXPECT_TRUE(rt_processors.processor(id));
+    }
+
+    // The rt table should shrink again when most processors are deleted
+    for (auto id : plugins)
+    {
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->remove_plugin_from_track(id, track_id));
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->delete_plugin(id));
+        EXPECT_FALSE(rt_processors.processor(id));
+    }
+    EXPECT_EQ(initial_capacity, rt_processors.capacity());
+    EXPECT_EQ(1, rt_processors.size());
+    EXPECT_TRUE(rt_processors.processor(track_id));
+
+    // Add more tracks than the audio graph initially has room for, with the rt thread running
+    _module_under_test->enable_realtime(true);
+    std::atomic_bool running = true;
+    auto rt = std::thread([&]()
+    {
+        SampleBuffer<AUDIO_CHUNK_SIZE> in_buffer(2);
+        SampleBuffer<AUDIO_CHUNK_SIZE> out_buffer(2);
+        ControlBuffer control_buffer;
+        while (running)
+        {
+            _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+            std::this_thread::sleep_for(std::chrono::microseconds(500));
+        }
+    });
+    int initial_tracks = _module_under_test->_audio_graph.max_tracks();
+    for (int i = 0; i < initial_tracks; ++i)
+    {
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->create_track("track_" + std::to_string(i), 2).first);
+    }
+    // And more audio connections than initially fit
+    auto initial_connections = _module_under_test->_audio_out_connections.capacity();
+    for (size_t i = 0; i <= initial_connections; ++i)
+    {
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->connect_audio_output_channel(0, 0, track_id));
+    }
+    running = false;
+    rt.join();
+    _module_under_test->enable_realtime(false);
+    EXPECT_GT(_module_under_test->_audio_out_connections.capacity(), initial_connections);
+    EXPECT_EQ(initial_connections + 1, _module_under_test->audio_output_connections().size());
+    EXPECT_GE(_module_under_test->_audio_graph.max_dependencies(), static_cast<int>(_processors->all_processors().size()));
+    EXPECT_GT(_module_under_test->_audio_graph.max_tracks(), initial_tracks);
+    EXPECT_EQ(initial_tracks + 1, static_cast<int>(_module_under_test->_audio_graph._audio_graph[0].size()));
+    EXPECT_EQ(initial_tracks + 1, rt_processors.size());
 }
 
 TEST_F(TestEngine, TestAudioConnections)
@@ -609,3 +874,532 @@ TEST_F(TestEngine, TestMasterTrackProcessing)
     _module_under_test->process_chunk(&in_buffer, &out_buffer, &ctrl_buffer, &ctrl_buffer, Time(0), 0);
     EXPECT_GE(out_buffer.channel(0)[0], 1.0f);
 }
+
+TEST_F(TestEngine, TestPinTrackToCore)
+{
+    auto engine = std::make_unique<AudioEngine>(SAMPLE_RATE, 2);
+    auto [status_1, track_1] = engine->create_track("track_1", 2);
+    auto [status_2, track_2] = engine->create_track("track_2", 2);
+    ASSERT_EQ(EngineReturnStatus::OK, status_1);
+    ASSERT_EQ(EngineReturnStatus::OK, status_2);
+    EXPECT_EQ(0, engine->_processors.track(track_1)->assigned_core());
+    EXPECT_EQ(1, engine->_processors.track(track_2)->assigned_core());
+
+    EXPECT_EQ(EngineReturnStatus::OK, engine->pin_track_to_core(track_1, 1));
+    EXPECT_EQ(1, engine->_processors.track(track_1)->assigned_core());
+    EXPECT_EQ(2u, engine->_audio_graph._audio_graph[1].size());
+    EXPECT_EQ(1, engine->_track_balancer.pinned_core(track_1));
+
+    EXPECT_EQ(EngineReturnStatus::ERROR, engine->pin_track_to_core(track_1, 2));
+    EXPECT_EQ(EngineReturnStatus::INVALID_TRACK, engine->pin_track_to_core(ObjectId(12345), 0));
+
+    EXPECT_EQ(EngineReturnStatus::OK, engine->pin_track_to_core(track_1, std::nullopt));
+    EXPECT_FALSE(engine->_track_balancer.pinned_core(track_1).has_value());
+    EXPECT_EQ(1, engine->_processors.track(track_1)->assigned_core());
+}
+
+TEST_F(TestEngine, TestWorkerWatchdog)
+{
+    auto engine = std::make_unique<AudioEngine>(SAMPLE_RATE, 2);
+    auto [status, track] = engine->create_track("track", 2);
+    ASSERT_EQ(EngineReturnStatus::OK, status);
+    engine->set_worker_watchdog(4.0f);
+    auto period = std::chrono::duration<float>(AUDIO_CHUNK_SIZE / SAMPLE_RATE);
+    EXPECT_NEAR(4.0f * period.count(), std::chrono::duration<float>(engine->_audio_graph._watchdog_timeout.load()).count(), 1.0e-6);
+
+    // A stalled core should be reported once, and again when it recovers
+    auto& stall = engine->_audio_graph._core_watch[1].stall;
+    stall = {true, track, ObjectId(1234)};
+    engine->_report_stalled_cores();
+    engine->_report_stalled_cores();
+    RtEvent event;
+    ASSERT_TRUE(engine->_main_out_queue.pop(event));
+    ASSERT_EQ(RtEventType::CORE_STALL_NOTIFICATION, event.type());
+    auto typed_event = event.core_stall_notification_event();
+    EXPECT_EQ(1, typed_event->core());
+    EXPECT_EQ(track, typed_event->track());
+    EXPECT_EQ(ObjectId(1234), typed_event->processor_id());
+    EXPECT_TRUE(typed_event->stalled());
+    EXPECT_FALSE(engine->_main_out_queue.pop(event));
+
+    stall = CoreStall();
+    engine->_report_stalled_cores();
+    ASSERT_TRUE(engine->_main_out_queue.pop(event));
+    EXPECT_FALSE(event.core_stall_notification_event()->stalled());
+}
+
+TEST_F(TestEngine, TestGroupTracks)
+{
+    auto [status_1, track_1] = _module_under_test->create_track("track_1", 2);
+    auto [status_2, track_2] = _module_under_test->create_track("track_2", 2);
+    auto [status_3, group] = _module_under_test->create_track("group", 2);
+    auto [status_4, master] = _module_under_test->create_track("master", 2);
+    ASSERT_EQ(EngineReturnStatus::OK, status_1);
+    ASSERT_EQ(EngineReturnStatus::OK, status_2);
+    ASSERT_EQ(EngineReturnStatus::OK, status_3);
+    ASSERT_EQ(EngineReturnStatus::OK, status_4);
+    _module_under_test->connect_audio_input_bus(0, 0, track_1);
+    _module_under_test->connect_audio_input_bus(1, 0, track_2);
+    _module_under_test->connect_audio_output_bus(0, 0, master);
+
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->connect_track_to_group(track_1, group));
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->connect_track_to_group(track_2, group));
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->connect_track_to_group(group, master));
+
+    // Cycles, tracks routed to themselves and unknown tracks should be refused
+    EXPECT_EQ(EngineReturnStatus::ERROR, _module_under_test->connect_track_to_group(master, track_1));
+    EXPECT_EQ(EngineReturnStatus::INVALID_TRACK, _module_under_test->connect_track_to_group(group, group));
+    EXPECT_EQ(EngineReturnStatus::INVALID_TRACK, _module_under_test->connect_track_to_group(ObjectId(12345), group));
+
+    SampleBuffer<AUDIO_CHUNK_SIZE> in_buffer(TEST_CHANNEL_COUNT);
+    SampleBuffer<AUDIO_CHUNK_SIZE> out_buffer(TEST_CHANNEL_COUNT);
+    ControlBuffer control_buffer;
+    test_utils::fill_sample_buffer(in_buffer, 1.0f);
+
+    // Both tracks are summed by the group, which is passed on to the master track
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+    EXPECT_EQ(3, _module_under_test->_audio_graph._levels);
+    auto main_bus = SampleBuffer<AUDIO_CHUNK_SIZE>::create_non_owning_buffer(out_buffer, 0, 2);
+    test_utils::assert_buffer_value(2.0f, main_bus, test_utils::DECIBEL_ERROR);
+
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->disconnect_track_from_group(track_2));
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+    test_utils::assert_buffer_value(1.0f, main_bus, test_utils::DECIBEL_ERROR);
+
+    // Deleting a group should disconnect its members
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->delete_track(group));
+    EXPECT_EQ(nullptr, _module_under_test->_processors.track(track_1)->output_group());
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+    EXPECT_EQ(1, _module_under_test->_audio_graph._levels);
+    test_utils::assert_buffer_value(0.0f, main_bus, test_utils::DECIBEL_ERROR);
+}
+
+class ConstantProcessor : public DummyProcessor
+{
+public:
+    explicit ConstantProcessor(HostControl host_control) : DummyProcessor(host_control) {}
+
+    void process_audio(const ChunkSampleBuffer& /*in_buffer*/, ChunkSampleBuffer& out_buffer) override
+    {
+        test_utils::fill_sample_buffer(out_buffer, 0.5f);
+    }
+};
+
+TEST_F(TestEngine, TestFreezeTrack)
+{
+    auto [status, track_id] = _module_under_test->create_track("track", 2);
+    ASSERT_EQ(EngineReturnStatus::OK, status);
+    _module_under_test->connect_audio_input_bus(0, 0, track_id);
+    _module_under_test->connect_audio_output_bus(0, 0, track_id);
+
+    EXPECT_EQ(EngineReturnStatus::INVALID_TRACK, _module_under_test->freeze_track(ObjectId(12345), std::chrono::seconds(1)));
+    EXPECT_EQ(EngineReturnStatus::ERROR, _module_under_test->freeze_track(track_id, Time(0)));
+    // Without any live input, the track only renders silence
+    EXPECT_EQ(EngineReturnStatus::ERROR, _module_under_test->freeze_track(track_id, std::chrono::milliseconds(10)));
+
+    auto processor = std::make_shared<ConstantProcessor>(_module_under_test->_host_control);
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->_register_processor(processor, "constant"));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->add_plugin_to_track(processor->id(), track_id));
+
+    // A frozen track renders with silent input, so live input should not be heard
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->freeze_track(track_id, std::chrono::milliseconds(10)));
+    EXPECT_EQ(EngineReturnStatus::ERROR, _module_under_test->freeze_track(track_id, std::chrono::milliseconds(10)));
+    auto track = _module_under_test->_processors.track(track_id);
+    EXPECT_TRUE(track->frozen());
+    EXPECT_EQ(static_cast<size_t>(std::ceil(0.01f * SAMPLE_RATE / AUDIO_CHUNK_SIZE)), track->_frozen_audio.size());
+    EXPECT_EQ(track.get(), _module_under_test->_realtime_processors.processor(track_id));
+    EXPECT_EQ(1u, _module_under_test->_audio_graph._audio_graph[0].size());
+
+    SampleBuffer<AUDIO_CHUNK_SIZE> in_buffer(TEST_CHANNEL_COUNT);
+    SampleBuffer<AUDIO_CHUNK_SIZE> out_buffer(TEST_CHANNEL_COUNT);
+    ControlBuffer control_buffer;
+    test_utils::fill_sample_buffer(in_buffer, 1.0f);
+    auto main_bus = SampleBuffer<AUDIO_CHUNK_SIZE>::create_non_owning_buffer(out_buffer, 0, 2);
+
+    // Playback follows the transport and is silent while it is stopped
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+    test_utils::assert_buffer_value(0.0f, main_bus, test_utils::DECIBEL_ERROR);
+    _module_under_test->_transport.set_playing_mode(PlayingMode::PLAYING, false);
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), AUDIO_CHUNK_SIZE);
+    test_utils::assert_buffer_value(0.5f, main_bus, test_utils::DECIBEL_ERROR);
+
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->unfreeze_track(track_id));
+    EXPECT_FALSE(track->frozen());
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 2 * AUDIO_CHUNK_SIZE);
+    test_utils::assert_buffer_value(0.5f, main_bus, test_utils::DECIBEL_ERROR);
+}
+
+TEST_F(TestEngine, TestLatencyCompensation)
+{
+    auto [status_1, track_1] = _module_under_test->create_track("track_1", 2);
+    auto [status_2, track_2] = _module_under_test->create_track("track_2", 2);
+    ASSERT_EQ(EngineReturnStatus::OK, status_1);
+    ASSERT_EQ(EngineReturnStatus::OK, status_2);
+    _module_under_test->connect_audio_input_bus(0, 0, track_1);
+    _module_under_test->connect_audio_input_bus(0, 0, track_2);
+    _module_under_test->connect_audio_output_bus(0, 0, track_1);
+    _module_under_test->connect_audio_output_bus(1, 0, track_2);
+
+    PluginInfo plugin_info;
+    plugin_info.uid = "sushi.testing.gain";
+    plugin_info.path = "";
+    plugin_info.type = PluginType::INTERNAL;
+    auto [load_status, plugin_id] = _module_under_test->create_processor(plugin_info, "gain");
+    ASSERT_EQ(EngineReturnStatus::OK, load_status);
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->add_plugin_to_track(plugin_id, track_1));
+    EXPECT_EQ(0, _module_under_test->processing_latency());
+
+    // Latency reported by plugins should be picked up periodically
+    _module_under_test->_processors.mutable_processor(plugin_id)->set_latency(AUDIO_CHUNK_SIZE);
+    _module_under_test->update_timings();
+    EXPECT_EQ(AUDIO_CHUNK_SIZE, _module_under_test->processing_latency());
+    EXPECT_EQ(AUDIO_CHUNK_SIZE, _module_under_test->track_latency(track_1).second);
+    EXPECT_EQ(0, _module_under_test->track_latency(track_2).second);
+    EXPECT_EQ(EngineReturnStatus::INVALID_TRACK, _module_under_test->track_latency(ObjectId(12345)).first);
+    EXPECT_EQ(0, _module_under_test->_processors.track(track_1)->compensation_delay());
+    EXPECT_EQ(AUDIO_CHUNK_SIZE, _module_under_test->_processors.track(track_2)->compensation_delay());
+
+    // The output of track 2 should be delayed to line up with that of track 1
+    SampleBuffer<AUDIO_CHUNK_SIZE> in_buffer(TEST_CHANNEL_COUNT);
+    SampleBuffer<AUDIO_CHUNK_SIZE> out_buffer(TEST_CHANNEL_COUNT);
+    ControlBuffer control_buffer;
+    test_utils::fill_sample_buffer(in_buffer, 1.0f);
+    auto bus_1 = SampleBuffer<AUDIO_CHUNK_SIZE>::create_non_owning_buffer(out_buffer, 0, 2);
+    auto bus_2 = SampleBuffer<AUDIO_CHUNK_SIZE>::create_non_owning_buffer(out_buffer, 2, 2);
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+    test_utils::assert_buffer_value(1.0f, bus_1, test_utils::DECIBEL_ERROR);
+    test_utils::assert_buffer_value(0.0f, bus_2, test_utils::DECIBEL_ERROR);
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+    test_utils::assert_buffer_value(1.0f, bus_2, test_utils::DECIBEL_ERROR);
+
+    // Tracks in a group are lined up with each other, and the group includes their latency
+    auto [group_status, group] = _module_under_test->create_track("group", 2);
+    ASSERT_EQ(EngineReturnStatus::OK, group_status);
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->connect_track_to_group(track_1, group));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->connect_track_to_group(track_2, group));
+    EXPECT_EQ(AUDIO_CHUNK_SIZE, _module_under_test->track_latency(group).second);
+    EXPECT_EQ(AUDIO_CHUNK_SIZE, _module_under_test->_processors.track(track_2)->compensation_delay());
+    EXPECT_EQ(0, _module_under_test->_processors.track(group)->compensation_delay());
+
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->remove_plugin_from_track(plugin_id, track_1));
+    EXPECT_EQ(0, _module_under_test->processing_latency());
+    EXPECT_EQ(0, _module_under_test->_processors.track(track_2)->compensation_delay());
+}
+
+TEST_F(TestEngine, TestOverloadShedding)
+{
+    auto [status_1, track_1] = _module_under_test->create_track("track_1", 2);
+    auto [status_2, track_2] = _module_under_test->create_track("track_2", 2);
+    ASSERT_EQ(EngineReturnStatus::OK, status_1);
+    ASSERT_EQ(EngineReturnStatus::OK, status_2);
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->set_track_priority(track_1, 10));
+    EXPECT_EQ(EngineReturnStatus::INVALID_TRACK, _module_under_test->set_track_priority(ObjectId(12345), 10));
+    EXPECT_EQ(10, _module_under_test->_processors.track(track_1)->priority());
+
+    // With a very short timing period, every chunk overloads the engine
+    _module_under_test->set_overload_shedding(true);
+    _module_under_test->_process_timer.set_timing_period(std::chrono::nanoseconds(1));
+    SampleBuffer<AUDIO_CHUNK_SIZE> in_buffer(TEST_CHANNEL_COUNT);
+    SampleBuffer<AUDIO_CHUNK_SIZE> out_buffer(TEST_CHANNEL_COUNT);
+    ControlBuffer control_buffer;
+    for (int i = 0; i <= OverloadShedder::OVERLOAD_CHUNKS; ++i)
+    {
+        _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+    }
+    EXPECT_EQ(1, _module_under_test->_audio_graph.shed_tracks());
+    EXPECT_TRUE(_module_under_test->_processors.track(track_2)->shed());
+    EXPECT_FALSE(_module_under_test->_processors.track(track_1)->shed());
+
+    // All tracks should be rendered again when shedding is turned off
+    _module_under_test->set_overload_shedding(false);
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+    EXPECT_EQ(0, _module_under_test->_audio_graph.shed_tracks());
+    _module_under_test->_process_timer.enable(false);
+}
+
+TEST_F(TestEngine, TestCpuBudget)
+{
+    auto [status_1, track_1] = _module_under_test->create_track("track_1", 2);
+    auto [status_2, track_2] = _module_under_test->create_track("track_2", 2);
+    ASSERT_EQ(EngineReturnStatus::OK, status_1);
+    ASSERT_EQ(EngineReturnStatus::OK, status_2);
+    PluginInfo plugin_info;
+    plugin_info.uid = "sushi.testing.gain";
+    plugin_info.path = "";
+    plugin_info.type = PluginType::INTERNAL;
+    auto [load_status, plugin_id] = _module_under_test->create_processor(plugin_info, "gain");
+    ASSERT_EQ(EngineReturnStatus::OK, load_status);
+
+    // Plugins of unknown cost are let through
+    auto [prediction_status, prediction] = _module_under_test->predict_plugin_load(plugin_info.uid, track_1);
+    ASSERT_EQ(EngineReturnStatus::OK, prediction_status);
+    EXPECT_FALSE(prediction.plugin_known);
+    EXPECT_FALSE(prediction.budget.has_value());
+    EXPECT_TRUE(prediction.within_budget);
+    EXPECT_EQ(EngineReturnStatus::INVALID_TRACK, _module_under_test->predict_plugin_load(plugin_info.uid, ObjectId(12345)).first);
+
+    _module_under_test->set_cpu_budget(0.5f);
+    _module_under_test->_plugin_costs._costs[plugin_info.uid] = 0.6f;
+    prediction = _module_under_test->predict_plugin_load(plugin_info.uid, track_1).second;
+    EXPECT_TRUE(prediction.plugin_known);
+    EXPECT_FLOAT_EQ(0.6f, prediction.plugin_load);
+    EXPECT_FLOAT_EQ(0.6f, prediction.predicted_load);
+    EXPECT_FLOAT_EQ(0.5f, prediction.budget.value());
+    EXPECT_FALSE(prediction.within_budget);
+    EXPECT_EQ(EngineReturnStatus::CPU_BUDGET_EXCEEDED, _module_under_test->add_plugin_to_track(plugin_id, track_1));
+
+    // The refusal is posted with the prediction, for controller clients
+    auto dispatcher = static_cast<dispatcher::EventDispatcher*>(_module_under_test->_event_dispatcher.get());
+    const CpuBudgetNotificationEvent* notification = nullptr;
+    while (dispatcher->_in_queue.empty() == false)
+    {
+        auto event = dispatcher->_in_queue.pop();
+        if (event->is_engine_notification() &&
+            static_cast<EngineNotificationEvent*>(event)->is_cpu_budget_notification())
+        {
+            delete notification;
+            notification = static_cast<CpuBudgetNotificationEvent*>(event);
+            continue;
+        }
+        delete event;
+    }
+    ASSERT_NE(nullptr, notification);
+    EXPECT_EQ(plugin_id, notification->processor());
+    EXPECT_EQ(track_1, notification->track());
+    EXPECT_FLOAT_EQ(0.6f, notification->prediction().predicted_load);
+    EXPECT_TRUE(notification->rejected());
+    delete notification;
+
+    // Only warned about, and once added, the plugin can be moved between tracks
+    _module_under_test->set_cpu_budget(0.5f, CpuBudgetPolicy::WARN);
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->add_plugin_to_track(plugin_id, track_1));
+    _module_under_test->set_cpu_budget(0.5f, CpuBudgetPolicy::REJECT);
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->remove_plugin_from_track(plugin_id, track_1));
+    EXPECT_EQ(EngineReturnStatus::OK, _module_under_test->add_plugin_to_track(plugin_id, track_2));
+
+    _module_under_test->set_cpu_budget(std::nullopt);
+    _module_under_test->_process_timer.enable(false);
+}
+
+TEST_F(TestEngine, TestRenderAhead)
+{
+    auto [status, track_id] = _module_under_test->create_track("track", 2);
+    ASSERT_EQ(EngineReturnStatus::OK, status);
+    _module_under_test->connect_audio_input_channel(0, 0, track_id);
+    _module_under_test->connect_audio_output_bus(0, 0, track_id);
+
+    PluginInfo plugin_info;
+    plugin_info.uid = "sushi.testing.gain";
+    plugin_info.path = "";
+    plugin_info.type = PluginType::INTERNAL;
+    auto [load_status, plugin_id] = _module_under_test->create_processor(plugin_info, "gain");
+    ASSERT_EQ(EngineReturnStatus::OK, load_status);
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->add_plugin_to_track(plugin_id, track_id));
+
+    EXPECT_EQ(EngineReturnStatus::INVALID_TRACK, _module_under_test->set_track_render_ahead(ObjectId(12345), 2));
+    EXPECT_EQ(EngineReturnStatus::ERROR, _module_under_test->set_track_render_ahead(track_id, -1));
+
+    // Tracks with live input can't be rendered ahead
+    EXPECT_EQ(EngineReturnStatus::ERROR, _module_under_test->set_track_render_ahead(track_id, 2));
+    EXPECT_TRUE(_module_under_test->_render_ahead_hosts.empty());
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->disconnect_audio_input_channel(0, 0, track_id));
+
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->set_track_render_ahead(track_id, 2));
+    EXPECT_EQ(EngineReturnStatus::ERROR, _module_under_test->connect_audio_input_bus(0, 0, track_id));
+    ASSERT_EQ(1u, _module_under_test->_render_ahead_hosts.size());
+    auto host = _module_under_test->_render_ahead_hosts[track_id].get();
+    EXPECT_EQ(host, _module_under_test->_rt_render_ahead_hosts[0].load());
+    auto track = _module_under_test->_processors.track(track_id);
+    EXPECT_EQ(host, track->render_ahead_host());
+    auto plugin = _module_under_test->_processors.mutable_processor(plugin_id);
+    EXPECT_EQ(&host->_transport, plugin->_host_control.transport());
+    EXPECT_EQ(0, _module_under_test->_plugin_latency(track.get()));
+    EXPECT_EQ(0, _module_under_test->processing_latency());
+
+    // The plugins are processed by the host, while the track itself stays in the rt part
+    EXPECT_EQ(nullptr, _module_under_test->_realtime_processors.processor(plugin_id));
+    EXPECT_EQ(track.get(), _module_under_test->_realtime_processors.processor(track_id));
+    EXPECT_EQ(EngineReturnStatus::ALREADY_IN_USE, _module_under_test->freeze_track(track_id, std::chrono::milliseconds(10)));
+    EXPECT_EQ(EngineReturnStatus::ALREADY_IN_USE, _module_under_test->set_processor_async(plugin_id, track_id, true));
+    EXPECT_EQ(EngineReturnStatus::ALREADY_IN_USE, _module_under_test->remove_plugin_from_track(plugin_id, track_id));
+
+    // Processing hands the host the transport, after which it renders ahead
+    SampleBuffer<AUDIO_CHUNK_SIZE> in_buffer(TEST_CHANNEL_COUNT);
+    SampleBuffer<AUDIO_CHUNK_SIZE> out_buffer(TEST_CHANNEL_COUNT);
+    ControlBuffer control_buffer;
+    test_utils::fill_sample_buffer(in_buffer, 1.0f);
+    auto main_bus = SampleBuffer<AUDIO_CHUNK_SIZE>::create_non_owning_buffer(out_buffer, 0, 2);
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+    test_utils::assert_buffer_value(0.0f, main_bus, test_utils::DECIBEL_ERROR);
+    while (host->_written.load() < 2)
+    {
+        std::this_thread::yield();
+    }
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+    test_utils::assert_buffer_value(0.0f, main_bus, test_utils::DECIBEL_ERROR);
+    EXPECT_EQ(0, host->underruns());
+
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->set_track_render_ahead(track_id, 0));
+    EXPECT_TRUE(_module_under_test->_render_ahead_hosts.empty());
+    EXPECT_EQ(nullptr, _module_under_test->_rt_render_ahead_hosts[0].load());
+    EXPECT_EQ(nullptr, track->render_ahead_host());
+    EXPECT_NE(nullptr, _module_under_test->_realtime_processors.processor(plugin_id));
+    EXPECT_EQ(&_module_under_test->_transport, plugin->_host_control.transport());
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->connect_audio_input_bus(0, 0, track_id));
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+    test_utils::assert_buffer_value(1.0f, main_bus, test_utils::DECIBEL_ERROR);
+}
+
+TEST_F(TestEngine, TestAsyncProcessing)
+{
+    auto [status, track_id] = _module_under_test->create_track("test_track", 2);
+    ASSERT_EQ(EngineReturnStatus::OK, status);
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->connect_audio_input_bus(0, 0, track_id));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->connect_audio_output_bus(0, 0, track_id));
+
+    PluginInfo plugin_info;
+    plugin_info.uid = "sushi.testing.gain";
+    plugin_info.path = "";
+    plugin_info.type = PluginType::INTERNAL;
+
+    auto [load_status, plugin_id] = _module_under_test->create_processor(plugin_info, "gain");
+    ASSERT_EQ(EngineReturnStatus::OK, load_status);
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->add_plugin_to_track(plugin_id, track_id));
+
+    EXPECT_EQ(EngineReturnStatus::INVALID_PLUGIN, _module_under_test->set_processor_async(ObjectId(12345), track_id, true));
+    EXPECT_EQ(EngineReturnStatus::INVALID_TRACK, _module_under_test->set_processor_async(plugin_id, ObjectId(12345), true));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->set_processor_async(plugin_id, track_id, true));
+    EXPECT_EQ(1u, _module_under_test->_async_hosts.size());
+
+    SampleBuffer<AUDIO_CHUNK_SIZE> in_buffer(TEST_CHANNEL_COUNT);
+    SampleBuffer<AUDIO_CHUNK_SIZE> out_buffer(TEST_CHANNEL_COUNT);
+    ControlBuffer control_buffer;
+    test_utils::fill_sample_buffer(in_buffer, 1.0f);
+    auto main_bus = SampleBuffer<AUDIO_CHUNK_SIZE>::create_non_owning_buffer(out_buffer, 0, 2);
+
+    // Audio through the plugin should be delayed by one chunk
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+    test_utils::assert_buffer_value(0.0f, main_bus);
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+    test_utils::assert_buffer_value(1.0f, main_bus, test_utils::DECIBEL_ERROR);
+
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->set_processor_async(plugin_id, track_id, false));
+    EXPECT_TRUE(_module_under_test->_async_hosts.empty());
+
+    // Removing the plugin from the track should also remove its host
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->set_processor_async(plugin_id, track_id, true));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->remove_plugin_from_track(plugin_id, track_id));
+    EXPECT_TRUE(_module_under_test->_async_hosts.empty());
+}
+
+TEST_F(TestEngine, TestPipelineProcessing)
+{
+    auto [status, track_id] = _module_under_test->create_track("test_track", 2);
+    ASSERT_EQ(EngineReturnStatus::OK, status);
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->connect_audio_input_bus(0, 0, track_id));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->connect_audio_output_bus(0, 0, track_id));
+
+    PluginInfo plugin_info;
+    plugin_info.uid = "sushi.testing.gain";
+    plugin_info.path = "";
+    plugin_info.type = PluginType::INTERNAL;
+
+    std::vector<ObjectId> plugins;
+    for (int i = 0; i < 4; ++i)
+    {
+        auto [load_status, plugin_id] = _module_under_test->create_processor(plugin_info, "gain_" + std::to_string(i));
+        ASSERT_EQ(EngineReturnStatus::OK, load_status);
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->add_plugin_to_track(plugin_id, track_id));
+        plugins.push_back(plugin_id);
+    }
+
+    EXPECT_EQ(EngineReturnStatus::INVALID_TRACK, _module_under_test->set_track_pipeline_stages(ObjectId(12345), 2));
+    EXPECT_EQ(EngineReturnStatus::ERROR, _module_under_test->set_track_pipeline_stages(track_id, -1));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->set_track_pipeline_stages(track_id, 2));
+
+    // Without timings, the chain should be split evenly
+    auto stages = _module_under_test->track_pipeline(track_id);
+    ASSERT_EQ(2u, stages.size());
+    EXPECT_EQ(std::vector<ObjectId>({plugins[0], plugins[1]}), stages[0].processors);
+    EXPECT_EQ(std::vector<ObjectId>({plugins[2], plugins[3]}), stages[1].processors);
+    EXPECT_NE(stages[0].timing_id, stages[1].timing_id);
+
+    // Plugins in a pipelined track can't be processed asynchronously on their own
+    EXPECT_EQ(EngineReturnStatus::ALREADY_IN_USE, _module_under_test->set_processor_async(plugins[0], track_id, true));
+
+    SampleBuffer<AUDIO_CHUNK_SIZE> in_buffer(TEST_CHANNEL_COUNT);
+    SampleBuffer<AUDIO_CHUNK_SIZE> out_buffer(TEST_CHANNEL_COUNT);
+    ControlBuffer control_buffer;
+    test_utils::fill_sample_buffer(in_buffer, 1.0f);
+    auto main_bus = SampleBuffer<AUDIO_CHUNK_SIZE>::create_non_owning_buffer(out_buffer, 0, 2);
+
+    // Audio through the track should be delayed by one chunk per stage
+    for (int i = 0; i < 2; ++i)
+    {
+        _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+        test_utils::assert_buffer_value(0.0f, main_bus);
+    }
+    _module_under_test->process_chunk(&in_buffer, &out_buffer, &control_buffer, &control_buffer, Time(0), 0);
+    test_utils::assert_buffer_value(1.0f, main_bus, test_utils::DECIBEL_ERROR);
+
+    // Removing a plugin should split the chain again, reusing the hosts of the stages
+    auto timing_ids = std::make_pair(stages[0].timing_id, stages[1].timing_id);
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->remove_plugin_from_track(plugins[1], track_id));
+    stages = _module_under_test->track_pipeline(track_id);
+    ASSERT_EQ(2u, stages.size());
+    EXPECT_EQ(timing_ids, std::make_pair(stages[0].timing_id, stages[1].timing_id));
+    EXPECT_EQ(3u, stages[0].processors.size() + stages[1].processors.size());
+    EXPECT_EQ(plugins[0], stages[0].processors.front());
+    EXPECT_EQ(plugins[3], stages[1].processors.back());
+
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->set_track_pipeline_stages(track_id, 0));
+    EXPECT_TRUE(_module_under_test->track_pipeline(track_id).empty());
+    EXPECT_TRUE(_module_under_test->_pipelines.empty());
+}
+
+TEST_F(TestEngine, TestProcessorBus)
+{
+    auto [status, track_id] = _module_under_test->create_multibus_track("multi", 2);
+    ASSERT_EQ(EngineReturnStatus::OK, status);
+    auto [single_status, single_track_id] = _module_under_test->create_track("single", 2);
+    ASSERT_EQ(EngineReturnStatus::OK, single_status);
+
+    PluginInfo plugin_info;
+    plugin_info.uid = "sushi.testing.gain";
+    plugin_info.path = "";
+    plugin_info.type = PluginType::INTERNAL;
+
+    std::vector<ObjectId> plugins;
+    for (int i = 0; i < 2; ++i)
+    {
+        auto [load_status, plugin_id] = _module_under_test->create_processor(plugin_info, "gain_" + std::to_string(i));
+        ASSERT_EQ(EngineReturnStatus::OK, load_status);
+        ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->add_plugin_to_track(plugin_id, track_id));
+        plugins.push_back(plugin_id);
+    }
+
+    EXPECT_EQ(EngineReturnStatus::INVALID_PLUGIN, _module_under_test->set_processor_bus(ObjectId(12345), track_id, 0));
+    EXPECT_EQ(EngineReturnStatus::INVALID_TRACK, _module_under_test->set_processor_bus(plugins[0], ObjectId(12345), 0));
+    EXPECT_EQ(EngineReturnStatus::INVALID_BUS, _module_under_test->set_processor_bus(plugins[0], track_id, 2));
+    EXPECT_EQ(EngineReturnStatus::INVALID_BUS, _module_under_test->set_processor_bus(plugins[0], single_track_id, 0));
+
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->set_processor_bus(plugins[0], track_id, 0));
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->set_processor_bus(plugins[1], track_id, 1));
+    auto track = _module_under_test->processor_container()->track(track_id);
+    EXPECT_TRUE(track->independent_buses());
+    EXPECT_EQ(1, track->processor_bus(plugins[1]).value_or(-1));
+
+    // The order of the chain should be kept
+    auto chain = _module_under_test->processor_container()->processors_on_track(track_id);
+    ASSERT_EQ(2u, chain.size());
+    EXPECT_EQ(plugins[0], chain[0]->id());
+    EXPECT_EQ(plugins[1], chain[1]->id());
+    EXPECT_EQ(2, chain[0]->input_channels());
+
+    // Bus assigned plugins can't be processed asynchronously
+    EXPECT_EQ(EngineReturnStatus::ALREADY_IN_USE, _module_under_test->set_processor_async(plugins[0], track_id, true));
+
+    ASSERT_EQ(EngineReturnStatus::OK, _module_under_test->set_processor_bus(plugins[1], track_id, std::nullopt));
+    EXPECT_FALSE(track->independent_buses());
+}
@@ -0,0 +1,61 @@
+#include "gtest/gtest.h"
+
+#define private public
+
+#include "engine/overload_shedder.cpp"
+
+using namespace sushi;
+using namespace sushi::engine;
+
+constexpr float OVERLOAD = 1.1f;
+constexpr float NORMAL_LOAD = 0.7f;
+constexpr float LOW_LOAD = 0.2f;
+
+class TestOverloadShedder : public ::testing::Test
+{
+protected:
+    TestOverloadShedder() {}
+
+    OverloadShedder _module_under_test;
+};
+
+TEST_F(TestOverloadShedder, TestShedding)
+{
+    // Single spikes are let through
+    EXPECT_EQ(ShedAction::NONE, _module_under_test.update(OVERLOAD, false));
+    EXPECT_EQ(ShedAction::NONE, _module_under_test.update(NORMAL_LOAD, false));
+    for (int i = 0; i < OverloadShedder::OVERLOAD_CHUNKS - 1; ++i)
+    {
+        EXPECT_EQ(ShedAction::NONE, _module_under_test.update(OVERLOAD, false));
+    }
+    EXPECT_EQ(ShedAction::SHED, _module_under_test.update(OVERLOAD, false));
+
+    // No more tracks are shed until the load has had time to settle
+    for (int i = 0; i < OverloadShedder::SETTLE_CHUNKS; ++i)
+    {
+        EXPECT_EQ(ShedAction::NONE, _module_under_test.update(OVERLOAD, true));
+    }
+    EXPECT_EQ(ShedAction::SHED, _module_under_test.update(OVERLOAD, true));
+}
+
+TEST_F(TestOverloadShedder, TestRestoring)
+{
+    // Nothing to restore if no tracks are shed
+    for (int i = 0; i < OverloadShedder::RESTORE_CHUNKS; ++i)
+    {
+        EXPECT_EQ(ShedAction::NONE, _module_under_test.update(LOW_LOAD, false));
+    }
+    _module_under_test.reset();
+
+    // A normal load doesn't restore tracks, only a load well below the deadline
+    for (int i = 0; i < OverloadShedder::RESTORE_CHUNKS; ++i)
+    {
+        EXPECT_EQ(ShedAction::NONE, _module_under_test.update(NORMAL_LOAD, true));
+    }
+    for (int i = 0; i < OverloadShedder::RESTORE_CHUNKS - 1; ++i)
+    {
+        EXPECT_EQ(ShedAction::NONE, _module_under_test.update(LOW_LOAD, true));
+    }
+    EXPECT_EQ(ShedAction::RESTORE, _module_under_test.update(LOW_LOAD, true));
+    EXPECT_EQ(ShedAction::NONE, _module_under_test.update(LOW_LOAD, true));
+}
@@ -0,0 +1,63 @@
+#include <cstdio>
+
+#include "gtest/gtest.h"
+
+#define private public
+
+#include "engine/plugin_cost_model.cpp"
+
+using namespace sushi;
+using namespace sushi::engine;
+
+constexpr char TEST_COST_FILE[] = "plugin_cost_model_test.txt";
+
+class TestPluginCostModel : public ::testing::Test
+{
+protected:
+    TestPluginCostModel() {}
+
+    PluginCostModel _module_under_test;
+};
+
+TEST_F(TestPluginCostModel, TestLearning)
+{
+    EXPECT_FALSE(_module_under_test.cost("plugin").has_value());
+    _module_under_test.add_instance(ObjectId(1), "plugin");
+    _module_under_test.add_instance(ObjectId(2), "plugin");
+    EXPECT_EQ("plugin", _module_under_test.uid(ObjectId(1)).value());
+
+    // The first measurement is taken as is, later ones are averaged in
+    _module_under_test.update(ObjectId(1), 0.2f);
+    EXPECT_FLOAT_EQ(0.2f, _module_under_test.cost("plugin").value());
+    _module_under_test.update(ObjectId(2), 0.6f);
+    EXPECT_FLOAT_EQ(0.2f + PluginCostModel::COST_SMOOTHING * 0.4f, _module_under_test.cost("plugin").value());
+
+    // The cost is kept after the instances are gone
+    _module_under_test.remove_instance(ObjectId(1));
+    _module_under_test.remove_instance(ObjectId(2));
+    _module_under_test.update(ObjectId(1), 1.0f);
+    EXPECT_FALSE(_module_under_test.uid(ObjectId(1)).has_value());
+    EXPECT_TRUE(_module_under_test.cost("plugin").has_value());
+}
+
+TEST_F(TestPluginCostModel, TestAdmission)
+{
+    _module_under_test.add_instance(ObjectId(1), "plugin");
+    EXPECT_FALSE(_module_under_test.admitted(ObjectId(1)));
+    _module_under_test.admit(ObjectId(1));
+    EXPECT_TRUE(_module_under_test.admitted(ObjectId(1)));
+    EXPECT_FALSE(_module_under_test.admitted(ObjectId(2)));
+}
+
+TEST_F(TestPluginCostModel, TestPersistence)
+{
+    _module_under_test.add_instance(ObjectId(1), "plugin with spaces");
+    _module_under_test.update(ObjectId(1), 0.25f);
+    ASSERT_TRUE(_module_under_test.save(TEST_COST_FILE));
+
+    PluginCostModel loaded;
+    EXPECT_FALSE(loaded.load("no_such_file.txt"));
+    ASSERT_TRUE(loaded.load(TEST_COST_FILE));
+    EXPECT_FLOAT_EQ(0.25f, loaded.cost("plugin with spaces").value());
+    std::remove(TEST_COST_FILE);
+}
@@ -108,3 +108,64 @@ TEST_F(TestProcessorContainer, TestTrackManagement)
     ASSERT_FALSE(_module_under_test.processor_exists("one"));
     ASSERT_FALSE(_module_under_test.processor_exists("two"));
 }
+
+TEST_F(TestProcessorContainer, TestConcurrentAccess)
+{
+    auto track = std::make_shared<Track>(_hc.make_host_control_mockup(SAMPLE_RATE), 2, nullptr);
+    track->set_name("track");
+    ASSERT_TRUE(_module_under_test.add_processor(track));
+    ASSERT_TRUE(_module_under_test.add_track(track));
+
+    // Readers should always see a consistent state while processors are added and removed
+    std::atomic_bool running = true;
+    std::atomic_int errors = 0;
+    auto reader = [&]()
+    {
+        while (running)
+        {
+            auto processors = _module_under_test.processors_on_track(track->id());
+            for (const auto& processor : processors)
+            {
+                auto same = _module_under_test.processor(processor->name());
+                // The processor may have been removed since, but never replaced by another one
+                if (same != nullptr && same != processor)
+                {
+                    errors++;
+                }
+            }
+            if (_module_under_test.all_tracks().size() != 1 || _module_under_test.track("track") != track)
+            {
+                errors++;
+            }
+        }
+    };
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 4; ++i)
+    {
+        readers.emplace_back(reader);
+    }
+
+    std::vector<std::weak_ptr<Processor>> removed_processors;
+    for (int i = 0; i < 200; ++i)
+    {
+        auto processor = std::make_shared<DummyProcessor>(_hc.make_host_control_mockup(SAMPLE_RATE));
+        processor->set_name("processor_" + std::to_string(i % 10));
+        ASSERT_TRUE(_module_under_test.add_processor(processor));
+        ASSERT_TRUE(_module_under_test.add_to_track(processor, track->id(), std::nullopt));
+        ASSERT_TRUE(_module_under_test.remove_from_track(processor->id(), track->id()));
+        ASSERT_TRUE(_module_under_test.remove_processor(processor->id()));
+        removed_processors.push_back(processor);
+    }
+    running = false;
+    for (auto& t : readers)
+    {
+        t.join();
+    }
+    EXPECT_EQ(0, errors);
+    EXPECT_TRUE(_module_under_test.processors_on_track(track->id()).empty());
+    // The container should not keep removed processors alive
+    for (const auto& processor : removed_processors)
+    {
+        EXPECT_TRUE(processor.expired());
+    }
+}
@@ -0,0 +1,111 @@
+#include "gtest/gtest.h"
+
+#define private public
+
+#include "engine/processor_table.cpp"
+#include "engine/storage_swap.h"
+#include "test_utils/host_control_mockup.h"
+#include "test_utils/dummy_processor.h"
+
+using namespace sushi;
+using namespace sushi::engine;
+
+class TestProcessorTable : public ::testing::Test
+{
+protected:
+    TestProcessorTable() {}
+
+    void SetUp()
+    {
+        for (int i = 0; i < 200; ++i)
+        {
+            _processors.push_back(std::make_unique<DummyProcessor>(_host_control.make_host_control_mockup()));
+        }
+    }
+
+    HostControlMockup _host_control;
+    std::vector<std::unique_ptr<DummyProcessor>> _processors;
+    ProcessorTable _module_under_test;
+};
+
+TEST_F(TestProcessorTable, TestInsertAndRemove)
+{
+    EXPECT_EQ(ProcessorTable::MIN_CAPACITY, _module_under_test.capacity());
+    EXPECT_EQ(0, _module_under_test.size());
+    EXPECT_EQ(nullptr, _module_under_test.processor(_processors[0]->id()));
+
+    for (int i = 0; i < _module_under_test.max_size(); ++i)
+    {
+        ASSERT_TRUE(_module_under_test.insert(_processors[i].get()));
+    }
+    EXPECT_EQ(_module_under_test.max_size(), _module_under_test.size());
+    // Duplicates are not allowed and a full table should refuse new processors
+    EXPECT_FALSE(_module_under_test.insert(_processors[0].get()));
+    EXPECT_FALSE(_module_under_test.insert(_processors[_module_under_test.max_size()].get()));
+
+    // Remove every other processor, the remaining ones must still be found
+    for (int i = 0; i < _module_under_test.max_size(); i += 2)
+    {
+        ASSERT_TRUE(_module_under_test.remove(_processors[i]->id()));
+    }
+    EXPECT_FALSE(_module_under_test.remove(_processors[0]->id()));
+    for (int i = 0; i < _module_under_test.max_size(); ++i)
+    {
+        EXPECT_EQ(i % 2 == 0 ? nullptr : _processors[i].get(), _module_under_test.processor(_processors[i]->id()));
+    }
+
+    int count = 0;
+    for (auto processor : _module_under_test)
+    {
+        EXPECT_EQ(processor, _module_under_test.processor(processor->id()));
+        count++;
+    }
+    EXPECT_EQ(_module_under_test.size(), count);
+
+    _module_under_test.clear();
+    EXPECT_EQ(0, _module_under_test.size());
+    EXPECT_EQ(nullptr, _module_under_test.processor(_processors[1]->id()));
+}
+
+TEST_F(TestProcessorTable, TestCapacity)
+{
+    EXPECT_EQ(ProcessorTable::MIN_CAPACITY, ProcessorTable::capacity_for(0));
+    EXPECT_EQ(256, ProcessorTable::capacity_for(100));
+    EXPECT_EQ(128, ProcessorTable(100).capacity());
+    EXPECT_GE(ProcessorTable(ProcessorTable::capacity_for(200)).max_size(), 200);
+}
+
+TEST_F(TestProcessorTable, TestSwap)
+{
+    for (int i = 0; i < 10; ++i)
+    {
+        ASSERT_TRUE(_module_under_test.insert(_processors[i].get()));
+    }
+
+    StorageSwap swap;
+    swap.add(&_module_under_test, ProcessorTable(ProcessorTable::capacity_for(200)));
+    bool called = false;
+    swap.on_swap([&]() {called = true;});
+    EXPECT_FALSE(swap.empty());
+    EXPECT_EQ(ProcessorTable::MIN_CAPACITY, _module_under_test.capacity());
+
+    swap.swap_rt();
+    EXPECT_TRUE(called);
+    EXPECT_EQ(ProcessorTable::capacity_for(200), _module_under_test.capacity());
+    EXPECT_EQ(10, _module_under_test.size());
+    for (int i = 0; i < 200; ++i)
+    {
+        if (i >= 10)
+        {
+            ASSERT_TRUE(_module_under_test.insert(_processors[i].get()));
+        }
+        EXPECT_EQ(_processors[i].get(), _module_under_test.processor(_processors[i]->id()));
+    }
+
+    std::vector<int> vector{1, 2, 3};
+    StorageSwap vector_swap;
+    vector_swap.add_vector(&vector, 100);
+    vector_swap.swap_rt();
+    EXPECT_EQ(100u, vector.capacity());
+    EXPECT_EQ(std::vector<int>({1, 2, 3}), vector);
+}
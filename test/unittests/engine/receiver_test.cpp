@@ -1,3 +1,5 @@
+#include <thread>
+
 #include "gtest/gtest.h"
 
 #define private public
@@ -52,4 +54,64 @@ TEST_F(TestAsyncReceiver, TestMultipleEvents)
     // Get the acks in the reverse order to exercise more of the code
     ASSERT_TRUE(_module_under_test.wait_for_response(id2, ZERO_TIMEOUT));
     ASSERT_TRUE(_module_under_test.wait_for_response(id1, ZERO_TIMEOUT));
-}
\ No newline at end of file
+}
+TEST_F(TestAsyncReceiver, TestWaitingForNotification)
+{
+    constexpr auto LONG_TIMEOUT = std::chrono::milliseconds(2000);
+    auto event1 = RtEvent::make_insert_processor_event(nullptr);
+    auto event2 = RtEvent::make_add_processor_to_track_event(123, 234);
+    EventId id1 = event1.returnable_event()->event_id();
+    EventId id2 = event2.returnable_event()->event_id();
+
+    // Two threads waiting for different events should both be woken up when their responses arrive
+    bool status2 = false;
+    auto waiter = std::thread([&]() {status2 = _module_under_test.wait_for_response(id2, LONG_TIMEOUT);});
+    auto start = std::chrono::steady_clock::now();
+    auto faux_rt_thread = std::thread([&]()
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        event1.returnable_event()->set_handled(true);
+        event2.returnable_event()->set_handled(false);
+        _queue.push(event1);
+        _queue.push(event2);
+        _module_under_test.notify();
+    });
+
+    EXPECT_TRUE(_module_under_test.wait_for_response(id1, LONG_TIMEOUT));
+    waiter.join();
+    faux_rt_thread.join();
+    EXPECT_FALSE(status2);
+    EXPECT_LT(std::chrono::steady_clock::now() - start, LONG_TIMEOUT / 2);
+    EXPECT_TRUE(_module_under_test._responses.empty());
+}
+
+TEST_F(TestAsyncReceiver, TestLateResponse)
+{
+    auto event = RtEvent::make_insert_processor_event(nullptr);
+    EventId id = event.returnable_event()->event_id();
+    EXPECT_EQ(ResponseStatus::TIMED_OUT, _module_under_test.wait_for_response_status(id, ZERO_TIMEOUT));
+
+    // The response to an event nobody is waiting for anymore should not be kept
+    event.returnable_event()->set_handled(true);
+    _queue.push(event);
+    auto event2 = RtEvent::make_add_processor_to_track_event(123, 234);
+    event2.returnable_event()->set_handled(false);
+    _queue.push(event2);
+    EXPECT_EQ(ResponseStatus::HANDLED_ERROR, _module_under_test.wait_for_response_status(event2.returnable_event()->event_id(), ZERO_TIMEOUT));
+    EXPECT_TRUE(_module_under_test._responses.empty());
+    EXPECT_TRUE(_module_under_test._timed_out.empty());
+}
+
+TEST_F(TestAsyncReceiver, TestTimedOutEventsPruned)
+{
+    auto event = RtEvent::make_insert_processor_event(nullptr);
+    EventId id = event.returnable_event()->event_id();
+    EXPECT_EQ(ResponseStatus::TIMED_OUT, _module_under_test.wait_for_response_status(id, ZERO_TIMEOUT));
+    ASSERT_EQ(1u, _module_under_test._timed_out.count(id));
+
+    // Events that are never returned should be forgotten eventually
+    _module_under_test._timed_out[id] -= TIMED_OUT_MAX_AGE + std::chrono::seconds(1);
+    EXPECT_EQ(ResponseStatus::TIMED_OUT, _module_under_test.wait_for_response_status(id + 1, ZERO_TIMEOUT));
+    EXPECT_EQ(0u, _module_under_test._timed_out.count(id));
+    EXPECT_EQ(1u, _module_under_test._timed_out.count(id + 1));
+}
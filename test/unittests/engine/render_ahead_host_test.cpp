@@ -0,0 +1,165 @@
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#define private public
+#include "engine/render_ahead_host.cpp"
+#undef private
+
+#include "test_utils/test_utils.h"
+#include "test_utils/host_control_mockup.h"
+#include "test_utils/dummy_processor.h"
+
+using namespace sushi;
+using namespace engine;
+
+constexpr float TEST_SAMPLE_RATE = 48000;
+constexpr int TEST_CHANNEL_COUNT = 2;
+constexpr int TEST_CHUNKS = 2;
+constexpr auto SLOW_PROCESSING_TIME = std::chrono::milliseconds(20);
+
+/* Outputs the number of chunks it has rendered and records the transport position of each */
+class RecordingProcessor : public DummyProcessor
+{
+public:
+    explicit RecordingProcessor(HostControl host_control) : DummyProcessor(host_control)
+    {
+        positions.reserve(16);
+    }
+
+    void process_event(const RtEvent& event) override
+    {
+        output_event(event);
+    }
+
+    void process_audio(const ChunkSampleBuffer& /*in_buffer*/, ChunkSampleBuffer& out_buffer) override
+    {
+        if (slow)
+        {
+            std::this_thread::sleep_for(SLOW_PROCESSING_TIME);
+        }
+        positions.push_back(_host_control.transport()->current_samples());
+        test_utils::fill_sample_buffer(out_buffer, static_cast<float>(positions.size()));
+    }
+
+    const Transport* transport()
+    {
+        return _host_control.transport();
+    }
+
+    std::atomic_bool     slow{false};
+    std::vector<int64_t> positions;
+};
+
+class RenderAheadHostTest : public ::testing::Test
+{
+protected:
+    RenderAheadHostTest() {}
+
+    void wait_for_rendered(int64_t chunks)
+    {
+        while (_module_under_test._written.load() < chunks)
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    HostControlMockup _host_control;
+    performance::PerformanceTimer _timer;
+    RecordingProcessor _processor{_host_control.make_host_control_mockup(TEST_SAMPLE_RATE)};
+    RenderAheadHost _module_under_test{{&_processor}, TEST_CHANNEL_COUNT, TEST_CHUNKS,
+                                       &_host_control._transport, TEST_SAMPLE_RATE, &_timer};
+    ChunkSampleBuffer _out{TEST_CHANNEL_COUNT};
+};
+
+TEST_F(RenderAheadHostTest, TestRenderAhead)
+{
+    EXPECT_EQ(&_module_under_test._transport, _processor.transport());
+    EXPECT_TRUE(_module_under_test.hosts(_processor.id()));
+
+    // Nothing is rendered before the rt thread has handed over the transport
+    EXPECT_FALSE(_module_under_test.pop(_out));
+    test_utils::assert_buffer_value(0.0f, _out);
+    EXPECT_EQ(0, _module_under_test.underruns());
+
+    // After that the ring is kept full and played back in order
+    for (float expected : {1.0f, 2.0f, 3.0f})
+    {
+        wait_for_rendered(static_cast<int64_t>(expected) + 1);
+        EXPECT_TRUE(_module_under_test.pop(_out));
+        test_utils::assert_buffer_value(expected, _out);
+    }
+    EXPECT_EQ(0, _module_under_test.underruns());
+
+    _module_under_test.stop();
+    EXPECT_EQ(&_host_control._transport, _processor.transport());
+}
+
+TEST_F(RenderAheadHostTest, TestTransportAhead)
+{
+    auto& transport = _host_control._transport;
+    transport.set_playing_mode(PlayingMode::PLAYING, false);
+    transport.set_time(Time(0), 0);
+
+    // Every chunk is rendered at the position of the cycle it is played in
+    _module_under_test.pop(_out);
+    for (int cycle = 1; cycle <= 3; ++cycle)
+    {
+        wait_for_rendered(cycle + 1);
+        transport.set_time(Time(0), cycle * AUDIO_CHUNK_SIZE);
+        EXPECT_TRUE(_module_under_test.pop(_out));
+    }
+    wait_for_rendered(5);
+    ASSERT_GE(_processor.positions.size(), 5u);
+    for (int chunk = 0; chunk < 5; ++chunk)
+    {
+        EXPECT_EQ((chunk + 1) * AUDIO_CHUNK_SIZE, _processor.positions[chunk]);
+    }
+}
+
+TEST_F(RenderAheadHostTest, TestEvents)
+{
+    RtSafeRtEventFifo event_queue;
+    _processor.set_event_output(&_module_under_test);
+    _module_under_test.pop(_out);
+    wait_for_rendered(TEST_CHUNKS);
+
+    // Events to the processor, and keyboard events to the track, are passed on before the
+    // next chunk is rendered and what the processor outputs is forwarded from the rt thread
+    ASSERT_TRUE(_module_under_test.queue_event(RtEvent::make_note_on_event(_processor.id(), 0, 0, 48, 1.0f)));
+    ASSERT_TRUE(_module_under_test.queue_event(RtEvent::make_note_off_event(ObjectId(123456), 0, 0, 48, 1.0f)));
+    _module_under_test.pop(_out);
+    wait_for_rendered(TEST_CHUNKS + 1);
+    _module_under_test.forward_events(&event_queue);
+
+    RtEvent event;
+    ASSERT_TRUE(event_queue.pop(event));
+    EXPECT_EQ(RtEventType::NOTE_ON, event.type());
+    ASSERT_TRUE(event_queue.pop(event));
+    EXPECT_EQ(RtEventType::NOTE_OFF, event.type());
+    EXPECT_FALSE(event_queue.pop(event));
+}
+
+TEST_F(RenderAheadHostTest, TestUnderruns)
+{
+    RenderAheadHost module_under_test({&_processor}, TEST_CHANNEL_COUNT, 1, &_host_control._transport,
+                                      TEST_SAMPLE_RATE, &_timer);
+    _module_under_test.stop();
+    _processor.set_transport(&module_under_test._transport);
+    _processor.slow = true;
+
+    module_under_test.pop(_out);
+    while (module_under_test._written.load() < 1)
+    {
+        std::this_thread::yield();
+    }
+    EXPECT_TRUE(module_under_test.pop(_out));
+
+    // The next chunk takes longer than a cycle, so it is replaced by silence
+    EXPECT_FALSE(module_under_test.pop(_out));
+    test_utils::assert_buffer_value(0.0f, _out);
+    EXPECT_EQ(1, module_under_test.underruns());
+}
@@ -0,0 +1,145 @@
+#include "gtest/gtest.h"
+
+#define private public
+
+#include "engine/track_balancer.cpp"
+
+using namespace sushi;
+using namespace sushi::engine;
+
+constexpr int TEST_CORES = 2;
+
+class TestTrackBalancer : public ::testing::Test
+{
+protected:
+    TestTrackBalancer() {}
+
+    TrackBalancer _module_under_test{TEST_CORES};
+};
+
+TEST_F(TestTrackBalancer, TestTrackLoad)
+{
+    EXPECT_FLOAT_EQ(0.2f, TrackBalancer::track_load(performance::ProcessTimings(0.2f, 0.1f, 0.2f)));
+    EXPECT_GT(TrackBalancer::track_load(performance::ProcessTimings(0.2f, 0.1f, 0.6f)), 0.2f);
+}
+
+TEST_F(TestTrackBalancer, TestBalancing)
+{
+    std::vector<TrackLoad> tracks = {{ObjectId(1), 0, 0.4f},
+                                     {ObjectId(2), 0, 0.3f},
+                                     {ObjectId(3), 0, 0.2f},
+                                     {ObjectId(4), 1, 0.1f}};
+    auto moves = _module_under_test.rebalance(tracks);
+    ASSERT_EQ(1u, moves.size());
+    EXPECT_EQ(ObjectId(1), moves[0].track);
+    EXPECT_EQ(1, moves[0].core);
+
+    // No moves should be done during the cooldown, even if the load is uneven
+    for (int i = 0; i < COOLDOWN_UPDATES; ++i)
+    {
+        EXPECT_TRUE(_module_under_test.rebalance(tracks).empty());
+    }
+    EXPECT_FALSE(_module_under_test.rebalance(tracks).empty());
+}
+
+TEST_F(TestTrackBalancer, TestHysteresis)
+{
+    // A small difference in load should not trigger any moves
+    std::vector<TrackLoad> tracks = {{ObjectId(1), 0, 0.3f},
+                                     {ObjectId(2), 1, 0.25f}};
+    EXPECT_TRUE(_module_under_test.rebalance(tracks).empty());
+
+    // Neither should moves that don't lower the load of the most loaded core
+    tracks = {{ObjectId(1), 0, 0.5f},
+              {ObjectId(2), 1, 0.1f}};
+    EXPECT_TRUE(_module_under_test.rebalance(tracks).empty());
+}
+
+TEST_F(TestTrackBalancer, TestPinnedTracks)
+{
+    EXPECT_FALSE(_module_under_test.pin_track(ObjectId(1), TEST_CORES));
+    EXPECT_FALSE(_module_under_test.pin_track(ObjectId(1), -1));
+    ASSERT_TRUE(_module_under_test.pin_track(ObjectId(1), 0));
+    ASSERT_TRUE(_module_under_test.pin_track(ObjectId(2), 1));
+    EXPECT_EQ(0, _module_under_test.pinned_core(ObjectId(1)));
+
+    // Pinned tracks should be moved back to their core and never moved by the balancing
+    std::vector<TrackLoad> tracks = {{ObjectId(1), 0, 0.6f},
+                                     {ObjectId(2), 0, 0.3f}};
+    auto moves = _module_under_test.rebalance(tracks);
+    ASSERT_EQ(1u, moves.size());
+    EXPECT_EQ(ObjectId(2), moves[0].track);
+    EXPECT_EQ(1, moves[0].core);
+
+    ASSERT_TRUE(_module_under_test.pin_track(ObjectId(1), std::nullopt));
+    EXPECT_FALSE(_module_under_test.pinned_core(ObjectId(1)).has_value());
+}
+
+TEST_F(TestTrackBalancer, TestElasticCores)
+{
+    TrackBalancer module_under_test(4);
+    module_under_test.set_elastic(true);
+    EXPECT_EQ(4, module_under_test.active_cores());
+    ASSERT_TRUE(module_under_test.pin_track(ObjectId(4), 3));
+
+    // A low load should gather all tracks that are not pinned on the first core
+    std::vector<TrackLoad> tracks = {{ObjectId(1), 0, 0.1f},
+                                     {ObjectId(2), 1, 0.1f},
+                                     {ObjectId(3), 2, 0.1f},
+                                     {ObjectId(4), 3, 0.1f}};
+    auto update = [&]()
+    {
+        auto moves = module_under_test.rebalance(tracks);
+        for (const auto& move : moves)
+        {
+            auto track = std::find_if(tracks.begin(), tracks.end(), [&](const auto& t) {return t.track == move.track;});
+            track->core = move.core;
+        }
+        return moves;
+    };
+    // Cores should be deactivated one at a time
+    update();
+    EXPECT_EQ(3, module_under_test.active_cores());
+    for (int i = 0; i < 2 * (COOLDOWN_UPDATES + 1); ++i)
+    {
+        update();
+    }
+    EXPECT_EQ(1, module_under_test.active_cores());
+    EXPECT_EQ(0, tracks[1].core);
+    EXPECT_EQ(0, tracks[2].core);
+    EXPECT_EQ(3, tracks[3].core);
+
+    // When the load increases, cores should be activated again at once
+    for (auto& track : tracks)
+    {
+        track.load = 0.5f;
+    }
+    auto moves = update();
+    EXPECT_EQ(3, module_under_test.active_cores());
+    EXPECT_FALSE(moves.empty());
+    for (const auto& move : moves)
+    {
+        EXPECT_LT(move.core, 3);
+    }
+
+    module_under_test.set_elastic(false);
+    EXPECT_EQ(4, module_under_test.active_cores());
+}
+
+TEST_F(TestTrackBalancer, TestSplitChain)
+{
+    // Processors with equal load should be split evenly
+    EXPECT_EQ(std::vector<int>({2, 2, 2}), TrackBalancer::split_chain({0.1f, 0.1f, 0.1f, 0.1f, 0.1f, 0.1f}, 3));
+
+    // A heavy processor should get a stage of its own
+    std::vector<float> loads = {0.05f, 0.05f, 0.4f, 0.1f, 0.1f, 0.1f};
+    auto stages = TrackBalancer::split_chain(loads, 2);
+    EXPECT_EQ(std::vector<int>({3, 3}), stages);
+    EXPECT_FLOAT_EQ(0.5f, TrackBalancer::max_stage_load(loads, stages));
+    stages = TrackBalancer::split_chain(loads, 3);
+    EXPECT_FLOAT_EQ(0.4f, TrackBalancer::max_stage_load(loads, stages));
+
+    // There can't be more stages than processors
+    EXPECT_EQ(std::vector<int>({1, 1}), TrackBalancer::split_chain({0.1f, 0.2f}, 4));
+    EXPECT_TRUE(TrackBalancer::split_chain({}, 2).empty());
+}
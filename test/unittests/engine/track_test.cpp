@@ -327,6 +327,213 @@ TEST_F(TrackTest, TestSilenceUnusedChannels)
     test_utils::assert_buffer_value(0.0f, right_channel);
 }
 
+TEST_F(TrackTest, TestBusAssignment)
+{
+    Track multibus_track(_host_control.make_host_control_mockup(), 2, &_timer);
+    multibus_track.init(TEST_SAMPLE_RATE);
+    RtSafeRtEventFifo event_queue;
+    multibus_track.set_event_output(&event_queue);
+
+    passthrough_plugin::PassthroughPlugin plugin_1(_host_control.make_host_control_mockup());
+    passthrough_plugin::PassthroughPlugin plugin_2(_host_control.make_host_control_mockup());
+    for (auto plugin : {&plugin_1, &plugin_2})
+    {
+        plugin->init(44100);
+        plugin->set_enabled(true);
+        plugin->set_input_channels(TEST_CHANNEL_COUNT);
+        plugin->set_output_channels(TEST_CHANNEL_COUNT);
+        multibus_track.add(plugin);
+    }
+
+    EXPECT_FALSE(multibus_track.set_processor_bus(plugin_1.id(), 2));
+    EXPECT_FALSE(_module_under_test.set_processor_bus(plugin_1.id(), 0));
+    ASSERT_TRUE(multibus_track.set_processor_bus(plugin_1.id(), 1));
+    EXPECT_EQ(1, multibus_track.processor_bus(plugin_1.id()).value_or(-1));
+    EXPECT_FALSE(multibus_track.independent_buses());
+
+    // A processor assigned to a bus should only process that bus, even if mixed with processors that are not
+    auto in_bus_0 = multibus_track.input_bus(0);
+    auto in_bus_1 = multibus_track.input_bus(1);
+    test_utils::fill_sample_buffer(in_bus_0, 1.0f);
+    test_utils::fill_sample_buffer(in_bus_1, 0.5f);
+    multibus_track.render();
+    test_utils::assert_buffer_value(1.0f, multibus_track.output_bus(0), test_utils::DECIBEL_ERROR);
+    test_utils::assert_buffer_value(0.0f, multibus_track.output_bus(1));
+
+    ASSERT_TRUE(multibus_track.set_processor_bus(plugin_2.id(), 0));
+    ASSERT_TRUE(multibus_track.independent_buses());
+    test_utils::fill_sample_buffer(in_bus_0, 1.0f);
+    test_utils::fill_sample_buffer(in_bus_1, 0.5f);
+    multibus_track.render();
+    test_utils::assert_buffer_value(1.0f, multibus_track.output_bus(0), test_utils::DECIBEL_ERROR);
+    test_utils::assert_buffer_value(0.5f, multibus_track.output_bus(1), test_utils::DECIBEL_ERROR);
+
+    // Keyboard events should be passed to the processors of every bus
+    multibus_track.process_event(RtEvent::make_note_on_event(0, 0, 0, 48, 1.0f));
+    multibus_track.render();
+    RtEvent event;
+    ASSERT_TRUE(event_queue.pop(event));
+    EXPECT_EQ(RtEventType::NOTE_ON, event.type());
+    ASSERT_TRUE(event_queue.pop(event));
+    EXPECT_EQ(RtEventType::NOTE_ON, event.type());
+    EXPECT_FALSE(event_queue.pop(event));
+
+    // Processors assigned to a bus can't be processed asynchronously
+    AsyncProcessorHost host(&plugin_1, &_timer);
+    EXPECT_FALSE(multibus_track.set_async_host(plugin_1.id(), &host));
+
+    ASSERT_TRUE(multibus_track.remove(plugin_1.id()));
+    EXPECT_FALSE(multibus_track.processor_bus(plugin_1.id()).has_value());
+    ASSERT_TRUE(multibus_track.remove(plugin_2.id()));
+    EXPECT_FALSE(multibus_track.independent_buses());
+}
+
+TEST_F(TrackTest, TestExecutionPlan)
+{
+    Track multibus_track(_host_control.make_host_control_mockup(), 2, &_timer);
+    DummyProcessor processor_1(_host_control.make_host_control_mockup());
+    DummyMonoProcessor processor_2(_host_control.make_host_control_mockup());
+    DummyProcessor processor_3(_host_control.make_host_control_mockup());
+    EXPECT_TRUE(multibus_track._plan.empty());
+    EXPECT_EQ(0, multibus_track._plan_output_source);
+
+    multibus_track.add(&processor_1);
+    multibus_track.add(&processor_2);
+    multibus_track.add(&processor_3);
+    ASSERT_TRUE(multibus_track.set_processor_bus(processor_3.id(), 1));
+
+    // Processors alternate between the buffers, except those on a bus, which copy back to the bus
+    const auto& plan = multibus_track._plan;
+    ASSERT_EQ(3u, plan.size());
+    EXPECT_EQ(&processor_1, plan[0].processor);
+    EXPECT_EQ(NO_BUS, plan[0].bus);
+    EXPECT_EQ(0, plan[0].source);
+    EXPECT_EQ(&processor_2, plan[1].processor);
+    EXPECT_EQ(1, plan[1].source);
+    EXPECT_EQ(1, plan[1].output_channels);
+    EXPECT_EQ(1, plan[2].bus);
+    EXPECT_EQ(0, plan[2].source);
+    EXPECT_EQ(0, plan[2].bus_source);
+    EXPECT_EQ(0, multibus_track._plan_output_source);
+
+    // The plan should follow changes to the chain
+    ASSERT_TRUE(multibus_track.remove(processor_1.id()));
+    ASSERT_EQ(2u, plan.size());
+    EXPECT_EQ(&processor_2, plan[0].processor);
+    EXPECT_EQ(0, plan[0].source);
+    EXPECT_EQ(1, multibus_track._plan_output_source);
+
+    AsyncProcessorHost host(&processor_2, &_timer);
+    ASSERT_TRUE(multibus_track.set_async_host(processor_2.id(), &host));
+    EXPECT_EQ(&host, plan[0].async_host);
+    ASSERT_TRUE(multibus_track.set_async_host(processor_2.id(), nullptr));
+    EXPECT_EQ(nullptr, plan[0].async_host);
+}
+
+TEST_F(TrackTest, TestAsyncProcessing)
+{
+    RtSafeRtEventFifo event_queue;
+    passthrough_plugin::PassthroughPlugin plugin(_host_control.make_host_control_mockup());
+    plugin.init(44100);
+    plugin.set_enabled(true);
+    plugin.set_input_channels(TEST_CHANNEL_COUNT);
+    plugin.set_output_channels(TEST_CHANNEL_COUNT);
+    _module_under_test.set_event_output(&event_queue);
+    _module_under_test.add(&plugin);
+
+    AsyncProcessorHost host(&plugin, &_timer);
+    EXPECT_FALSE(_module_under_test.set_async_host(1234567u, &host));
+    ASSERT_TRUE(_module_under_test.set_async_host(plugin.id(), &host));
+
+    // Output from the plugin should be delayed by one chunk
+    auto in_bus = _module_under_test.input_bus(0);
+    auto out = _module_under_test.output_bus(0);
+    test_utils::fill_sample_buffer(in_bus, 1.0f);
+    _module_under_test.render();
+    _module_under_test.wait_for_async_processing();
+    test_utils::assert_buffer_value(0.0f, out);
+
+    _module_under_test.render();
+    _module_under_test.wait_for_async_processing();
+    test_utils::assert_buffer_value(1.0f, out, test_utils::DECIBEL_ERROR);
+
+    // Events output by the plugin should still be passed on by the track
+    _module_under_test.process_event(RtEvent::make_note_on_event(0, 0, 0, 48, 1.0f));
+    _module_under_test.render();
+    _module_under_test.wait_for_async_processing();
+    RtEvent event;
+    ASSERT_TRUE(event_queue.pop(event));
+    EXPECT_EQ(RtEventType::NOTE_ON, event.type());
+
+    ASSERT_TRUE(_module_under_test.set_async_host(plugin.id(), nullptr));
+    EXPECT_TRUE(_module_under_test._async_hosts.empty());
+    ASSERT_TRUE(_module_under_test.set_async_host(plugin.id(), &host));
+    ASSERT_TRUE(_module_under_test.remove(plugin.id()));
+    EXPECT_TRUE(_module_under_test._async_hosts.empty());
+}
+
+TEST_F(TrackTest, TestPipelineProcessing)
+{
+    RtSafeRtEventFifo event_queue;
+    std::vector<std::unique_ptr<passthrough_plugin::PassthroughPlugin>> plugins;
+    for (int i = 0; i < 3; ++i)
+    {
+        auto& plugin = plugins.emplace_back(std::make_unique<passthrough_plugin::PassthroughPlugin>(_host_control.make_host_control_mockup()));
+        plugin->init(44100);
+        plugin->set_enabled(true);
+        plugin->set_input_channels(TEST_CHANNEL_COUNT);
+        plugin->set_output_channels(TEST_CHANNEL_COUNT);
+        _module_under_test.add(plugin.get());
+    }
+    _module_under_test.set_event_output(&event_queue);
+
+    AsyncProcessorHost first_stage(std::vector<Processor*>{plugins[0].get()}, &_timer);
+    AsyncProcessorHost second_stage(std::vector<Processor*>{plugins[1].get(), plugins[2].get()}, &_timer);
+    AsyncProcessorHost wrong_order(std::vector<Processor*>{plugins[2].get(), plugins[1].get()}, &_timer);
+
+    // The stages must contain all processors of the track, in order
+    EXPECT_FALSE(_module_under_test.set_pipeline({&first_stage}));
+    EXPECT_FALSE(_module_under_test.set_pipeline({&first_stage, &wrong_order}));
+    EXPECT_TRUE(_module_under_test._async_hosts.empty());
+    ASSERT_TRUE(_module_under_test.set_pipeline({&first_stage, &second_stage}));
+    EXPECT_EQ(2u, _module_under_test._async_hosts.size());
+
+    // Output should be delayed by one chunk per stage
+    auto in_bus = _module_under_test.input_bus(0);
+    auto out = _module_under_test.output_bus(0);
+    for (int i = 0; i < 2; ++i)
+    {
+        test_utils::fill_sample_buffer(in_bus, 1.0f);
+        _module_under_test.render();
+        _module_under_test.wait_for_async_processing();
+        test_utils::assert_buffer_value(0.0f, out);
+    }
+    _module_under_test.render();
+    _module_under_test.wait_for_async_processing();
+    test_utils::assert_buffer_value(1.0f, out, test_utils::DECIBEL_ERROR);
+
+    // Keyboard events should be passed through all processors of a stage and on to the track output
+    _module_under_test.process_event(RtEvent::make_note_on_event(0, 0, 0, 48, 1.0f));
+    RtEvent event;
+    for (int i = 0; i < 3 && event_queue.empty(); ++i)
+    {
+        _module_under_test.render();
+        _module_under_test.wait_for_async_processing();
+    }
+    ASSERT_TRUE(event_queue.pop(event));
+    EXPECT_EQ(RtEventType::NOTE_ON, event.type());
+    EXPECT_FALSE(event_queue.pop(event));
+
+    // Removing a processor returns its whole stage to normal processing
+    ASSERT_TRUE(_module_under_test.remove(plugins[1]->id()));
+    ASSERT_EQ(1u, _module_under_test._async_hosts.size());
+    EXPECT_EQ(&first_stage, _module_under_test._async_hosts.front());
+    EXPECT_EQ(static_cast<RtEventPipe*>(&_module_under_test), plugins[2]->_output_pipe);
+
+    ASSERT_TRUE(_module_under_test.set_pipeline({}));
+    EXPECT_TRUE(_module_under_test._async_hosts.empty());
+}
+
 TEST(TestStandAloneFunctions, TesPanAndGainCalculation)
 {
     auto [left_gain, right_gain] = calc_l_r_gain(5.0f, 0.0f);
@@ -343,3 +550,384 @@ TEST(TestStandAloneFunctions, TesPanAndGainCalculation)
     EXPECT_NEAR(1.2f, left_gain, 0.01f);
     EXPECT_FLOAT_EQ(0.5, right_gain);
 }
+
+class TailProcessor : public DummyProcessor
+{
+public:
+    explicit TailProcessor(HostControl host_control) : DummyProcessor(host_control)
+    {
+        _tail_length = 2 * AUDIO_CHUNK_SIZE;
+    }
+
+    void process_audio(const ChunkSampleBuffer& in_buffer, ChunkSampleBuffer& out_buffer) override
+    {
+        process_calls++;
+        out_buffer = in_buffer;
+    }
+
+    int process_calls{0};
+};
+
+TEST_F(TrackTest, TestIdleProcessorSkipping)
+{
+    TailProcessor processor(_host_control.make_host_control_mockup());
+    DummyProcessor no_tail_processor(_host_control.make_host_control_mockup());
+    _module_under_test.add(&processor);
+    _module_under_test.add(&no_tail_processor);
+    auto in_bus = _module_under_test.input_bus(0);
+
+    test_utils::fill_sample_buffer(in_bus, 1.0f);
+    _module_under_test.render();
+    EXPECT_EQ(1, processor.process_calls);
+
+    // Processing continues for the length of the tail after the input becomes silent
+    in_bus.clear();
+    for (int i = 0; i < 2; ++i)
+    {
+        _module_under_test.render();
+    }
+    EXPECT_EQ(3, processor.process_calls);
+    for (int i = 0; i < 5; ++i)
+    {
+        _module_under_test.render();
+    }
+    EXPECT_EQ(3, processor.process_calls);
+    EXPECT_TRUE(_module_under_test.output_bus(0).is_silent());
+
+    // Keyboard events should resume processing immediately
+    _module_under_test.process_event(RtEvent::make_note_on_event(0, 0, 0, 48, 1.0f));
+    _module_under_test.render();
+    EXPECT_EQ(4, processor.process_calls);
+
+    // And so should audio
+    for (int i = 0; i < 5; ++i)
+    {
+        _module_under_test.render();
+    }
+    EXPECT_EQ(6, processor.process_calls);
+    test_utils::fill_sample_buffer(in_bus, 1.0f);
+    _module_under_test.render();
+    EXPECT_EQ(7, processor.process_calls);
+    EXPECT_FALSE(_module_under_test.output_bus(0).is_silent());
+}
+
+class DoublingProcessor : public DummyProcessor
+{
+public:
+    explicit DoublingProcessor(HostControl host_control) : DummyProcessor(host_control) {}
+
+    void process_audio(const ChunkSampleBuffer& in_buffer, ChunkSampleBuffer& out_buffer) override
+    {
+        out_buffer.clear();
+        out_buffer.add_with_gain(in_buffer, 2.0f);
+    }
+};
+
+TEST_F(TrackTest, TestExternalInput)
+{
+    DoublingProcessor processor_1(_host_control.make_host_control_mockup());
+    DoublingProcessor processor_2(_host_control.make_host_control_mockup());
+    _module_under_test.add(&processor_1);
+    _module_under_test.add(&processor_2);
+    ChunkSampleBuffer input(TEST_CHANNEL_COUNT);
+    test_utils::fill_sample_buffer(input, 1.0f);
+
+    // The input should be read in place and never written to
+    _module_under_test.set_external_input(ChunkSampleBuffer::create_non_owning_buffer(input));
+    _module_under_test.render();
+    test_utils::assert_buffer_value(4.0f, _module_under_test.output_bus(0));
+    test_utils::assert_buffer_value(1.0f, input);
+    EXPECT_EQ(0, _module_under_test._external_input.channel_count());
+
+    // Mono input to processors with more channels needs to be copied first
+    _module_under_test.set_external_input(ChunkSampleBuffer::create_non_owning_buffer(input, 0, 1));
+    _module_under_test.render();
+    test_utils::assert_buffer_value(4.0f, _module_under_test.output_channel(0));
+    test_utils::assert_buffer_value(0.0f, _module_under_test.output_channel(1));
+
+    // As does input to processors on a bus, which write back to their input
+    Track multibus_track(_host_control.make_host_control_mockup(), 2, &_timer);
+    DoublingProcessor bus_processor(_host_control.make_host_control_mockup());
+    DummyProcessor track_processor(_host_control.make_host_control_mockup());
+    multibus_track.init(TEST_SAMPLE_RATE);
+    multibus_track.add(&bus_processor);
+    multibus_track.add(&track_processor);
+    ASSERT_TRUE(multibus_track.set_processor_bus(bus_processor.id(), 0));
+    ChunkSampleBuffer multibus_input(4);
+    test_utils::fill_sample_buffer(multibus_input, 1.0f);
+    multibus_track.set_external_input(ChunkSampleBuffer::create_non_owning_buffer(multibus_input));
+    multibus_track.render();
+    test_utils::assert_buffer_value(2.0f, multibus_track.output_bus(0));
+    test_utils::assert_buffer_value(1.0f, multibus_input);
+}
+
+TEST_F(TrackTest, TestDeferredGain)
+{
+    // Mono tracks with pan should give the same output when the gain is applied on mixing
+    Track track(_host_control.make_host_control_mockup(), 1, &_timer, CREATE_PAN_CONTROLS);
+    Track deferred_track(_host_control.make_host_control_mockup(), 1, &_timer, CREATE_PAN_CONTROLS);
+    track.init(TEST_SAMPLE_RATE);
+    deferred_track.init(TEST_SAMPLE_RATE);
+    deferred_track.set_deferred_gain(true);
+    ChunkSampleBuffer mixed(2);
+
+    for (auto t : {&track, &deferred_track})
+    {
+        t->process_event(RtEvent::make_parameter_change_event(0, 0, t->parameter_from_name("gain")->id(), 0.875f));
+        t->process_event(RtEvent::make_parameter_change_event(0, 0, t->parameter_from_name("pan")->id(), 0.5f));
+    }
+    for (int chunk = 0; chunk < 2; ++chunk)
+    {
+        for (auto t : {&track, &deferred_track})
+        {
+            auto in = t->input_channel(0);
+            test_utils::fill_sample_buffer(in, 1.0f);
+            t->render();
+        }
+        test_utils::fill_sample_buffer(mixed, 1.0f);
+        deferred_track.mix_output_channel(LEFT_CHANNEL_INDEX, mixed, LEFT_CHANNEL_INDEX, true);
+        deferred_track.mix_output_channel(RIGHT_CHANNEL_INDEX, mixed, RIGHT_CHANNEL_INDEX, false);
+
+        auto expected = track.output_bus(0);
+        for (int i = 0; i < AUDIO_CHUNK_SIZE; ++i)
+        {
+            ASSERT_FLOAT_EQ(expected.channel(LEFT_CHANNEL_INDEX)[i], mixed.channel(LEFT_CHANNEL_INDEX)[i]);
+            ASSERT_FLOAT_EQ(expected.channel(RIGHT_CHANNEL_INDEX)[i] + 1.0f, mixed.channel(RIGHT_CHANNEL_INDEX)[i]);
+        }
+    }
+    // The output of the processors is left untouched
+    test_utils::assert_buffer_value(1.0f, deferred_track.output_channel(LEFT_CHANNEL_INDEX));
+}
+
+class ChunkCountingProcessor : public DummyProcessor
+{
+public:
+    explicit ChunkCountingProcessor(HostControl host_control) : DummyProcessor(host_control) {}
+
+    void process_audio(const ChunkSampleBuffer& /*in_buffer*/, ChunkSampleBuffer& out_buffer) override
+    {
+        test_utils::fill_sample_buffer(out_buffer, static_cast<float>(++chunks));
+    }
+
+    const engine::Transport* transport()
+    {
+        return _host_control.transport();
+    }
+
+    int chunks{0};
+};
+
+TEST_F(TrackTest, TestFreeze)
+{
+    // A track that only passes on its input renders silence and can't be frozen
+    DummyProcessor passthrough(_host_control.make_host_control_mockup());
+    _module_under_test.add(&passthrough);
+    EXPECT_FALSE(_module_under_test.freeze(3));
+    EXPECT_FALSE(_module_under_test.frozen());
+    _module_under_test.remove(passthrough.id());
+
+    ChunkCountingProcessor processor(_host_control.make_host_control_mockup());
+    _module_under_test.add(&processor);
+    ASSERT_TRUE(_module_under_test.freeze(3));
+    EXPECT_TRUE(_module_under_test.frozen());
+    EXPECT_EQ(3, processor.chunks);
+
+    // Nothing should be played back before the transport is started
+    auto& transport = _host_control._transport;
+    transport.set_time(Time(0), 0);
+    _module_under_test.render();
+    test_utils::assert_buffer_value(0.0f, _module_under_test.output_bus(0), test_utils::DECIBEL_ERROR);
+
+    // The frozen audio should follow the transport from its start, without rendering the
+    // processor, and be silent after its end
+    transport.set_playing_mode(PlayingMode::PLAYING, false);
+    int64_t samples = AUDIO_CHUNK_SIZE;
+    for (float expected : {1.0f, 2.0f, 3.0f, 0.0f})
+    {
+        transport.set_time(Time(0), samples);
+        samples += AUDIO_CHUNK_SIZE;
+        _module_under_test.render();
+        test_utils::assert_buffer_value(expected, _module_under_test.output_bus(0), test_utils::DECIBEL_ERROR);
+    }
+    EXPECT_EQ(3, processor.chunks);
+
+    // Stopping and restarting the transport should start over from the beginning
+    transport.set_playing_mode(PlayingMode::STOPPED, false);
+    transport.set_time(Time(0), samples);
+    samples += AUDIO_CHUNK_SIZE;
+    _module_under_test.render();
+    test_utils::assert_buffer_value(0.0f, _module_under_test.output_bus(0), test_utils::DECIBEL_ERROR);
+    transport.set_playing_mode(PlayingMode::PLAYING, false);
+    transport.set_time(Time(0), samples);
+    _module_under_test.render();
+    test_utils::assert_buffer_value(1.0f, _module_under_test.output_bus(0), test_utils::DECIBEL_ERROR);
+
+    _module_under_test.unfreeze();
+    EXPECT_FALSE(_module_under_test.frozen());
+    _module_under_test.render();
+    test_utils::assert_buffer_value(4.0f, _module_under_test.output_bus(0), test_utils::DECIBEL_ERROR);
+    _module_under_test.remove(processor.id());
+}
+
+TEST_F(TrackTest, TestFrozenPlaybackFollowsTransport)
+{
+    ChunkCountingProcessor processor(_host_control.make_host_control_mockup());
+    _module_under_test.add(&processor);
+    auto& transport = _host_control._transport;
+    transport.set_playing_mode(PlayingMode::PLAYING, false);
+    transport.set_time(Time(0), 0);
+    int64_t samples = AUDIO_CHUNK_SIZE;
+    transport.set_time(Time(0), samples);
+
+    // Frozen while playing, playback should pick up at the current transport position
+    ASSERT_TRUE(_module_under_test.freeze(6));
+    samples += AUDIO_CHUNK_SIZE;
+    transport.set_time(Time(0), samples);
+    _module_under_test.render();
+    test_utils::assert_buffer_value(3.0f, _module_under_test.output_bus(0), test_utils::DECIBEL_ERROR);
+
+    // Seeking forward and back while playing should jump in the frozen audio as well
+    samples += 3 * AUDIO_CHUNK_SIZE;
+    transport.set_time(Time(0), samples);
+    _module_under_test.render();
+    test_utils::assert_buffer_value(6.0f, _module_under_test.output_bus(0), test_utils::DECIBEL_ERROR);
+
+    samples -= 4 * AUDIO_CHUNK_SIZE;
+    transport.set_time(Time(0), samples);
+    _module_under_test.render();
+    test_utils::assert_buffer_value(2.0f, _module_under_test.output_bus(0), test_utils::DECIBEL_ERROR);
+
+    // And carry on from there
+    for (float expected : {3.0f, 4.0f})
+    {
+        samples += AUDIO_CHUNK_SIZE;
+        transport.set_time(Time(0), samples);
+        _module_under_test.render();
+        test_utils::assert_buffer_value(expected, _module_under_test.output_bus(0), test_utils::DECIBEL_ERROR);
+    }
+
+    // Seeking past the end of the audio is silent
+    samples += 10 * AUDIO_CHUNK_SIZE;
+    transport.set_time(Time(0), samples);
+    _module_under_test.render();
+    test_utils::assert_buffer_value(0.0f, _module_under_test.output_bus(0), test_utils::DECIBEL_ERROR);
+    EXPECT_EQ(6, processor.chunks);
+
+    _module_under_test.unfreeze();
+    _module_under_test.remove(processor.id());
+}
+
+TEST_F(TrackTest, TestCompensationDelay)
+{
+    ChunkCountingProcessor processor(_host_control.make_host_control_mockup());
+    _module_under_test.add(&processor);
+    StorageSwap swap;
+    _module_under_test.set_compensation_delay(swap, AUDIO_CHUNK_SIZE);
+    swap.swap_rt();
+    EXPECT_EQ(AUDIO_CHUNK_SIZE, _module_under_test.compensation_delay());
+
+    // Delayed a whole chunk
+    for (float expected : {0.0f, 1.0f, 2.0f})
+    {
+        _module_under_test.render();
+        test_utils::assert_buffer_value(expected, _module_under_test.output_bus(0), test_utils::DECIBEL_ERROR);
+    }
+
+    // Delays shorter than a chunk should work too, and the delay line starts out silent
+    StorageSwap short_swap;
+    _module_under_test.set_compensation_delay(short_swap, 1);
+    short_swap.swap_rt();
+    _module_under_test.render();
+    auto output = _module_under_test.output_bus(0);
+    EXPECT_FLOAT_EQ(0.0f, output.channel(0)[0]);
+    EXPECT_FLOAT_EQ(4.0f, output.channel(0)[1]);
+    _module_under_test.render();
+    EXPECT_FLOAT_EQ(4.0f, output.channel(1)[0]);
+    EXPECT_FLOAT_EQ(5.0f, output.channel(1)[AUDIO_CHUNK_SIZE - 1]);
+    _module_under_test.remove(processor.id());
+}
+
+TEST_F(TrackTest, TestShedding)
+{
+    ChunkCountingProcessor processor(_host_control.make_host_control_mockup());
+    _module_under_test.add(&processor);
+    _module_under_test.set_priority(-1);
+    EXPECT_EQ(-1, _module_under_test.priority());
+
+    // The output should fade out over one chunk, after which the track is not rendered
+    _module_under_test.set_shed(true);
+    _module_under_test.render();
+    auto output = _module_under_test.output_bus(0);
+    EXPECT_FLOAT_EQ(1.0f, output.channel(0)[0]);
+    EXPECT_FLOAT_EQ(0.0f, output.channel(0)[AUDIO_CHUNK_SIZE - 1]);
+    EXPECT_FALSE(_module_under_test.independent_buses());
+    _module_under_test.render();
+    test_utils::assert_buffer_value(0.0f, output, test_utils::DECIBEL_ERROR);
+    EXPECT_EQ(1, processor.chunks);
+
+    // And fade in again when no longer shed
+    _module_under_test.set_shed(false);
+    _module_under_test.render();
+    EXPECT_EQ(2, processor.chunks);
+    EXPECT_FLOAT_EQ(0.0f, output.channel(1)[0]);
+    EXPECT_FLOAT_EQ(2.0f, output.channel(1)[AUDIO_CHUNK_SIZE - 1]);
+    _module_under_test.render();
+    test_utils::assert_buffer_value(3.0f, output, test_utils::DECIBEL_ERROR);
+    _module_under_test.remove(processor.id());
+}
+
+TEST_F(TrackTest, TestStalled)
+{
+    ChunkSampleBuffer buffer(TEST_CHANNEL_COUNT);
+    test_utils::fill_sample_buffer(buffer, 1.0f);
+    auto output = _module_under_test.output_bus(0);
+    test_utils::fill_sample_buffer(output, 2.0f);
+
+    // A stalled track should add nothing when mixed, and silence when replacing
+    _module_under_test.set_stalled(true);
+    EXPECT_TRUE(_module_under_test.stalled());
+    _module_under_test.mix_output_channel(0, buffer, 0, false);
+    _module_under_test.mix_output_channel(1, buffer, 1, true);
+    EXPECT_FLOAT_EQ(1.0f, buffer.channel(0)[0]);
+    EXPECT_FLOAT_EQ(0.0f, buffer.channel(1)[0]);
+
+    _module_under_test.set_stalled(false);
+    _module_under_test.mix_output_channel(0, buffer, 0, false);
+    EXPECT_FLOAT_EQ(3.0f, buffer.channel(0)[0]);
+}
+
+TEST_F(TrackTest, TestRenderAhead)
+{
+    ChunkCountingProcessor processor(_host_control.make_host_control_mockup());
+    _module_under_test.add(&processor);
+    {
+        RenderAheadHost host({&processor}, TEST_CHANNEL_COUNT, 2, &_host_control._transport, TEST_SAMPLE_RATE, &_timer);
+        EXPECT_EQ(&host._transport, processor.transport());
+        EXPECT_TRUE(host.hosts(processor.id()));
+        ASSERT_TRUE(_module_under_test.set_render_ahead_host(&host));
+        EXPECT_FALSE(_module_under_test.freeze(1));
+
+        // Nothing is rendered before the rt thread has handed the host the transport
+        _module_under_test.render();
+        test_utils::assert_buffer_value(0.0f, _module_under_test.output_bus(0));
+
+        // The track should play back the chunks rendered by the host, in order
+        for (float expected : {1.0f, 2.0f, 3.0f})
+        {
+            while (host._written.load() - host._read.load() < 2)
+            {
+                std::this_thread::yield();
+            }
+            _module_under_test.render();
+            test_utils::assert_buffer_value(expected, _module_under_test.output_bus(0), test_utils::DECIBEL_ERROR);
+        }
+        EXPECT_EQ(0, host.underruns());
+
+        ASSERT_TRUE(_module_under_test.set_render_ahead_host(nullptr));
+    }
+    EXPECT_EQ(&_host_control._transport, processor.transport());
+    int rendered = processor.chunks;
+    _module_under_test.render();
+    test_utils::assert_buffer_value(static_cast<float>(rendered + 1), _module_under_test.output_bus(0), test_utils::DECIBEL_ERROR);
+    _module_under_test.remove(processor.id());
+}
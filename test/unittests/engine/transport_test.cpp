@@ -97,6 +97,38 @@ TEST_F(TestTransport, TestTimeline44Time)
     EXPECT_DOUBLE_EQ(4.0, _module_under_test.current_bar_start_beats());
 }
 
+TEST_F(TestTransport, TestSetAheadOf)
+{
+    constexpr int TEST_SAMPLERATE_X2 = 32768;
+    _module_under_test.set_sample_rate(TEST_SAMPLERATE_X2);
+    _module_under_test.set_time_signature({4, 4}, false);
+    _module_under_test.set_tempo(120, false);
+    _module_under_test.set_playing_mode(PlayingMode::PLAYING, false);
+    _module_under_test.set_time(std::chrono::seconds(0), 0);
+    _module_under_test.set_time(std::chrono::seconds(1), TEST_SAMPLERATE_X2);
+
+    /* 1.5 seconds ahead, equal to 3/4 bar at 120 bpm, should be in the next bar */
+    RtEventFifo<10> ahead_event_output;
+    Transport ahead(TEST_SAMPLERATE, &ahead_event_output);
+    ahead.set_ahead_of(_module_under_test.snapshot(), 3 * TEST_SAMPLERATE_X2 / 2);
+    EXPECT_TRUE(ahead.playing());
+    EXPECT_FLOAT_EQ(120, ahead.current_tempo());
+    EXPECT_EQ(5 * TEST_SAMPLERATE_X2 / 2, ahead.current_samples());
+    EXPECT_EQ(std::chrono::milliseconds(2500), ahead.current_process_time());
+    EXPECT_DOUBLE_EQ(1.0, ahead.current_bar_beats());
+    EXPECT_DOUBLE_EQ(5.0, ahead.current_beats());
+    EXPECT_DOUBLE_EQ(4.0, ahead.current_bar_start_beats());
+    EXPECT_TRUE(ahead_event_output.empty());
+
+    /* Stopped transports don't move */
+    _module_under_test.set_playing_mode(PlayingMode::STOPPED, false);
+    _module_under_test.set_time(std::chrono::seconds(2), 2 * TEST_SAMPLERATE_X2);
+    ahead.set_ahead_of(_module_under_test.snapshot(), TEST_SAMPLERATE_X2);
+    EXPECT_FALSE(ahead.playing());
+    EXPECT_EQ(PlayStateChange::STOPPING, ahead.current_state_change());
+    EXPECT_DOUBLE_EQ(_module_under_test.current_beats(), ahead.current_beats());
+}
+
 TEST_F(TestTransport, TestTimeline68Time)
 {
     /* Test the above but with different time signature and samplerate */
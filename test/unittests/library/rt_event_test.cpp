@@ -129,6 +129,14 @@ TEST (TestRealtimeEvents, TestFactoryFunction)
     EXPECT_EQ(123u, event.processor_reorder_event()->processor());
     EXPECT_EQ(456u, event.processor_reorder_event()->track());
 
+    event = RtEvent::make_processor_bus_event(ObjectId(123), ObjectId(456), 3);
+    EXPECT_EQ(RtEventType::SET_PROCESSOR_BUS, event.type());
+    EXPECT_EQ(123u, event.processor_bus_event()->processor());
+    EXPECT_EQ(456u, event.processor_bus_event()->track());
+    EXPECT_EQ(3, event.processor_bus_event()->bus().value_or(-1));
+    event = RtEvent::make_processor_bus_event(ObjectId(123), ObjectId(456), std::nullopt);
+    EXPECT_FALSE(event.processor_bus_event()->bus().has_value());
+
     event = RtEvent::make_tempo_event(25, 130);
     EXPECT_EQ(RtEventType::TEMPO, event.type());
     EXPECT_EQ(25, event.tempo_event()->sample_offset());
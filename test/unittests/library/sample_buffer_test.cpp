@@ -338,6 +338,14 @@ TEST (TestSampleBuffer, TestAddWithGain)
         ASSERT_FLOAT_EQ(7.0f, buffer.channel(0)[n]);
         ASSERT_FLOAT_EQ(6.0f, buffer.channel(1)[n]);
     }
+
+    // Test single channel replacing with gain
+    buffer.replace_with_gain(0, 1, buffer_2, 0.5f);
+    for (unsigned int n = 0; n < AUDIO_CHUNK_SIZE; ++n)
+    {
+        ASSERT_FLOAT_EQ(0.5f, buffer.channel(0)[n]);
+        ASSERT_FLOAT_EQ(6.0f, buffer.channel(1)[n]);
+    }
 }
 
 TEST (TestSampleBuffer, TestRamping)
@@ -374,20 +382,20 @@ TEST (TestSampleBuffer, TestAddWithRamp)
         buffer.channel(0)[i] = 1.0f;
         buffer.channel(1)[i] = 1.0f;
         buffer_2.channel(0)[i] = 1.0f;
-        buffer_2.channel(1)[i] = 1.0f;
+        buffer_2.channel(1)[i] = 2.0f;
     }
 
     // Test buffers with equal channel count
     buffer.add_with_ramp(buffer_2, 0.5f, 1.0f);
 
     ASSERT_FLOAT_EQ(1.5f, buffer.channel(0)[0]);
-    ASSERT_FLOAT_EQ(1.5f, buffer.channel(1)[0]);
+    ASSERT_FLOAT_EQ(2.0f, buffer.channel(1)[0]);
 
     ASSERT_NEAR(1.75f, buffer.channel(0)[AUDIO_CHUNK_SIZE / 2 - 1], 0.05f);
-    ASSERT_NEAR(1.75f, buffer.channel(1)[AUDIO_CHUNK_SIZE / 2 - 1], 0.05f);
+    ASSERT_NEAR(2.5f, buffer.channel(1)[AUDIO_CHUNK_SIZE / 2 - 1], 0.05f);
 
     ASSERT_FLOAT_EQ(2.0f, buffer.channel(0)[AUDIO_CHUNK_SIZE - 1]);
-    ASSERT_FLOAT_EQ(2.0f, buffer.channel(1)[AUDIO_CHUNK_SIZE - 1]);
+    ASSERT_FLOAT_EQ(3.0f, buffer.channel(1)[AUDIO_CHUNK_SIZE - 1]);
 
     // Test adding mono buffer to stereo buffer with ramp
     SampleBuffer<AUDIO_CHUNK_SIZE> mono_buffer(1);
@@ -411,6 +419,14 @@ TEST (TestSampleBuffer, TestAddWithRamp)
 
     ASSERT_FLOAT_EQ(3.0f, buffer.channel(0)[AUDIO_CHUNK_SIZE - 1]);
     ASSERT_FLOAT_EQ(3.0f, buffer.channel(1)[AUDIO_CHUNK_SIZE - 1]);
+
+    // Test single channel replacing with ramp
+    buffer.replace_with_ramp(1, 0, mono_buffer, 1.0f, 0.0f);
+
+    ASSERT_FLOAT_EQ(2.0f, buffer.channel(0)[0]);
+    ASSERT_FLOAT_EQ(1.0f, buffer.channel(1)[0]);
+    ASSERT_FLOAT_EQ(3.0f, buffer.channel(0)[AUDIO_CHUNK_SIZE - 1]);
+    ASSERT_FLOAT_EQ(0.0f, buffer.channel(1)[AUDIO_CHUNK_SIZE - 1]);
 }
 
 TEST (TestSampleBuffer, TestCountClippedSamples)
@@ -437,6 +453,21 @@ TEST (TestSampleBuffer, TestPeakCalculation)
     EXPECT_FLOAT_EQ(1.5, buffer.calc_peak_value(1));
 }
 
+TEST (TestSampleBuffer, TestSilenceDetection)
+{
+    SampleBuffer<AUDIO_CHUNK_SIZE> buffer(2);
+    EXPECT_TRUE(buffer.is_silent());
+
+    buffer.channel(1)[3] = SILENCE_THRESHOLD / 2;
+    EXPECT_TRUE(buffer.is_silent());
+    buffer.channel(1)[AUDIO_CHUNK_SIZE - 1] = -0.1f;
+    EXPECT_FALSE(buffer.is_silent());
+
+    // Only the channels of non-owning buffers should be checked
+    auto channel_0 = SampleBuffer<AUDIO_CHUNK_SIZE>::create_non_owning_buffer(buffer, 0, 1);
+    EXPECT_TRUE(channel_0.is_silent());
+}
+
 TEST (TestSampleBuffer, TestRMSCalculation)
 {
     SampleBuffer<AUDIO_CHUNK_SIZE> buffer(2);
@@ -452,3 +483,51 @@ TEST (TestSampleBuffer, TestRMSCalculation)
     EXPECT_FLOAT_EQ(1, buffer.calc_rms_value(0));
     EXPECT_NEAR(1.0f / std::sqrt(2), buffer.calc_rms_value(1), 0.01);
 }
+
+TEST(TestSampleBuffer, TestSimdKernels)
+{
+    // Odd lengths and offsets give unaligned arrays with samples left over after the vector loops
+    constexpr int MAX_SAMPLES = 67;
+    std::array<float, MAX_SAMPLES + 1> source;
+    std::array<float, MAX_SAMPLES + 1> expected;
+    std::array<float, MAX_SAMPLES + 1> result;
+    for (int i = 0; i < static_cast<int>(source.size()); ++i)
+    {
+        source[i] = std::sin(0.7f * i);
+    }
+    auto scalar = simd::kernels(simd::SimdLevel::SCALAR);
+    ASSERT_NE(nullptr, scalar);
+    ASSERT_NE(nullptr, simd::kernels(simd::active_level()));
+    EXPECT_EQ(simd::kernels(simd::active_level()), simd::active_kernels);
+
+    for (auto level : {simd::SimdLevel::SSE, simd::SimdLevel::AVX2, simd::SimdLevel::AVX512, simd::SimdLevel::NEON})
+    {
+        auto kernels = simd::kernels(level);
+        if (kernels == nullptr)
+        {
+            continue;
+        }
+        SCOPED_TRACE(simd::to_string(level));
+        for (int samples : {1, 4, 15, 16, 33, MAX_SAMPLES})
+        {
+            auto compare = [&](auto&& function)
+            {
+                std::fill(expected.begin(), expected.end(), 0.5f);
+                std::fill(result.begin(), result.end(), 0.5f);
+                function(*scalar, expected.data() + 1);
+                function(*kernels, result.data() + 1);
+                for (size_t i = 0; i < result.size(); ++i)
+                {
+                    ASSERT_NEAR(expected[i], result[i], 1.0e-6f) << samples << " samples, index " << i;
+                }
+            };
+            compare([&](auto& k, float* dest) {k.apply_gain(dest, 0.3f, samples);});
+            compare([&](auto& k, float* dest) {k.ramp(dest, 1.0f, -0.01f, samples);});
+            compare([&](auto& k, float* dest) {k.add(dest, source.data(), samples);});
+            compare([&](auto& k, float* dest) {k.add_with_gain(dest, source.data(), 0.3f, samples);});
+            compare([&](auto& k, float* dest) {k.add_with_ramp(dest, source.data(), 0.2f, 0.015f, samples);});
+            compare([&](auto& k, float* dest) {k.replace_with_gain(dest, source.data(), -2.0f, samples);});
+            compare([&](auto& k, float* dest) {k.replace_with_ramp(dest, source.data(), 1.0f, -0.015f, samples);});
+        }
+    }
+}
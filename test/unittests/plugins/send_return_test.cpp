@@ -107,8 +107,7 @@ TEST_F(TestSendReturnPlugins, TestProcessing)
     _send_instance.process_audio(buffer_1, buffer_2);
     buffer_2.clear();
 
-    // Swap manually and verify that signal is returned
-    _return_instance._swap_buffers();
+    // Verify that signal is returned within the same chunk
     _return_instance.process_audio(buffer_1, buffer_2);
     test_utils::assert_buffer_value(1.0f, buffer_2);
 }
@@ -129,15 +128,23 @@ TEST_F(TestSendReturnPlugins, TestMultipleSends)
     send_instance_2.process_audio(buffer_1, buffer_2);
     buffer_2.clear();
 
-    // Call process on the return, the buffers should not be swapped so output should be 0
+    // Call process on the return, we should read both sends on the output
     _return_instance.process_audio(buffer_1, buffer_2);
-    test_utils::assert_buffer_value(0.0f, buffer_2);
+    test_utils::assert_buffer_value(2.0f, buffer_2);
 
-    // Fast forward time and call process again, buffers should now be swapped and we should
-    // read both sends on the output
+    // Audio sent after the return was processed should be output in the next chunk
+    _send_instance.process_audio(buffer_1, buffer_2);
     _host_control_mockup._transport.set_time(Time(10), AUDIO_CHUNK_SIZE);
     _return_instance.process_audio(buffer_1, buffer_2);
-    test_utils::assert_buffer_value(2.0f, buffer_2);
+    test_utils::assert_buffer_value(1.0f, buffer_2);
+
+    // If the return is not processed, sent audio should not accumulate over several chunks
+    _host_control_mockup._transport.set_time(Time(20), AUDIO_CHUNK_SIZE * 2);
+    _send_instance.process_audio(buffer_1, buffer_2);
+    _host_control_mockup._transport.set_time(Time(30), AUDIO_CHUNK_SIZE * 3);
+    _send_instance.process_audio(buffer_1, buffer_2);
+    _return_instance.process_audio(buffer_1, buffer_2);
+    test_utils::assert_buffer_value(1.0f, buffer_2);
 }
 
 TEST_F(TestSendReturnPlugins, TestSelectiveChannelSending)
@@ -161,8 +168,7 @@ TEST_F(TestSendReturnPlugins, TestSelectiveChannelSending)
     _send_instance.process_event(event);
     _send_instance.process_audio(buffer_1, buffer_1);
 
-    // Swap manually and verify that signal only the first channel was sent
-    _return_instance._swap_buffers();
+    // Verify that signal only the first channel was sent
     _return_instance.process_audio(buffer_1, buffer_2);
     EXPECT_FLOAT_EQ(1.0f, buffer_2.channel(0)[0]);
     EXPECT_FLOAT_EQ(0.0f, buffer_2.channel(1)[0]);
@@ -173,8 +179,7 @@ TEST_F(TestSendReturnPlugins, TestSelectiveChannelSending)
     _send_instance.process_event(event);
     _send_instance.process_audio(buffer_1, buffer_1);
 
-    // Swap manually and verify that signal only the first channel was sent to channel 2
-    _return_instance._swap_buffers();
+    // Verify that signal only the first channel was sent to channel 2
     _return_instance.process_audio(buffer_1, buffer_2);
     EXPECT_FLOAT_EQ(0.0f, buffer_2.channel(0)[0]);
     EXPECT_FLOAT_EQ(1.0f, buffer_2.channel(1)[0]);
@@ -185,7 +190,6 @@ TEST_F(TestSendReturnPlugins, TestSelectiveChannelSending)
     _send_instance.process_audio(buffer_1, buffer_1);
 
     // Both return channels should be 0
-    _return_instance._swap_buffers();
     _return_instance.process_audio(buffer_1, buffer_2);
     EXPECT_FLOAT_EQ(0.0f, buffer_2.channel(0)[0]);
     EXPECT_FLOAT_EQ(0.0f, buffer_2.channel(1)[0]);
@@ -210,7 +214,6 @@ TEST_F(TestSendReturnPlugins, TestSelectiveChannelSending)
     buffer_1 = ChunkSampleBuffer(4);
     buffer_2 = ChunkSampleBuffer(4);
 
-    _return_instance._swap_buffers();
     _return_instance.process_audio(buffer_1, buffer_2);
     EXPECT_FLOAT_EQ(0.0f, buffer_2.channel(0)[0]);
     EXPECT_FLOAT_EQ(0.0f, buffer_2.channel(1)[0]);
@@ -226,19 +229,16 @@ TEST_F(TestSendReturnPlugins, TestRampedProcessing)
 
     // Test only ramping
     _return_instance.send_audio_with_ramp(buffer_1, 0, 2.0f, 0.0f);
-    _return_instance._swap_buffers();
     _return_instance.process_audio(buffer_1, buffer_2);
     EXPECT_NEAR(2.0f, buffer_2.channel(0)[0], 0.01);
     EXPECT_NEAR(1.0f, buffer_2.channel(0)[AUDIO_CHUNK_SIZE / 2], 0.1);
     EXPECT_NEAR(0.0f, buffer_2.channel(0)[AUDIO_CHUNK_SIZE - 1], 0.01);
-    _return_instance._swap_buffers();
 
     // Test parameter smoothing
     _send_instance._set_destination(&_return_instance);
     auto event = RtEvent::make_parameter_change_event(0, 0, 0, 0.0f);
     _send_instance.process_event(event);
     _send_instance.process_audio(buffer_1, buffer_2);
-    _return_instance._swap_buffers();
     _return_instance.process_audio(buffer_1, buffer_2);
 
     // Audio should now begin to ramp down
@@ -174,6 +174,16 @@ public:
         return {_return_status, DEFAULT_TIMINGS};
     }
 
+    std::pair<ControlStatus, std::vector<PipelineStageTimings>> get_track_pipeline_timings(int /*track_id*/) const override
+    {
+        return {_return_status, {}};
+    }
+
+    std::pair<ControlStatus, CpuLoadPrediction> get_plugin_load_prediction(const std::string& /*uid*/, int /*track_id*/) const override
+    {
+        return {_return_status, {0, 0.0f, 0.0f, false, 0.0f, std::nullopt, true}};
+    }
+
     ControlStatus reset_all_timings() override
     {
         _recently_called = true;
@@ -324,36 +334,40 @@ public:
         return _return_status;
     }
 
-    ControlStatus create_track(const std::string& name, int channels) override
+    ControlStatus create_track(const std::string& name, int channels, std::optional<int> transaction_id) override
     {
         _args_from_last_call.clear();
         _args_from_last_call["name"] = name;
         _args_from_last_call["channels"] = std::to_string(channels);
+        _args_from_last_call["transaction_id"] = std::to_string(transaction_id.value_or(-1));
         _recently_called = true;
         return _return_status;
     }
 
-    ControlStatus create_multibus_track(const std::string& name, int buses) override
+    ControlStatus create_multibus_track(const std::string& name, int buses, std::optional<int> transaction_id) override
     {
         _args_from_last_call.clear();
         _args_from_last_call["name"] = name;
         _args_from_last_call["buses"] = std::to_string(buses);
+        _args_from_last_call["transaction_id"] = std::to_string(transaction_id.value_or(-1));
         _recently_called = true;
         return _return_status;
     }
 
-    ControlStatus create_pre_track(const std::string& name) override
+    ControlStatus create_pre_track(const std::string& name, std::optional<int> transaction_id) override
     {
         _args_from_last_call.clear();
         _args_from_last_call["name"] = name;
+        _args_from_last_call["transaction_id"] = std::to_string(transaction_id.value_or(-1));
         _recently_called = true;
         return _return_status;
     }
 
-    ControlStatus create_post_track(const std::string& name) override
+    ControlStatus create_post_track(const std::string& name, std::optional<int> transaction_id) override
     {
         _args_from_last_call.clear();
         _args_from_last_call["name"] = name;
+        _args_from_last_call["transaction_id"] = std::to_string(transaction_id.value_or(-1));
         _recently_called = true;
         return _return_status;
     }
@@ -362,13 +376,15 @@ public:
     ControlStatus move_processor_on_track(int processor_id,
                                           int source_track_id,
                                           int dest_track_id,
-                                          std::optional<int> before_processor_id) override
+                                          std::optional<int> before_processor_id,
+                                          std::optional<int> transaction_id) override
     {
         _args_from_last_call.clear();
         _args_from_last_call["processor_id"] = std::to_string(processor_id);
         _args_from_last_call["source_track_id"] = std::to_string(source_track_id);
         _args_from_last_call["dest_track_id"] = std::to_string(dest_track_id);
         _args_from_last_call["before_processor_id"] = std::to_string(before_processor_id.value_or(-1));
+        _args_from_last_call["transaction_id"] = std::to_string(transaction_id.value_or(-1));
         _recently_called = true;
         return _return_status;
     }
@@ -378,7 +394,8 @@ public:
                                             const std::string& file,
                                             PluginType type,
                                             int track_id,
-                                            std::optional<int> before_processor_id) override
+                                            std::optional<int> before_processor_id,
+                                            std::optional<int> transaction_id) override
     {
         _args_from_last_call.clear();
         _args_from_last_call["name"] = name;
@@ -387,23 +404,58 @@ public:
         _args_from_last_call["type"] = std::to_string(static_cast<int>(type));
         _args_from_last_call["track_id"] = std::to_string(track_id);
         _args_from_last_call["before_processor_id"] = std::to_string(before_processor_id.value_or(-1));
+        _args_from_last_call["transaction_id"] = std::to_string(transaction_id.value_or(-1));
         _recently_called = true;
         return _return_status;
     }
 
-    ControlStatus delete_processor_from_track(int processor_id, int track_id) override
+    ControlStatus delete_processor_from_track(int processor_id, int track_id, std::optional<int> transaction_id) override
     {
         _args_from_last_call.clear();
         _args_from_last_call["processor_id"] = std::to_string(processor_id);
         _args_from_last_call["track_id"] = std::to_string(track_id);
+        _args_from_last_call["transaction_id"] = std::to_string(transaction_id.value_or(-1));
         _recently_called = true;
         return _return_status;
     }
 
-    ControlStatus delete_track(int track_id) override
+    ControlStatus delete_track(int track_id, std::optional<int> transaction_id) override
     {
         _args_from_last_call.clear();
         _args_from_last_call["track_id"] = std::to_string(track_id);
+        _args_from_last_call["transaction_id"] = std::to_string(transaction_id.value_or(-1));
+        _recently_called = true;
+        return _return_status;
+    }
+
+    ControlStatus pin_track_to_core(int track_id, std::optional<int> core) override
+    {
+        _args_from_last_call.clear();
+        _args_from_last_call["track_id"] = std::to_string(track_id);
+        _args_from_last_call["core"] = std::to_string(core.value_or(-1));
+        _recently_called = true;
+        return _return_status;
+    }
+
+    std::pair<ControlStatus, int> begin_transaction() override
+    {
+        _args_from_last_call.clear();
+        _recently_called = true;
+        return {_return_status, 1};
+    }
+
+    ControlStatus commit_transaction(int transaction_id) override
+    {
+        _args_from_last_call.clear();
+        _args_from_last_call["transaction_id"] = std::to_string(transaction_id);
+        _recently_called = true;
+        return _return_status;
+    }
+
+    ControlStatus abort_transaction(int transaction_id) override
+    {
+        _args_from_last_call.clear();
+        _args_from_last_call["transaction_id"] = std::to_string(transaction_id);
         _recently_called = true;
         return _return_status;
     }